@@ -85,6 +85,10 @@ static void print_sensor_data(struct bme280_data *comp_data);
 /******************************************************
  *               Variable Definitions
  ******************************************************/
+static struct bme280_shadow bme280_shadow;
+static bme280_wiced_intf_t bme280_intf;
+static bme280_wiced_meas_t one_shot_meas;
+static wiced_event_flags_t meas_events;
 
 /******************************************************
  *               Function Definitions
@@ -95,20 +99,24 @@ void application_start( )
 	wiced_result_t wres;
 	int8_t bme_rslt;
 
-	struct bme280_dev dev_bme280;
+	struct bme280_dev dev_bme280 = { 0 };
 	struct bme280_data comp_data;
 	uint8_t settings_sel;
 	uint16_t typ_meas_time;
+	uint32_t events;
 
     /* Initialise the WICED device */
     wiced_init();
 
     WPRINT_APP_INFO( ( "--- BME280 Temperature, Humidity, and Pressure Sensor Snippet ---\n" ) );
 
+    /* Answer control register reads from the shadow instead of the bus */
+    dev_bme280.shadow = &bme280_shadow;
+
 #ifndef BME280_USE_SPI
-    wres = bme280_wiced_init_i2c(&dev_bme280, BME280_I2C, BME280_I2C_ADDR_PRIM);
+    wres = bme280_wiced_init_i2c(&dev_bme280, &bme280_intf, BME280_I2C, BME280_I2C_ADDR_PRIM);
 #else
-    wres = bme280_wiced_init_spi(&dev_bme280, BME280_SPI, BME280_SPI_CS);
+    wres = bme280_wiced_init_spi(&dev_bme280, &bme280_intf, BME280_SPI, BME280_SPI_CS);
 #endif
 
 	if(wres != WICED_SUCCESS){
@@ -130,18 +138,30 @@ void application_start( )
 		WPRINT_APP_INFO(("Error %d while configuring BME280!\n", bme_rslt));
 	}
 
+	WPRINT_APP_INFO(("Bus reads saved by the register shadow: %lu\n", (unsigned long)bme280_shadow.reads_saved));
+
 	typ_meas_time = bme280_wiced_get_meas_time(&dev_bme280);
 	WPRINT_APP_INFO(("Typical measurement time for current settings: %ums\n", (unsigned)typ_meas_time));
 
-	/* One-shot read of temperature, humidity, and pressure */
-	if((bme_rslt = bme280_set_sensor_mode(BME280_FORCED_MODE, &dev_bme280)) == BME280_OK){
-		wiced_rtos_delay_milliseconds(typ_meas_time);
-		bme280_get_sensor_data(BME280_ALL, &comp_data, &dev_bme280);
-		WPRINT_APP_INFO(("One-Shot Forced Measurement: "));
-		print_sensor_data(&comp_data);
+	/* One-shot read of temperature, humidity, and pressure. The measurement runs on the
+	 * hardware IO worker thread and completes as soon as the sensor clears its measuring bit. */
+	wiced_rtos_init_event_flags(&meas_events);
+	one_shot_meas.event_flags = &meas_events;
+	one_shot_meas.event_flag = BME280_WICED_MEAS_DONE_EVENT;
+	if((wres = bme280_wiced_measure_async(&one_shot_meas, &dev_bme280, BME280_ALL)) == WICED_SUCCESS){
+		/* This thread is free to do other work here; the snippet just waits for the result */
+		wiced_rtos_wait_for_event_flags(&meas_events, BME280_WICED_MEAS_DONE_EVENT, &events,
+				WICED_TRUE, WAIT_FOR_ANY_EVENT, WICED_WAIT_FOREVER);
+		if(one_shot_meas.result == WICED_SUCCESS){
+			WPRINT_APP_INFO(("One-Shot Forced Measurement: "));
+			print_sensor_data(&one_shot_meas.data);
+		}
+		else{
+			WPRINT_APP_INFO(("Error %u during BME280 forced measurement!\n", (unsigned)one_shot_meas.result));
+		}
 	}
 	else{
-		WPRINT_APP_INFO(("Error %d setting BME280 sensor mode!\n", bme_rslt));
+		WPRINT_APP_INFO(("Error %u starting BME280 forced measurement!\n", (unsigned)wres));
 	}
 
 	/* Start periodic measurements */
@@ -41,29 +41,152 @@
 #include "wiced.h"
 #include "bme280.h"
 
-#define BME280_I2C_DISABLE_DMA (WICED_FALSE)
+/* disable_dma argument of the wiced_i2c_init_*_message() calls of the CPU driven transfers */
+#define BME280_I2C_DISABLE_DMA (WICED_TRUE)
 
 /**
- * Initialize the BME280 with I2C communications.
+ * Transfers shorter than this stay CPU driven in BME280_WICED_XFER_DMA mode: setting up the DMA
+ * streams costs more than clocking a few bytes. The burst data read (8 bytes) and the calibration
+ * reads (26 and 7 bytes) qualify, single register accesses do not.
+ */
+#define BME280_WICED_DMA_MIN_LEN (7)
+
+/**
+ * Number of BME280 devices the wrapper can drive at the same time, e.g. two sensors (primary and
+ * secondary address) on each mikroBUS port.
+ */
+#define BME280_WICED_MAX_DEVICES (4)
+
+/**
+ * Size of the transport scratch buffer: the longest I2C register write, register address included.
+ * The driver writes one register at a time (two bytes); longer writes fail with BME280_E_INVALID_LEN.
+ */
+#define BME280_WICED_XFER_BUF_LEN (32)
+
+/**
+ * Event flag conventionally used to signal a completed asynchronous measurement.
+ */
+#define BME280_WICED_MEAS_DONE_EVENT (1 << 0)
+
+/**
+ * Interval between status register polls once the typical measurement time has elapsed.
+ */
+#define BME280_WICED_MEAS_POLL_MS (1)
+
+/**
+ * How the register transfers move data between the bus and memory.
+ */
+typedef enum
+{
+    BME280_WICED_XFER_POLLED, /**< The CPU moves every byte (default) */
+    BME280_WICED_XFER_DMA,    /**< DMA moves the longer transfers, see BME280_WICED_DMA_MIN_LEN */
+} bme280_wiced_xfer_mode_t;
+
+/**
+ * Transport context of one BME280, owned by the caller and managed by the wrapper. The init functions
+ * enter it into the wrapper's device table and set bme280_dev.id to its slot, which is how the bus
+ * callbacks find it. It must stay valid until bme280_wiced_deinit() and, for the DMA mode, must not
+ * be placed in CCM RAM (declare it static or global, not on a thread stack).
+ */
+typedef struct
+{
+    wiced_i2c_device_t       i2c;
+    wiced_spi_device_t       spi;
+    uint8_t                  interface;  /**< BME280_I2C_INTF or BME280_SPI_INTF */
+    bme280_wiced_xfer_mode_t xfer_mode;
+    uint8_t                  xfer_buffer[BME280_WICED_XFER_BUF_LEN] __attribute__((aligned(4))); /**< I2C write scratch, DMA staging */
+} bme280_wiced_intf_t;
+
+/**
+ * Completion callback of an asynchronous measurement, called on the hardware IO worker thread.
+ *
+ * @param[in] result : WICED_SUCCESS, WICED_TIMEOUT if the sensor kept converting past the datasheet
+ *                     maximum, WICED_ERROR on a bus error
+ * @param[in] data   : The compensated data, valid for WICED_SUCCESS
+ * @param[in] arg    : The callback_arg of the measurement
+ */
+typedef void (*bme280_wiced_meas_callback_t)(wiced_result_t result, const struct bme280_data *data, void *arg);
+
+/**
+ * State of an asynchronous forced mode measurement. It must be zero-initialised before its first use;
+ * the caller sets the completion fields and the wrapper owns the rest.
+ */
+typedef struct
+{
+    /* Completion, set by the caller */
+    bme280_wiced_meas_callback_t callback;      /**< Called on completion, may be NULL */
+    void*                        callback_arg;  /**< Handed to callback */
+    wiced_event_flags_t*         event_flags;   /**< Set on completion, may be NULL */
+    uint32_t                     event_flag;    /**< Flags set in event_flags */
+
+    /* Outcome, valid once busy is cleared */
+    wiced_result_t               result;
+    struct bme280_data           data;
+
+    /* Internal */
+    struct bme280_dev*           dev;
+    uint8_t                      sensor_comp;
+    volatile wiced_bool_t        busy;
+    wiced_bool_t                 poll_registered;
+    uint32_t                     poll_ms;
+    wiced_time_t                 start_time;
+    uint32_t                     first_poll_ms;
+    uint32_t                     timeout_ms;
+    wiced_timed_event_t          poll_event;
+} bme280_wiced_meas_t;
+
+/**
+ * Initialize the BME280 with I2C communications. Several sensors may share a port as long as their
+ * addresses differ.
  *
  * @param[in] dev      : The BME280 device
+ * @param[in] intf     : The transport context of the device
  * @param[in] i2c_port : The I2C port to use for the device
  * @param[in] i2c_addr : The I2C address to use for the device
  *
- * @return @ref wiced_result_t
+ * @return @ref wiced_result_t, WICED_ERROR also when BME280_WICED_MAX_DEVICES devices are in use
  */
-wiced_result_t bme280_wiced_init_i2c(struct bme280_dev *dev, wiced_i2c_t i2c_port, uint8_t i2c_addr);
+wiced_result_t bme280_wiced_init_i2c(struct bme280_dev *dev, bme280_wiced_intf_t* intf, wiced_i2c_t i2c_port, uint8_t i2c_addr);
 
 /**
- * Initialize the BME280 with SPI communications.
+ * Initialize the BME280 with SPI communications. Several sensors may share a port with their own
+ * chip select lines.
  *
  * @param[in] dev         : The BME280 device
+ * @param[in] intf        : The transport context of the device
  * @param[in] spi_port    : The SPI port to use for the device
  * @param[in] chip_select : The GPIO to use for the chip select pin of the device
  *
- * @return @ref wiced_result_t
+ * @return @ref wiced_result_t, WICED_ERROR also when BME280_WICED_MAX_DEVICES devices are in use
+ */
+wiced_result_t bme280_wiced_init_spi(struct bme280_dev *dev, bme280_wiced_intf_t* intf, wiced_spi_t spi_port, wiced_gpio_t chip_select);
+
+/**
+ * Release the device table slot of a BME280. The bus is left initialized for other sensors on it.
+ *
+ * @param[in] dev : The BME280 device
+ *
+ * @return WICED_SUCCESS, WICED_BADARG if the device was not initialized
  */
-wiced_result_t bme280_wiced_init_spi(struct bme280_dev *dev, wiced_spi_t spi_port, wiced_gpio_t chip_select);
+wiced_result_t bme280_wiced_deinit(struct bme280_dev *dev);
+
+/**
+ * Select how the register transfers of an initialized device are carried out. In BME280_WICED_XFER_DMA
+ * mode the longer transfers are staged through the buffer of the transport context (the driver's
+ * buffers are on thread stacks, which may sit in CCM RAM) and the calling thread sleeps until the DMA
+ * completes. Combined with
+ * bme280_wiced_measure_async() the data read then runs on the hardware IO worker thread while the
+ * CPU serves the network threads.
+ *
+ * When another port owns a DMA stream that is shared with the sensor's port (see
+ * platform_shared_dma.h) the transfer falls back to the CPU driven mode.
+ *
+ * @param[in] dev  : The BME280 device
+ * @param[in] mode : The transfer mode
+ *
+ * @return WICED_SUCCESS, WICED_BADARG if the device was not initialized
+ */
+wiced_result_t bme280_wiced_set_xfer_mode(struct bme280_dev *dev, bme280_wiced_xfer_mode_t mode);
 
 /**
  * Calculate the typical measurement time based on the current device settings. According to the
@@ -75,6 +198,26 @@ wiced_result_t bme280_wiced_init_spi(struct bme280_dev *dev, wiced_spi_t spi_por
  */
 uint16_t bme280_wiced_get_meas_time(const struct bme280_dev *dev);
 
+/**
+ * Start a forced mode measurement without blocking the calling thread. The bus transfers run on the
+ * hardware IO worker thread: the sensor is triggered, its status register is first polled once the
+ * typical measurement time (microsecond model, rounded up to the next tick) has elapsed and then
+ * every BME280_WICED_MEAS_POLL_MS until the measuring bit clears, and the data are read right away.
+ * Completion is reported through meas->callback and/or meas->event_flags.
+ *
+ * The device must not be used by other threads until the measurement completed. Measurements of
+ * several devices may run at the same time: they all run on the worker thread, which interleaves
+ * their bus transfers, so sensors sharing a bus need no further locking.
+ *
+ * @param[in,out] meas        : The measurement state
+ * @param[in]     dev         : The BME280 device, with dev->settings matching the sensor
+ * @param[in]     sensor_comp : The components to read (BME280_PRESS, BME280_TEMP, BME280_HUM or BME280_ALL)
+ *
+ * @return WICED_SUCCESS if the measurement was queued, WICED_PENDING if meas is still busy,
+ *         otherwise error
+ */
+wiced_result_t bme280_wiced_measure_async(bme280_wiced_meas_t* meas, struct bme280_dev *dev, uint8_t sensor_comp);
+
 
 
 #endif /* APPS_SNIP_BME280_TEST_BME280_WICED_WRAPPER_H_ */
@@ -0,0 +1,408 @@
+/** @file
+ *  Host benchmark of the sensor message formatting.
+ *
+ *  Formats the same readings with printf floating point, the way the application did before, and
+ *  with the fixed-point builder, and checks that both produce the same text. Two messages are
+ *  timed: the console line and the json event of a single reading. The json event is also built
+ *  from the pre-rendered template, whose text must match but for the padding of its value slots,
+ *  and which is handed on in place rather than formatted into a buffer. Readings are spread over the
+ *  sensor operating range by a fixed generator, so two runs of the same build format the same
+ *  values. Results are written to stdout as CSV, or as JSON with --json.
+ *
+ *  Usage: fmt_bench [--csv | --json]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "fixed_fmt.h"
+#include "msg_template.h"
+#include "watson_sample.h"
+
+/* The printf path formats the struct bme280_data fields as they are */
+#ifndef FLOATING_POINT_REPRESENTATION
+#error "fmt_bench needs the floating point struct bme280_data"
+#endif
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+/* Readings formatted per round, and rounds timed */
+#ifndef BENCH_SAMPLES
+#define BENCH_SAMPLES           (4096)
+#endif
+#ifndef BENCH_ROUNDS
+#define BENCH_ROUNDS            (64)
+#endif
+#define BENCH_SEED              (0x5EED1234U)
+
+#define DEVICE_ID               "myNebula20"
+
+/* Slot widths and message size of the application */
+#define MESSAGE_P_WIDTH         (10)
+#define MESSAGE_T_WIDTH         (7)
+#define MESSAGE_H_WIDTH         (7)
+#define MESSAGE_TS_WIDTH        (10)
+#define MESSAGE_LEN             (sizeof(DEVICE_ID) + 79 + MESSAGE_P_WIDTH + MESSAGE_T_WIDTH + MESSAGE_H_WIDTH + MESSAGE_TS_WIDTH)
+
+/******************************************************
+ *                   Enumerations
+ ******************************************************/
+typedef enum
+{
+    BENCH_LINE,     /* console line */
+    BENCH_JSON,     /* json event of a single reading */
+    BENCH_MESSAGES
+} bench_message_t;
+
+typedef enum
+{
+    BENCH_SNPRINTF,
+    BENCH_FIXED_FMT,
+    BENCH_MSG_TEMPLATE,
+    BENCH_PATHS
+} bench_path_t;
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+typedef struct
+{
+    uint64_t messages;
+    uint64_t ns;
+    uint64_t bytes;
+} bench_result_t;
+
+/* Formats a reading into out, or elsewhere, and points text at the result; returns its length */
+typedef int32_t (*bench_format_t)(const watson_sample_t* sample, char* out, uint32_t size, const char** text);
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+static uint64_t now_ns(void);
+static uint32_t bench_rand(uint32_t* state, uint32_t lo, uint32_t hi);
+static void make_samples(void);
+static void make_template(void);
+static int same_but_spaces(const char* a, const char* b);
+
+static int32_t line_snprintf(const watson_sample_t* sample, char* out, uint32_t size, const char** text);
+static int32_t line_fixed_fmt(const watson_sample_t* sample, char* out, uint32_t size, const char** text);
+static int32_t json_snprintf(const watson_sample_t* sample, char* out, uint32_t size, const char** text);
+static int32_t json_fixed_fmt(const watson_sample_t* sample, char* out, uint32_t size, const char** text);
+static int32_t json_msg_template(const watson_sample_t* sample, char* out, uint32_t size, const char** text);
+
+static uint32_t check_path(bench_message_t message, bench_path_t path);
+static void run_path(bench_message_t message, bench_path_t path, bench_result_t* result);
+
+/******************************************************
+ *               Variable Definitions
+ ******************************************************/
+static const char* const bench_messages[BENCH_MESSAGES] = { "line", "json" };
+static const char* const bench_paths[BENCH_PATHS] = { "snprintf", "fixed_fmt", "msg_template" };
+
+/* Formatter of each message and path, NULL where a path does not build that message */
+static const bench_format_t bench_formats[BENCH_MESSAGES][BENCH_PATHS] =
+{
+    [BENCH_LINE] = { line_snprintf, line_fixed_fmt, NULL },
+    [BENCH_JSON] = { json_snprintf, json_fixed_fmt, json_msg_template },
+};
+
+static watson_sample_t samples[BENCH_SAMPLES];
+static bench_result_t results[BENCH_MESSAGES][BENCH_PATHS];
+static msg_template_t json_template;
+static char json_template_buffer[MESSAGE_LEN];
+static int32_t json_slot_p;
+static int32_t json_slot_t;
+static int32_t json_slot_h;
+static int32_t json_slot_ts;
+
+/* Keeps the compiler from dropping the formatted text */
+static volatile uint32_t bench_sink;
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+int main(int argc, char** argv)
+{
+    int json = ( argc > 1 ) && ( strcmp(argv[1], "--json") == 0 );
+    const char* separator = "";
+    uint32_t mismatches = 0;
+    uint32_t m;
+    uint32_t p;
+
+    make_samples();
+    make_template();
+
+    for ( m = 0; m < BENCH_MESSAGES; m++ )
+    {
+        for ( p = 0; p < BENCH_PATHS; p++ )
+        {
+            if ( bench_formats[m][p] != NULL )
+            {
+                mismatches += check_path((bench_message_t)m, (bench_path_t)p);
+                run_path((bench_message_t)m, (bench_path_t)p, &results[m][p]);
+            }
+        }
+    }
+
+    if ( json )
+    {
+        printf("{\n  \"samples\": %u,\n  \"rounds\": %u,\n  \"results\": [", (unsigned)BENCH_SAMPLES, (unsigned)BENCH_ROUNDS);
+    }
+    else
+    {
+        printf("message,path,messages,ns_per_message,bytes_per_message\n");
+    }
+    for ( m = 0; m < BENCH_MESSAGES; m++ )
+    {
+        for ( p = 0; p < BENCH_PATHS; p++ )
+        {
+            const bench_result_t* result = &results[m][p];
+            double ns;
+            double bytes;
+
+            if ( result->messages == 0 )
+            {
+                continue;
+            }
+            ns = (double)result->ns / (double)result->messages;
+            bytes = (double)result->bytes / (double)result->messages;
+            if ( json )
+            {
+                printf("%s\n    { \"message\": \"%s\", \"path\": \"%s\", \"messages\": %llu, \"ns_per_message\": %.1f, "
+                       "\"bytes_per_message\": %.1f }", separator, bench_messages[m], bench_paths[p],
+                       (unsigned long long)result->messages, ns, bytes);
+                separator = ",";
+            }
+            else
+            {
+                printf("%s,%s,%llu,%.1f,%.1f\n", bench_messages[m], bench_paths[p],
+                       (unsigned long long)result->messages, ns, bytes);
+            }
+        }
+    }
+    if ( json )
+    {
+        printf("\n  ]\n}\n");
+    }
+
+    if ( mismatches != 0 )
+    {
+        fprintf(stderr, "%u messages differ from the snprintf text\n", (unsigned)mismatches);
+        return 1;
+    }
+    return 0;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t bench_rand(uint32_t* state, uint32_t lo, uint32_t hi)
+{
+    /* xorshift32 */
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return lo + *state % ( hi - lo + 1 );
+}
+
+/* Readings over the operating range: -40 to 85 degC, 300 to 1100 hPa, 0 to 100 %RH, in hundredths
+ * as the sensor resolves them */
+static void make_samples(void)
+{
+    uint32_t state = BENCH_SEED;
+    watson_centi_t centi;
+    uint32_t i;
+
+    for ( i = 0; i < BENCH_SAMPLES; i++ )
+    {
+        centi.temperature = (int32_t)bench_rand(&state, 0, 12500) - 4000;
+        centi.pressure = (int32_t)bench_rand(&state, 3000000, 11000000);
+        centi.humidity = (int32_t)bench_rand(&state, 0, 10000);
+        memset(&samples[i], 0, sizeof(samples[i]));
+        samples[i].seq = i + 1;
+        samples[i].time_ms = i * 5000;
+        watson_sample_from_centi(&centi, &samples[i].data);
+    }
+}
+
+/* The json event template as the application renders it */
+static void make_template(void)
+{
+    msg_template_init(&json_template, json_template_buffer, sizeof(json_template_buffer));
+    msg_template_text(&json_template, "{\"d\": {\"p\":");
+    json_slot_p = msg_template_slot(&json_template, MESSAGE_P_WIDTH, 2);
+    msg_template_text(&json_template, ",\"h_unit\":\"%\",\"p_unit\":\"Pa\",\"t\":");
+    json_slot_t = msg_template_slot(&json_template, MESSAGE_T_WIDTH, 2);
+    msg_template_text(&json_template, ",\"h\":");
+    json_slot_h = msg_template_slot(&json_template, MESSAGE_H_WIDTH, 2);
+    msg_template_text(&json_template, ",\"t_unit\":\"C\", \"id\":\"" DEVICE_ID "\", \"ts\":");
+    json_slot_ts = msg_template_slot(&json_template, MESSAGE_TS_WIDTH, 0);
+    msg_template_text(&json_template, "}}");
+    if ( msg_template_finish(&json_template) < 0 )
+    {
+        fprintf(stderr, "json template does not fit\n");
+        exit(1);
+    }
+}
+
+/* Text equal once spaces are dropped, which json ignores between tokens */
+static int same_but_spaces(const char* a, const char* b)
+{
+    for ( ;; )
+    {
+        while ( *a == ' ' )
+        {
+            a++;
+        }
+        while ( *b == ' ' )
+        {
+            b++;
+        }
+        if ( *a != *b )
+        {
+            return 0;
+        }
+        if ( *a == '\0' )
+        {
+            return 1;
+        }
+        a++;
+        b++;
+    }
+}
+
+static int32_t line_snprintf(const watson_sample_t* sample, char* out, uint32_t size, const char** text)
+{
+    *text = out;
+    return snprintf(out, size, "Temperature = %.2f\xf8""C, Humidity = %.2f%%, Pressure = %.2fPa\n",
+                    sample->data.temperature, sample->data.humidity, sample->data.pressure);
+}
+
+static int32_t line_fixed_fmt(const watson_sample_t* sample, char* out, uint32_t size, const char** text)
+{
+    fixed_fmt_t fmt;
+    watson_centi_t centi;
+
+    watson_sample_to_centi(&sample->data, &centi);
+    *text = out;
+    fixed_fmt_init(&fmt, out, size);
+    fixed_fmt_str(&fmt, "Temperature = ");
+    fixed_fmt_decimal(&fmt, centi.temperature, 2);
+    fixed_fmt_str(&fmt, "\xf8""C, Humidity = ");
+    fixed_fmt_decimal(&fmt, centi.humidity, 2);
+    fixed_fmt_str(&fmt, "%, Pressure = ");
+    fixed_fmt_decimal(&fmt, centi.pressure, 2);
+    fixed_fmt_str(&fmt, "Pa\n");
+    return fixed_fmt_finish(&fmt);
+}
+
+static int32_t json_snprintf(const watson_sample_t* sample, char* out, uint32_t size, const char** text)
+{
+    *text = out;
+    return snprintf(out, size, "{\"d\": {\"p\":%.2f,\"h_unit\":\"%%\",\"p_unit\":\"Pa\",\"t\":%.2f,\"h\":%.2f,\"t_unit\":\"C\", \"id\":\"%s\", \"ts\":%u}}",
+                    sample->data.pressure, sample->data.temperature, sample->data.humidity, DEVICE_ID,
+                    (unsigned)sample->time_ms);
+}
+
+static int32_t json_fixed_fmt(const watson_sample_t* sample, char* out, uint32_t size, const char** text)
+{
+    fixed_fmt_t fmt;
+    watson_centi_t centi;
+
+    watson_sample_to_centi(&sample->data, &centi);
+    *text = out;
+    fixed_fmt_init(&fmt, out, size);
+    fixed_fmt_str(&fmt, "{\"d\": {\"p\":");
+    fixed_fmt_decimal(&fmt, centi.pressure, 2);
+    fixed_fmt_str(&fmt, ",\"h_unit\":\"%\",\"p_unit\":\"Pa\",\"t\":");
+    fixed_fmt_decimal(&fmt, centi.temperature, 2);
+    fixed_fmt_str(&fmt, ",\"h\":");
+    fixed_fmt_decimal(&fmt, centi.humidity, 2);
+    fixed_fmt_str(&fmt, ",\"t_unit\":\"C\", \"id\":\"");
+    fixed_fmt_str(&fmt, DEVICE_ID);
+    fixed_fmt_str(&fmt, "\", \"ts\":");
+    fixed_fmt_uint(&fmt, sample->time_ms);
+    fixed_fmt_str(&fmt, "}}");
+    return fixed_fmt_finish(&fmt);
+}
+
+/* The message lives in the template buffer, out is not used */
+static int32_t json_msg_template(const watson_sample_t* sample, char* out, uint32_t size, const char** text)
+{
+    watson_centi_t centi;
+
+    (void)out;
+    (void)size;
+    watson_sample_to_centi(&sample->data, &centi);
+    if ( ( msg_template_set(&json_template, json_slot_p, centi.pressure) != 0 ) ||
+         ( msg_template_set(&json_template, json_slot_t, centi.temperature) != 0 ) ||
+         ( msg_template_set(&json_template, json_slot_h, centi.humidity) != 0 ) ||
+         ( msg_template_set_uint(&json_template, json_slot_ts, sample->time_ms) != 0 ) )
+    {
+        return -1;
+    }
+    *text = msg_template_data(&json_template);
+    return msg_template_length(&json_template);
+}
+
+/* Number of readings whose text differs from the snprintf text; the template differs in padding */
+static uint32_t check_path(bench_message_t message, bench_path_t path)
+{
+    char expected_buffer[MESSAGE_LEN];
+    char buffer[MESSAGE_LEN];
+    const char* expected;
+    const char* text;
+    uint32_t mismatches = 0;
+    uint32_t i;
+
+    for ( i = 0; i < BENCH_SAMPLES; i++ )
+    {
+        int32_t len = bench_formats[message][path](&samples[i], buffer, sizeof(buffer), &text);
+        int same;
+
+        bench_formats[message][BENCH_SNPRINTF](&samples[i], expected_buffer, sizeof(expected_buffer), &expected);
+        same = ( len >= 0 ) && ( ( path == BENCH_MSG_TEMPLATE ) ? same_but_spaces(text, expected) : ( strcmp(text, expected) == 0 ) );
+        if ( !same )
+        {
+            if ( mismatches++ == 0 )
+            {
+                fprintf(stderr, "%s %s: \"%s\", snprintf: \"%s\"\n", bench_messages[message], bench_paths[path], text, expected);
+            }
+        }
+    }
+    return mismatches;
+}
+
+static void run_path(bench_message_t message, bench_path_t path, bench_result_t* result)
+{
+    bench_format_t format = bench_formats[message][path];
+    char buffer[MESSAGE_LEN];
+    const char* text;
+    uint64_t start;
+    uint32_t round;
+    uint32_t i;
+
+    start = now_ns();
+    for ( round = 0; round < BENCH_ROUNDS; round++ )
+    {
+        for ( i = 0; i < BENCH_SAMPLES; i++ )
+        {
+            int32_t len = format(&samples[i], buffer, sizeof(buffer), &text);
+
+            bench_sink += (uint32_t)len + (uint8_t)text[len / 2];
+            result->bytes += (uint32_t)len;
+        }
+    }
+    result->ns += now_ns() - start;
+    result->messages += (uint64_t)BENCH_ROUNDS * BENCH_SAMPLES;
+}
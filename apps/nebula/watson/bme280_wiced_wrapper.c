@@ -36,19 +36,41 @@
  */
 
 #include "../bme280_test/bme280_wiced_wrapper.h"
+#ifdef PLATFORM_HAS_SHARED_DMA_LOCKS
+#include "platform_shared_dma.h"
+#endif
 
 /******************************************************
- *               Variable Definitions
+ *                      Macros
  ******************************************************/
+
+/**
+ * SPI mode of the BME280, without the DMA selection which is made per transfer.
+ */
+#define BME280_SPI_MODE (SPI_CLOCK_RISING_EDGE | SPI_CLOCK_IDLE_HIGH | SPI_MSB_FIRST)
+
 /**
- * The I2C device that is used to communicate with the BME280.
+ * Claim and release the DMA streams of the bus port. Boards without shared streams always grant them.
  */
-static wiced_i2c_device_t bme280_i2c_dev;
+#ifdef PLATFORM_HAS_SHARED_DMA_LOCKS
+#define BME280_SPI_DMA_LOCK(port)   (platform_spi_dma_lock(port) == PLATFORM_SUCCESS)
+#define BME280_SPI_DMA_UNLOCK(port) platform_spi_dma_unlock(port)
+#define BME280_I2C_DMA_LOCK(port)   (platform_i2c_dma_lock(port) == PLATFORM_SUCCESS)
+#define BME280_I2C_DMA_UNLOCK(port) platform_i2c_dma_unlock(port)
+#else
+#define BME280_SPI_DMA_LOCK(port)   (WICED_TRUE)
+#define BME280_SPI_DMA_UNLOCK(port)
+#define BME280_I2C_DMA_LOCK(port)   (WICED_TRUE)
+#define BME280_I2C_DMA_UNLOCK(port)
+#endif
 
+/******************************************************
+ *               Variable Definitions
+ ******************************************************/
 /**
- * The SPI device that is used to communicate with the BME280.
+ * The transport contexts of the initialized devices, indexed by bme280_dev.id.
  */
-static wiced_spi_device_t bme280_spi_dev;
+static bme280_wiced_intf_t* bme280_intf_table[BME280_WICED_MAX_DEVICES];
 
 /******************************************************
  *               Static Function Declarations
@@ -58,7 +80,7 @@ static wiced_spi_device_t bme280_spi_dev;
  * Read the BME280 device register with I2C communications. This is used by the bme280_dev
  * as a function pointer for read.
  *
- * @param[in]  dev_id   : The device ID (I2C address)
+ * @param[in]  dev_id   : The device ID (slot in the device table)
  * @param[in]  reg_addr : The register address to read
  * @param[out] data     : The buffer to put the read data into
  * @param[in]  len      : The length of data to read
@@ -71,7 +93,7 @@ static int8_t bme280_i2c_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, u
  * Write the BME280 device register with I2C communications. This is used by the bme280_dev
  * as a function pointer for write.
  *
- * @param[in] dev_id   : The device ID (I2C address)
+ * @param[in] dev_id   : The device ID (slot in the device table)
  * @param[in] reg_addr : The register address to write to
  * @param[in] data     : The buffer data to write
  * @param[in] len      : The length of data to write
@@ -84,7 +106,7 @@ static int8_t bme280_i2c_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *data,
  * Read the BME280 device register with SPI communications. This is used by the bme280_dev
  * as a function pointer for read.
  *
- * @param[in]  dev_id   : The device ID (I2C address)
+ * @param[in]  dev_id   : The device ID (slot in the device table)
  * @param[in]  reg_addr : The register address to read
  * @param[out] data     : The buffer to put the read data into
  * @param[in]  len      : The length of data to read
@@ -97,7 +119,7 @@ static int8_t bme280_spi_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, u
  * Write the BME280 device register with SPI communications. This is used by the bme280_dev
  * as a function pointer for write.
  *
- * @param[in] dev_id   : The device ID (I2C address)
+ * @param[in] dev_id   : The device ID (slot in the device table)
  * @param[in] reg_addr : The register address to write to
  * @param[in] data     : The buffer data to write
  * @param[in] len      : The length of data to write
@@ -106,6 +128,36 @@ static int8_t bme280_spi_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, u
  */
 static int8_t bme280_spi_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len);
 
+/**
+ * Decide whether a transfer uses DMA and, if so, claim the DMA streams of the bus port. A transfer
+ * that got WICED_TRUE must release the streams with BME280_SPI_DMA_UNLOCK/BME280_I2C_DMA_UNLOCK.
+ *
+ * @param[in] intf : The transport context of the device
+ * @param[in] len  : The number of data bytes, register address excluded
+ *
+ * @return WICED_TRUE to transfer with DMA, WICED_FALSE to let the CPU move the data
+ */
+static wiced_bool_t bme280_dma_begin(bme280_wiced_intf_t* intf, uint16_t len);
+
+/**
+ * Look up the transport context of a device. The bus callbacks only get the bme280_dev.id.
+ *
+ * @param[in] dev_id : The device ID (slot in the device table)
+ *
+ * @return The transport context, NULL if the slot is not in use
+ */
+static bme280_wiced_intf_t* bme280_intf_get(uint8_t dev_id);
+
+/**
+ * Enter a transport context into the device table and point the device at it.
+ *
+ * @param[in] dev  : The BME280 device
+ * @param[in] intf : The transport context
+ *
+ * @return WICED_SUCCESS, WICED_ERROR if all BME280_WICED_MAX_DEVICES slots are taken
+ */
+static wiced_result_t bme280_intf_register(struct bme280_dev *dev, bme280_wiced_intf_t* intf);
+
 /**
  * Delay for period milliseconds. This is used by the bme200_dev as a function pointer
  * for delay_ms.
@@ -116,33 +168,88 @@ static int8_t bme280_spi_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *data,
  */
 static void bme280_delay_ms(uint32_t period);
 
+/**
+ * Trigger the forced mode conversion of an asynchronous measurement and schedule the first status poll.
+ * Runs on the hardware IO worker thread.
+ *
+ * @param[in] arg : The bme280_wiced_meas_t of the measurement
+ *
+ * @return WICED_SUCCESS
+ */
+static wiced_result_t bme280_meas_start(void *arg);
+
+/**
+ * Poll the status register of an asynchronous measurement and read the data once the conversion is done.
+ * Runs on the hardware IO worker thread.
+ *
+ * @param[in] arg : The bme280_wiced_meas_t of the measurement
+ *
+ * @return WICED_SUCCESS
+ */
+static wiced_result_t bme280_meas_poll(void *arg);
+
+/**
+ * (Re)arm the status poll of an asynchronous measurement with the given period.
+ *
+ * @param[in] meas    : The measurement
+ * @param[in] time_ms : Time until the next poll, and between the following ones
+ *
+ * @return void
+ */
+static void bme280_meas_schedule(bme280_wiced_meas_t* meas, uint32_t time_ms);
+
+/**
+ * Finish an asynchronous measurement: stop polling and report the result.
+ *
+ * @param[in] meas   : The measurement
+ * @param[in] result : The outcome
+ *
+ * @return void
+ */
+static void bme280_meas_complete(bme280_wiced_meas_t* meas, wiced_result_t result);
+
 /******************************************************
  *               Function Definitions
  ******************************************************/
 
 static int8_t bme280_i2c_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len)
 {
+	bme280_wiced_intf_t* intf = bme280_intf_get(dev_id);
 	wiced_i2c_message_t msg;
+	int8_t rslt;
 
-	if(data == NULL){
-		return BME280_E_NULL_PTR;
+	if(intf == NULL){
+		return BME280_E_DEV_NOT_FOUND;
 	}
 
-	bme280_i2c_dev.address = (uint16_t)dev_id;
-
-	if(wiced_i2c_init_tx_message(&msg, &reg_addr, 1, 1, BME280_I2C_DISABLE_DMA) != WICED_SUCCESS){
-		return BME280_E_COMM_FAIL;
+	if(data == NULL){
+		return BME280_E_NULL_PTR;
 	}
 
-	if(wiced_i2c_transfer(&bme280_i2c_dev, &msg, 1) != WICED_SUCCESS){
-		return BME280_E_COMM_FAIL;
+	if(bme280_dma_begin(intf, len)){
+		/* The address and the data are staged in the context, the driver's buffer may be out of DMA reach */
+		intf->xfer_buffer[0] = reg_addr;
+		rslt = BME280_OK;
+		/* The device uses DMA only while the streams are held */
+		intf->i2c.flags |= I2C_DEVICE_USE_DMA;
+		if(wiced_i2c_init_combined_message(&msg, &intf->xfer_buffer[0], &intf->xfer_buffer[1], 1, len, 1, WICED_FALSE) != WICED_SUCCESS ||
+				wiced_i2c_transfer(&intf->i2c, &msg, 1) != WICED_SUCCESS){
+			rslt = BME280_E_COMM_FAIL;
+		}
+		intf->i2c.flags &= ~I2C_DEVICE_USE_DMA;
+		BME280_I2C_DMA_UNLOCK(intf->i2c.port);
+		if(rslt == BME280_OK){
+			memcpy(data, &intf->xfer_buffer[1], len);
+		}
+		return rslt;
 	}
 
-	if(wiced_i2c_init_rx_message(&msg, data, len, 1, BME280_I2C_DISABLE_DMA) != WICED_SUCCESS){
+	/* Register address write and data read in one transfer, joined by a repeated start */
+	if(wiced_i2c_init_combined_message(&msg, &reg_addr, data, 1, len, 1, BME280_I2C_DISABLE_DMA) != WICED_SUCCESS){
 		return BME280_E_COMM_FAIL;
 	}
 
-	if(wiced_i2c_transfer(&bme280_i2c_dev, &msg, 1) != WICED_SUCCESS){
+	if(wiced_i2c_transfer(&intf->i2c, &msg, 1) != WICED_SUCCESS){
 		return BME280_E_COMM_FAIL;
 	}
 
@@ -151,35 +258,43 @@ static int8_t bme280_i2c_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, u
 
 static int8_t bme280_i2c_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len)
 {
+	bme280_wiced_intf_t* intf = bme280_intf_get(dev_id);
 	wiced_i2c_message_t msg;
-	uint8_t* tx_data;
+	wiced_bool_t dma;
+	int8_t rslt = BME280_OK;
+
+	if(intf == NULL){
+		return BME280_E_DEV_NOT_FOUND;
+	}
 
 	if(data == NULL){
 		return BME280_E_NULL_PTR;
 	}
 
-	tx_data = (uint8_t*)malloc(len+1);
-	if(tx_data == NULL){
+	if(len >= sizeof(intf->xfer_buffer)){
 		return BME280_E_INVALID_LEN;
 	}
 
-	bme280_i2c_dev.address = (uint16_t)dev_id;
+	intf->xfer_buffer[0] = reg_addr;
+	memcpy(&intf->xfer_buffer[1], data, len);
 
-	tx_data[0] = reg_addr;
-	memcpy(&tx_data[1], data, len);
+	/* The message is already staged in the context, so only the streams need to be claimed for DMA */
+	dma = bme280_dma_begin(intf, len);
+	if(dma){
+		intf->i2c.flags |= I2C_DEVICE_USE_DMA;
+	}
 
-	if(wiced_i2c_init_tx_message(&msg, tx_data, len+1, 1, BME280_I2C_DISABLE_DMA) != WICED_SUCCESS){
-		free(tx_data);
-		return BME280_E_COMM_FAIL;
+	if(wiced_i2c_init_tx_message(&msg, intf->xfer_buffer, len+1, 1, dma ? WICED_FALSE : BME280_I2C_DISABLE_DMA) != WICED_SUCCESS ||
+			wiced_i2c_transfer(&intf->i2c, &msg, 1) != WICED_SUCCESS){
+		rslt = BME280_E_COMM_FAIL;
 	}
 
-	if(wiced_i2c_transfer(&bme280_i2c_dev, &msg, 1) != WICED_SUCCESS){
-		free(tx_data);
-		return BME280_E_COMM_FAIL;
+	if(dma){
+		intf->i2c.flags &= ~I2C_DEVICE_USE_DMA;
+		BME280_I2C_DMA_UNLOCK(intf->i2c.port);
 	}
 
-	free(tx_data);
-	return BME280_OK;
+	return rslt;
 }
 
 
@@ -191,89 +306,125 @@ static void bme280_delay_ms(uint32_t period)
 
 static int8_t bme280_spi_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len)
 {
-	wiced_spi_message_segment_t msg;
-	uint8_t *xfer_buffer;
-	int8_t ret = BME280_OK;
+	bme280_wiced_intf_t* intf = bme280_intf_get(dev_id);
+	wiced_spi_message_segment_t msg[2];
+	int8_t rslt = BME280_OK;
+
+	if(intf == NULL){
+		return BME280_E_DEV_NOT_FOUND;
+	}
 
 	if(data == NULL){
 		return BME280_E_NULL_PTR;
 	}
 
-	xfer_buffer = (uint8_t*)malloc(len+1);
-	if(xfer_buffer == NULL){
-		return BME280_E_INVALID_LEN;
+	if(bme280_dma_begin(intf, len)){
+		/* Same two segments, staged in the context: the driver's buffer may be out of DMA reach */
+		intf->xfer_buffer[0] = reg_addr;
+		memset(&intf->xfer_buffer[1], 0x00, len);
+
+		msg[0].length    = 1;
+		msg[0].tx_buffer = &intf->xfer_buffer[0];
+		msg[0].rx_buffer = NULL;
+		msg[1].length    = len;
+		msg[1].tx_buffer = &intf->xfer_buffer[1];
+		msg[1].rx_buffer = &intf->xfer_buffer[1];
+
+		intf->spi.mode = (BME280_SPI_MODE | SPI_USE_DMA);
+		if(wiced_spi_transfer(&intf->spi, msg, 2) != WICED_SUCCESS){
+			rslt = BME280_E_COMM_FAIL;
+		}
+		intf->spi.mode = (BME280_SPI_MODE | SPI_NO_DMA);
+		BME280_SPI_DMA_UNLOCK(intf->spi.port);
+
+		if(rslt == BME280_OK){
+			memcpy(data, &intf->xfer_buffer[1], len);
+		}
+		return rslt;
 	}
 
-	xfer_buffer[0] = reg_addr;
-	memset(&xfer_buffer[1], 0x00, len);
+	/* Chip select stays asserted across the segments: the register address goes out first, then the
+	 * data are clocked straight into the caller's buffer, which also supplies the (zeroed) dummy bytes */
+	memset(data, 0x00, len);
 
-	msg.length    = len+1;
-	msg.tx_buffer = xfer_buffer;
-	msg.rx_buffer = xfer_buffer;
+	msg[0].length    = 1;
+	msg[0].tx_buffer = &reg_addr;
+	msg[0].rx_buffer = NULL;
+	msg[1].length    = len;
+	msg[1].tx_buffer = data;
+	msg[1].rx_buffer = data;
 
-	if(wiced_spi_transfer(&bme280_spi_dev, &msg, 1 ) == WICED_SUCCESS){
-		memcpy(data, &xfer_buffer[1], len);
-	}
-	else{
-		ret = BME280_E_COMM_FAIL;
+	if(wiced_spi_transfer(&intf->spi, msg, 2) != WICED_SUCCESS){
+		rslt = BME280_E_COMM_FAIL;
 	}
 
-	free(xfer_buffer);
-	return ret;
+	return rslt;
 }
 
 
 static int8_t bme280_spi_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len)
 {
-	wiced_spi_message_segment_t msg;
-	uint8_t *xfer_buffer;
-	int8_t ret = BME280_OK;
+	bme280_wiced_intf_t* intf = bme280_intf_get(dev_id);
+	wiced_spi_message_segment_t msg[2];
 
-	if(data == NULL){
-		return BME280_E_NULL_PTR;
+	if(intf == NULL){
+		return BME280_E_DEV_NOT_FOUND;
 	}
 
-	xfer_buffer = (uint8_t*)malloc(len+1);
-	if(xfer_buffer == NULL){
-		return BME280_E_INVALID_LEN;
+	if(data == NULL){
+		return BME280_E_NULL_PTR;
 	}
 
-	xfer_buffer[0] = reg_addr;
-	memcpy(&xfer_buffer[1], data, len);
-
-	msg.length    = len+1;
-	msg.tx_buffer = xfer_buffer;
-	msg.rx_buffer = NULL;
+	/* Register address and data as two segments of one chip select cycle, no copy needed */
+	msg[0].length    = 1;
+	msg[0].tx_buffer = &reg_addr;
+	msg[0].rx_buffer = NULL;
+	msg[1].length    = len;
+	msg[1].tx_buffer = data;
+	msg[1].rx_buffer = NULL;
 
-	if(wiced_spi_transfer(&bme280_spi_dev, &msg, 1 ) != WICED_SUCCESS){
-		ret = BME280_E_COMM_FAIL;
+	if(wiced_spi_transfer(&intf->spi, msg, 2) != WICED_SUCCESS){
+		return BME280_E_COMM_FAIL;
 	}
 
-	free(xfer_buffer);
-	return ret;
+	return BME280_OK;
 }
 
-wiced_result_t bme280_wiced_init_i2c(struct bme280_dev *dev, wiced_i2c_t i2c_port, uint8_t i2c_addr)
+wiced_result_t bme280_wiced_init_i2c(struct bme280_dev *dev, bme280_wiced_intf_t* intf, wiced_i2c_t i2c_port, uint8_t i2c_addr)
 {
 	wiced_result_t wres;
 
-	bme280_i2c_dev.port = i2c_port;
-	bme280_i2c_dev.address = (uint16_t)i2c_addr;
-	bme280_i2c_dev.address_width = I2C_ADDRESS_WIDTH_7BIT;
-	bme280_i2c_dev.flags = 0x00;
-	bme280_i2c_dev.speed_mode = I2C_HIGH_SPEED_MODE;
+	if(dev == NULL || intf == NULL){
+		return WICED_BADARG;
+	}
+
+	memset(intf, 0x00, sizeof(*intf));
+	intf->interface = BME280_I2C_INTF;
+	intf->xfer_mode = BME280_WICED_XFER_POLLED;
+	intf->i2c.port = i2c_port;
+	intf->i2c.address = (uint16_t)i2c_addr;
+	intf->i2c.address_width = I2C_ADDRESS_WIDTH_7BIT;
+	/* CPU driven by default, I2C_DEVICE_USE_DMA is set around the DMA transfers */
+	intf->i2c.flags = 0x00;
+	intf->i2c.speed_mode = I2C_HIGH_SPEED_MODE;
+
+	if((wres = bme280_intf_register(dev, intf)) != WICED_SUCCESS){
+		return wres;
+	}
 
-	dev->id = i2c_addr;
 	dev->interface = BME280_I2C_INTF;
 	dev->read = bme280_i2c_read;
 	dev->write = bme280_i2c_write;
 	dev->delay_ms = bme280_delay_ms;
 
-	if((wres = wiced_i2c_init(&bme280_i2c_dev)) != WICED_SUCCESS){
+	/* Initialising a port again is harmless, so sensors on the same bus do not need to coordinate */
+	if((wres = wiced_i2c_init(&intf->i2c)) != WICED_SUCCESS){
+		bme280_wiced_deinit(dev);
 		return wres;
 	}
 
 	if(bme280_init(dev) != BME280_OK){
+		bme280_wiced_deinit(dev);
 		wres = WICED_ERROR;
 	}
 
@@ -281,26 +432,39 @@ wiced_result_t bme280_wiced_init_i2c(struct bme280_dev *dev, wiced_i2c_t i2c_por
 }
 
 
-wiced_result_t bme280_wiced_init_spi(struct bme280_dev *dev, wiced_spi_t spi_port, wiced_gpio_t chip_select)
+wiced_result_t bme280_wiced_init_spi(struct bme280_dev *dev, bme280_wiced_intf_t* intf, wiced_spi_t spi_port, wiced_gpio_t chip_select)
 {
 	wiced_result_t wres;
 
-	bme280_spi_dev.port = spi_port;
-	bme280_spi_dev.chip_select = chip_select;
-	bme280_spi_dev.mode = (SPI_CLOCK_RISING_EDGE | SPI_CLOCK_IDLE_HIGH | SPI_NO_DMA | SPI_MSB_FIRST);
-	bme280_spi_dev.speed = 10000000; /* 10MHz */
-	bme280_spi_dev.bits = 8;
+	if(dev == NULL || intf == NULL){
+		return WICED_BADARG;
+	}
+
+	memset(intf, 0x00, sizeof(*intf));
+	intf->interface = BME280_SPI_INTF;
+	intf->xfer_mode = BME280_WICED_XFER_POLLED;
+	intf->spi.port = spi_port;
+	intf->spi.chip_select = chip_select;
+	intf->spi.mode = (BME280_SPI_MODE | SPI_NO_DMA);
+	intf->spi.speed = 10000000; /* 10MHz */
+	intf->spi.bits = 8;
+
+	if((wres = bme280_intf_register(dev, intf)) != WICED_SUCCESS){
+		return wres;
+	}
 
 	dev->interface = BME280_SPI_INTF;
 	dev->read = bme280_spi_read;
 	dev->write = bme280_spi_write;
 	dev->delay_ms = bme280_delay_ms;
 
-	if((wres = wiced_spi_init(&bme280_spi_dev)) != WICED_SUCCESS){
+	if((wres = wiced_spi_init(&intf->spi)) != WICED_SUCCESS){
+		bme280_wiced_deinit(dev);
 		return wres;
 	}
 
 	if(bme280_init(dev) != BME280_OK){
+		bme280_wiced_deinit(dev);
 		wres = WICED_ERROR;
 	}
 
@@ -308,34 +472,224 @@ wiced_result_t bme280_wiced_init_spi(struct bme280_dev *dev, wiced_spi_t spi_por
 }
 
 
-uint16_t bme280_wiced_get_meas_time(const struct bme280_dev *dev)
+wiced_result_t bme280_wiced_deinit(struct bme280_dev *dev)
+{
+	if(dev == NULL || bme280_intf_get(dev->id) == NULL){
+		return WICED_BADARG;
+	}
+
+	/* The bus stays initialized, other sensors may share it */
+	bme280_intf_table[dev->id] = NULL;
+	dev->read = NULL;
+	dev->write = NULL;
+
+	return WICED_SUCCESS;
+}
+
+
+wiced_result_t bme280_wiced_set_xfer_mode(struct bme280_dev *dev, bme280_wiced_xfer_mode_t mode)
+{
+	bme280_wiced_intf_t* intf;
+
+	if(dev == NULL || (intf = bme280_intf_get(dev->id)) == NULL){
+		return WICED_BADARG;
+	}
+
+	intf->xfer_mode = mode;
+
+	return WICED_SUCCESS;
+}
+
+
+static bme280_wiced_intf_t* bme280_intf_get(uint8_t dev_id)
+{
+	if(dev_id >= BME280_WICED_MAX_DEVICES){
+		return NULL;
+	}
+
+	return bme280_intf_table[dev_id];
+}
+
+
+static wiced_result_t bme280_intf_register(struct bme280_dev *dev, bme280_wiced_intf_t* intf)
+{
+	uint8_t slot;
+	uint8_t free_slot = BME280_WICED_MAX_DEVICES;
+
+	for(slot = 0; slot < BME280_WICED_MAX_DEVICES; slot++){
+		/* A context that is initialized again keeps its slot */
+		if(bme280_intf_table[slot] == intf){
+			free_slot = slot;
+			break;
+		}
+		if(bme280_intf_table[slot] == NULL && free_slot == BME280_WICED_MAX_DEVICES){
+			free_slot = slot;
+		}
+	}
+
+	if(free_slot == BME280_WICED_MAX_DEVICES){
+		return WICED_ERROR;
+	}
+
+	bme280_intf_table[free_slot] = intf;
+	dev->id = free_slot;
+
+	return WICED_SUCCESS;
+}
+
+
+static wiced_bool_t bme280_dma_begin(bme280_wiced_intf_t* intf, uint16_t len)
 {
-	uint16_t meas_time = 0;
+	/* Short transfers are cheaper without DMA, long ones must fit the staging buffer */
+	if(intf->xfer_mode != BME280_WICED_XFER_DMA || len < BME280_WICED_DMA_MIN_LEN || len >= sizeof(intf->xfer_buffer)){
+		return WICED_FALSE;
+	}
+
+	if(intf->interface == BME280_SPI_INTF){
+		return BME280_SPI_DMA_LOCK(intf->spi.port) ? WICED_TRUE : WICED_FALSE;
+	}
+
+	return BME280_I2C_DMA_LOCK(intf->i2c.port) ? WICED_TRUE : WICED_FALSE;
+}
 
+
+uint16_t bme280_wiced_get_meas_time(const struct bme280_dev *dev)
+{
 	if(dev == NULL){
 		return 0;
 	}
 
-	if(dev->settings.osr_h != BME280_NO_OVERSAMPLING || dev->settings.osr_p != BME280_NO_OVERSAMPLING
-			|| dev->settings.osr_t != BME280_NO_OVERSAMPLING){
-		meas_time = 1;
+	/* Round the microsecond model up to whole milliseconds */
+	return (uint16_t)((bme280_cal_meas_delay_us(&dev->settings, BME280_MEAS_TIME_TYP) + 999) / 1000);
+}
 
-		if(dev->settings.osr_h != BME280_NO_OVERSAMPLING || dev->settings.osr_p != BME280_NO_OVERSAMPLING){
-			meas_time += 1;
-		}
 
-		if(dev->settings.osr_t != BME280_NO_OVERSAMPLING){
-			meas_time += (0x01 << (dev->settings.osr_t));
-		}
+wiced_result_t bme280_wiced_measure_async(bme280_wiced_meas_t* meas, struct bme280_dev *dev, uint8_t sensor_comp)
+{
+	wiced_result_t wres;
 
-		if(dev->settings.osr_p != BME280_NO_OVERSAMPLING){
-			meas_time += (0x01 << (dev->settings.osr_p));
+	if(meas == NULL || dev == NULL){
+		return WICED_BADARG;
+	}
+
+	if(meas->busy){
+		return WICED_PENDING;
+	}
+
+	meas->dev = dev;
+	meas->sensor_comp = sensor_comp;
+	meas->result = WICED_PENDING;
+	meas->busy = WICED_TRUE;
+
+	/* Only queue the request here, the bus transfers run on the worker thread */
+	if((wres = wiced_rtos_send_asynchronous_event(WICED_HARDWARE_IO_WORKER_THREAD, bme280_meas_start, meas)) != WICED_SUCCESS){
+		meas->busy = WICED_FALSE;
+	}
+
+	return wres;
+}
+
+
+static wiced_result_t bme280_meas_start(void *arg)
+{
+	bme280_wiced_meas_t* meas = (bme280_wiced_meas_t*)arg;
+	uint32_t max_time_ms;
+
+	if(bme280_set_sensor_mode(BME280_FORCED_MODE, meas->dev) != BME280_OK){
+		bme280_meas_complete(meas, WICED_ERROR);
+		return WICED_SUCCESS;
+	}
+
+	wiced_time_get_time(&meas->start_time);
+
+	/* First look at the sensor when a typical conversion is done, give up one poll after the maximum */
+	meas->first_poll_ms = (bme280_cal_meas_delay_us(&meas->dev->settings, BME280_MEAS_TIME_TYP) + 999) / 1000;
+	max_time_ms = (bme280_cal_meas_delay_us(&meas->dev->settings, BME280_MEAS_TIME_MAX) + 999) / 1000;
+	meas->timeout_ms = max_time_ms + BME280_WICED_MEAS_POLL_MS;
+
+	bme280_meas_schedule(meas, meas->first_poll_ms);
+
+	return WICED_SUCCESS;
+}
+
+
+static wiced_result_t bme280_meas_poll(void *arg)
+{
+	bme280_wiced_meas_t* meas = (bme280_wiced_meas_t*)arg;
+	wiced_time_t now;
+	uint8_t status;
+
+	/* Ticks queued before the timer of this or a previous measurement was stopped */
+	if(!meas->busy || !meas->poll_registered){
+		return WICED_SUCCESS;
+	}
+
+	wiced_time_get_time(&now);
+	if((uint32_t)(now - meas->start_time) < meas->first_poll_ms){
+		return WICED_SUCCESS;
+	}
+
+	if(bme280_get_status(&status, meas->dev) != BME280_OK){
+		bme280_meas_complete(meas, WICED_ERROR);
+		return WICED_SUCCESS;
+	}
+
+	if(status & BME280_STATUS_MEAS_MSK){
+		if((uint32_t)(now - meas->start_time) > meas->timeout_ms){
+			bme280_meas_complete(meas, WICED_TIMEOUT);
 		}
+		else{
+			bme280_meas_schedule(meas, BME280_WICED_MEAS_POLL_MS);
+		}
+		return WICED_SUCCESS;
+	}
+
+	if(bme280_get_sensor_data(meas->sensor_comp, &meas->data, meas->dev) != BME280_OK){
+		bme280_meas_complete(meas, WICED_ERROR);
+	}
+	else{
+		bme280_meas_complete(meas, WICED_SUCCESS);
+	}
 
-		if(dev->settings.osr_h != BME280_NO_OVERSAMPLING){
-			meas_time += (0x01 << (dev->settings.osr_h));
+	return WICED_SUCCESS;
+}
+
+
+static void bme280_meas_schedule(bme280_wiced_meas_t* meas, uint32_t time_ms)
+{
+	if(meas->poll_registered){
+		if(meas->poll_ms == time_ms){
+			return;
 		}
+		wiced_rtos_deregister_timed_event(&meas->poll_event);
+		meas->poll_registered = WICED_FALSE;
+	}
+
+	if(wiced_rtos_register_timed_event(&meas->poll_event, WICED_HARDWARE_IO_WORKER_THREAD, bme280_meas_poll, time_ms, meas) != WICED_SUCCESS){
+		bme280_meas_complete(meas, WICED_ERROR);
+		return;
 	}
 
-	return meas_time;
+	meas->poll_registered = WICED_TRUE;
+	meas->poll_ms = time_ms;
+}
+
+
+static void bme280_meas_complete(bme280_wiced_meas_t* meas, wiced_result_t result)
+{
+	if(meas->poll_registered){
+		wiced_rtos_deregister_timed_event(&meas->poll_event);
+		meas->poll_registered = WICED_FALSE;
+	}
+
+	meas->result = result;
+	meas->busy = WICED_FALSE;
+
+	if(meas->callback != NULL){
+		meas->callback(result, &meas->data, meas->callback_arg);
+	}
+
+	if(meas->event_flags != NULL){
+		wiced_rtos_set_event_flags(meas->event_flags, meas->event_flag);
+	}
 }
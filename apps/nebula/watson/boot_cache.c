@@ -0,0 +1,225 @@
+/** @file
+ *  Boot time caches kept in the application DCT.
+ */
+
+#include <string.h>
+#include "wwd_wifi.h"
+#include "boot_cache.h"
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+/* Highest 2.4 GHz channel, the band is not reported with the channel */
+#define BOOT_CACHE_MAX_2G4_CHANNEL          (14)
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+/**
+ * join the cached access point without scanning, with the credentials stored for its SSID
+ */
+static wiced_result_t cache_join(void);
+/**
+ * cache the access point the station is on
+ */
+static void cache_remember_ap(void);
+static void cache_forget_ap(void);
+
+/******************************************************
+ *               Variable Definitions
+ ******************************************************/
+static boot_cache_dct_t cache;
+static uint32_t cache_offset;
+static wiced_bool_t cache_dirty;
+static wiced_bool_t broker_counted;
+static boot_cache_stats_t stats;
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+void boot_cache_init(uint32_t dct_offset)
+{
+    cache_offset = dct_offset;
+    cache_dirty = WICED_FALSE;
+    broker_counted = WICED_FALSE;
+    memset(&stats, 0, sizeof(stats));
+    if ( ( wiced_dct_read_with_copy( &cache, DCT_APP_SECTION, dct_offset, sizeof(cache) ) != WICED_SUCCESS ) ||
+         ( cache.version != BOOT_CACHE_VERSION ) )
+    {
+        memset(&cache, 0, sizeof(cache));
+        cache.version = BOOT_CACHE_VERSION;
+    }
+}
+
+wiced_result_t boot_cache_network_up(wiced_interface_t interface)
+{
+    wiced_result_t ret = WICED_ERROR;
+
+    if ( ( interface == WICED_STA_INTERFACE ) && cache.ap_valid )
+    {
+        ret = cache_join( );
+        if ( ret == WICED_SUCCESS )
+        {
+            ret = wiced_ip_up( interface, WICED_USE_EXTERNAL_DHCP_SERVER, NULL );
+            if ( ret != WICED_SUCCESS )
+            {
+                wiced_leave_ap( interface );
+            }
+        }
+        if ( ret == WICED_SUCCESS )
+        {
+            stats.ap_joins++;
+        }
+        else
+        {
+            /* Moved, switched off or replaced: scan as usual */
+            stats.ap_misses++;
+        }
+    }
+    if ( ret != WICED_SUCCESS )
+    {
+        ret = wiced_network_up( interface, WICED_USE_EXTERNAL_DHCP_SERVER, NULL );
+    }
+    if ( interface != WICED_STA_INTERFACE )
+    {
+        return ret;
+    }
+    if ( ret == WICED_SUCCESS )
+    {
+        /* Written only when the access point changed */
+        cache_remember_ap( );
+    }
+    else
+    {
+        cache_forget_ap( );
+    }
+    return ret;
+}
+
+wiced_bool_t boot_cache_get_broker(wiced_ip_address_t* address)
+{
+    if ( cache.broker_boots == 0 )
+    {
+        return WICED_FALSE;
+    }
+    if ( !broker_counted )
+    {
+        broker_counted = WICED_TRUE;
+        cache.broker_boots--;
+        cache_dirty = WICED_TRUE;
+    }
+    SET_IPV4_ADDRESS( *address, cache.broker_ip );
+    stats.broker_hits++;
+    return WICED_TRUE;
+}
+
+void boot_cache_set_broker(const wiced_ip_address_t* address)
+{
+    if ( address == NULL )
+    {
+        if ( cache.broker_boots != 0 )
+        {
+            cache.broker_boots = 0;
+            cache_dirty = WICED_TRUE;
+        }
+        return;
+    }
+    if ( ( cache.broker_ip != GET_IPV4_ADDRESS( *address ) ) || ( cache.broker_boots != BOOT_CACHE_BROKER_BOOTS ) )
+    {
+        cache.broker_ip = GET_IPV4_ADDRESS( *address );
+        cache.broker_boots = BOOT_CACHE_BROKER_BOOTS;
+        cache_dirty = WICED_TRUE;
+    }
+    /* This boot has been paid for by the lookup */
+    broker_counted = WICED_TRUE;
+}
+
+wiced_result_t boot_cache_save(void)
+{
+    wiced_result_t ret;
+
+    if ( !cache_dirty )
+    {
+        return WICED_SUCCESS;
+    }
+    ret = wiced_dct_write( &cache, DCT_APP_SECTION, cache_offset, sizeof(cache) );
+    if ( ret == WICED_SUCCESS )
+    {
+        cache_dirty = WICED_FALSE;
+        stats.writes++;
+    }
+    return ret;
+}
+
+void boot_cache_get_stats(boot_cache_stats_t* out)
+{
+    *out = stats;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+static wiced_result_t cache_join(void)
+{
+    platform_dct_wifi_config_t* wifi;
+    wiced_config_ap_entry_t* ap;
+    wiced_ap_info_t details;
+    wiced_result_t ret = WICED_ERROR;
+    uint32_t i;
+
+    if ( wiced_dct_read_lock( (void**)&wifi, WICED_FALSE, DCT_WIFI_CONFIG_SECTION, 0, sizeof(*wifi) ) != WICED_SUCCESS )
+    {
+        return WICED_ERROR;
+    }
+    /* The credentials stay in the Wi-Fi DCT, the cache only adds where the network was found */
+    for ( i = 0; i < CONFIG_AP_LIST_SIZE; i++ )
+    {
+        ap = &wifi->stored_ap_list[i];
+        if ( ( ap->details.SSID.length == cache.ssid_length ) && ( memcmp( ap->details.SSID.value, cache.ssid, cache.ssid_length ) == 0 ) )
+        {
+            details = ap->details;
+            details.BSSID = cache.bssid;
+            details.channel = cache.channel;
+            details.band = (wiced_802_11_band_t)cache.band;
+            ret = wiced_join_ap_specific( &details, ap->security_key_length, ap->security_key );
+            break;
+        }
+    }
+    wiced_dct_read_unlock( wifi, WICED_FALSE );
+    return ret;
+}
+
+static void cache_remember_ap(void)
+{
+    wl_bss_info_t bss;
+    wiced_security_t security;
+    uint32_t channel;
+    boot_cache_dct_t entry = cache;
+
+    if ( ( wwd_wifi_get_ap_info( &bss, &security ) != WWD_SUCCESS ) || ( bss.SSID_len > sizeof(entry.ssid) ) ||
+         ( wwd_wifi_get_channel( WWD_STA_INTERFACE, &channel ) != WWD_SUCCESS ) )
+    {
+        return;
+    }
+    entry.ap_valid = 1;
+    entry.bssid = bss.BSSID;
+    entry.ssid_length = bss.SSID_len;
+    memset( entry.ssid, 0, sizeof(entry.ssid) );
+    memcpy( entry.ssid, bss.SSID, bss.SSID_len );
+    entry.channel = (uint8_t)channel;
+    entry.band = ( channel > BOOT_CACHE_MAX_2G4_CHANNEL ) ? WICED_802_11_BAND_5GHZ : WICED_802_11_BAND_2_4GHZ;
+    if ( memcmp( &entry, &cache, sizeof(entry) ) != 0 )
+    {
+        cache = entry;
+        cache_dirty = WICED_TRUE;
+    }
+}
+
+static void cache_forget_ap(void)
+{
+    if ( cache.ap_valid )
+    {
+        cache.ap_valid = 0;
+        cache_dirty = WICED_TRUE;
+    }
+}
@@ -0,0 +1,101 @@
+/** @file
+ *  Boot time caches kept in the application DCT: the access point joined last and the address
+ *  of the broker.
+ *
+ *  With a cached BSSID, channel and band the station joins without scanning; when that join
+ *  fails the cache is cleared and wiced_network_up() joins the usual way. The broker address is
+ *  used without a name lookup for BOOT_CACHE_BROKER_BOOTS boots after it was resolved. There is
+ *  no clock across resets, so that is the TTL; an address that fails to connect is dropped right
+ *  away.
+ *
+ *  Changes are kept in RAM until boot_cache_save(), so the slow DCT write can wait until a
+ *  message went out. Call from one thread at a time.
+ */
+
+#ifndef APPS_NEBULA_WATSON_BOOT_CACHE_H_
+#define APPS_NEBULA_WATSON_BOOT_CACHE_H_
+
+#include "wiced.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+/* Changes whenever boot_cache_dct_t does, an entry of another layout is ignored */
+#define BOOT_CACHE_VERSION                  (1)
+/* Boots that use the broker address before it is resolved again */
+#define BOOT_CACHE_BROKER_BOOTS             (16)
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+/**
+ * Entry in the application DCT. All zeros, the state of a fresh DCT, is an empty cache.
+ */
+typedef struct
+{
+    uint8_t     version;
+    uint8_t     ap_valid;
+    uint8_t     channel;
+    uint8_t     band;           /**< wiced_802_11_band_t */
+    wiced_mac_t bssid;
+    uint8_t     ssid_length;    /**< Of the SSID the entry belongs to */
+    uint8_t     ssid[32];
+    uint8_t     broker_boots;   /**< Boots left to use broker_ip, 0 when there is none */
+    uint32_t    broker_ip;      /**< IPv4 address */
+} boot_cache_dct_t;
+
+typedef struct
+{
+    uint32_t ap_joins;          /**< Joins to the cached access point */
+    uint32_t ap_misses;         /**< Cached access point gone, joined with a scan */
+    uint32_t broker_hits;       /**< Broker address taken from the cache */
+    uint32_t writes;            /**< DCT writes */
+} boot_cache_stats_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+/**
+ * Read the cache.
+ *
+ * @param[in] dct_offset : Offset of the boot_cache_dct_t in the application DCT
+ */
+void boot_cache_init(uint32_t dct_offset);
+
+/**
+ * Bring the network up, through the cached access point if there is one, and remember the
+ * access point that was joined. Same arguments as wiced_network_up(), with DHCP.
+ */
+wiced_result_t boot_cache_network_up(wiced_interface_t interface);
+
+/**
+ * The cached broker address. Counts a boot against the TTL on the first call.
+ *
+ * @param[out] address : Broker address
+ *
+ * @return WICED_TRUE when an address was cached and has not expired
+ */
+wiced_bool_t boot_cache_get_broker(wiced_ip_address_t* address);
+
+/**
+ * Cache a broker address that was just resolved and worked, for BOOT_CACHE_BROKER_BOOTS boots, or
+ * forget the cached one when address is NULL.
+ */
+void boot_cache_set_broker(const wiced_ip_address_t* address);
+
+/**
+ * Write changes to the DCT, nothing if there are none.
+ */
+wiced_result_t boot_cache_save(void);
+
+void boot_cache_get_stats(boot_cache_stats_t* stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_BOOT_CACHE_H_ */
@@ -0,0 +1,110 @@
+/** @file
+ *  Bounds checked text builder with fixed-point decimal output.
+ */
+
+#include "fixed_fmt.h"
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+/* Digits of the largest uint32_t */
+#define FIXED_FMT_MAX_DIGITS        (10)
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+/* Append the digits of value, at least min_digits of them */
+static void put_digits(fixed_fmt_t* fmt, uint32_t value, uint32_t min_digits);
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+void fixed_fmt_init(fixed_fmt_t* fmt, char* buffer, uint32_t size)
+{
+    fmt->buffer = buffer;
+    fmt->size = size;
+    fmt->len = 0;
+    fmt->overflow = ( size == 0 );
+}
+
+void fixed_fmt_char(fixed_fmt_t* fmt, char c)
+{
+    /* One byte stays free for the terminating NUL */
+    if ( fmt->len + 1 < fmt->size )
+    {
+        fmt->buffer[fmt->len++] = c;
+    }
+    else
+    {
+        fmt->overflow = 1;
+    }
+}
+
+void fixed_fmt_str(fixed_fmt_t* fmt, const char* str)
+{
+    while ( *str != '\0' )
+    {
+        fixed_fmt_char(fmt, *str++);
+    }
+}
+
+void fixed_fmt_uint(fixed_fmt_t* fmt, uint32_t value)
+{
+    put_digits(fmt, value, 1);
+}
+
+void fixed_fmt_decimal(fixed_fmt_t* fmt, int32_t value, uint32_t decimals)
+{
+    static const uint32_t pow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+    uint32_t magnitude;
+
+    if ( decimals >= sizeof(pow10) / sizeof(pow10[0]) )
+    {
+        decimals = sizeof(pow10) / sizeof(pow10[0]) - 1;
+    }
+    if ( value < 0 )
+    {
+        fixed_fmt_char(fmt, '-');
+        magnitude = 0U - (uint32_t)value;
+    }
+    else
+    {
+        magnitude = (uint32_t)value;
+    }
+
+    put_digits(fmt, magnitude / pow10[decimals], 1);
+    if ( decimals != 0 )
+    {
+        fixed_fmt_char(fmt, '.');
+        put_digits(fmt, magnitude % pow10[decimals], decimals);
+    }
+}
+
+int32_t fixed_fmt_finish(fixed_fmt_t* fmt)
+{
+    if ( fmt->size != 0 )
+    {
+        fmt->buffer[fmt->len] = '\0';
+    }
+    return fmt->overflow ? -1 : (int32_t)fmt->len;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+static void put_digits(fixed_fmt_t* fmt, uint32_t value, uint32_t min_digits)
+{
+    char digits[FIXED_FMT_MAX_DIGITS];
+    uint32_t count = 0;
+
+    do
+    {
+        digits[count++] = (char)( '0' + value % 10 );
+        value /= 10;
+    } while ( ( value != 0 ) || ( count < min_digits ) );
+
+    while ( count != 0 )
+    {
+        fixed_fmt_char(fmt, digits[--count]);
+    }
+}
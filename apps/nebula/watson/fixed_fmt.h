@@ -0,0 +1,79 @@
+/** @file
+ *  Bounds checked text builder with fixed-point decimal output.
+ *
+ *  Replaces sprintf with %f for the sensor messages: values are scaled integers, so newlib's
+ *  floating point printf (large, slow and stack hungry) is not needed. Output never runs past the
+ *  buffer; an overflow is remembered and reported by fixed_fmt_finish().
+ */
+
+#ifndef APPS_NEBULA_WATSON_FIXED_FMT_H_
+#define APPS_NEBULA_WATSON_FIXED_FMT_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+typedef struct
+{
+    char*    buffer;
+    uint32_t size;
+    uint32_t len;
+    uint8_t  overflow;
+} fixed_fmt_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+/**
+ * Start writing at the beginning of a buffer.
+ *
+ * @param[out] fmt    : Builder state
+ * @param[in]  buffer : Output
+ * @param[in]  size   : Size of buffer including the terminating NUL
+ */
+void fixed_fmt_init(fixed_fmt_t* fmt, char* buffer, uint32_t size);
+
+/**
+ * Append a NUL terminated string.
+ */
+void fixed_fmt_str(fixed_fmt_t* fmt, const char* str);
+
+/**
+ * Append one character.
+ */
+void fixed_fmt_char(fixed_fmt_t* fmt, char c);
+
+/**
+ * Append an unsigned integer in decimal.
+ */
+void fixed_fmt_uint(fixed_fmt_t* fmt, uint32_t value);
+
+/**
+ * Append a fixed-point value.
+ *
+ * @param[in] fmt      : Builder state
+ * @param[in] value    : The value times 10^decimals, e.g. 2150 with 2 decimals for "21.50"
+ * @param[in] decimals : Digits after the decimal point, 0 to 9
+ */
+void fixed_fmt_decimal(fixed_fmt_t* fmt, int32_t value, uint32_t decimals);
+
+/**
+ * Terminate the text.
+ *
+ * @param[in] fmt : Builder state
+ *
+ * @return length of the text, or -1 if it did not fit; the buffer then holds as much of it as fits,
+ *         NUL terminated
+ */
+int32_t fixed_fmt_finish(fixed_fmt_t* fmt);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_FIXED_FMT_H_ */
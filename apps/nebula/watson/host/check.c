@@ -0,0 +1,34 @@
+/** @file
+ *  What the host checks share.
+ */
+
+#include <string.h>
+#include "check.h"
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+void check_make_sample(uint32_t seq, uint32_t time_ms, int32_t temperature, int32_t pressure, int32_t humidity,
+                       watson_sample_t* sample)
+{
+    watson_centi_t centi;
+
+    centi.temperature = temperature;
+    centi.pressure = pressure;
+    centi.humidity = humidity;
+    memset(sample, 0, sizeof(*sample));
+    sample->seq = seq;
+    sample->time_ms = time_ms;
+    watson_sample_from_centi(&centi, &sample->data);
+}
+
+void check_seq_sample(uint32_t seq, watson_sample_t* sample)
+{
+    uint32_t noise = seq * 2654435761U;
+
+    check_make_sample(seq, seq * 5000 + ( noise >> 28 ),
+                      2100 + (int32_t)( seq / 40 % 300 ) + (int32_t)( noise >> 30 ),
+                      10130000 + (int32_t)( seq / 3 % 4000 ) + (int32_t)( ( noise >> 8 ) % 13 ),
+                      4500 + (int32_t)( seq / 25 % 900 ) + (int32_t)( ( noise >> 16 ) % 9 ), sample);
+    sample->flags = ( seq % 97 == 0 );
+}
@@ -0,0 +1,51 @@
+/** @file
+ *  What the host checks share: the CHECK macro and the samples they feed the modules.
+ */
+
+#ifndef APPS_NEBULA_WATSON_HOST_CHECK_H_
+#define APPS_NEBULA_WATSON_HOST_CHECK_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "watson_sample.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                      Macros
+ ******************************************************/
+/* Exits nonzero on the first broken expectation */
+#define CHECK(cond)                                                                     \
+    do                                                                                  \
+    {                                                                                   \
+        if ( !( cond ) )                                                                \
+        {                                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);    \
+            exit(1);                                                                    \
+        }                                                                               \
+    } while ( 0 )
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+/**
+ * A sample with the given readings, in hundredths, and no flags.
+ */
+void check_make_sample(uint32_t seq, uint32_t time_ms, int32_t temperature, int32_t pressure, int32_t humidity,
+                       watson_sample_t* sample);
+
+/**
+ * The sample numbered seq of a slowly drifting room. Every field follows from seq, so a sample
+ * torn between two writes, or stored under the wrong number, does not compare equal to the one
+ * made again from its seq.
+ */
+void check_seq_sample(uint32_t seq, watson_sample_t* sample);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_HOST_CHECK_H_ */
@@ -0,0 +1,152 @@
+/** @file
+ *  Host check of the packed sample encoding.
+ *
+ *  Exits nonzero on the first broken expectation:
+ *    - a full batch spanning the largest seq and time offsets the layout holds decodes to the
+ *      samples encoded, to the hundredth;
+ *    - values out of range are clipped: temperature to the INT16 range, pressure and humidity to
+ *      their unsigned fields;
+ *    - the encoder refuses too many samples or too small a buffer, the decoder a wrong version, a
+ *      length that does not match the sample count and too little room.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "check.h"
+#include "sample_codec.h"
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+#define U16_MAX                 (0xFFFFU)
+#define U24_MAX                 (0xFFFFFFU)
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+static void check_centi(const watson_sample_t* sample, int32_t temperature, int32_t pressure, int32_t humidity);
+static void check_round_trip(void);
+static void check_clipping(void);
+static void check_rejects(void);
+
+/******************************************************
+ *               Variable Definitions
+ ******************************************************/
+static watson_sample_t samples[SAMPLE_CODEC_MAX_SAMPLES + 1];
+static watson_sample_t decoded[SAMPLE_CODEC_MAX_SAMPLES];
+static uint8_t payload[SAMPLE_CODEC_LEN(SAMPLE_CODEC_MAX_SAMPLES + 1)];
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+int main(void)
+{
+    check_round_trip();
+    check_clipping();
+    check_rejects();
+    printf("all checks passed\n");
+    return 0;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+static void check_centi(const watson_sample_t* sample, int32_t temperature, int32_t pressure, int32_t humidity)
+{
+    watson_centi_t centi;
+
+    watson_sample_to_centi(&sample->data, &centi);
+    CHECK(centi.temperature == temperature);
+    CHECK(centi.pressure == pressure);
+    CHECK(centi.humidity == humidity);
+}
+
+static void check_round_trip(void)
+{
+    const uint32_t count = SAMPLE_CODEC_MAX_SAMPLES;
+    /* Near the top of the counters, so that the offsets are taken across the 2^32 wrap */
+    const uint32_t first_seq = 0xFFFFFF00U;
+    const uint32_t first_time = 0xFFFF0000U;
+    uint32_t i;
+
+    for ( i = 0; i < count; i++ )
+    {
+        /* The last sample sits at the largest offsets the u16 seq and u24 time fields hold */
+        uint32_t seq_offset = ( i == count - 1 ) ? U16_MAX : i * 7;
+        uint32_t time_offset = ( i == count - 1 ) ? U24_MAX : i * 5003;
+
+        check_make_sample(first_seq + seq_offset, first_time + time_offset, -4000 + (int32_t)i * 37,
+                          3000000 + (int32_t)i * 40111, (int32_t)i * 39, &samples[i]);
+    }
+
+    CHECK(sample_codec_encode(samples, count, payload, sizeof(payload)) == (int32_t)SAMPLE_CODEC_LEN(count));
+    CHECK(payload[0] == SAMPLE_CODEC_VERSION);
+    CHECK(payload[1] == count);
+    CHECK(sample_codec_decode(payload, SAMPLE_CODEC_LEN(count), decoded, count) == (int32_t)count);
+
+    for ( i = 0; i < count; i++ )
+    {
+        watson_centi_t centi;
+
+        watson_sample_to_centi(&samples[i].data, &centi);
+        CHECK(decoded[i].seq == samples[i].seq);
+        CHECK(decoded[i].time_ms == samples[i].time_ms);
+        CHECK(decoded[i].flags == 0);
+        check_centi(&decoded[i], centi.temperature, centi.pressure, centi.humidity);
+    }
+    CHECK(decoded[count - 1].time_ms - decoded[0].time_ms == U24_MAX);
+    CHECK(decoded[count - 1].seq - decoded[0].seq == U16_MAX);
+
+    /* An empty batch is a bare header */
+    CHECK(sample_codec_encode(samples, 0, payload, sizeof(payload)) == SAMPLE_CODEC_HEADER_LEN);
+    CHECK(sample_codec_decode(payload, SAMPLE_CODEC_HEADER_LEN, decoded, 0) == 0);
+}
+
+static void check_clipping(void)
+{
+    check_make_sample(1, 0, 40000, -5, -1, &samples[0]);
+    check_make_sample(2, 10, -40000, U24_MAX + 1000, U16_MAX + 1, &samples[1]);
+    check_make_sample(3, 20, INT16_MAX, U24_MAX, U16_MAX, &samples[2]);
+    check_make_sample(4, 30, INT16_MIN, 0, 0, &samples[3]);
+
+    CHECK(sample_codec_encode(samples, 4, payload, sizeof(payload)) == (int32_t)SAMPLE_CODEC_LEN(4));
+    CHECK(sample_codec_decode(payload, SAMPLE_CODEC_LEN(4), decoded, 4) == 4);
+
+    check_centi(&decoded[0], INT16_MAX, 0, 0);
+    check_centi(&decoded[1], INT16_MIN, U24_MAX, U16_MAX);
+    /* The range limits themselves pass unchanged */
+    check_centi(&decoded[2], INT16_MAX, U24_MAX, U16_MAX);
+    check_centi(&decoded[3], INT16_MIN, 0, 0);
+}
+
+static void check_rejects(void)
+{
+    uint32_t i;
+
+    for ( i = 0; i <= SAMPLE_CODEC_MAX_SAMPLES; i++ )
+    {
+        check_make_sample(i + 1, i * 1000, 2100, 10132500, 4500, &samples[i]);
+    }
+
+    /* Encoder: one sample past the count field, one byte short of room */
+    CHECK(sample_codec_encode(samples, SAMPLE_CODEC_MAX_SAMPLES + 1, payload, sizeof(payload)) == -1);
+    CHECK(sample_codec_encode(samples, 3, payload, SAMPLE_CODEC_LEN(3) - 1) == -1);
+    CHECK(sample_codec_encode(samples, 3, payload, SAMPLE_CODEC_LEN(3)) == (int32_t)SAMPLE_CODEC_LEN(3));
+
+    /* Decoder: lengths either side of the one the count gives, and a truncated header */
+    CHECK(sample_codec_decode(payload, SAMPLE_CODEC_LEN(3), decoded, 3) == 3);
+    CHECK(sample_codec_decode(payload, SAMPLE_CODEC_LEN(3) - 1, decoded, 3) == -1);
+    CHECK(sample_codec_decode(payload, SAMPLE_CODEC_LEN(3) + 1, decoded, 3) == -1);
+    CHECK(sample_codec_decode(payload, SAMPLE_CODEC_LEN(2), decoded, 3) == -1);
+    CHECK(sample_codec_decode(payload, SAMPLE_CODEC_HEADER_LEN - 1, decoded, 3) == -1);
+
+    /* Too little room for the samples */
+    CHECK(sample_codec_decode(payload, SAMPLE_CODEC_LEN(3), decoded, 2) == -1);
+
+    /* Versions other than the one known */
+    payload[0] = SAMPLE_CODEC_VERSION + 1;
+    CHECK(sample_codec_decode(payload, SAMPLE_CODEC_LEN(3), decoded, 3) == -1);
+    payload[0] = 0;
+    CHECK(sample_codec_decode(payload, SAMPLE_CODEC_LEN(3), decoded, 3) == -1);
+}
@@ -0,0 +1,232 @@
+/** @file
+ *  Host check of the report by exception filter, with the limits of the application.
+ *
+ *  Exits nonzero on the first broken expectation:
+ *    - deadband, with the rate limits off: a slow drift is suppressed until it has moved a full
+ *      deadband from the last report, in either direction, and the relative humidity deadband
+ *      takes over from the absolute one at low humidity;
+ *    - heartbeat: a steady reading is reported once per heartbeat period, across the wrap of the
+ *      millisecond clock, and an on demand reading restarts the period;
+ *    - rate alarm: a ramp raises one alarm on its rising edge however long it lasts, readings
+ *      taken close together do not alarm on noise, and a second ramp alarms again.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "check.h"
+#include "report_filter.h"
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+#define SAMPLE_PERIOD_MS        (5000)
+#define HEARTBEAT_MS            (15 * 60 * 1000)
+#define RATE_INTERVAL_MS        (20000)
+
+/* A quiet room, in hundredths */
+#define ROOM_T                  (2150)
+#define ROOM_P                  (10132500)
+#define ROOM_H                  (4500)
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+static void start(const report_filter_config_t* limits, uint32_t time_ms);
+static uint32_t check(int32_t temperature, int32_t pressure, int32_t humidity, uint32_t flags);
+static void check_deadband(void);
+static void check_heartbeat(void);
+static void check_rate_alarm(void);
+
+/******************************************************
+ *               Variable Definitions
+ ******************************************************/
+/* The limits of the application */
+static const report_filter_config_t config =
+{
+    .channel =
+    {
+        [WATSON_CHANNEL_TEMPERATURE] = { .abs_deadband = 20,   .rel_deadband_bp = 0,   .rate_limit = 100 },
+        [WATSON_CHANNEL_PRESSURE]    = { .abs_deadband = 5000, .rel_deadband_bp = 0,   .rate_limit = 10000 },
+        [WATSON_CHANNEL_HUMIDITY]    = { .abs_deadband = 200,  .rel_deadband_bp = 500, .rate_limit = 500 },
+    },
+    .heartbeat_ms = HEARTBEAT_MS,
+    .rate_interval_ms = RATE_INTERVAL_MS,
+};
+
+static report_filter_t filter;
+static uint32_t now_ms;
+static uint32_t seq;
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+int main(void)
+{
+    check_deadband();
+    check_heartbeat();
+    check_rate_alarm();
+    printf("all checks passed\n");
+    return 0;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+static void start(const report_filter_config_t* limits, uint32_t time_ms)
+{
+    report_filter_init(&filter, limits);
+    now_ms = time_ms;
+    seq = 0;
+    CHECK(check(ROOM_T, ROOM_P, ROOM_H, 0) == REPORT_FILTER_FIRST);
+}
+
+/* Checks a reading taken at now_ms, then advances now_ms by one sample period */
+static uint32_t check(int32_t temperature, int32_t pressure, int32_t humidity, uint32_t flags)
+{
+    watson_sample_t sample;
+    uint32_t reasons;
+
+    check_make_sample(++seq, now_ms, temperature, pressure, humidity, &sample);
+    sample.flags = flags;
+
+    reasons = report_filter_check(&filter, &sample);
+    now_ms += SAMPLE_PERIOD_MS;
+    return reasons;
+}
+
+static void check_deadband(void)
+{
+    report_filter_config_t deadband_only = config;
+    report_filter_stats_t stats;
+    int32_t t;
+    uint32_t i;
+
+    /* The steps below would be rates over the limits */
+    for ( i = 0; i < WATSON_CHANNELS; i++ )
+    {
+        deadband_only.channel[i].rate_limit = 0;
+    }
+    start(&deadband_only, 1000);
+
+    /* 0.05 degC per reading: every fourth reading is reported */
+    for ( i = 1, t = ROOM_T; i <= 12; i++ )
+    {
+        t += 5;
+        CHECK(check(t, ROOM_P, ROOM_H, 0) == ( ( i % 4 == 0 ) ? REPORT_FILTER_CHANGE : 0 ));
+    }
+    /* Back down: 0.19 from the last report is inside the deadband, 0.20 is not */
+    CHECK(check(t - 19, ROOM_P, ROOM_H, 0) == 0);
+    CHECK(check(t - 20, ROOM_P, ROOM_H, 0) == REPORT_FILTER_CHANGE);
+    t -= 20;
+
+    /* Pressure by 49.99 Pa, then 50 Pa */
+    CHECK(check(t, ROOM_P + 4999, ROOM_H, 0) == 0);
+    CHECK(check(t, ROOM_P - 5000, ROOM_H, 0) == REPORT_FILTER_CHANGE);
+
+    /* Humidity at 45 %RH: 5 % is 2.25 %RH, so the 2 %RH absolute deadband decides */
+    CHECK(check(t, ROOM_P - 5000, ROOM_H + 199, 0) == 0);
+    CHECK(check(t, ROOM_P - 5000, ROOM_H + 200, 0) == REPORT_FILTER_CHANGE);
+
+    /* Humidity at 10 %RH: 5 % is 0.5 %RH, so the relative deadband decides */
+    start(&deadband_only, 1000);
+    CHECK(check(ROOM_T, ROOM_P, 1000, 0) == REPORT_FILTER_CHANGE);
+    CHECK(check(ROOM_T, ROOM_P, 1049, 0) == 0);
+    CHECK(check(ROOM_T, ROOM_P, 1050, 0) == REPORT_FILTER_CHANGE);
+    CHECK(check(ROOM_T, ROOM_P, 1001, 0) == 0);
+    CHECK(check(ROOM_T, ROOM_P, 997, 0) == REPORT_FILTER_CHANGE);
+
+    report_filter_get_stats(&filter, &stats);
+    CHECK(stats.checked == 6);
+    CHECK(stats.reported == 4);
+    CHECK(stats.rate_alarms == 0);
+}
+
+static void check_heartbeat(void)
+{
+    report_filter_stats_t stats;
+    uint32_t per_period = HEARTBEAT_MS / SAMPLE_PERIOD_MS;
+    uint32_t reported = 0;
+    uint32_t i;
+
+    /* Start an hour before the millisecond clock wraps, run for two hours */
+    start(&config, 0U - 60 * 60 * 1000);
+    for ( i = 1; i <= 8 * per_period; i++ )
+    {
+        uint32_t reasons = check(ROOM_T, ROOM_P, ROOM_H, 0);
+
+        CHECK(reasons == ( ( i % per_period == 0 ) ? REPORT_FILTER_HEARTBEAT : 0 ));
+        reported += ( reasons != 0 );
+    }
+    CHECK(reported == 8);
+
+    /* A button press halfway through a period restarts it */
+    for ( i = 1; i < per_period / 2; i++ )
+    {
+        CHECK(check(ROOM_T, ROOM_P, ROOM_H, 0) == 0);
+    }
+    CHECK(check(ROOM_T, ROOM_P, ROOM_H, WATSON_SAMPLE_ON_DEMAND) == REPORT_FILTER_ON_DEMAND);
+    for ( i = 1; i < per_period; i++ )
+    {
+        CHECK(check(ROOM_T, ROOM_P, ROOM_H, 0) == 0);
+    }
+    CHECK(check(ROOM_T, ROOM_P, ROOM_H, 0) == REPORT_FILTER_HEARTBEAT);
+
+    report_filter_get_stats(&filter, &stats);
+    CHECK(stats.reported == 1 + 8 + 1 + 1);
+}
+
+static void check_rate_alarm(void)
+{
+    report_filter_stats_t stats;
+    uint32_t alarms = 0;
+    uint32_t changes = 0;
+    int32_t p = ROOM_P;
+    uint32_t i;
+
+    start(&config, 1000);
+
+    /* A door opens: 20 Pa per reading is 240 Pa/min, over the 100 Pa/min limit, for ten minutes */
+    for ( i = 0; i < 120; i++ )
+    {
+        uint32_t reasons;
+
+        p += 2000;
+        reasons = check(ROOM_T, p, ROOM_H, 0);
+        CHECK(( reasons & ~( REPORT_FILTER_RATE_ALARM | REPORT_FILTER_CHANGE ) ) == 0);
+        alarms += ( ( reasons & REPORT_FILTER_RATE_ALARM ) != 0 );
+        changes += ( ( reasons & REPORT_FILTER_CHANGE ) != 0 );
+
+        /* The alarm comes with the first reading a full rate interval after the ramp started */
+        if ( i + 1 == RATE_INTERVAL_MS / SAMPLE_PERIOD_MS )
+        {
+            CHECK(reasons & REPORT_FILTER_RATE_ALARM);
+        }
+    }
+    CHECK(alarms == 1);
+    /* Otherwise the ramp goes by its deadband: 50 Pa is every third reading, or sooner after the
+     * alarm report */
+    CHECK(changes >= 120 / 3 - 1);
+    CHECK(changes <= 120 / 3 + 1);
+
+    /* The ramp stops and the alarm clears without a report */
+    for ( i = 0; i < 2 * RATE_INTERVAL_MS / SAMPLE_PERIOD_MS; i++ )
+    {
+        CHECK(check(ROOM_T, p, ROOM_H, 0) == 0);
+    }
+
+    /* Two readings 1 s apart with 0.3 degC of noise between them are not an 18 degC/min rate */
+    now_ms -= SAMPLE_PERIOD_MS - 1000;
+    CHECK(( check(ROOM_T + 30, p, ROOM_H, 0) & REPORT_FILTER_RATE_ALARM ) == 0);
+    CHECK(( check(ROOM_T, p, ROOM_H, 0) & REPORT_FILTER_RATE_ALARM ) == 0);
+
+    /* A second ramp is a new rising edge */
+    for ( i = 0, alarms = 0; i < 24; i++ )
+    {
+        p -= 2000;
+        alarms += ( ( check(ROOM_T, p, ROOM_H, 0) & REPORT_FILTER_RATE_ALARM ) != 0 );
+    }
+    CHECK(alarms == 1);
+
+    report_filter_get_stats(&filter, &stats);
+    CHECK(stats.rate_alarms == 2);
+}
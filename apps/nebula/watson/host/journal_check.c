@@ -0,0 +1,324 @@
+/** @file
+ *  Host check of the sample journal against the file backed flash emulator.
+ *
+ *  Runs the journal through three scenarios and exits nonzero on the first broken expectation:
+ *    - fill, reopen and drain in batches: order, values and the pending count survive a reopen;
+ *    - wrap a small journal: the oldest readings are given up and counted, erases spread evenly;
+ *    - power cuts at random points of appends, drains of one to three batches and sector erases,
+ *      each followed by a reopen: no reading acknowledged by a written record is lost, none is
+ *      delivered before one already consumed, and only readings that were appended are ever
+ *      delivered.
+ *  Also prints the flash used and the flash traffic per reading for the append and drain paths.
+ *
+ *  Usage: journal_check [image file]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "check.h"
+#include "journal_flash_file.h"
+#include "sample_journal.h"
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+#define SECTOR_SIZE             (4096)
+/* Readings per drain, as many as one payload of the application */
+#define DRAIN_BATCH             (SAMPLE_JOURNAL_RECORD_SAMPLES)
+#define TORTURE_ROUNDS          (3000)
+#define TORTURE_READINGS        (200000)
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+static int same_sample(const watson_sample_t* a, const watson_sample_t* b);
+static void open_image(journal_flash_file_t* emu, const char* path, uint32_t size);
+static void check_fill_and_drain(const char* path);
+static void check_wrap(const char* path);
+static void check_power_cuts(const char* path);
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+int main(int argc, char** argv)
+{
+    const char* path = ( argc > 1 ) ? argv[1] : "journal_check.img";
+
+    srand(1);
+    check_fill_and_drain(path);
+    check_wrap(path);
+    check_power_cuts(path);
+    remove(path);
+    printf("all checks passed\n");
+    return 0;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+/* Readings are made from their seq, so any delivered reading can be verified. They drift slowly
+ * with some noise and timing jitter, like a room seen every five seconds. */
+static int same_sample(const watson_sample_t* a, const watson_sample_t* b)
+{
+    watson_centi_t ca;
+    watson_centi_t cb;
+
+    watson_sample_to_centi(&a->data, &ca);
+    watson_sample_to_centi(&b->data, &cb);
+    return ( a->seq == b->seq ) && ( a->time_ms == b->time_ms ) && ( a->flags == b->flags ) &&
+           ( memcmp(&ca, &cb, sizeof(ca)) == 0 );
+}
+
+static void open_image(journal_flash_file_t* emu, const char* path, uint32_t size)
+{
+    remove(path);
+    CHECK(journal_flash_file_open(emu, path, size, SECTOR_SIZE) == 0);
+}
+
+static void check_fill_and_drain(const char* path)
+{
+    journal_flash_file_t emu;
+    sample_journal_t journal;
+    watson_sample_t batch[DRAIN_BATCH];
+    watson_sample_t expect;
+    uint32_t next = 1;
+    uint32_t seq;
+    uint32_t pending;
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t bytes;
+    int32_t n;
+    int32_t i;
+
+    open_image(&emu, path, 64 * SECTOR_SIZE);
+    CHECK(sample_journal_open(&journal, &emu.flash, 0, emu.size) == 0);
+    CHECK(sample_journal_pending(&journal) == 0);
+    CHECK(sample_journal_peek(&journal, batch, DRAIN_BATCH) == 0);
+
+    writes = emu.writes;
+    bytes = emu.bytes_written;
+    for ( seq = 1; seq <= 5000; seq++ )
+    {
+        check_seq_sample(seq, &expect);
+        CHECK(sample_journal_append(&journal, &expect) == 0);
+    }
+    CHECK(sample_journal_flush(&journal) == 0);
+    CHECK(journal.stats.staged == 0);
+    pending = sample_journal_pending(&journal);
+    printf("append: %.3f flash writes, %.1f bytes of flash per reading, %.1f readings per record\n",
+           (double)( emu.writes - writes ) / 5000, (double)( emu.bytes_written - bytes ) / 5000, 5000.0 / pending);
+
+    /* Reopen, drain half, reopen again and drain the rest */
+    CHECK(sample_journal_open(&journal, &emu.flash, 0, emu.size) == 0);
+    CHECK(sample_journal_pending(&journal) == pending);
+    reads = emu.reads;
+    writes = emu.writes;
+    while ( next <= 2500 )
+    {
+        n = sample_journal_peek(&journal, batch, DRAIN_BATCH);
+        CHECK(n > 0);
+        for ( i = 0; i < n; i++ )
+        {
+            check_seq_sample(next++, &expect);
+            CHECK(same_sample(&batch[i], &expect));
+        }
+        CHECK(sample_journal_consume(&journal) == 0);
+    }
+    pending = sample_journal_pending(&journal);
+    CHECK(sample_journal_open(&journal, &emu.flash, 0, emu.size) == 0);
+    CHECK(sample_journal_pending(&journal) == pending);
+    while ( ( n = sample_journal_peek(&journal, batch, DRAIN_BATCH) ) > 0 )
+    {
+        for ( i = 0; i < n; i++ )
+        {
+            check_seq_sample(next++, &expect);
+            CHECK(same_sample(&batch[i], &expect));
+        }
+        CHECK(sample_journal_consume(&journal) == 0);
+    }
+    CHECK(n == 0);
+    CHECK(next == 5001);
+    CHECK(sample_journal_pending(&journal) == 0);
+    printf("drain: %.3f flash reads, %.3f flash writes per reading in batches of %d\n",
+           (double)( emu.reads - reads ) / 5000, (double)( emu.writes - writes ) / 5000, DRAIN_BATCH);
+
+    CHECK(sample_journal_open(&journal, &emu.flash, 0, emu.size) == 0);
+    CHECK(sample_journal_pending(&journal) == 0);
+    journal_flash_file_close(&emu);
+}
+
+static void check_wrap(const char* path)
+{
+    journal_flash_file_t emu;
+    sample_journal_t journal;
+    sample_journal_stats_t stats;
+    watson_sample_t batch[DRAIN_BATCH];
+    uint32_t sectors = 8;
+    uint32_t total;
+    uint32_t seq;
+    uint32_t next;
+    uint32_t min_erases = 0xFFFFFFFFU;
+    uint32_t max_erases = 0;
+    uint32_t i;
+    int32_t n;
+
+    open_image(&emu, path, sectors * SECTOR_SIZE);
+    CHECK(sample_journal_open(&journal, &emu.flash, 0, emu.size) == 0);
+    total = journal.stats.capacity * SAMPLE_JOURNAL_RECORD_SAMPLES * 20 + 17;
+    for ( seq = 1; seq <= total; seq++ )
+    {
+        watson_sample_t sample;
+
+        check_seq_sample(seq, &sample);
+        CHECK(sample_journal_append(&journal, &sample) == 0);
+    }
+    CHECK(sample_journal_flush(&journal) == 0);
+    sample_journal_get_stats(&journal, &stats);
+    CHECK(stats.appended == total);
+    CHECK(stats.pending > journal.stats.capacity - journal.records_per_sector);
+
+    /* The survivors are the newest readings, in order, and a reopen finds the same */
+    CHECK(sample_journal_open(&journal, &emu.flash, 0, emu.size) == 0);
+    CHECK(sample_journal_pending(&journal) == stats.pending);
+    next = stats.dropped + 1;
+    while ( ( n = sample_journal_peek(&journal, batch, DRAIN_BATCH) ) > 0 )
+    {
+        for ( i = 0; i < (uint32_t)n; i++ )
+        {
+            CHECK(batch[i].seq == next++);
+        }
+        CHECK(sample_journal_consume(&journal) == 0);
+    }
+    CHECK(n == 0);
+    CHECK(next == total + 1);
+
+    for ( i = 0; i < sectors; i++ )
+    {
+        min_erases = ( emu.erases[i] < min_erases ) ? emu.erases[i] : min_erases;
+        max_erases = ( emu.erases[i] > max_erases ) ? emu.erases[i] : max_erases;
+    }
+    printf("wrap: %u readings into %u records, %u dropped, erases per sector %u to %u\n", (unsigned)total,
+           (unsigned)stats.capacity, (unsigned)stats.dropped, (unsigned)min_erases, (unsigned)max_erases);
+    CHECK(max_erases - min_erases <= 1);
+    journal_flash_file_close(&emu);
+}
+
+static void check_power_cuts(const char* path)
+{
+    journal_flash_file_t emu;
+    sample_journal_t journal;
+    watson_sample_t batch[2 * DRAIN_BATCH];
+    watson_sample_t expect;
+    uint8_t* delivered = calloc(TORTURE_READINGS + 2, 1);
+    uint8_t* acked = calloc(TORTURE_READINGS + 2, 1);
+    uint32_t next_seq = 1;
+    uint32_t staged_from;       /* First seq of the readings staged in RAM */
+    uint32_t committed = 0;     /* Highest seq whose consume returned success */
+    uint32_t last;              /* Highest seq delivered since the last reopen */
+    uint32_t cuts = 0;
+    uint32_t torn = 0;
+    uint32_t round;
+    uint32_t seq;
+    uint32_t peeks;
+    int32_t n;
+    int32_t i;
+
+    CHECK(( delivered != NULL ) && ( acked != NULL ));
+    /* Large enough that nothing is dropped, so every acknowledged reading must come out */
+    open_image(&emu, path, 128 * SECTOR_SIZE);
+    for ( round = 0; ( round < TORTURE_ROUNDS ) && ( next_seq <= TORTURE_READINGS ); round++ )
+    {
+        journal_flash_file_power_on(&emu);
+        CHECK(sample_journal_open(&journal, &emu.flash, 0, emu.size) == 0);
+        last = committed;
+        staged_from = next_seq;
+        journal_flash_file_arm(&emu, rand() % 3000);
+        while ( !emu.power_lost && ( next_seq <= TORTURE_READINGS ) )
+        {
+            if ( rand() % 64 != 0 )
+            {
+                /* Readings are acknowledged once the record holding them is written */
+                check_seq_sample(next_seq, &expect);
+                if ( sample_journal_append(&journal, &expect) != 0 )
+                {
+                    staged_from = next_seq;
+                }
+                else if ( journal.stats.staged == 1 )
+                {
+                    for ( ; staged_from < next_seq; staged_from++ )
+                    {
+                        acked[staged_from] = 1;
+                    }
+                }
+                next_seq++;
+                continue;
+            }
+            if ( sample_journal_flush(&journal) == 0 )
+            {
+                for ( ; staged_from < next_seq; staged_from++ )
+                {
+                    acked[staged_from] = 1;
+                }
+            }
+            staged_from = next_seq;
+            /* Up to three batches in flight before the consume */
+            peeks = 1 + rand() % 3;
+            n = sample_journal_peek(&journal, batch, DRAIN_BATCH + rand() % DRAIN_BATCH);
+            while ( n > 0 )
+            {
+                for ( i = 0; i < n; i++ )
+                {
+                    seq = batch[i].seq;
+                    check_seq_sample(seq, &expect);
+                    CHECK(( seq > 0 ) && ( seq < next_seq ) && same_sample(&batch[i], &expect));
+                    CHECK(seq > committed);
+                    CHECK(seq > last);
+                    last = seq;
+                    /* Published; a consume cut short only means it may come out again */
+                    delivered[seq] = 1;
+                }
+                if ( --peeks == 0 )
+                {
+                    break;
+                }
+                n = sample_journal_peek_more(&journal, batch, DRAIN_BATCH + rand() % DRAIN_BATCH);
+            }
+            if ( ( last > committed ) && ( sample_journal_consume(&journal) == 0 ) )
+            {
+                committed = last;
+            }
+            /* A peek after a failed consume starts again from the tail */
+            last = committed;
+        }
+        cuts += emu.power_lost;
+        torn += journal.stats.corrupt;
+    }
+
+    /* Power stays on: everything acknowledged and not yet delivered comes out now */
+    journal_flash_file_power_on(&emu);
+    CHECK(sample_journal_open(&journal, &emu.flash, 0, emu.size) == 0);
+    while ( ( n = sample_journal_peek(&journal, batch, DRAIN_BATCH) ) > 0 )
+    {
+        for ( i = 0; i < n; i++ )
+        {
+            seq = batch[i].seq;
+            check_seq_sample(seq, &expect);
+            CHECK(( seq > committed ) && ( seq < next_seq ) && same_sample(&batch[i], &expect));
+            committed = seq;
+            delivered[seq] = 1;
+        }
+        CHECK(sample_journal_consume(&journal) == 0);
+    }
+    CHECK(n == 0);
+    torn += journal.stats.corrupt;
+    for ( seq = 1; seq < next_seq; seq++ )
+    {
+        CHECK(!acked[seq] || delivered[seq]);
+    }
+    printf("power cuts: %u cuts over %u readings, no acknowledged reading lost, %u torn records skipped\n",
+           (unsigned)cuts, (unsigned)( next_seq - 1 ), (unsigned)torn);
+    free(delivered);
+    free(acked);
+    journal_flash_file_close(&emu);
+}
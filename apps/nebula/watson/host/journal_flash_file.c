@@ -0,0 +1,171 @@
+/** @file
+ *  File backed NOR flash emulator for the host build of the sample journal.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "journal_flash_file.h"
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+static int32_t emu_read(void* context, uint32_t address, void* data, uint32_t len);
+static int32_t emu_write(void* context, uint32_t address, const void* data, uint32_t len);
+static int32_t emu_erase(void* context, uint32_t address);
+static int32_t spend(journal_flash_file_t* emu);
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+int journal_flash_file_open(journal_flash_file_t* emu, const char* path, uint32_t size, uint32_t sector_size)
+{
+    long len;
+
+    memset(emu, 0, sizeof(*emu));
+    emu->file = fopen(path, "r+b");
+    if ( emu->file == NULL )
+    {
+        emu->file = fopen(path, "w+b");
+    }
+    if ( ( emu->file == NULL ) || ( sector_size == 0 ) || ( size % sector_size != 0 ) )
+    {
+        return -1;
+    }
+    fseek(emu->file, 0, SEEK_END);
+    for ( len = ftell(emu->file); len < (long)size; len++ )
+    {
+        fputc(0xFF, emu->file);
+    }
+    fflush(emu->file);
+
+    emu->size = size;
+    emu->budget = -1;
+    emu->erases = calloc(size / sector_size, sizeof(uint32_t));
+    emu->flash.context = emu;
+    emu->flash.read = emu_read;
+    emu->flash.write = emu_write;
+    emu->flash.erase = emu_erase;
+    emu->flash.sector_size = sector_size;
+    return ( emu->erases != NULL ) ? 0 : -1;
+}
+
+void journal_flash_file_close(journal_flash_file_t* emu)
+{
+    if ( emu->file != NULL )
+    {
+        fclose(emu->file);
+    }
+    free(emu->erases);
+    memset(emu, 0, sizeof(*emu));
+}
+
+void journal_flash_file_arm(journal_flash_file_t* emu, int32_t budget)
+{
+    emu->budget = budget;
+}
+
+void journal_flash_file_power_on(journal_flash_file_t* emu)
+{
+    emu->power_lost = 0;
+    emu->budget = -1;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+static int32_t emu_read(void* context, uint32_t address, void* data, uint32_t len)
+{
+    journal_flash_file_t* emu = context;
+
+    if ( emu->power_lost || ( address + len > emu->size ) || ( len == 0 ) )
+    {
+        return -1;
+    }
+    emu->reads++;
+    emu->bytes_read += len;
+    fseek(emu->file, (long)address, SEEK_SET);
+    return ( fread(data, 1, len, emu->file) == len ) ? 0 : -1;
+}
+
+static int32_t emu_write(void* context, uint32_t address, const void* data, uint32_t len)
+{
+    journal_flash_file_t* emu = context;
+    const uint8_t* in = data;
+    uint8_t cell;
+    uint32_t i;
+
+    if ( emu->power_lost || ( address + len > emu->size ) || ( len == 0 ) )
+    {
+        return -1;
+    }
+    emu->writes++;
+    for ( i = 0; i < len; i++ )
+    {
+        fseek(emu->file, (long)( address + i ), SEEK_SET);
+        cell = (uint8_t)fgetc(emu->file);
+        if ( spend(emu) != 0 )
+        {
+            /* Cut part way through the byte */
+            cell &= (uint8_t)( in[i] | rand() );
+        }
+        else
+        {
+            cell &= in[i];
+        }
+        fseek(emu->file, (long)( address + i ), SEEK_SET);
+        fputc(cell, emu->file);
+        if ( emu->power_lost )
+        {
+            fflush(emu->file);
+            return -1;
+        }
+        emu->bytes_written++;
+    }
+    fflush(emu->file);
+    return 0;
+}
+
+static int32_t emu_erase(void* context, uint32_t address)
+{
+    journal_flash_file_t* emu = context;
+    uint32_t sector_size = emu->flash.sector_size;
+    uint32_t start = address - address % sector_size;
+    uint32_t len = sector_size;
+    uint32_t i;
+
+    if ( emu->power_lost || ( address >= emu->size ) )
+    {
+        return -1;
+    }
+    if ( spend(emu) != 0 )
+    {
+        len = (uint32_t)rand() % sector_size;
+    }
+    fseek(emu->file, (long)start, SEEK_SET);
+    for ( i = 0; i < len; i++ )
+    {
+        fputc(0xFF, emu->file);
+    }
+    fflush(emu->file);
+    if ( emu->power_lost )
+    {
+        return -1;
+    }
+    emu->erases[start / sector_size]++;
+    return 0;
+}
+
+/* Returns nonzero when this operation is the one the power cut hits */
+static int32_t spend(journal_flash_file_t* emu)
+{
+    if ( emu->budget < 0 )
+    {
+        return 0;
+    }
+    if ( emu->budget-- == 0 )
+    {
+        emu->power_lost = 1;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+/** @file
+ *  File backed NOR flash emulator for the host build of the sample journal.
+ *
+ *  Programming only clears bits and erasing sets a whole sector to 0xFF, as on the serial flash of
+ *  the board. A power cut can be armed to stop the emulated flash part way through a program or an
+ *  erase: the byte being programmed keeps a random subset of its new zero bits, an erase leaves a
+ *  random part of the sector erased, and every access fails until power is restored.
+ */
+
+#ifndef APPS_NEBULA_WATSON_HOST_JOURNAL_FLASH_FILE_H_
+#define APPS_NEBULA_WATSON_HOST_JOURNAL_FLASH_FILE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include "sample_journal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+typedef struct
+{
+    FILE*                  file;
+    uint32_t               size;
+    sample_journal_flash_t flash;       /**< Pass to sample_journal_open() */
+    int32_t                budget;      /**< Bytes programmed and sectors erased before the power cut, -1 for none */
+    uint8_t                power_lost;
+    uint32_t               reads;
+    uint32_t               writes;
+    uint32_t               bytes_read;
+    uint32_t               bytes_written;
+    uint32_t*              erases;      /**< Per sector */
+} journal_flash_file_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+/**
+ * Open or create the flash image; a new or short image is padded with erased sectors.
+ *
+ * @return 0, or -1 if the file cannot be used
+ */
+int journal_flash_file_open(journal_flash_file_t* emu, const char* path, uint32_t size, uint32_t sector_size);
+
+void journal_flash_file_close(journal_flash_file_t* emu);
+
+/**
+ * Cut the power after budget more programmed bytes or erased sectors, -1 to never cut it.
+ */
+void journal_flash_file_arm(journal_flash_file_t* emu, int32_t budget);
+
+/**
+ * Restore power after a cut.
+ */
+void journal_flash_file_power_on(journal_flash_file_t* emu);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_HOST_JOURNAL_FLASH_FILE_H_ */
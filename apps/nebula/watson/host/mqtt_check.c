@@ -0,0 +1,569 @@
+/** @file
+ *  Host check of the MQTT request completion table and publish window in mqtt.c.
+ *
+ *  The RTOS, the clock and the MQTT library are stand-ins defined here, on one thread: a wait on a
+ *  semaphore first delivers the next scripted broker event, as the event thread would, and
+ *  otherwise lets its whole timeout pass on the clock. Exits nonzero on the first broken
+ *  expectation:
+ *    - window: a full window holds the next publish back until its timeout, an acknowledgement
+ *      frees a slot, and publishes nobody acknowledges time out at their own deadline;
+ *    - an acknowledgement that comes inside the library call, before its msgid is known;
+ *    - a flush also waits for the callbacks, a publish is counted in flight while its callback runs;
+ *    - a late acknowledgement of a publish that timed out does not complete the next one;
+ *    - the connect succeeds on an accepted CONNACK and fails on a refused or missing one, and the
+ *      subscribe, unsubscribe and close complete through the table;
+ *    - a disconnect fails every publish in flight before the disconnect callback runs;
+ *    - a publish the library refuses has no callback and gives its slot back;
+ *    - TLS sessions: the library's wiced_tls_init_context() reaches the wrapper in mqtt.c through
+ *      -Wl,--wrap, as on the device. The cached session goes into the context of a connect to the
+ *      server it came from and the server resumes it, but not into one to another server, not
+ *      once its lifetime is over, and not into a context set up outside a connect.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "check.h"
+#include "wiced_tls.h"
+#include "mqtt.h"
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+#define WINDOW                  (4)
+#define ASYNC_TIMEOUT_MS        (1000)
+/* WICED_MQTT_TIMEOUT in mqtt.c */
+#define REQUEST_TIMEOUT_MS      (5000)
+#define MAX_SCRIPT              (8)
+#define CONNACK_REFUSED         (5)     /* not authorised */
+#define TLS_LIFETIME_MS         (60 * 1000)
+#define TLS_HANDSHAKE_MS        (300)
+#define BROKER                  (0x0A000001)
+#define OTHER_BROKER            (0x0A000002)
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+typedef struct
+{
+    uint32_t completed;
+    uint32_t timeouts;
+    uint32_t errors;
+    uint32_t in_flight;     /* mqtt_app_publish_in_flight() seen by the last callback */
+} callbacks_t;
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+static void deliver(wiced_mqtt_event_type_t type, wiced_mqtt_msgid_t msgid);
+static void script(wiced_mqtt_event_type_t type, wiced_mqtt_msgid_t msgid);
+static void published(wiced_mqtt_msgid_t msgid, wiced_result_t result, void* arg);
+static void disconnected(void* arg);
+static void reset(void);
+static void check_window(void);
+static void check_ack_inside_call(void);
+static void check_flush(void);
+static void check_late_ack(void);
+static void check_connect(void);
+static void check_disconnect(void);
+static void check_refused(void);
+static void check_tls_session(void);
+static void tls_connect(uint32_t peer);
+
+/******************************************************
+ *               Variable Definitions
+ ******************************************************/
+static wiced_time_t now_ms;
+static wiced_mqtt_msgid_t next_msgid;
+static wiced_mqtt_msgid_t last_msgid;
+/* Broker events delivered by the next waits, in order */
+static wiced_mqtt_event_info_t scripted[MAX_SCRIPT];
+static uint32_t scripted_count;
+/* Library behaviour */
+static wiced_bool_t ack_inside_call;
+static wiced_bool_t refuse_publish;
+static wiced_bool_t send_connack;
+static uint8_t connack_code;
+static callbacks_t callbacks;
+static uint32_t disconnect_calls;
+static uint32_t errors_at_disconnect;
+/* TLS: the context of the last handshake, the session the library offered in it and the one the
+ * server keeps */
+static wiced_tls_context_t tls_context;
+static wiced_tls_session_t tls_offered;
+static wiced_tls_session_t tls_server_session;
+static uint32_t tls_handshakes;
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+int main(void)
+{
+    CHECK(mqtt_app_init(0) == WICED_BADARG);
+    CHECK(mqtt_app_init(MQTT_PUBLISH_WINDOW_MAX + 1) == WICED_BADARG);
+
+    check_window();
+    check_ack_inside_call();
+    check_flush();
+    check_late_ack();
+    check_connect();
+    check_disconnect();
+    check_refused();
+    check_tls_session();
+    printf("all checks passed\n");
+    return 0;
+}
+
+/******************************************************
+ *           RTOS and MQTT library stand-ins
+ ******************************************************/
+wiced_result_t wiced_time_get_time(wiced_time_t* time_ptr)
+{
+    *time_ptr = now_ms;
+    return WICED_SUCCESS;
+}
+
+wiced_result_t wiced_rtos_init_mutex(wiced_mutex_t* mutex)
+{
+    UNUSED_PARAMETER(mutex);
+    return WICED_SUCCESS;
+}
+
+wiced_result_t wiced_rtos_lock_mutex(wiced_mutex_t* mutex)
+{
+    UNUSED_PARAMETER(mutex);
+    return WICED_SUCCESS;
+}
+
+wiced_result_t wiced_rtos_unlock_mutex(wiced_mutex_t* mutex)
+{
+    UNUSED_PARAMETER(mutex);
+    return WICED_SUCCESS;
+}
+
+wiced_result_t wiced_rtos_init_semaphore(wiced_semaphore_t* semaphore)
+{
+    UNUSED_PARAMETER(semaphore);
+    return WICED_SUCCESS;
+}
+
+wiced_result_t wiced_rtos_set_semaphore(wiced_semaphore_t* semaphore)
+{
+    UNUSED_PARAMETER(semaphore);
+    return WICED_SUCCESS;
+}
+
+wiced_result_t wiced_rtos_get_semaphore(wiced_semaphore_t* semaphore, uint32_t timeout_ms)
+{
+    wiced_mqtt_event_info_t event;
+
+    UNUSED_PARAMETER(semaphore);
+    if ( scripted_count == 0 )
+    {
+        now_ms += timeout_ms;
+        return WICED_TIMEOUT;
+    }
+    event = scripted[0];
+    memmove(&scripted[0], &scripted[1], --scripted_count * sizeof(scripted[0]));
+    now_ms += 1;
+    mqtt_connection_event_cb(NULL, &event);
+    return WICED_SUCCESS;
+}
+
+wiced_result_t wiced_mqtt_connect(wiced_mqtt_object_t mqtt_obj, wiced_ip_address_t* address, wiced_interface_t interface,
+        wiced_mqtt_callback_t callback, wiced_mqtt_security_t* security, wiced_mqtt_pkt_connect_t* conninfo)
+{
+    wiced_mqtt_event_info_t event;
+
+    UNUSED_PARAMETER(mqtt_obj);
+    UNUSED_PARAMETER(address);
+    UNUSED_PARAMETER(interface);
+    UNUSED_PARAMETER(callback);
+    UNUSED_PARAMETER(conninfo);
+    if ( security != NULL )
+    {
+        /* A new context for the handshake, through the wrapper. The server resumes the session it
+         * knows and makes a new one for anything else */
+        CHECK(wiced_tls_init_context(&tls_context, NULL, NULL) == WICED_SUCCESS);
+        tls_offered = tls_context.session;
+        if ( ( tls_offered.length == 0 ) ||
+             ( memcmp(&tls_offered, &tls_server_session, sizeof(tls_offered)) != 0 ) )
+        {
+            tls_handshakes++;
+            memset(&tls_server_session, 0, sizeof(tls_server_session));
+            tls_server_session.cipher = 0xC02F;
+            tls_server_session.length = sizeof(tls_server_session.id);
+            memset(tls_server_session.id, (int)tls_handshakes, sizeof(tls_server_session.id));
+            memset(tls_server_session.master, (int)( 0x80 + tls_handshakes ), sizeof(tls_server_session.master));
+        }
+        tls_context.session = tls_server_session;
+        now_ms += TLS_HANDSHAKE_MS;
+    }
+    if ( send_connack )
+    {
+        CHECK(scripted_count < MAX_SCRIPT);
+        memset(&event, 0, sizeof(event));
+        event.type = WICED_MQTT_EVENT_TYPE_CONNECT_REQ_STATUS;
+        event.data.conn_ack.err_code = connack_code;
+        scripted[scripted_count++] = event;
+    }
+    return WICED_SUCCESS;
+}
+
+wiced_result_t wiced_mqtt_disconnect(wiced_mqtt_object_t mqtt_obj)
+{
+    UNUSED_PARAMETER(mqtt_obj);
+    script(WICED_MQTT_EVENT_TYPE_DISCONNECTED, 0);
+    return WICED_SUCCESS;
+}
+
+wiced_mqtt_msgid_t wiced_mqtt_subscribe(wiced_mqtt_object_t mqtt_obj, char* topic, uint8_t qos)
+{
+    UNUSED_PARAMETER(mqtt_obj);
+    UNUSED_PARAMETER(topic);
+    UNUSED_PARAMETER(qos);
+    last_msgid = next_msgid++;
+    return last_msgid;
+}
+
+wiced_mqtt_msgid_t wiced_mqtt_unsubscribe(wiced_mqtt_object_t mqtt_obj, char* topic)
+{
+    UNUSED_PARAMETER(mqtt_obj);
+    UNUSED_PARAMETER(topic);
+    last_msgid = next_msgid++;
+    return last_msgid;
+}
+
+wiced_mqtt_msgid_t wiced_mqtt_publish(wiced_mqtt_object_t mqtt_obj, char* topic, uint8_t* data, uint32_t data_len, uint8_t qos)
+{
+    UNUSED_PARAMETER(mqtt_obj);
+    UNUSED_PARAMETER(topic);
+    UNUSED_PARAMETER(data);
+    UNUSED_PARAMETER(data_len);
+    UNUSED_PARAMETER(qos);
+    if ( refuse_publish )
+    {
+        return 0;
+    }
+    last_msgid = next_msgid++;
+    if ( ack_inside_call )
+    {
+        /* The PUBACK is handled on the event thread before the call returns */
+        deliver(WICED_MQTT_EVENT_TYPE_PUBLISHED, last_msgid);
+    }
+    return last_msgid;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+static void deliver(wiced_mqtt_event_type_t type, wiced_mqtt_msgid_t msgid)
+{
+    wiced_mqtt_event_info_t event;
+
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.data.msgid = msgid;
+    mqtt_connection_event_cb(NULL, &event);
+}
+
+static void script(wiced_mqtt_event_type_t type, wiced_mqtt_msgid_t msgid)
+{
+    CHECK(scripted_count < MAX_SCRIPT);
+    memset(&scripted[scripted_count], 0, sizeof(scripted[0]));
+    scripted[scripted_count].type = type;
+    scripted[scripted_count].data.msgid = msgid;
+    scripted_count++;
+}
+
+static void published(wiced_mqtt_msgid_t msgid, wiced_result_t result, void* arg)
+{
+    callbacks_t* counts = (callbacks_t*)arg;
+
+    UNUSED_PARAMETER(msgid);
+    if ( result == WICED_SUCCESS )
+    {
+        counts->completed++;
+    }
+    else if ( result == WICED_TIMEOUT )
+    {
+        counts->timeouts++;
+    }
+    else
+    {
+        counts->errors++;
+    }
+    counts->in_flight = mqtt_app_publish_in_flight();
+}
+
+static void disconnected(void* arg)
+{
+    callbacks_t* counts = (callbacks_t*)arg;
+
+    disconnect_calls++;
+    errors_at_disconnect = counts->errors;
+}
+
+/* A fresh table and library, the clock goes on */
+static void reset(void)
+{
+    CHECK(mqtt_app_init(WINDOW) == WICED_SUCCESS);
+    mqtt_app_set_disconnect_callback(NULL, NULL);
+    memset(&callbacks, 0, sizeof(callbacks));
+    next_msgid = 1;
+    scripted_count = 0;
+    ack_inside_call = WICED_FALSE;
+    refuse_publish = WICED_FALSE;
+    send_connack = WICED_TRUE;
+    connack_code = 0;
+}
+
+static void check_window(void)
+{
+    uint8_t data[] = "x";
+    mqtt_app_stats_t stats;
+    wiced_time_t start;
+    uint32_t i;
+
+    reset();
+    for ( i = 0; i < WINDOW; i++ )
+    {
+        CHECK(mqtt_app_publish_async(NULL, 1, "t", data, 1, published, &callbacks, ASYNC_TIMEOUT_MS) == WICED_SUCCESS);
+    }
+    CHECK(mqtt_app_publish_in_flight() == WINDOW);
+
+    /* Full: the next publish waits out its timeout */
+    start = now_ms;
+    CHECK(mqtt_app_publish_async(NULL, 1, "t", data, 1, published, &callbacks, ASYNC_TIMEOUT_MS) == WICED_TIMEOUT);
+    CHECK(now_ms - start >= ASYNC_TIMEOUT_MS);
+    CHECK(mqtt_app_publish_in_flight() == WINDOW);
+
+    /* An acknowledgement frees a slot, out of order */
+    deliver(WICED_MQTT_EVENT_TYPE_PUBLISHED, 2);
+    CHECK(callbacks.completed == 1);
+    CHECK(mqtt_app_publish_in_flight() == WINDOW - 1);
+    CHECK(mqtt_app_publish_async(NULL, 1, "t", data, 1, published, &callbacks, ASYNC_TIMEOUT_MS) == WICED_SUCCESS);
+
+    /* Nothing more is acknowledged: each times out at its own deadline and the flush returns */
+    start = now_ms;
+    CHECK(mqtt_app_publish_flush(2 * REQUEST_TIMEOUT_MS) == WICED_SUCCESS);
+    CHECK(now_ms - start <= REQUEST_TIMEOUT_MS);
+    CHECK(callbacks.timeouts == WINDOW);
+    CHECK(callbacks.errors == 0);
+    CHECK(mqtt_app_publish_in_flight() == 0);
+
+    /* Their acknowledgements come too late */
+    deliver(WICED_MQTT_EVENT_TYPE_PUBLISHED, 1);
+    mqtt_app_get_stats(&stats);
+    CHECK(stats.completed == 1);
+    CHECK(stats.timeouts == WINDOW);
+    CHECK(stats.unmatched == 1);
+}
+
+static void check_ack_inside_call(void)
+{
+    uint8_t data[] = "x";
+    mqtt_app_stats_t stats;
+    wiced_time_t start;
+
+    reset();
+    ack_inside_call = WICED_TRUE;
+    CHECK(mqtt_app_publish_async(NULL, 1, "t", data, 1, published, &callbacks, ASYNC_TIMEOUT_MS) == WICED_SUCCESS);
+    CHECK(callbacks.completed == 1);
+    CHECK(mqtt_app_publish_in_flight() == 0);
+
+    start = now_ms;
+    CHECK(mqtt_app_publish(NULL, 1, "t", data, 1) == WICED_SUCCESS);
+    CHECK(now_ms == start);
+
+    mqtt_app_get_stats(&stats);
+    CHECK(stats.completed == 2);
+    CHECK(stats.unmatched == 0);
+}
+
+static void check_flush(void)
+{
+    uint8_t data[] = "x";
+    uint32_t i;
+
+    reset();
+    for ( i = 0; i < WINDOW; i++ )
+    {
+        CHECK(mqtt_app_publish_async(NULL, 1, "t", data, 1, published, &callbacks, ASYNC_TIMEOUT_MS) == WICED_SUCCESS);
+    }
+    for ( i = 0; i < WINDOW; i++ )
+    {
+        script(WICED_MQTT_EVENT_TYPE_PUBLISHED, (wiced_mqtt_msgid_t)( WINDOW - i ));
+    }
+    CHECK(mqtt_app_publish_flush(ASYNC_TIMEOUT_MS) == WICED_SUCCESS);
+    CHECK(callbacks.completed == WINDOW);
+    CHECK(mqtt_app_publish_in_flight() == 0);
+    /* The last callback still counted its own publish in flight */
+    CHECK(callbacks.in_flight == 1);
+}
+
+static void check_late_ack(void)
+{
+    uint8_t data[] = "x";
+    mqtt_app_stats_t stats;
+    wiced_mqtt_msgid_t timed_out;
+    wiced_time_t start;
+
+    reset();
+    start = now_ms;
+    CHECK(mqtt_app_publish(NULL, 1, "t", data, 1) == WICED_ERROR);
+    CHECK(now_ms - start >= REQUEST_TIMEOUT_MS);
+    timed_out = last_msgid;
+
+    /* The acknowledgement of the first arrives while the second waits, the second stays unanswered */
+    script(WICED_MQTT_EVENT_TYPE_PUBLISHED, timed_out);
+    start = now_ms;
+    CHECK(mqtt_app_publish(NULL, 1, "t", data, 1) == WICED_ERROR);
+    CHECK(now_ms - start >= REQUEST_TIMEOUT_MS);
+
+    script(WICED_MQTT_EVENT_TYPE_PUBLISHED, next_msgid);
+    CHECK(mqtt_app_publish(NULL, 1, "t", data, 1) == WICED_SUCCESS);
+
+    mqtt_app_get_stats(&stats);
+    CHECK(stats.timeouts == 2);
+    CHECK(stats.unmatched == 1);
+    CHECK(stats.completed == 1);
+}
+
+static void check_connect(void)
+{
+    wiced_ip_address_t address;
+    mqtt_app_stats_t stats;
+    wiced_time_t start;
+
+    memset(&address, 0, sizeof(address));
+    reset();
+    CHECK(mqtt_conn_open(NULL, &address, WICED_STA_INTERFACE, mqtt_connection_event_cb, NULL, "check") == WICED_SUCCESS);
+
+    script(WICED_MQTT_EVENT_TYPE_SUBCRIBED, next_msgid);
+    CHECK(mqtt_app_subscribe(NULL, "t", 1) == WICED_SUCCESS);
+    script(WICED_MQTT_EVENT_TYPE_UNSUBSCRIBED, next_msgid);
+    CHECK(mqtt_app_unsubscribe(NULL, "t") == WICED_SUCCESS);
+    CHECK(mqtt_conn_close(NULL) == WICED_SUCCESS);
+
+    /* The broker answers, but refuses */
+    connack_code = CONNACK_REFUSED;
+    start = now_ms;
+    CHECK(mqtt_conn_open(NULL, &address, WICED_STA_INTERFACE, mqtt_connection_event_cb, NULL, "check") == WICED_ERROR);
+    CHECK(now_ms - start < REQUEST_TIMEOUT_MS);
+
+    /* The broker does not answer */
+    send_connack = WICED_FALSE;
+    start = now_ms;
+    CHECK(mqtt_conn_open(NULL, &address, WICED_STA_INTERFACE, mqtt_connection_event_cb, NULL, "check") == WICED_ERROR);
+    CHECK(now_ms - start >= REQUEST_TIMEOUT_MS);
+
+    mqtt_app_get_stats(&stats);
+    CHECK(stats.completed == 4);
+    CHECK(stats.failed == 1);
+    CHECK(stats.timeouts == 1);
+}
+
+static void check_disconnect(void)
+{
+    uint8_t data[] = "x";
+    uint32_t i;
+
+    reset();
+    mqtt_app_set_disconnect_callback(disconnected, &callbacks);
+    disconnect_calls = 0;
+    for ( i = 0; i < WINDOW - 1; i++ )
+    {
+        CHECK(mqtt_app_publish_async(NULL, 1, "t", data, 1, published, &callbacks, ASYNC_TIMEOUT_MS) == WICED_SUCCESS);
+    }
+    deliver(WICED_MQTT_EVENT_TYPE_DISCONNECTED, 0);
+    CHECK(callbacks.errors == WINDOW - 1);
+    CHECK(mqtt_app_publish_in_flight() == 0);
+    CHECK(disconnect_calls == 1);
+    CHECK(errors_at_disconnect == WINDOW - 1);
+
+    /* Nothing is left to time out */
+    CHECK(mqtt_app_publish_flush(0) == WICED_SUCCESS);
+    CHECK(callbacks.timeouts == 0);
+}
+
+static void check_refused(void)
+{
+    uint8_t data[] = "x";
+    mqtt_app_stats_t stats;
+
+    reset();
+    refuse_publish = WICED_TRUE;
+    CHECK(mqtt_app_publish_async(NULL, 1, "t", data, 1, published, &callbacks, ASYNC_TIMEOUT_MS) == WICED_ERROR);
+    CHECK(mqtt_app_publish(NULL, 1, "t", data, 1) == WICED_ERROR);
+    CHECK(mqtt_app_publish_in_flight() == 0);
+    CHECK(callbacks.completed + callbacks.timeouts + callbacks.errors == 0);
+
+    mqtt_app_get_stats(&stats);
+    CHECK(stats.completed + stats.failed + stats.timeouts == 0);
+}
+
+static void check_tls_session(void)
+{
+    tls_session_cache_t cache;
+    tls_session_stats_t stats;
+    wiced_tls_context_t other;
+
+    reset();
+    tls_session_cache_init(&cache, TLS_LIFETIME_MS);
+    mqtt_app_set_tls_session_cache(&cache);
+
+    /* Nothing cached: a full handshake, its session is kept */
+    tls_connect(BROKER);
+    CHECK(tls_offered.length == 0);
+    CHECK(cache.session.peer == BROKER);
+    CHECK(cache.session.id_length == sizeof(tls_server_session.id));
+    CHECK(memcmp(cache.session.id, tls_server_session.id, sizeof(cache.session.id)) == 0);
+
+    /* The same server: the session goes into the context and is resumed */
+    tls_connect(BROKER);
+    CHECK(tls_offered.length == sizeof(tls_offered.id));
+    CHECK(memcmp(&tls_offered, &tls_server_session, sizeof(tls_offered)) == 0);
+    CHECK(tls_handshakes == 1);
+
+    /* A context set up outside a connect is left alone */
+    memset(&other, 0xFF, sizeof(other));
+    CHECK(wiced_tls_init_context(&other, NULL, NULL) == WICED_SUCCESS);
+    CHECK(other.session.length == 0);
+
+    /* Another server does not get it, and its own session replaces it */
+    tls_connect(OTHER_BROKER);
+    CHECK(tls_offered.length == 0);
+    CHECK(tls_handshakes == 2);
+    CHECK(cache.session.peer == OTHER_BROKER);
+
+    /* Nor does the server it came from once it expired */
+    now_ms += TLS_LIFETIME_MS;
+    tls_connect(OTHER_BROKER);
+    CHECK(tls_offered.length == 0);
+    CHECK(tls_handshakes == 3);
+
+    tls_session_get_stats(&cache, &stats);
+    CHECK(stats.full == 3);
+    CHECK(stats.resumed == 1);
+    CHECK(stats.refused == 0);
+    CHECK(stats.failed == 0);
+    CHECK(stats.resumed_ms == TLS_HANDSHAKE_MS);
+
+    /* Without a cache the context keeps what the library set up */
+    mqtt_app_set_tls_session_cache(NULL);
+    tls_connect(OTHER_BROKER);
+    CHECK(tls_offered.length == 0);
+}
+
+static void tls_connect(uint32_t peer)
+{
+    wiced_mqtt_security_t security;
+    wiced_ip_address_t address;
+
+    memset(&security, 0, sizeof(security));
+    memset(&address, 0, sizeof(address));
+    GET_IPV4_ADDRESS(address) = peer;
+    memset(&tls_offered, 0xFF, sizeof(tls_offered));
+    CHECK(mqtt_conn_open(NULL, &address, WICED_STA_INTERFACE, mqtt_connection_event_cb, &security, "check") == WICED_SUCCESS);
+}
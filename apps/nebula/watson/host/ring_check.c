@@ -0,0 +1,311 @@
+/** @file
+ *  Host check of the sample ring.
+ *
+ *  Exits nonzero on the first broken expectation:
+ *    - both policies filled past capacity from one thread: what push returns, the order of the
+ *      samples popped and the dropped, overwritten and high-water counters;
+ *    - a pop racing a write into its slot, staged by leaving the slot sequence odd the way the
+ *      producer does while it copies: SAMPLE_RING_OVERRUN and the overwritten counter;
+ *    - both policies with a producer and a consumer thread. The producer keeps a bounded lead
+ *      over the consumer, so that pops keep racing pushes for the whole run: with drop newest it
+ *      waits while the ring is full and most samples go through it, with drop oldest it stays
+ *      half a ring past a full one, so it keeps rewriting the slots the consumer reads. The
+ *      consumer stalls now and then and the producer pushes on regardless, overflowing the ring.
+ *      Samples come out in seq order and untorn, every sample missing from the sequence is
+ *      counted as dropped or overwritten and nothing is counted twice.
+ *
+ *  Usage: ring_check [samples per threaded run]
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "check.h"
+#include "sample_ring.h"
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+#define THREADED_SAMPLES        (1000000)
+/* Seqs the producer may be ahead of the last one popped, outside the stalls */
+#define DROP_NEWEST_LEAD        (SAMPLE_RING_CAPACITY)
+#define DROP_OLDEST_LEAD        (SAMPLE_RING_CAPACITY + SAMPLE_RING_CAPACITY / 2)
+/* The consumer stalls for STALL_SPIN iterations after one pop in STALL_EVERY */
+#define STALL_EVERY             (1000)
+#define STALL_SPIN              (20000)
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+typedef struct
+{
+    sample_ring_t* ring;
+    uint32_t       samples;
+    uint32_t       accepted;    /* pushes that returned SAMPLE_RING_OK */
+    uint32_t       full;        /* pushes that returned SAMPLE_RING_FULL */
+    uint32_t       lead;
+    uint32_t       popped_seq;  /* last seq popped, written by the consumer */
+    int            stalling;    /* set by the consumer while it stalls */
+    int            done;
+} producer_t;
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+static void check_drop_newest(void);
+static void check_drop_oldest(void);
+static void check_overrun(void);
+static void check_threaded(sample_ring_policy_t policy, uint32_t samples);
+static void* producer_thread(void* arg);
+
+/******************************************************
+ *               Variable Definitions
+ ******************************************************/
+static sample_ring_t ring;
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+int main(int argc, char** argv)
+{
+    uint32_t samples = ( argc > 1 ) ? (uint32_t)strtoul(argv[1], NULL, 0) : THREADED_SAMPLES;
+
+    check_drop_newest();
+    check_drop_oldest();
+    check_overrun();
+    check_threaded(SAMPLE_RING_DROP_NEWEST, samples);
+    check_threaded(SAMPLE_RING_DROP_OLDEST, samples);
+    printf("all checks passed\n");
+    return 0;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+static void check_drop_newest(void)
+{
+    watson_sample_t sample;
+    sample_ring_stats_t stats;
+    uint32_t seq;
+
+    sample_ring_init(&ring, SAMPLE_RING_DROP_NEWEST);
+    CHECK(sample_ring_pop(&ring, &sample) == SAMPLE_RING_EMPTY);
+
+    for ( seq = 1; seq <= SAMPLE_RING_CAPACITY + 5; seq++ )
+    {
+        check_seq_sample(seq, &sample);
+        CHECK(sample_ring_push(&ring, &sample) == ( ( seq <= SAMPLE_RING_CAPACITY ) ? SAMPLE_RING_OK : SAMPLE_RING_FULL ));
+    }
+    sample_ring_get_stats(&ring, &stats);
+    CHECK(stats.pushed == SAMPLE_RING_CAPACITY);
+    CHECK(stats.dropped == 5);
+    CHECK(stats.high_water == SAMPLE_RING_CAPACITY);
+    CHECK(stats.level == SAMPLE_RING_CAPACITY);
+
+    /* The oldest samples are kept */
+    for ( seq = 1; seq <= SAMPLE_RING_CAPACITY; seq++ )
+    {
+        CHECK(sample_ring_pop(&ring, &sample) == SAMPLE_RING_OK);
+        CHECK(sample.seq == seq);
+    }
+    CHECK(sample_ring_pop(&ring, &sample) == SAMPLE_RING_EMPTY);
+
+    sample_ring_get_stats(&ring, &stats);
+    CHECK(stats.popped == SAMPLE_RING_CAPACITY);
+    CHECK(stats.overwritten == 0);
+    CHECK(stats.level == 0);
+}
+
+static void check_drop_oldest(void)
+{
+    watson_sample_t sample;
+    sample_ring_stats_t stats;
+    uint32_t seq;
+
+    sample_ring_init(&ring, SAMPLE_RING_DROP_OLDEST);
+
+    for ( seq = 1; seq <= SAMPLE_RING_CAPACITY + 5; seq++ )
+    {
+        check_seq_sample(seq, &sample);
+        CHECK(sample_ring_push(&ring, &sample) == SAMPLE_RING_OK);
+    }
+    sample_ring_get_stats(&ring, &stats);
+    CHECK(stats.pushed == SAMPLE_RING_CAPACITY + 5);
+    CHECK(stats.dropped == 0);
+    CHECK(stats.high_water == SAMPLE_RING_CAPACITY);
+    CHECK(stats.level == SAMPLE_RING_CAPACITY);
+
+    /* The newest samples are kept, the five oldest are counted once the consumer notices */
+    for ( seq = 6; seq <= SAMPLE_RING_CAPACITY + 5; seq++ )
+    {
+        CHECK(sample_ring_pop(&ring, &sample) == SAMPLE_RING_OK);
+        CHECK(sample.seq == seq);
+    }
+    CHECK(sample_ring_pop(&ring, &sample) == SAMPLE_RING_EMPTY);
+
+    sample_ring_get_stats(&ring, &stats);
+    CHECK(stats.popped == SAMPLE_RING_CAPACITY);
+    CHECK(stats.overwritten == 5);
+    CHECK(stats.level == 0);
+}
+
+static void check_overrun(void)
+{
+    watson_sample_t sample;
+    sample_ring_stats_t stats;
+    uint32_t seq;
+
+    sample_ring_init(&ring, SAMPLE_RING_DROP_OLDEST);
+    for ( seq = 1; seq <= 3; seq++ )
+    {
+        check_seq_sample(seq, &sample);
+        CHECK(sample_ring_push(&ring, &sample) == SAMPLE_RING_OK);
+    }
+
+    /* Stage a producer that lapped the consumer and is halfway through rewriting the oldest slot */
+    ring.slots[0].seq = 2 * SAMPLE_RING_CAPACITY + 1;
+    CHECK(sample_ring_pop(&ring, &sample) == SAMPLE_RING_OVERRUN);
+
+    /* Popping again goes on with the next sample */
+    CHECK(sample_ring_pop(&ring, &sample) == SAMPLE_RING_OK);
+    CHECK(sample.seq == 2);
+    CHECK(sample_ring_pop(&ring, &sample) == SAMPLE_RING_OK);
+    CHECK(sample.seq == 3);
+    CHECK(sample_ring_pop(&ring, &sample) == SAMPLE_RING_EMPTY);
+
+    sample_ring_get_stats(&ring, &stats);
+    CHECK(stats.popped == 2);
+    CHECK(stats.overwritten == 1);
+}
+
+static void check_threaded(sample_ring_policy_t policy, uint32_t samples)
+{
+    producer_t producer;
+    pthread_t thread;
+    watson_sample_t sample;
+    watson_sample_t expected;
+    sample_ring_stats_t stats;
+    sample_ring_result_t result;
+    uint32_t last_seq = 0;
+    uint32_t popped = 0;
+    uint32_t overruns = 0;
+    uint32_t missing = 0;
+    volatile uint32_t spin;
+
+    sample_ring_init(&ring, policy);
+    memset(&producer, 0, sizeof(producer));
+    producer.ring = &ring;
+    producer.samples = samples;
+    producer.lead = ( policy == SAMPLE_RING_DROP_NEWEST ) ? DROP_NEWEST_LEAD : DROP_OLDEST_LEAD;
+    CHECK(pthread_create(&thread, NULL, producer_thread, &producer) == 0);
+
+    for ( ;; )
+    {
+        int done = __atomic_load_n(&producer.done, __ATOMIC_ACQUIRE);
+
+        result = sample_ring_pop(&ring, &sample);
+        if ( result == SAMPLE_RING_EMPTY )
+        {
+            /* The ring was seen empty after the producer finished, nothing can follow */
+            if ( done )
+            {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+        if ( result == SAMPLE_RING_OVERRUN )
+        {
+            overruns++;
+            continue;
+        }
+        CHECK(result == SAMPLE_RING_OK);
+
+        /* In order, untorn, and every seq skipped accounted for below */
+        check_seq_sample(sample.seq, &expected);
+        CHECK(memcmp(&sample, &expected, sizeof(sample)) == 0);
+        CHECK(sample.seq > last_seq);
+        missing += sample.seq - last_seq - 1;
+        last_seq = sample.seq;
+        popped++;
+        __atomic_store_n(&producer.popped_seq, last_seq, __ATOMIC_RELEASE);
+
+        if ( popped % STALL_EVERY == 0 )
+        {
+            __atomic_store_n(&producer.stalling, 1, __ATOMIC_RELEASE);
+            for ( spin = 0; spin < STALL_SPIN; spin++ )
+            {
+            }
+            __atomic_store_n(&producer.stalling, 0, __ATOMIC_RELEASE);
+        }
+    }
+    CHECK(pthread_join(thread, NULL) == 0);
+
+    sample_ring_get_stats(&ring, &stats);
+    CHECK(stats.popped == popped);
+    CHECK(stats.level == 0);
+    /* The bounded lead keeps the consumer in the race, a good part of the samples go through it */
+    CHECK(popped >= samples / 4);
+    CHECK(stats.high_water <= SAMPLE_RING_CAPACITY);
+    if ( policy == SAMPLE_RING_DROP_NEWEST )
+    {
+        /* Rejected samples never get a seq in the ring, the producer hands out the next one */
+        CHECK(producer.accepted + producer.full == samples);
+        CHECK(stats.dropped == producer.full);
+        CHECK(stats.pushed == producer.accepted);
+        CHECK(stats.overwritten == 0);
+        CHECK(overruns == 0);
+        CHECK(missing == 0);
+        CHECK(popped == producer.accepted);
+    }
+    else
+    {
+        CHECK(producer.full == 0);
+        CHECK(stats.dropped == 0);
+        CHECK(stats.pushed == samples);
+        /* The last sample cannot be lapped, so it is always delivered */
+        CHECK(last_seq == samples);
+        CHECK(missing == stats.overwritten);
+        CHECK(popped + stats.overwritten == samples);
+    }
+    if ( stats.dropped + stats.overwritten != 0 )
+    {
+        CHECK(stats.high_water == SAMPLE_RING_CAPACITY);
+    }
+
+    printf("%s: %u samples, %u popped, %u dropped, %u overwritten (%u overruns), high water %u of %u\n",
+           ( policy == SAMPLE_RING_DROP_NEWEST ) ? "drop newest" : "drop oldest", (unsigned)samples,
+           (unsigned)popped, (unsigned)stats.dropped, (unsigned)stats.overwritten, (unsigned)overruns,
+           (unsigned)stats.high_water, (unsigned)SAMPLE_RING_CAPACITY);
+}
+
+static void* producer_thread(void* arg)
+{
+    producer_t* producer = (producer_t*)arg;
+    watson_sample_t sample;
+    uint32_t seq = 1;
+    uint32_t i;
+
+    for ( i = 0; i < producer->samples; i++ )
+    {
+        while ( ( seq - __atomic_load_n(&producer->popped_seq, __ATOMIC_ACQUIRE) > producer->lead ) &&
+                !__atomic_load_n(&producer->stalling, __ATOMIC_ACQUIRE) )
+        {
+            sched_yield();
+        }
+        check_seq_sample(seq, &sample);
+        if ( sample_ring_push(producer->ring, &sample) == SAMPLE_RING_OK )
+        {
+            producer->accepted++;
+            seq++;
+        }
+        else
+        {
+            producer->full++;
+        }
+    }
+    __atomic_store_n(&producer->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
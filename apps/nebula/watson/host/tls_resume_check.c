@@ -0,0 +1,188 @@
+/** @file
+ *  Host check of the TLS session cache against a local TLS server standing in for the broker.
+ *
+ *  Connects repeatedly with OpenSSL, restricted to what the device TLS does: TLS 1.2, resumption by
+ *  session id, no session tickets and no extended master secret. Each session goes through the
+ *  tls_session_t form of the cache and is rebuilt from it for the next connect, as the firmware
+ *  does with the WICED TLS context. Exits nonzero on the first broken expectation:
+ *    - the first connect is a full handshake, the following ones are resumed;
+ *    - a session the server does not know is counted as refused and a full handshake follows;
+ *    - a session is not offered to another server.
+ *  Prints the average time of the full and the resumed handshakes, TCP connect included.
+ *
+ *  Usage: tls_resume_check [host [port [connects]]], a server as started by "make tls-run".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include "check.h"
+#include "tls_session.h"
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+#define LIFETIME_MS             (60 * 60 * 1000)
+#define OTHER_PEER              (0x0A000001)
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+static uint32_t now_ms(void);
+/**
+ * connect to the server once through the cache, returns 1 when resumed
+ */
+static int32_t connect_once(SSL_CTX* ctx, tls_session_cache_t* cache, const struct sockaddr_in* server, uint32_t peer);
+static SSL_SESSION* session_to_openssl(SSL* ssl, const tls_session_t* session);
+static void session_from_openssl(tls_session_t* out, SSL_SESSION* session, uint32_t peer);
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+int main(int argc, char** argv)
+{
+    const char* host = ( argc > 1 ) ? argv[1] : "127.0.0.1";
+    int port = ( argc > 2 ) ? atoi(argv[2]) : 8883;
+    int connects = ( argc > 3 ) ? atoi(argv[3]) : 10;
+    struct sockaddr_in server;
+    tls_session_cache_t cache;
+    tls_session_stats_t stats;
+    SSL_CTX* ctx;
+    uint32_t peer;
+    int i;
+
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_port = htons((uint16_t)port);
+    CHECK(inet_pton(AF_INET, host, &server.sin_addr) == 1);
+    CHECK(connects >= 2);
+    peer = ntohl(server.sin_addr.s_addr);
+
+    ctx = SSL_CTX_new(TLS_client_method());
+    CHECK(ctx != NULL);
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET | SSL_OP_NO_EXTENDED_MASTER_SECRET);
+    /* The stand-in has a self-signed certificate, verification is not what is checked here */
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, NULL);
+
+    tls_session_cache_init(&cache, LIFETIME_MS);
+    CHECK(connect_once(ctx, &cache, &server, peer) == 0);
+    for ( i = 1; i < connects; i++ )
+    {
+        CHECK(connect_once(ctx, &cache, &server, peer) == 1);
+    }
+
+    /* A session the server never issued */
+    cache.session.id[0] ^= 0xFF;
+    CHECK(connect_once(ctx, &cache, &server, peer) == 0);
+    CHECK(cache.stats.refused == 1);
+    CHECK(connect_once(ctx, &cache, &server, peer) == 1);
+
+    /* Same session, another server */
+    CHECK(tls_session_offer(&cache, OTHER_PEER, now_ms()) == NULL);
+    CHECK(cache.session.id_length == 0);
+    CHECK(connect_once(ctx, &cache, &server, peer) == 0);
+
+    tls_session_get_stats(&cache, &stats);
+    CHECK(stats.failed == 0);
+    printf("%u full handshakes, %.2f ms average; %u resumed, %.2f ms average; %u refused\n", (unsigned)stats.full,
+           (double)stats.full_ms / stats.full, (unsigned)stats.resumed, (double)stats.resumed_ms / stats.resumed,
+           (unsigned)stats.refused);
+    SSL_CTX_free(ctx);
+    printf("all checks passed\n");
+    return 0;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+static uint32_t now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)( ts.tv_sec * 1000 + ts.tv_nsec / 1000000 );
+}
+
+static int32_t connect_once(SSL_CTX* ctx, tls_session_cache_t* cache, const struct sockaddr_in* server, uint32_t peer)
+{
+    const tls_session_t* offer;
+    tls_session_t session;
+    SSL_SESSION* resume = NULL;
+    SSL* ssl;
+    uint32_t start;
+    uint32_t end;
+    int32_t resumed;
+    int fd;
+
+    ssl = SSL_new(ctx);
+    CHECK(ssl != NULL);
+    start = now_ms();
+    offer = tls_session_offer(cache, peer, start);
+    if ( offer != NULL )
+    {
+        resume = session_to_openssl(ssl, offer);
+        CHECK(SSL_set_session(ssl, resume) == 1);
+    }
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(fd >= 0);
+    CHECK(connect(fd, (const struct sockaddr*)server, sizeof(*server)) == 0);
+    SSL_set_fd(ssl, fd);
+    if ( SSL_connect(ssl) != 1 )
+    {
+        ERR_print_errors_fp(stderr);
+        CHECK(0);
+    }
+    end = now_ms();
+
+    session_from_openssl(&session, SSL_get_session(ssl), peer);
+    resumed = tls_session_done(cache, &session, end, end - start);
+    /* The cache must tell resumed handshakes the way the TLS library does */
+    CHECK(resumed == SSL_session_reused(ssl));
+
+    SSL_shutdown(ssl);
+    SSL_free(ssl);
+    close(fd);
+    if ( resume != NULL )
+    {
+        SSL_SESSION_free(resume);
+    }
+    return resumed;
+}
+
+static SSL_SESSION* session_to_openssl(SSL* ssl, const tls_session_t* session)
+{
+    SSL_SESSION* out = SSL_SESSION_new();
+    unsigned char suite[2] = { (unsigned char)( session->cipher >> 8 ), (unsigned char)session->cipher };
+    const SSL_CIPHER* cipher = SSL_CIPHER_find(ssl, suite);
+
+    CHECK(( out != NULL ) && ( cipher != NULL ));
+    CHECK(SSL_SESSION_set1_id(out, session->id, session->id_length) == 1);
+    CHECK(SSL_SESSION_set1_master_key(out, session->master, sizeof(session->master)) == 1);
+    CHECK(SSL_SESSION_set_cipher(out, cipher) == 1);
+    CHECK(SSL_SESSION_set_protocol_version(out, TLS1_2_VERSION) == 1);
+    return out;
+}
+
+static void session_from_openssl(tls_session_t* out, SSL_SESSION* session, uint32_t peer)
+{
+    const unsigned char* id;
+    unsigned int id_length;
+
+    memset(out, 0, sizeof(*out));
+    id = SSL_SESSION_get_id(session, &id_length);
+    CHECK(id_length <= TLS_SESSION_ID_LEN);
+    CHECK(SSL_SESSION_get_master_key(session, out->master, sizeof(out->master)) == sizeof(out->master));
+    out->id_length = (uint8_t)id_length;
+    memcpy(out->id, id, id_length);
+    out->cipher = (uint16_t)SSL_CIPHER_get_protocol_id(SSL_SESSION_get0_cipher(session));
+    out->peer = peer;
+}
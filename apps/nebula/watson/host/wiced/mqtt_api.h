@@ -0,0 +1,101 @@
+/** @file
+ *  Host stand-in for the WICED MQTT library API, for mqtt_check.
+ */
+
+#ifndef APPS_NEBULA_WATSON_HOST_WICED_MQTT_API_H_
+#define APPS_NEBULA_WATSON_HOST_WICED_MQTT_API_H_
+
+#include "wiced.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+#define WICED_MQTT_PROTOCOL_VER4                (4)
+#define WICED_MQTT_QOS_DELIVER_AT_MOST_ONCE     (0)
+#define WICED_MQTT_QOS_DELIVER_AT_LEAST_ONCE    (1)
+
+/******************************************************
+ *                   Enumerations
+ ******************************************************/
+/* The library spells the subscribe event WICED_MQTT_EVENT_TYPE_SUBCRIBED, mqtt.c renames it */
+typedef enum
+{
+    WICED_MQTT_EVENT_TYPE_CONNECT_REQ_STATUS   = 0,
+    WICED_MQTT_EVENT_TYPE_DISCONNECTED         = 1,
+    WICED_MQTT_EVENT_TYPE_PUBLISHED            = 2,
+    WICED_MQTT_EVENT_TYPE_PUBLISH_MSG_RECEIVED = 3,
+    WICED_MQTT_EVENT_TYPE_SUBCRIBED            = 4,
+    WICED_MQTT_EVENT_TYPE_UNSUBSCRIBED         = 5,
+} wiced_mqtt_event_type_t;
+
+/******************************************************
+ *                 Type Definitions
+ ******************************************************/
+typedef void* wiced_mqtt_object_t;
+typedef uint16_t wiced_mqtt_msgid_t;
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+typedef struct
+{
+    uint8_t* topic;
+    uint32_t topic_len;
+    uint8_t* data;
+    uint32_t data_len;
+} wiced_mqtt_topic_msg_t;
+
+typedef struct
+{
+    uint8_t err_code;
+} wiced_mqtt_connack_t;
+
+typedef struct
+{
+    wiced_mqtt_event_type_t type;
+    union
+    {
+        wiced_mqtt_connack_t   conn_ack;
+        wiced_mqtt_msgid_t     msgid;
+        wiced_mqtt_topic_msg_t pub_recvd;
+    } data;
+} wiced_mqtt_event_info_t;
+
+typedef wiced_result_t (*wiced_mqtt_callback_t)( wiced_mqtt_object_t mqtt_object, wiced_mqtt_event_info_t* event );
+
+typedef struct
+{
+    int unused;
+} wiced_mqtt_security_t;
+
+typedef struct
+{
+    uint16_t port_number;
+    uint8_t  mqtt_version;
+    uint8_t  clean_session;
+    uint8_t* client_id;
+    uint16_t keep_alive;
+    uint8_t* password;
+    uint8_t* username;
+    uint8_t* peer_cn;
+} wiced_mqtt_pkt_connect_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+wiced_result_t wiced_mqtt_connect( wiced_mqtt_object_t mqtt_obj, wiced_ip_address_t* address, wiced_interface_t interface,
+        wiced_mqtt_callback_t callback, wiced_mqtt_security_t* security, wiced_mqtt_pkt_connect_t* conninfo );
+wiced_result_t wiced_mqtt_disconnect( wiced_mqtt_object_t mqtt_obj );
+wiced_mqtt_msgid_t wiced_mqtt_subscribe( wiced_mqtt_object_t mqtt_obj, char* topic, uint8_t qos );
+wiced_mqtt_msgid_t wiced_mqtt_unsubscribe( wiced_mqtt_object_t mqtt_obj, char* topic );
+wiced_mqtt_msgid_t wiced_mqtt_publish( wiced_mqtt_object_t mqtt_obj, char* topic, uint8_t* data, uint32_t data_len, uint8_t qos );
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_HOST_WICED_MQTT_API_H_ */
@@ -0,0 +1,10 @@
+/** @file
+ *  Host stand-in for the WICED MQTT library common header, for mqtt_check.
+ */
+
+#ifndef APPS_NEBULA_WATSON_HOST_WICED_MQTT_COMMON_H_
+#define APPS_NEBULA_WATSON_HOST_WICED_MQTT_COMMON_H_
+
+#include "mqtt_api.h"
+
+#endif /* APPS_NEBULA_WATSON_HOST_WICED_MQTT_COMMON_H_ */
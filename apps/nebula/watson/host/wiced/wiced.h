@@ -0,0 +1,90 @@
+/** @file
+ *  Host stand-in for the parts of the WICED headers that mqtt.c uses, for mqtt_check.
+ *
+ *  Only types and prototypes: mqtt_check provides the RTOS, the clock and the MQTT library.
+ */
+
+#ifndef APPS_NEBULA_WATSON_HOST_WICED_WICED_H_
+#define APPS_NEBULA_WATSON_HOST_WICED_WICED_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                      Macros
+ ******************************************************/
+#define UNUSED_PARAMETER(x)     ( (void)(x) )
+#define WPRINT_APP_INFO(args)   printf args
+#define GET_IPV4_ADDRESS(a)     ( (a).ip.v4 )
+
+/******************************************************
+ *                   Enumerations
+ ******************************************************/
+typedef enum
+{
+    WICED_SUCCESS = 0,
+    WICED_PENDING = 1,
+    WICED_TIMEOUT = 2,
+    WICED_ERROR   = 4,
+    WICED_BADARG  = 5,
+} wiced_result_t;
+
+typedef enum
+{
+    WICED_FALSE = 0,
+    WICED_TRUE  = 1,
+} wiced_bool_t;
+
+typedef enum
+{
+    WICED_STA_INTERFACE,
+} wiced_interface_t;
+
+/******************************************************
+ *                 Type Definitions
+ ******************************************************/
+typedef uint32_t wiced_time_t;
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+typedef struct
+{
+    int id;
+} wiced_mutex_t;
+
+typedef struct
+{
+    int id;
+} wiced_semaphore_t;
+
+typedef struct
+{
+    int version;
+    union
+    {
+        uint32_t v4;
+    } ip;
+} wiced_ip_address_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+wiced_result_t wiced_time_get_time( wiced_time_t* time_ptr );
+wiced_result_t wiced_rtos_init_mutex( wiced_mutex_t* mutex );
+wiced_result_t wiced_rtos_lock_mutex( wiced_mutex_t* mutex );
+wiced_result_t wiced_rtos_unlock_mutex( wiced_mutex_t* mutex );
+wiced_result_t wiced_rtos_init_semaphore( wiced_semaphore_t* semaphore );
+wiced_result_t wiced_rtos_set_semaphore( wiced_semaphore_t* semaphore );
+wiced_result_t wiced_rtos_get_semaphore( wiced_semaphore_t* semaphore, uint32_t timeout_ms );
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_HOST_WICED_WICED_H_ */
@@ -0,0 +1,45 @@
+/** @file
+ *  Host stand-in for the WICED TLS header, for mqtt_check: only the session that mqtt.c copies
+ *  to and from the cache, and the context set up that mqtt.c wraps.
+ */
+
+#ifndef APPS_NEBULA_WATSON_HOST_WICED_WICED_TLS_H_
+#define APPS_NEBULA_WATSON_HOST_WICED_WICED_TLS_H_
+
+#include "wiced.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+typedef struct
+{
+    int32_t       cipher;
+    int32_t       length;
+    unsigned char id[32];
+    unsigned char master[48];
+} wiced_tls_session_t;
+
+typedef struct
+{
+    wiced_tls_session_t session;
+} wiced_tls_context_t;
+
+typedef struct
+{
+    int unused;
+} wiced_tls_identity_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+wiced_result_t wiced_tls_init_context( wiced_tls_context_t* context, wiced_tls_identity_t* identity, const char* peer_cn );
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_HOST_WICED_WICED_TLS_H_ */
@@ -0,0 +1,21 @@
+/** @file
+ *  Stand-in for the TLS context set up of the WICED library, for mqtt_check. It is its own
+ *  translation unit, as the library is on the device: -Wl,--wrap only redirects undefined
+ *  references, so the calls from mqtt_check.c reach the wrapper in mqtt.c and the wrapper's
+ *  __real_wiced_tls_init_context() reaches this.
+ */
+
+#include <string.h>
+#include "wiced_tls.h"
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+/* Starts the context without a session */
+wiced_result_t wiced_tls_init_context(wiced_tls_context_t* context, wiced_tls_identity_t* identity, const char* peer_cn)
+{
+    UNUSED_PARAMETER(identity);
+    UNUSED_PARAMETER(peer_cn);
+    memset(context, 0, sizeof(*context));
+    return WICED_SUCCESS;
+}
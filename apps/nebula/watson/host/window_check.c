@@ -0,0 +1,266 @@
+/** @file
+ *  Host check of the windowed summaries against a double precision reference.
+ *
+ *  Readings drift slowly with noise, one every five seconds, and are fed to the windows the way the
+ *  application does: due windows are closed before each reading is added, and on the sample ticks
+ *  while no readings come. Every summary is compared with count, min, max, mean and variance
+ *  recomputed in double precision from the readings inside [end - duration, end), and every reading
+ *  must be covered by as many summaries as there are hops per window. Exits nonzero on the first
+ *  broken expectation. Runs tumbling windows, sliding windows of 5 and of WINDOW_STATS_MAX_PANES
+ *  hops, and each of them again with a twenty minute gap in the readings.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "check.h"
+#include "window_stats.h"
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+#define SAMPLE_PERIOD_MS        (5000)
+#define RUN_MS                  (3 * 60 * 60 * 1000)
+#define MAX_READINGS            (RUN_MS / SAMPLE_PERIOD_MS)
+#define MAX_SUMMARIES           (RUN_MS / ( 60 * 1000 ) + 64)
+#define GAP_START_MS            (70 * 60 * 1000 + 2500)
+#define GAP_MS                  (20 * 60 * 1000)
+
+/* Allowed error against the reference: mean and stddev in hundredths, variance relative */
+#define MEAN_TOLERANCE          (1)
+#define STDDEV_TOLERANCE        (1)
+#define VARIANCE_TOLERANCE      (1e-4)
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+typedef struct
+{
+    uint32_t time_ms;
+    int32_t  values[WATSON_CHANNELS];
+} reading_t;
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+static void make_reading(uint32_t time_ms, uint32_t* state, reading_t* reading);
+static int in_window(uint32_t time_ms, uint32_t end_ms, uint32_t duration_ms);
+static void close_due(window_stats_t* stats, uint32_t now_ms);
+static void check_summary(const window_stats_summary_t* summary, uint32_t duration_ms);
+static void check_run(uint32_t duration_ms, uint32_t hop_ms, int gap);
+
+/******************************************************
+ *               Variable Definitions
+ ******************************************************/
+static reading_t readings[MAX_READINGS];
+static uint32_t reading_count;
+static window_stats_summary_t summaries[MAX_SUMMARIES];
+static uint32_t summary_count;
+static double worst_variance_error;
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+int main(void)
+{
+    check_run(5 * 60 * 1000, 5 * 60 * 1000, 0);
+    check_run(5 * 60 * 1000, 60 * 1000, 0);
+    check_run(60 * 60 * 1000, 60 * 60 * 1000 / WINDOW_STATS_MAX_PANES, 0);
+    check_run(5 * 60 * 1000, 5 * 60 * 1000, 1);
+    check_run(5 * 60 * 1000, 60 * 1000, 1);
+    check_run(60 * 60 * 1000, 60 * 60 * 1000 / WINDOW_STATS_MAX_PANES, 1);
+    printf("worst relative variance error %.2e above 1.0 units squared\n", worst_variance_error);
+    printf("all checks passed\n");
+    return 0;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+/* A room over a few hours: slow swings with sensor noise, pressure far from zero to stress the
+ * single precision accumulators */
+static void make_reading(uint32_t time_ms, uint32_t* state, reading_t* reading)
+{
+    double hours = time_ms / 3600000.0;
+    int32_t noise[WATSON_CHANNELS];
+    uint32_t c;
+
+    for ( c = 0; c < WATSON_CHANNELS; c++ )
+    {
+        /* xorshift32 */
+        *state ^= *state << 13;
+        *state ^= *state >> 17;
+        *state ^= *state << 5;
+        noise[c] = (int32_t)( *state % 201 ) - 100;
+    }
+    reading->time_ms = time_ms;
+    reading->values[WATSON_CHANNEL_TEMPERATURE] = 2150 + (int32_t)( 150.0 * sin(hours * 2.0) ) + noise[0] / 10;
+    reading->values[WATSON_CHANNEL_PRESSURE] = 10132500 + (int32_t)( 20000.0 * sin(hours * 0.7) ) + noise[1] * 3;
+    reading->values[WATSON_CHANNEL_HUMIDITY] = 4500 + (int32_t)( 800.0 * sin(hours * 1.3) ) + noise[2] / 4;
+}
+
+/* time_ms in [end_ms - duration_ms, end_ms), also when the window starts before time 0 */
+static int in_window(uint32_t time_ms, uint32_t end_ms, uint32_t duration_ms)
+{
+    return ( end_ms - time_ms - 1 ) < duration_ms;
+}
+
+static void close_due(window_stats_t* stats, uint32_t now_ms)
+{
+    window_stats_summary_t summary;
+
+    while ( window_stats_close(stats, now_ms, &summary) )
+    {
+        CHECK(summary_count < MAX_SUMMARIES);
+        CHECK(summary.end_ms <= now_ms);
+        check_summary(&summary, stats->duration_ms);
+        summaries[summary_count++] = summary;
+    }
+}
+
+static void check_summary(const window_stats_summary_t* summary, uint32_t duration_ms)
+{
+    double sum[WATSON_CHANNELS] = { 0 };
+    double sum_sq[WATSON_CHANNELS] = { 0 };
+    int32_t min[WATSON_CHANNELS];
+    int32_t max[WATSON_CHANNELS];
+    uint32_t first_ms = 0;
+    uint32_t last_ms = 0;
+    uint32_t count = 0;
+    uint32_t i;
+    uint32_t c;
+
+    CHECK(summary->end_ms - summary->start_ms <= duration_ms);
+    for ( i = 0; i < reading_count; i++ )
+    {
+        const reading_t* reading = &readings[i];
+
+        if ( !in_window(reading->time_ms, summary->end_ms, duration_ms) )
+        {
+            continue;
+        }
+        /* A window shortened to the start of the readings still holds all of its readings */
+        CHECK(reading->time_ms >= summary->start_ms);
+        if ( count++ == 0 )
+        {
+            first_ms = reading->time_ms;
+            memcpy(min, reading->values, sizeof(min));
+            memcpy(max, reading->values, sizeof(max));
+        }
+        last_ms = reading->time_ms;
+        for ( c = 0; c < WATSON_CHANNELS; c++ )
+        {
+            sum[c] += reading->values[c];
+            min[c] = ( reading->values[c] < min[c] ) ? reading->values[c] : min[c];
+            max[c] = ( reading->values[c] > max[c] ) ? reading->values[c] : max[c];
+        }
+    }
+
+    CHECK(summary->count == count);
+    if ( count == 0 )
+    {
+        return;
+    }
+    CHECK(summary->first_ms == first_ms);
+    CHECK(summary->last_ms == last_ms);
+
+    for ( i = 0; i < reading_count; i++ )
+    {
+        if ( in_window(readings[i].time_ms, summary->end_ms, duration_ms) )
+        {
+            for ( c = 0; c < WATSON_CHANNELS; c++ )
+            {
+                double d = readings[i].values[c] - sum[c] / count;
+
+                sum_sq[c] += d * d;
+            }
+        }
+    }
+    for ( c = 0; c < WATSON_CHANNELS; c++ )
+    {
+        const window_stats_channel_t* channel = &summary->channel[c];
+        double mean = sum[c] / count;
+        double variance = ( count > 1 ) ? sum_sq[c] / ( count - 1 ) : 0.0;
+        double error = fabs(channel->variance - variance);
+
+        CHECK(channel->min == min[c]);
+        CHECK(channel->max == max[c]);
+        CHECK(fabs(channel->mean - mean) <= MEAN_TOLERANCE);
+        CHECK(fabs(channel->stddev - sqrt(variance)) <= STDDEV_TOLERANCE);
+        CHECK(error <= 1.0 + VARIANCE_TOLERANCE * variance);
+        if ( ( variance > 10000.0 ) && ( error / variance > worst_variance_error ) )
+        {
+            worst_variance_error = error / variance;
+        }
+    }
+}
+
+static void check_run(uint32_t duration_ms, uint32_t hop_ms, int gap)
+{
+    window_stats_t stats;
+    watson_sample_t sample;
+    uint32_t state = 0x5EED0018U;
+    uint32_t panes = duration_ms / hop_ms;
+    uint32_t empty = 0;
+    uint32_t now_ms;
+    uint32_t i;
+    uint32_t s;
+
+    CHECK(window_stats_init(&stats, duration_ms, hop_ms) == 0);
+    CHECK(window_stats_time_left(&stats, 0) == WINDOW_STATS_NO_DEADLINE);
+    reading_count = 0;
+    summary_count = 0;
+
+    /* Start off the hop grid, so that the first window is a short one */
+    for ( now_ms = 123456; now_ms < 123456 + RUN_MS; now_ms += SAMPLE_PERIOD_MS )
+    {
+        close_due(&stats, now_ms);
+        if ( gap && ( now_ms - 123456 >= GAP_START_MS ) && ( now_ms - 123456 < GAP_START_MS + GAP_MS ) )
+        {
+            continue;
+        }
+        CHECK(reading_count < MAX_READINGS);
+        make_reading(now_ms, &state, &readings[reading_count]);
+        check_make_sample(reading_count + 1, now_ms, readings[reading_count].values[WATSON_CHANNEL_TEMPERATURE],
+                          readings[reading_count].values[WATSON_CHANNEL_PRESSURE],
+                          readings[reading_count].values[WATSON_CHANNEL_HUMIDITY], &sample);
+        reading_count++;
+        window_stats_add(&stats, &sample);
+        CHECK(window_stats_time_left(&stats, now_ms) <= hop_ms);
+    }
+    /* Let every window that holds a reading close */
+    close_due(&stats, now_ms + duration_ms);
+
+    /* Windows follow each other by one hop. Only a stretch without readings longer than a window
+     * closes empty windows, which the application drops, and after one the next may start later */
+    for ( s = 1; s < summary_count; s++ )
+    {
+        if ( summaries[s - 1].count == 0 )
+        {
+            empty++;
+            CHECK((int32_t)( summaries[s].end_ms - summaries[s - 1].end_ms ) >= (int32_t)hop_ms);
+        }
+        else
+        {
+            CHECK(summaries[s].end_ms == summaries[s - 1].end_ms + hop_ms);
+        }
+    }
+    CHECK(( empty != 0 ) == ( gap && ( GAP_MS > duration_ms ) ));
+
+    /* Every reading is in a summary for each hop of the window */
+    for ( i = 0; i < reading_count; i++ )
+    {
+        uint32_t covered = 0;
+
+        for ( s = 0; s < summary_count; s++ )
+        {
+            covered += in_window(readings[i].time_ms, summaries[s].end_ms, duration_ms);
+        }
+        CHECK(covered == panes);
+    }
+
+    printf("%s %u/%u min%s: %u readings, %u windows\n", ( panes == 1 ) ? "tumbling" : "sliding",
+           (unsigned)( duration_ms / 60000 ), (unsigned)( hop_ms / 60000 ), gap ? " with a gap" : "",
+           (unsigned)reading_count, (unsigned)summary_count);
+}
@@ -0,0 +1,91 @@
+/** @file
+ *  Sample journal flash access on the serial flash of the board (wiced_spi_flash).
+ */
+
+#include <string.h>
+#include "wiced_framework.h"
+#include "journal_sflash.h"
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+static int32_t sflash_journal_read(void* context, uint32_t address, void* data, uint32_t len);
+static int32_t sflash_journal_write(void* context, uint32_t address, const void* data, uint32_t len);
+static int32_t sflash_journal_erase(void* context, uint32_t address);
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+wiced_result_t journal_sflash_init(journal_sflash_t* sflash)
+{
+    memset(sflash, 0, sizeof(*sflash));
+    if ( init_sflash( &sflash->handle, 0, SFLASH_WRITE_ALLOWED ) != 0 )
+    {
+        return WICED_ERROR;
+    }
+    if ( ( sflash_get_size( &sflash->handle, &sflash->size ) != 0 ) || ( sflash->size == 0 ) )
+    {
+        deinit_sflash( &sflash->handle );
+        return WICED_ERROR;
+    }
+    sflash->flash.context = sflash;
+    sflash->flash.read = sflash_journal_read;
+    sflash->flash.write = sflash_journal_write;
+    sflash->flash.erase = sflash_journal_erase;
+    sflash->flash.sector_size = SECTOR_SIZE;
+    return WICED_SUCCESS;
+}
+
+wiced_result_t journal_sflash_check_apps(uint32_t base, uint32_t size, uint8_t* app_id)
+{
+    wiced_app_t app;
+    uint8_t id;
+    uint8_t i;
+
+    for ( id = DCT_FR_APP_INDEX; id <= DCT_APP2_INDEX; id++ )
+    {
+        /* Entries the build left empty have no sectors */
+        if ( wiced_framework_app_open( id, &app ) != WICED_SUCCESS )
+        {
+            continue;
+        }
+        for ( i = 0; i < app.app_header.count; i++ )
+        {
+            uint32_t start = (uint32_t)app.app_header.sectors[i].start * SECTOR_SIZE;
+            uint32_t end = start + (uint32_t)app.app_header.sectors[i].count * SECTOR_SIZE;
+
+            if ( ( app.app_header.sectors[i].count != 0 ) && ( start < base + size ) && ( base < end ) )
+            {
+                wiced_framework_app_close( &app );
+                *app_id = id;
+                return WICED_ERROR;
+            }
+        }
+        wiced_framework_app_close( &app );
+    }
+    return WICED_SUCCESS;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+static int32_t sflash_journal_read(void* context, uint32_t address, void* data, uint32_t len)
+{
+    journal_sflash_t* sflash = context;
+
+    return ( sflash_read( &sflash->handle, address, data, len ) == 0 ) ? 0 : -1;
+}
+
+static int32_t sflash_journal_write(void* context, uint32_t address, const void* data, uint32_t len)
+{
+    journal_sflash_t* sflash = context;
+
+    return ( sflash_write( &sflash->handle, address, data, len ) == 0 ) ? 0 : -1;
+}
+
+static int32_t sflash_journal_erase(void* context, uint32_t address)
+{
+    journal_sflash_t* sflash = context;
+
+    return ( sflash_sector_erase( &sflash->handle, address ) == 0 ) ? 0 : -1;
+}
@@ -0,0 +1,55 @@
+/** @file
+ *  Sample journal flash access on the serial flash of the board (wiced_spi_flash).
+ */
+
+#ifndef APPS_NEBULA_WATSON_JOURNAL_SFLASH_H_
+#define APPS_NEBULA_WATSON_JOURNAL_SFLASH_H_
+
+#include "wiced.h"
+#include "spi_flash.h"
+#include "sample_journal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+typedef struct
+{
+    sflash_handle_t        handle;
+    sample_journal_flash_t flash;   /**< Pass to sample_journal_open() */
+    unsigned long          size;    /**< Size of the flash part */
+} journal_sflash_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+/**
+ * Open the serial flash for writing.
+ *
+ * @param[out] sflash : Flash access
+ *
+ * @return WICED_SUCCESS, or WICED_ERROR if the flash does not answer
+ */
+wiced_result_t journal_sflash_init(journal_sflash_t* sflash);
+
+/**
+ * Check a journal region against the images of the WICED apps lookup table, which the build
+ * places on the same serial flash from APPS_START_SECTOR up: the FR and OTA applications, the
+ * resource filesystem, the Wi-Fi firmware and the applications.
+ *
+ * @param[in]  base    : Start of the journal region
+ * @param[in]  size    : Its size
+ * @param[out] app_id  : The first image in the way, for WICED_ERROR
+ *
+ * @return WICED_SUCCESS if no image overlaps the region, WICED_ERROR if one does
+ */
+wiced_result_t journal_sflash_check_apps(uint32_t base, uint32_t size, uint8_t* app_id);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_JOURNAL_SFLASH_H_ */
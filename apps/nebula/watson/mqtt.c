@@ -1,14 +1,78 @@
 #include "wiced.h"
 #include "mqtt_common.h"
+#include "wiced_tls.h"
+#include "mqtt.h"
 #define WICED_MQTT_TIMEOUT                  (5000)
 #define WICED_MQTT_DELAY_IN_MILLISECONDS    (1000)
 #define MQTT_MAX_RESOURCE_SIZE              (0x7fffffff)
-static wiced_mqtt_event_type_t expected_event;
-static wiced_semaphore_t semaphore;
+/* Longest wait between checks for publishes that were never acknowledged */
+#define MQTT_PUBLISH_POLL_MS                (100)
+/* Publishes in flight, plus the connect, disconnect, subscribe or unsubscribe being waited for */
+#define MQTT_COMPLETIONS                    (MQTT_PUBLISH_WINDOW_MAX + 4)
 
 
 #define WICED_MQTT_EVENT_TYPE_SUBSCRIBED 4
 
+/*
+ * A request waiting for its event, keyed by event type and msgid. The connect and the disconnect
+ * have no msgid. Publishes complete through their callback, the other requests wake the thread
+ * waiting on the semaphore of their entry.
+ */
+typedef struct
+{
+    wiced_bool_t            used;
+    wiced_bool_t            sending;    /* In the library call, msgid not known yet */
+    wiced_bool_t            dropped;    /* Connection lost while sending */
+    wiced_bool_t            done;
+    wiced_mqtt_event_type_t type;
+    wiced_mqtt_msgid_t      msgid;
+    wiced_result_t          result;
+    wiced_time_t            deadline;
+    mqtt_publish_callback_t callback;
+    void                    *arg;
+    wiced_semaphore_t       semaphore;
+} mqtt_completion_t;
+
+/*
+ * An event that came before the library call returned its msgid.
+ */
+typedef struct
+{
+    wiced_mqtt_event_type_t type;
+    wiced_mqtt_msgid_t      msgid;
+} mqtt_early_event_t;
+
+static wiced_mutex_t completion_mutex;
+static mqtt_completion_t completions[MQTT_COMPLETIONS];
+static mqtt_early_event_t early_events[MQTT_COMPLETIONS];
+static uint32_t early_event_count;
+static wiced_semaphore_t publish_done;
+static uint32_t publish_count;
+static uint32_t publish_window = 1;
+static mqtt_app_stats_t stats;
+static mqtt_disconnect_callback_t disconnect_callback;
+static void *disconnect_arg;
+static tls_session_cache_t *tls_cache;
+/* Set while mqtt_conn_open() is in the library: the session to offer and the context it went to */
+static wiced_bool_t tls_connecting;
+static const tls_session_t *tls_offer;
+static wiced_tls_context_t *tls_context;
+
+static int32_t request_open( wiced_mqtt_event_type_t type, mqtt_publish_callback_t callback, void *arg, uint32_t timeout );
+static wiced_result_t request_sent( int32_t index, wiced_bool_t sent, wiced_mqtt_msgid_t msgid );
+static wiced_result_t request_sent_and_wait( int32_t index, wiced_bool_t sent, wiced_mqtt_msgid_t msgid );
+static void request_complete( uint32_t index, wiced_result_t result );
+static void request_event( wiced_mqtt_event_type_t type, wiced_mqtt_msgid_t msgid, wiced_result_t result );
+static void request_fail_all( void );
+static void publish_expire( void );
+static wiced_result_t publish_wait( uint32_t limit, uint32_t timeout );
+static void publish_ignore( wiced_mqtt_msgid_t msgid, wiced_result_t result, void *arg );
+static void tls_session_to_context( wiced_tls_session_t *out, const tls_session_t *session );
+static void tls_session_from_context( tls_session_t *out, const wiced_tls_session_t *session );
+
+wiced_result_t __real_wiced_tls_init_context( wiced_tls_context_t *context, wiced_tls_identity_t *identity, const char *peer_cn );
+wiced_result_t __wrap_wiced_tls_init_context( wiced_tls_context_t *context, wiced_tls_identity_t *identity, const char *peer_cn );
+
 void mqtt_print_status( wiced_result_t result, const char * ok_message, const char * error_message )
 {
     if ( result == WICED_SUCCESS )
@@ -35,21 +99,95 @@ void mqtt_print_status( wiced_result_t result, const char * ok_message, const ch
     }
 }
 
+wiced_result_t mqtt_app_init( uint32_t window )
+{
+    uint32_t i;
+
+    if ( ( window == 0 ) || ( window > MQTT_PUBLISH_WINDOW_MAX ) )
+    {
+        return WICED_BADARG;
+    }
+    publish_window = window;
+    publish_count = 0;
+    early_event_count = 0;
+    memset( &stats, 0, sizeof( stats ) );
+    memset( completions, 0, sizeof( completions ) );
+    if ( ( wiced_rtos_init_mutex( &completion_mutex ) != WICED_SUCCESS ) || ( wiced_rtos_init_semaphore( &publish_done ) != WICED_SUCCESS ) )
+    {
+        return WICED_ERROR;
+    }
+    for ( i = 0; i < MQTT_COMPLETIONS; i++ )
+    {
+        if ( wiced_rtos_init_semaphore( &completions[i].semaphore ) != WICED_SUCCESS )
+        {
+            return WICED_ERROR;
+        }
+    }
+    return WICED_SUCCESS;
+}
+
+void mqtt_app_set_disconnect_callback( mqtt_disconnect_callback_t callback, void *arg )
+{
+    disconnect_arg = arg;
+    disconnect_callback = callback;
+}
+
+void mqtt_app_set_tls_session_cache( tls_session_cache_t *cache )
+{
+    tls_cache = cache;
+}
+
+/*
+ * Every TLS context is set up here, the one of the MQTT connection while mqtt_conn_open() is in
+ * the library. It gets the cached session, the handshake that follows offers its id.
+ */
+wiced_result_t __wrap_wiced_tls_init_context( wiced_tls_context_t *context, wiced_tls_identity_t *identity, const char *peer_cn )
+{
+    wiced_result_t ret = __real_wiced_tls_init_context( context, identity, peer_cn );
+
+    if ( ( ret == WICED_SUCCESS ) && tls_connecting )
+    {
+        tls_context = context;
+        if ( tls_offer != NULL )
+        {
+            tls_session_to_context( &context->session, tls_offer );
+        }
+    }
+    return ret;
+}
+
 /*
  * Call back function to handle connection events.
+ *
+ * Each event completes the request it answers, found by event type and msgid in the completion
+ * table, so a late acknowledgement of one message can never complete the wait for another. A
+ * disconnect fails every request still waiting and is then passed on to the disconnect callback.
  */
 wiced_result_t mqtt_connection_event_cb( wiced_mqtt_object_t mqtt_object, wiced_mqtt_event_info_t *event )
 {
     switch ( event->type )
     {
         case WICED_MQTT_EVENT_TYPE_CONNECT_REQ_STATUS:
+        {
+            /* A CONNACK with a nonzero return code is a refusal */
+            request_event( event->type, 0, ( event->data.conn_ack.err_code == 0 ) ? WICED_SUCCESS : WICED_ERROR );
+        }
+            break;
         case WICED_MQTT_EVENT_TYPE_DISCONNECTED:
+        {
+            request_event( event->type, 0, WICED_SUCCESS );
+            request_fail_all( );
+            if ( disconnect_callback != NULL )
+            {
+                disconnect_callback( disconnect_arg );
+            }
+        }
+            break;
         case WICED_MQTT_EVENT_TYPE_PUBLISHED:
         case WICED_MQTT_EVENT_TYPE_SUBSCRIBED:
         case WICED_MQTT_EVENT_TYPE_UNSUBSCRIBED:
         {
-            expected_event = event->type;
-            wiced_rtos_set_semaphore( &semaphore );
+            request_event( event->type, event->data.msgid, WICED_SUCCESS );
         }
             break;
         case WICED_MQTT_EVENT_TYPE_PUBLISH_MSG_RECEIVED:
@@ -64,42 +202,6 @@ wiced_result_t mqtt_connection_event_cb( wiced_mqtt_object_t mqtt_object, wiced_
     return WICED_SUCCESS;
 }
 
-/*
- * Call back function to handle channel events.
- *
- * For each event:
- *  - The call back will set the expected_event global to the received event.
- *  - The call back will set the event semaphore to run any blocking thread functions waiting on this event
- *  - Some events will also log other global variables required for extra processing.
- *
- * A thread function will probably be waiting for the received event. Once the event is received and the
- * semaphore is set, the thread function will check for the received event and make sure it matches what
- * it is expecting.
- *
- * Note:  This mechanism is not thread safe as we are using a non protected global variable for read/write.
- * However as this snip is a single controlled thread, there is no risc of racing conditions. It is
- * however not recommended for multi-threaded applications.
- */
-
-/*
- * A blocking call to an expected event.
- */
-wiced_result_t mqtt_wait_for( wiced_mqtt_event_type_t event, uint32_t timeout )
-{
-    if ( wiced_rtos_get_semaphore( &semaphore, timeout ) != WICED_SUCCESS )
-    {
-        return WICED_ERROR;
-    }
-    else
-    {
-        if ( event != expected_event )
-        {
-            return WICED_ERROR;
-        }
-    }
-    return WICED_SUCCESS;
-}
-
 /*
  * Open a connection and wait for WICED_MQTT_TIMEOUT period to receive a connection open OK event
  */
@@ -107,6 +209,12 @@ wiced_result_t mqtt_conn_open( wiced_mqtt_object_t mqtt_obj, wiced_ip_address_t
 {
     wiced_mqtt_pkt_connect_t conninfo;
     wiced_result_t ret = WICED_SUCCESS;
+    int32_t index;
+    wiced_time_t start;
+    wiced_time_t end;
+    tls_session_t session;
+    tls_session_stats_t tls_stats;
+    int32_t resumed;
 
     memset( &conninfo, 0, sizeof( conninfo ) );
 
@@ -119,16 +227,41 @@ wiced_result_t mqtt_conn_open( wiced_mqtt_object_t mqtt_obj, wiced_ip_address_t
     conninfo.username = NULL;
     conninfo.peer_cn = NULL;
     WPRINT_APP_INFO(("Connecting as device :%s", clientId));
-    ret = wiced_mqtt_connect( mqtt_obj, address, interface, callback, security, &conninfo );
-    if ( ret != WICED_SUCCESS )
+    index = request_open( WICED_MQTT_EVENT_TYPE_CONNECT_REQ_STATUS, NULL, NULL, WICED_MQTT_TIMEOUT );
+    if ( index < 0 )
     {
         return WICED_ERROR;
     }
-    if ( mqtt_wait_for( WICED_MQTT_EVENT_TYPE_CONNECT_REQ_STATUS, WICED_MQTT_TIMEOUT ) != WICED_SUCCESS )
+    wiced_time_get_time( &start );
+    if ( ( tls_cache != NULL ) && ( security != NULL ) )
     {
-        return WICED_ERROR;
+        tls_offer = tls_session_offer( tls_cache, GET_IPV4_ADDRESS( *address ), start );
+        tls_context = NULL;
+        tls_connecting = WICED_TRUE;
     }
-    return WICED_SUCCESS;
+    /* Returns once the TCP connection is open and the TLS handshake is done */
+    ret = wiced_mqtt_connect( mqtt_obj, address, interface, callback, security, &conninfo );
+    if ( tls_connecting )
+    {
+        tls_connecting = WICED_FALSE;
+        wiced_time_get_time( &end );
+        if ( ( ret == WICED_SUCCESS ) && ( tls_context != NULL ) )
+        {
+            tls_session_from_context( &session, &tls_context->session );
+            session.peer = GET_IPV4_ADDRESS( *address );
+            resumed = tls_session_done( tls_cache, &session, end, end - start );
+            tls_session_get_stats( tls_cache, &tls_stats );
+            WPRINT_APP_INFO(( "[MQTT] TLS handshake %lums, %s (full %lu, average %lums; resumed %lu, average %lums)\n", (unsigned long) ( end - start ),
+                    resumed ? "resumed" : "full",
+                    (unsigned long) tls_stats.full, (unsigned long) ( ( tls_stats.full != 0 ) ? tls_stats.full_ms / tls_stats.full : 0 ),
+                    (unsigned long) tls_stats.resumed, (unsigned long) ( ( tls_stats.resumed != 0 ) ? tls_stats.resumed_ms / tls_stats.resumed : 0 ) ));
+        }
+        else
+        {
+            tls_session_done( tls_cache, NULL, end, end - start );
+        }
+    }
+    return request_sent_and_wait( index, ( ret == WICED_SUCCESS ) ? WICED_TRUE : WICED_FALSE, 0 );
 }
 
 /*
@@ -136,15 +269,13 @@ wiced_result_t mqtt_conn_open( wiced_mqtt_object_t mqtt_obj, wiced_ip_address_t
  */
 wiced_result_t mqtt_conn_close( wiced_mqtt_object_t mqtt_obj )
 {
-    if ( wiced_mqtt_disconnect( mqtt_obj ) != WICED_SUCCESS )
-    {
-        return WICED_ERROR;
-    }
-    if ( mqtt_wait_for( WICED_MQTT_EVENT_TYPE_DISCONNECTED, WICED_MQTT_TIMEOUT ) != WICED_SUCCESS )
+    int32_t index = request_open( WICED_MQTT_EVENT_TYPE_DISCONNECTED, NULL, NULL, WICED_MQTT_TIMEOUT );
+
+    if ( index < 0 )
     {
         return WICED_ERROR;
     }
-    return WICED_SUCCESS;
+    return request_sent_and_wait( index, ( wiced_mqtt_disconnect( mqtt_obj ) == WICED_SUCCESS ) ? WICED_TRUE : WICED_FALSE, 0 );
 }
 
 /*
@@ -153,16 +284,14 @@ wiced_result_t mqtt_conn_close( wiced_mqtt_object_t mqtt_obj )
 wiced_result_t mqtt_app_subscribe( wiced_mqtt_object_t mqtt_obj, char *topic, uint8_t qos )
 {
     wiced_mqtt_msgid_t pktid;
-    pktid = wiced_mqtt_subscribe( mqtt_obj, topic, qos );
-    if ( pktid == 0 )
-    {
-        return WICED_ERROR;
-    }
-    if ( mqtt_wait_for( WICED_MQTT_EVENT_TYPE_SUBSCRIBED, WICED_MQTT_TIMEOUT ) != WICED_SUCCESS )
+    int32_t index = request_open( WICED_MQTT_EVENT_TYPE_SUBSCRIBED, NULL, NULL, WICED_MQTT_TIMEOUT );
+
+    if ( index < 0 )
     {
         return WICED_ERROR;
     }
-    return WICED_SUCCESS;
+    pktid = wiced_mqtt_subscribe( mqtt_obj, topic, qos );
+    return request_sent_and_wait( index, ( pktid != 0 ) ? WICED_TRUE : WICED_FALSE, pktid );
 }
 
 /*
@@ -171,34 +300,380 @@ wiced_result_t mqtt_app_subscribe( wiced_mqtt_object_t mqtt_obj, char *topic, ui
 wiced_result_t mqtt_app_unsubscribe( wiced_mqtt_object_t mqtt_obj, char *topic )
 {
     wiced_mqtt_msgid_t pktid;
-    pktid = wiced_mqtt_unsubscribe( mqtt_obj, topic );
+    int32_t index = request_open( WICED_MQTT_EVENT_TYPE_UNSUBSCRIBED, NULL, NULL, WICED_MQTT_TIMEOUT * 2 );
 
-    if ( pktid == 0 )
-    {
-        return WICED_ERROR;
-    }
-    if ( mqtt_wait_for( WICED_MQTT_EVENT_TYPE_UNSUBSCRIBED, WICED_MQTT_TIMEOUT*2 ) != WICED_SUCCESS )
+    if ( index < 0 )
     {
         return WICED_ERROR;
     }
-    return WICED_SUCCESS;
+    pktid = wiced_mqtt_unsubscribe( mqtt_obj, topic );
+    return request_sent_and_wait( index, ( pktid != 0 ) ? WICED_TRUE : WICED_FALSE, pktid );
 }
 
 /*
- * Publish (send) WICED_MESSAGE_STR to WICED_TOPIC and wait for 5 seconds to receive a PUBCOMP (as it is QoS=2).
+ * Publish and wait for WICED_MQTT_TIMEOUT to receive its acknowledgement.
  */
 wiced_result_t mqtt_app_publish( wiced_mqtt_object_t mqtt_obj, uint8_t qos, char *topic, uint8_t *data, uint32_t data_len )
 {
     wiced_mqtt_msgid_t pktid;
+    int32_t index;
+
+    if ( publish_wait( publish_window - 1, WICED_MQTT_TIMEOUT ) != WICED_SUCCESS )
+    {
+        return WICED_ERROR;
+    }
+    index = request_open( WICED_MQTT_EVENT_TYPE_PUBLISHED, NULL, NULL, WICED_MQTT_TIMEOUT );
+    if ( index < 0 )
+    {
+        return WICED_ERROR;
+    }
     pktid = wiced_mqtt_publish( mqtt_obj, topic, data, data_len, qos );
-    if ( pktid == 0 )
+    return request_sent_and_wait( index, ( pktid != 0 ) ? WICED_TRUE : WICED_FALSE, pktid );
+}
+
+wiced_result_t mqtt_app_publish_async( wiced_mqtt_object_t mqtt_obj, uint8_t qos, char *topic, uint8_t *data, uint32_t data_len,
+        mqtt_publish_callback_t callback, void *arg, uint32_t timeout )
+{
+    wiced_mqtt_msgid_t pktid;
+    int32_t index;
+
+    if ( publish_wait( publish_window - 1, timeout ) != WICED_SUCCESS )
+    {
+        return WICED_TIMEOUT;
+    }
+    index = request_open( WICED_MQTT_EVENT_TYPE_PUBLISHED, ( callback != NULL ) ? callback : publish_ignore, arg, WICED_MQTT_TIMEOUT );
+    if ( index < 0 )
     {
         return WICED_ERROR;
     }
+    pktid = wiced_mqtt_publish( mqtt_obj, topic, data, data_len, qos );
+    return request_sent( index, ( pktid != 0 ) ? WICED_TRUE : WICED_FALSE, pktid );
+}
+
+wiced_result_t mqtt_app_publish_flush( uint32_t timeout )
+{
+    return publish_wait( 0, timeout );
+}
+
+uint32_t mqtt_app_publish_in_flight( void )
+{
+    return publish_count;
+}
+
+void mqtt_app_get_stats( mqtt_app_stats_t *out )
+{
+    wiced_rtos_lock_mutex( &completion_mutex );
+    *out = stats;
+    wiced_rtos_unlock_mutex( &completion_mutex );
+}
+
+/*
+ * Take a completion entry before the library call, so that no event can get ahead of it.
+ * Returns the entry, or -1 when the table is full.
+ */
+static int32_t request_open( wiced_mqtt_event_type_t type, mqtt_publish_callback_t callback, void *arg, uint32_t timeout )
+{
+    mqtt_completion_t *c;
+    wiced_time_t now;
+    int32_t index;
+
+    wiced_time_get_time( &now );
+    wiced_rtos_lock_mutex( &completion_mutex );
+    for ( index = 0; ( index < MQTT_COMPLETIONS ) && completions[index].used; index++ )
+    {
+    }
+    if ( index == MQTT_COMPLETIONS )
+    {
+        wiced_rtos_unlock_mutex( &completion_mutex );
+        return -1;
+    }
+    c = &completions[index];
+    c->used = WICED_TRUE;
+    c->sending = WICED_TRUE;
+    c->dropped = WICED_FALSE;
+    c->done = WICED_FALSE;
+    c->type = type;
+    c->msgid = 0;
+    c->result = WICED_PENDING;
+    c->deadline = now + timeout;
+    c->callback = callback;
+    c->arg = arg;
+    if ( type == WICED_MQTT_EVENT_TYPE_PUBLISHED )
+    {
+        publish_count++;
+    }
+    wiced_rtos_unlock_mutex( &completion_mutex );
+    return index;
+}
+
+/*
+ * Record the msgid the library call returned, or give the entry back when the call failed.
+ * Completes the request if its event, or a disconnect, came during the call.
+ */
+static wiced_result_t request_sent( int32_t index, wiced_bool_t sent, wiced_mqtt_msgid_t msgid )
+{
+    mqtt_completion_t *c = &completions[index];
+    uint32_t i;
 
-    if ( mqtt_wait_for( WICED_MQTT_EVENT_TYPE_PUBLISHED, WICED_MQTT_TIMEOUT ) != WICED_SUCCESS )
+    wiced_rtos_lock_mutex( &completion_mutex );
+    c->sending = WICED_FALSE;
+    if ( !sent )
     {
+        c->used = WICED_FALSE;
+        if ( c->type == WICED_MQTT_EVENT_TYPE_PUBLISHED )
+        {
+            publish_count--;
+        }
+        wiced_rtos_unlock_mutex( &completion_mutex );
         return WICED_ERROR;
     }
+    c->msgid = msgid;
+    if ( c->dropped )
+    {
+        request_complete( index, WICED_ERROR );
+        return WICED_SUCCESS;
+    }
+    for ( i = 0; i < early_event_count; i++ )
+    {
+        if ( ( early_events[i].type == c->type ) && ( early_events[i].msgid == msgid ) )
+        {
+            early_events[i] = early_events[--early_event_count];
+            request_complete( index, WICED_SUCCESS );
+            return WICED_SUCCESS;
+        }
+    }
+    wiced_rtos_unlock_mutex( &completion_mutex );
     return WICED_SUCCESS;
 }
+
+/*
+ * request_sent(), then wait for the request to complete or its deadline to pass.
+ */
+static wiced_result_t request_sent_and_wait( int32_t index, wiced_bool_t sent, wiced_mqtt_msgid_t msgid )
+{
+    mqtt_completion_t *c = &completions[index];
+    wiced_result_t result;
+    wiced_time_t now;
+
+    if ( request_sent( index, sent, msgid ) != WICED_SUCCESS )
+    {
+        return WICED_ERROR;
+    }
+    while ( 1 )
+    {
+        wiced_time_get_time( &now );
+        wiced_rtos_lock_mutex( &completion_mutex );
+        if ( c->done || ( (int32_t) ( now - c->deadline ) >= 0 ) )
+        {
+            break;
+        }
+        wiced_rtos_unlock_mutex( &completion_mutex );
+        /* A wake up left over from an earlier user of the entry only costs a turn of the loop */
+        wiced_rtos_get_semaphore( &c->semaphore, c->deadline - now );
+    }
+    if ( !c->done )
+    {
+        stats.timeouts++;
+    }
+    result = c->done ? c->result : WICED_TIMEOUT;
+    c->used = WICED_FALSE;
+    if ( c->type == WICED_MQTT_EVENT_TYPE_PUBLISHED )
+    {
+        publish_count--;
+        wiced_rtos_set_semaphore( &publish_done );
+    }
+    wiced_rtos_unlock_mutex( &completion_mutex );
+    return ( result == WICED_SUCCESS ) ? WICED_SUCCESS : WICED_ERROR;
+}
+
+/*
+ * Complete a request. Called with completion_mutex locked, returns with it unlocked.
+ * A request with a callback gives its entry back here once the callback has returned, so that a
+ * flush also waits for the callbacks. A waiting thread gives its entry back itself.
+ */
+static void request_complete( uint32_t index, wiced_result_t result )
+{
+    mqtt_completion_t *c = &completions[index];
+
+    if ( result == WICED_SUCCESS )
+    {
+        stats.completed++;
+    }
+    else if ( result == WICED_TIMEOUT )
+    {
+        stats.timeouts++;
+    }
+    else
+    {
+        stats.failed++;
+    }
+    if ( c->callback == NULL )
+    {
+        c->done = WICED_TRUE;
+        c->result = result;
+        wiced_rtos_unlock_mutex( &completion_mutex );
+        wiced_rtos_set_semaphore( &c->semaphore );
+        return;
+    }
+    /* Done keeps the other paths off the entry while the callback runs unlocked */
+    c->done = WICED_TRUE;
+    wiced_rtos_unlock_mutex( &completion_mutex );
+    c->callback( c->msgid, result, c->arg );
+    wiced_rtos_lock_mutex( &completion_mutex );
+    c->used = WICED_FALSE;
+    publish_count--;
+    wiced_rtos_unlock_mutex( &completion_mutex );
+    wiced_rtos_set_semaphore( &publish_done );
+}
+
+/*
+ * Complete the request an event answers with result. The connect and the disconnect match by type
+ * alone.
+ */
+static void request_event( wiced_mqtt_event_type_t type, wiced_mqtt_msgid_t msgid, wiced_result_t result )
+{
+    wiced_bool_t numbered = ( type != WICED_MQTT_EVENT_TYPE_CONNECT_REQ_STATUS ) && ( type != WICED_MQTT_EVENT_TYPE_DISCONNECTED );
+    wiced_bool_t awaited = WICED_FALSE;
+    uint32_t i;
+
+    wiced_rtos_lock_mutex( &completion_mutex );
+    for ( i = 0; i < MQTT_COMPLETIONS; i++ )
+    {
+        mqtt_completion_t *c = &completions[i];
+
+        if ( !c->used || c->done || ( c->type != type ) )
+        {
+            continue;
+        }
+        if ( !numbered || ( !c->sending && ( c->msgid == msgid ) ) )
+        {
+            request_complete( i, result );
+            return;
+        }
+        awaited = awaited || c->sending;
+    }
+    if ( awaited )
+    {
+        /* Keep it for a request whose msgid is not known yet, forgetting the oldest */
+        if ( early_event_count == MQTT_COMPLETIONS )
+        {
+            memmove( &early_events[0], &early_events[1], sizeof( early_events ) - sizeof( early_events[0] ) );
+            early_event_count--;
+        }
+        early_events[early_event_count].type = type;
+        early_events[early_event_count].msgid = msgid;
+        early_event_count++;
+    }
+    else if ( numbered )
+    {
+        /* Late, after its request timed out, or never asked for */
+        stats.unmatched++;
+    }
+    wiced_rtos_unlock_mutex( &completion_mutex );
+}
+
+/*
+ * Fail everything still waiting, the broker will not answer any more.
+ */
+static void request_fail_all( void )
+{
+    uint32_t i;
+
+    wiced_rtos_lock_mutex( &completion_mutex );
+    early_event_count = 0;
+    for ( i = 0; i < MQTT_COMPLETIONS; i++ )
+    {
+        if ( !completions[i].used || completions[i].done )
+        {
+            continue;
+        }
+        if ( completions[i].sending )
+        {
+            /* Still in the library call, request_sent() completes it */
+            completions[i].dropped = WICED_TRUE;
+            continue;
+        }
+        request_complete( i, WICED_ERROR );
+        wiced_rtos_lock_mutex( &completion_mutex );
+    }
+    wiced_rtos_unlock_mutex( &completion_mutex );
+}
+
+/*
+ * Complete the asynchronous publishes that outlived their deadline with WICED_TIMEOUT.
+ */
+static void publish_expire( void )
+{
+    wiced_time_t now;
+    uint32_t i;
+
+    wiced_time_get_time( &now );
+    wiced_rtos_lock_mutex( &completion_mutex );
+    for ( i = 0; i < MQTT_COMPLETIONS; i++ )
+    {
+        if ( completions[i].used && !completions[i].done && !completions[i].sending && ( completions[i].callback != NULL ) &&
+             ( (int32_t) ( now - completions[i].deadline ) >= 0 ) )
+        {
+            request_complete( i, WICED_TIMEOUT );
+            wiced_rtos_lock_mutex( &completion_mutex );
+        }
+    }
+    wiced_rtos_unlock_mutex( &completion_mutex );
+}
+
+/*
+ * Wait, up to timeout, until no more than limit publishes are in flight.
+ */
+static wiced_result_t publish_wait( uint32_t limit, uint32_t timeout )
+{
+    wiced_time_t start;
+    wiced_time_t now;
+    uint32_t wait;
+
+    wiced_time_get_time( &start );
+    while ( 1 )
+    {
+        publish_expire( );
+        if ( publish_count <= limit )
+        {
+            return WICED_SUCCESS;
+        }
+        wiced_time_get_time( &now );
+        if ( now - start >= timeout )
+        {
+            return WICED_TIMEOUT;
+        }
+        wait = timeout - ( now - start );
+        wiced_rtos_get_semaphore( &publish_done, ( wait < MQTT_PUBLISH_POLL_MS ) ? wait : MQTT_PUBLISH_POLL_MS );
+    }
+}
+
+static void publish_ignore( wiced_mqtt_msgid_t msgid, wiced_result_t result, void *arg )
+{
+    UNUSED_PARAMETER( msgid );
+    UNUSED_PARAMETER( result );
+    UNUSED_PARAMETER( arg );
+}
+
+/*
+ * The session of a WICED TLS context is a PolarSSL ssl_session.
+ */
+static void tls_session_to_context( wiced_tls_session_t *out, const tls_session_t *session )
+{
+    out->length = session->id_length;
+    memcpy( out->id, session->id, sizeof( session->id ) );
+    memcpy( out->master, session->master, sizeof( session->master ) );
+    out->cipher = session->cipher;
+}
+
+static void tls_session_from_context( tls_session_t *out, const wiced_tls_session_t *session )
+{
+    memset( out, 0, sizeof( *out ) );
+    if ( ( session->length > 0 ) && ( session->length <= TLS_SESSION_ID_LEN ) )
+    {
+        out->id_length = (uint8_t) session->length;
+        memcpy( out->id, session->id, (size_t) session->length );
+        memcpy( out->master, session->master, sizeof( out->master ) );
+        out->cipher = (uint16_t) session->cipher;
+    }
+}
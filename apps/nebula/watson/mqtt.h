@@ -1,12 +1,91 @@
 #include "wiced.h"
 #include "mqtt_api.h"
+#include "tls_session.h"
+
+/* Most publishes that can wait for their acknowledgement at the same time */
+#define MQTT_PUBLISH_WINDOW_MAX             (8)
+
+/**
+ * Completion of an asynchronous publish: WICED_SUCCESS once the broker acknowledged it (sent, for
+ * QoS 0), WICED_TIMEOUT when no acknowledgement came in time, WICED_ERROR when the connection
+ * dropped. Runs on the MQTT event thread or in the publishing thread, so it must be short.
+ */
+typedef void (*mqtt_publish_callback_t)( wiced_mqtt_msgid_t msgid, wiced_result_t result, void *arg );
+
+/**
+ * The connection was lost or closed. Runs on the MQTT event thread after every request still
+ * waiting has failed, so it must be short.
+ */
+typedef void (*mqtt_disconnect_callback_t)( void *arg );
+
+/**
+ * Requests answered since mqtt_app_init(). Every request has its own deadline.
+ */
+typedef struct
+{
+    uint32_t completed;
+    uint32_t failed;        /**< Refused or cut short by a disconnect */
+    uint32_t timeouts;
+    uint32_t unmatched;     /**< Acknowledgements nobody waited for, mostly late ones */
+} mqtt_app_stats_t;
+
+/**
+ * Set up the completion table and the publish window, before the connection is opened.
+ *
+ * @param[in] window : Publishes in flight at most, 1 to MQTT_PUBLISH_WINDOW_MAX
+ */
+wiced_result_t mqtt_app_init( uint32_t window );
+
+/**
+ * Be told when the connection goes down, NULL to stop.
+ */
+void mqtt_app_set_disconnect_callback( mqtt_disconnect_callback_t callback, void *arg );
+
+/**
+ * Resume TLS sessions from cache on connect and time the handshakes, NULL to stop.
+ *
+ * The MQTT library sets up a new TLS context for every connect, so the session is put into it
+ * through a wrapper of wiced_tls_init_context(), which needs the link option
+ * -Wl,--wrap=wiced_tls_init_context. Connect from one thread at a time.
+ *
+ * The broker is not authenticated: a security without ca_cert, as watson.c passes, has the
+ * library accept any server certificate, and a resumed session is only as trusted as the full
+ * handshake it came from. Put the broker's root CA into ca_cert to authenticate it.
+ */
+void mqtt_app_set_tls_session_cache( tls_session_cache_t *cache );
 
 wiced_result_t mqtt_connection_event_cb( wiced_mqtt_object_t mqtt_object, wiced_mqtt_event_info_t *event );
-wiced_result_t mqtt_wait_for( wiced_mqtt_event_type_t event, uint32_t timeout );
 wiced_result_t mqtt_conn_open( wiced_mqtt_object_t mqtt_obj, wiced_ip_address_t *address, wiced_interface_t interface, wiced_mqtt_callback_t callback, wiced_mqtt_security_t *security, char * clientId);
 wiced_result_t mqtt_conn_close( wiced_mqtt_object_t mqtt_object );
 wiced_result_t mqtt_app_subscribe( wiced_mqtt_object_t mqtt_obj, char *topic, uint8_t qos );
 wiced_result_t mqtt_app_unsubscribe( wiced_mqtt_object_t mqtt_obj, char *topic );
 wiced_result_t mqtt_app_publish( wiced_mqtt_object_t mqtt_obj, uint8_t qos, char *topic, uint8_t *data, uint32_t data_len );
 
+/**
+ * Publish without waiting for the acknowledgement. While the window is full the call waits, up to
+ * timeout, for a publish in flight to complete. With several publishing threads the window is a
+ * soft limit, they can pass the wait together.
+ *
+ * The data is framed before the call returns. With QoS 1 and 2 the library may send it again, so
+ * it must then stay valid until the callback.
+ *
+ * @return WICED_SUCCESS when sent, the callback follows; WICED_TIMEOUT when the window stayed
+ *         full; WICED_ERROR when the library refused the message. The callback only runs after
+ *         WICED_SUCCESS.
+ */
+wiced_result_t mqtt_app_publish_async( wiced_mqtt_object_t mqtt_obj, uint8_t qos, char *topic, uint8_t *data, uint32_t data_len,
+        mqtt_publish_callback_t callback, void *arg, uint32_t timeout );
+
+/**
+ * Wait, up to timeout, until every asynchronous publish has completed and its callback returned.
+ */
+wiced_result_t mqtt_app_publish_flush( uint32_t timeout );
+
+/**
+ * Publishes waiting for their acknowledgement.
+ */
+uint32_t mqtt_app_publish_in_flight( void );
+
+void mqtt_app_get_stats( mqtt_app_stats_t *stats );
+
 void mqtt_print_status( wiced_result_t restult, const char * ok_message, const char * error_message );
@@ -0,0 +1,241 @@
+/** @file
+ *  Keeps the MQTT connection to the broker up.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "wiced_crypto.h"
+#include "mqtt.h"
+#include "mqtt_link.h"
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+/**
+ * one attempt: network, name lookup, connect and subscriptions
+ */
+static wiced_result_t link_connect(mqtt_link_t* link);
+/**
+ * wait before the next attempt, longer after every failed one
+ */
+static void link_backoff(mqtt_link_t* link, wiced_time_t now);
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+void mqtt_link_init(mqtt_link_t* link, wiced_mqtt_object_t object, const char* broker, char* client_id, wiced_interface_t interface,
+        wiced_mqtt_callback_t callback, wiced_mqtt_security_t* security)
+{
+    unsigned int seed;
+
+    memset(link, 0, sizeof(*link));
+    link->object = object;
+    link->broker = broker;
+    link->client_id = client_id;
+    link->interface = interface;
+    link->callback = callback;
+    link->security = security;
+    link->state = MQTT_LINK_DOWN;
+    /* Devices booted together must not draw the same jitter */
+    if ( wiced_crypto_get_random( &seed, sizeof(seed) ) == WICED_SUCCESS )
+    {
+        srand( seed );
+    }
+}
+
+void mqtt_link_set_address(mqtt_link_t* link, const wiced_ip_address_t* address)
+{
+    link->address = *address;
+    link->address_valid = WICED_TRUE;
+    link->address_looked_up = WICED_FALSE;
+    wiced_time_get_time( &link->address_time );
+}
+
+wiced_result_t mqtt_link_subscribe(mqtt_link_t* link, char* topic, uint8_t qos)
+{
+    if ( link->topic_count == MQTT_LINK_MAX_TOPICS )
+    {
+        return WICED_BADARG;
+    }
+    link->topics[link->topic_count].topic = topic;
+    link->topics[link->topic_count].qos = qos;
+    link->topic_count++;
+    return WICED_SUCCESS;
+}
+
+uint32_t mqtt_link_service(mqtt_link_t* link, wiced_time_t now)
+{
+    if ( link->state == MQTT_LINK_UP )
+    {
+        if ( !link->dropped )
+        {
+            return MQTT_LINK_NO_DEADLINE;
+        }
+        link->stats.drops++;
+        WPRINT_APP_INFO(("[MQTT] Connection lost, reconnecting\n"));
+        /* A connection that was stable starts over from the shortest delay, one that dropped soon
+         * after it opened keeps backing off */
+        if ( now - link->up_time >= MQTT_LINK_STABLE_MS )
+        {
+            link->attempts = 0;
+        }
+        link_backoff( link, now );
+    }
+    if ( ( link->state == MQTT_LINK_BACKOFF ) && ( (int32_t)( link->retry_time - now ) > 0 ) )
+    {
+        return link->retry_time - now;
+    }
+    if ( link_connect( link ) == WICED_SUCCESS )
+    {
+        link->state = MQTT_LINK_UP;
+        link->failures = 0;
+        wiced_time_get_time( &link->up_time );
+        link->stats.connects++;
+        WPRINT_APP_INFO(("[MQTT] Connected to %s, %lu topics subscribed\n", link->broker, (unsigned long)link->topic_count));
+        return MQTT_LINK_NO_DEADLINE;
+    }
+    link->stats.failures++;
+    /* The attempt may have taken a while */
+    wiced_time_get_time( &now );
+    link_backoff( link, now );
+    WPRINT_APP_INFO(("[MQTT] Connecting failed, attempt %lu, next one in %lums\n", (unsigned long)link->attempts,
+            (unsigned long)( link->retry_time - now )));
+    return link->retry_time - now;
+}
+
+wiced_bool_t mqtt_link_is_up(const mqtt_link_t* link)
+{
+    return ( link->state == MQTT_LINK_UP ) && !link->dropped;
+}
+
+void mqtt_link_check(mqtt_link_t* link, wiced_result_t result)
+{
+    if ( result == WICED_SUCCESS )
+    {
+        link->failures = 0;
+        return;
+    }
+    if ( !mqtt_link_is_up( link ) || ( ++link->failures < MQTT_LINK_MAX_FAILURES ) )
+    {
+        return;
+    }
+    WPRINT_APP_INFO(("[MQTT] %lu publishes failed in a row, closing the connection\n", (unsigned long)link->failures));
+    mqtt_conn_close( link->object );
+    link->dropped = WICED_TRUE;
+}
+
+void mqtt_link_dropped(void* arg)
+{
+    mqtt_link_t* link = (mqtt_link_t*)arg;
+
+    link->dropped = WICED_TRUE;
+    if ( link->event_flags != NULL )
+    {
+        wiced_rtos_set_event_flags( link->event_flags, link->event_flag );
+    }
+}
+
+void mqtt_link_get_stats(const mqtt_link_t* link, mqtt_link_stats_t* stats)
+{
+    *stats = link->stats;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+static wiced_result_t link_connect(mqtt_link_t* link)
+{
+    wiced_result_t ret;
+    wiced_time_t now;
+    uint32_t i;
+
+    if ( !wiced_network_is_up( link->interface ) )
+    {
+        ret = ( link->network_up != NULL ) ? link->network_up( link->interface ) :
+                wiced_network_up( link->interface, WICED_USE_EXTERNAL_DHCP_SERVER, NULL );
+        if ( ret != WICED_SUCCESS )
+        {
+            WPRINT_APP_INFO(("[MQTT] Not able to join the access point\n"));
+            return WICED_ERROR;
+        }
+    }
+    wiced_time_get_time( &now );
+    if ( link->address_valid && ( now - link->address_time >= MQTT_LINK_ADDRESS_TTL_MS ) )
+    {
+        link->address_valid = WICED_FALSE;
+    }
+    if ( !link->address_valid )
+    {
+        ret = wiced_hostname_lookup( link->broker, &link->address, MQTT_LINK_DNS_TIMEOUT_MS, link->interface );
+        if ( ( ret != WICED_SUCCESS ) || ( link->address.ip.v4 == 0 ) )
+        {
+            WPRINT_APP_INFO(("[MQTT] Error resolving %s\n", link->broker));
+            return WICED_ERROR;
+        }
+        link->address_valid = WICED_TRUE;
+        link->address_looked_up = WICED_TRUE;
+        link->address_time = now;
+    }
+    WPRINT_APP_INFO(("[MQTT] Broker IP: %u.%u.%u.%u\n", (uint8_t)(GET_IPV4_ADDRESS(link->address) >> 24),
+            (uint8_t)(GET_IPV4_ADDRESS(link->address) >> 16),
+            (uint8_t)(GET_IPV4_ADDRESS(link->address) >> 8),
+            (uint8_t)(GET_IPV4_ADDRESS(link->address) >> 0)));
+
+    /* Start the library afresh, the old connection may have left its socket behind */
+    if ( link->library_ready )
+    {
+        wiced_mqtt_deinit( link->object );
+        link->library_ready = WICED_FALSE;
+    }
+    if ( wiced_mqtt_init( link->object ) != WICED_SUCCESS )
+    {
+        return WICED_ERROR;
+    }
+    link->library_ready = WICED_TRUE;
+    link->dropped = WICED_FALSE;
+    if ( mqtt_conn_open( link->object, &link->address, link->interface, link->callback, link->security, link->client_id ) != WICED_SUCCESS )
+    {
+        /* Look it up again next time, the broker may have moved */
+        link->address_valid = WICED_FALSE;
+        if ( link->address_callback != NULL )
+        {
+            link->address_callback( NULL );
+        }
+        return WICED_ERROR;
+    }
+    if ( link->address_looked_up && ( link->address_callback != NULL ) )
+    {
+        link->address_callback( &link->address );
+    }
+    link->address_looked_up = WICED_FALSE;
+    for ( i = 0; i < link->topic_count; i++ )
+    {
+        if ( mqtt_app_subscribe( link->object, link->topics[i].topic, link->topics[i].qos ) != WICED_SUCCESS )
+        {
+            WPRINT_APP_INFO(("[MQTT] Error subscribing to %s\n", link->topics[i].topic));
+            mqtt_conn_close( link->object );
+            return WICED_ERROR;
+        }
+    }
+    return link->dropped ? WICED_ERROR : WICED_SUCCESS;
+}
+
+static void link_backoff(mqtt_link_t* link, wiced_time_t now)
+{
+    uint32_t delay = MQTT_LINK_BACKOFF_MIN_MS;
+    uint32_t i;
+
+    for ( i = 0; ( i < link->attempts ) && ( delay < MQTT_LINK_BACKOFF_MAX_MS ); i++ )
+    {
+        delay *= 2;
+    }
+    if ( delay > MQTT_LINK_BACKOFF_MAX_MS )
+    {
+        delay = MQTT_LINK_BACKOFF_MAX_MS;
+    }
+    /* Equal jitter: at least half the delay, so retries never bunch up at zero */
+    delay = delay / 2 + (uint32_t)rand( ) % ( delay / 2 + 1 );
+    link->attempts++;
+    link->retry_time = now + delay;
+    link->state = MQTT_LINK_BACKOFF;
+}
@@ -0,0 +1,170 @@
+/** @file
+ *  Keeps the MQTT connection to the broker up.
+ *
+ *  The link connects, and after a drop reconnects, from the thread that services it: it brings the
+ *  network back if needed, resolves the broker, opens the connection and subscribes again to every
+ *  topic registered with mqtt_link_subscribe(). Failed attempts are retried after an exponential
+ *  backoff from MQTT_LINK_BACKOFF_MIN_MS to MQTT_LINK_BACKOFF_MAX_MS with equal jitter (half the
+ *  delay fixed, half random), so a fleet does not come back to the broker all at once. The backoff
+ *  only starts over from the shortest delay once a connection has stayed up MQTT_LINK_STABLE_MS,
+ *  so a broker that accepts connections and drops them soon after is not retried at the shortest
+ *  delay forever. A publish going through does not count: at QoS 0 it is only written to the
+ *  socket, which a connection about to be dropped still takes.
+ *
+ *  A drop is seen through mqtt_link_dropped(), called on the disconnect event, or after
+ *  MQTT_LINK_MAX_FAILURES publishes in a row failed on a connection that looks open.
+ *
+ *  The broker address is looked up again after MQTT_LINK_ADDRESS_TTL_MS, or once it failed to
+ *  connect. An address known from before, see mqtt_link_set_address(), saves the first lookup.
+ */
+
+#ifndef APPS_NEBULA_WATSON_MQTT_LINK_H_
+#define APPS_NEBULA_WATSON_MQTT_LINK_H_
+
+#include "wiced.h"
+#include "mqtt_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+#define MQTT_LINK_MAX_TOPICS                (4)
+/* Delay before the first retry, doubled on each failed attempt up to the maximum */
+#define MQTT_LINK_BACKOFF_MIN_MS            (1000)
+#define MQTT_LINK_BACKOFF_MAX_MS            (5 * 60 * 1000)
+/* Up this long before a drop, and the backoff starts over from the minimum */
+#define MQTT_LINK_STABLE_MS                 (60 * 1000)
+/* Publishes failing in a row before the connection is taken down and opened again */
+#define MQTT_LINK_MAX_FAILURES              (3)
+#define MQTT_LINK_DNS_TIMEOUT_MS            (10000)
+/* Reconnects reuse the broker address for this long */
+#define MQTT_LINK_ADDRESS_TTL_MS            (60 * 60 * 1000)
+/* Returned by mqtt_link_service() while the link is up */
+#define MQTT_LINK_NO_DEADLINE               (0xFFFFFFFFUL)
+
+/******************************************************
+ *                   Enumerations
+ ******************************************************/
+typedef enum
+{
+    MQTT_LINK_DOWN,         /**< Not connected yet, the next service attempts right away */
+    MQTT_LINK_UP,
+    MQTT_LINK_BACKOFF,      /**< Waiting for the next attempt */
+} mqtt_link_state_t;
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+typedef struct
+{
+    char    *topic;
+    uint8_t qos;
+} mqtt_link_topic_t;
+
+typedef struct
+{
+    uint32_t connects;      /**< Connections opened */
+    uint32_t drops;         /**< Connections lost */
+    uint32_t failures;      /**< Attempts that failed */
+} mqtt_link_stats_t;
+
+typedef struct
+{
+    /* Set before mqtt_link_init() returns, the event flags may be set later */
+    wiced_mqtt_object_t    object;
+    const char             *broker;     /**< Host name of the broker */
+    char                   *client_id;
+    wiced_interface_t      interface;
+    wiced_mqtt_callback_t  callback;
+    wiced_mqtt_security_t  *security;
+    wiced_event_flags_t    *event_flags; /**< Set to event_flag on a drop, or NULL */
+    uint32_t               event_flag;
+    /** Joins the network when it is down, wiced_network_up() with DHCP when NULL */
+    wiced_result_t         (*network_up)(wiced_interface_t interface);
+    /** Told about a looked up address once it connected, and with NULL when an address failed */
+    void                   (*address_callback)(const wiced_ip_address_t* address);
+
+    mqtt_link_topic_t      topics[MQTT_LINK_MAX_TOPICS];
+    uint32_t               topic_count;
+    mqtt_link_state_t      state;
+    uint32_t               attempts;    /**< Attempts since the link was last stable */
+    uint32_t               failures;    /**< Publishes failed in a row */
+    wiced_time_t           retry_time;
+    wiced_time_t           up_time;     /**< When the connection opened */
+    wiced_bool_t           library_ready;
+    volatile wiced_bool_t  dropped;
+    wiced_ip_address_t     address;
+    wiced_bool_t           address_valid;
+    wiced_bool_t           address_looked_up;   /**< Not confirmed by a connect yet */
+    wiced_time_t           address_time;
+    mqtt_link_stats_t      stats;
+} mqtt_link_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+/**
+ * Set up a link that is down. mqtt_app_init() must have been called.
+ *
+ * @param[out] link      : Link
+ * @param[in]  object    : MQTT object, owned by the link from now on
+ * @param[in]  broker    : Host name of the broker, kept
+ * @param[in]  client_id : Kept
+ * @param[in]  interface : Network interface to connect through
+ * @param[in]  callback  : Event callback, mqtt_connection_event_cb()
+ * @param[in]  security  : Credentials, kept
+ */
+void mqtt_link_init(mqtt_link_t* link, wiced_mqtt_object_t object, const char* broker, char* client_id, wiced_interface_t interface,
+        wiced_mqtt_callback_t callback, wiced_mqtt_security_t* security);
+
+/**
+ * Connect to address without a lookup, until it fails or MQTT_LINK_ADDRESS_TTL_MS have passed.
+ */
+void mqtt_link_set_address(mqtt_link_t* link, const wiced_ip_address_t* address);
+
+/**
+ * Subscribe to topic on every connect. Takes effect from the next connect.
+ *
+ * @return WICED_SUCCESS, or WICED_BADARG when MQTT_LINK_MAX_TOPICS topics are registered
+ */
+wiced_result_t mqtt_link_subscribe(mqtt_link_t* link, char* topic, uint8_t qos);
+
+/**
+ * Notice a drop and connect when the backoff allows. An attempt blocks for as long as the network,
+ * the name lookup and the connect take. Call from a single thread.
+ *
+ * @param[in] now : Current time
+ *
+ * @return Milliseconds until the link needs service again, MQTT_LINK_NO_DEADLINE while it is up
+ */
+uint32_t mqtt_link_service(mqtt_link_t* link, wiced_time_t now);
+
+/**
+ * True while the connection is open and no drop was seen.
+ */
+wiced_bool_t mqtt_link_is_up(const mqtt_link_t* link);
+
+/**
+ * Report the result of a publish. After MQTT_LINK_MAX_FAILURES failures in a row the connection is
+ * closed and opened again by the next service.
+ */
+void mqtt_link_check(mqtt_link_t* link, wiced_result_t result);
+
+/**
+ * The connection went down. Safe from the MQTT event thread, pass it to
+ * mqtt_app_set_disconnect_callback().
+ *
+ * @param[in] arg : The link
+ */
+void mqtt_link_dropped(void* arg);
+
+void mqtt_link_get_stats(const mqtt_link_t* link, mqtt_link_stats_t* stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_MQTT_LINK_H_ */
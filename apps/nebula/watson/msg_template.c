@@ -0,0 +1,141 @@
+/** @file
+ *  Pre-rendered message with fixed-width value slots.
+ */
+
+#include "msg_template.h"
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+/* Widest slot: sign, ten digits and the decimal point */
+#define MSG_TEMPLATE_MAX_WIDTH      (12)
+#define MSG_TEMPLATE_MAX_DECIMALS   (9)
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+/* Right align a value into a slot */
+static int32_t put_value(msg_template_t* tpl, int32_t slot, uint32_t magnitude, uint8_t negative);
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+void msg_template_init(msg_template_t* tpl, char* buffer, uint32_t size)
+{
+    fixed_fmt_init(&tpl->fmt, buffer, size);
+    tpl->len = -1;
+    tpl->slot_count = 0;
+}
+
+void msg_template_text(msg_template_t* tpl, const char* text)
+{
+    fixed_fmt_str(&tpl->fmt, text);
+}
+
+int32_t msg_template_slot(msg_template_t* tpl, uint32_t width, uint32_t decimals)
+{
+    msg_template_slot_t* slot;
+    uint32_t i;
+
+    if ( ( tpl->slot_count == MSG_TEMPLATE_MAX_SLOTS ) || ( width == 0 ) || ( width > MSG_TEMPLATE_MAX_WIDTH ) ||
+         ( decimals > MSG_TEMPLATE_MAX_DECIMALS ) || ( ( decimals != 0 ) && ( width < decimals + 2 ) ) )
+    {
+        tpl->fmt.overflow = 1;
+        return -1;
+    }
+    slot = &tpl->slots[tpl->slot_count];
+    slot->offset = (uint16_t)tpl->fmt.len;
+    slot->width = (uint8_t)width;
+    slot->decimals = (uint8_t)decimals;
+    for ( i = 0; i < width; i++ )
+    {
+        fixed_fmt_char(&tpl->fmt, ' ');
+    }
+    if ( tpl->fmt.overflow )
+    {
+        return -1;
+    }
+    tpl->slot_count++;
+    put_value(tpl, (int32_t)tpl->slot_count - 1, 0, 0);
+    return (int32_t)tpl->slot_count - 1;
+}
+
+int32_t msg_template_finish(msg_template_t* tpl)
+{
+    tpl->len = fixed_fmt_finish(&tpl->fmt);
+    return tpl->len;
+}
+
+int32_t msg_template_set(msg_template_t* tpl, int32_t slot, int32_t value)
+{
+    if ( value < 0 )
+    {
+        return put_value(tpl, slot, 0U - (uint32_t)value, 1);
+    }
+    return put_value(tpl, slot, (uint32_t)value, 0);
+}
+
+int32_t msg_template_set_uint(msg_template_t* tpl, int32_t slot, uint32_t value)
+{
+    return put_value(tpl, slot, value, 0);
+}
+
+const char* msg_template_data(const msg_template_t* tpl)
+{
+    return tpl->fmt.buffer;
+}
+
+int32_t msg_template_length(const msg_template_t* tpl)
+{
+    return tpl->len;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+static int32_t put_value(msg_template_t* tpl, int32_t slot, uint32_t magnitude, uint8_t negative)
+{
+    const msg_template_slot_t* s;
+    char text[MSG_TEMPLATE_MAX_WIDTH];
+    uint32_t count = 0;
+    uint32_t i;
+
+    if ( ( slot < 0 ) || ( (uint32_t)slot >= tpl->slot_count ) )
+    {
+        return -1;
+    }
+    s = &tpl->slots[slot];
+
+    /* Built from the last digit; the fraction always has all its digits and a 0 before the point */
+    do
+    {
+        if ( ( count == s->decimals ) && ( count != 0 ) && ( count < s->width ) )
+        {
+            text[count++] = '.';
+        }
+        if ( count == s->width )
+        {
+            return -1;
+        }
+        text[count++] = (char)( '0' + magnitude % 10 );
+        magnitude /= 10;
+    } while ( ( magnitude != 0 ) || ( count <= s->decimals ) );
+    if ( negative )
+    {
+        if ( count == s->width )
+        {
+            return -1;
+        }
+        text[count++] = '-';
+    }
+
+    for ( i = 0; i < s->width - count; i++ )
+    {
+        tpl->fmt.buffer[s->offset + i] = ' ';
+    }
+    for ( ; i < s->width; i++ )
+    {
+        tpl->fmt.buffer[s->offset + i] = text[--count];
+    }
+    return 0;
+}
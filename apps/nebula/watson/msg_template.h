@@ -0,0 +1,110 @@
+/** @file
+ *  Pre-rendered message with fixed-width value slots.
+ *
+ *  The constant part of a message (keys, units, device id) is rendered once. Each value gets a slot
+ *  of fixed width that is overwritten in place, right aligned and padded with spaces, which json
+ *  accepts as whitespace. Building a message is then a handful of digit writes: constant time, no
+ *  allocation, and the buffer and length can go to the MQTT layer as they are.
+ */
+
+#ifndef APPS_NEBULA_WATSON_MSG_TEMPLATE_H_
+#define APPS_NEBULA_WATSON_MSG_TEMPLATE_H_
+
+#include <stdint.h>
+#include "fixed_fmt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                      Macros
+ ******************************************************/
+#define MSG_TEMPLATE_MAX_SLOTS              (8)
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+typedef struct
+{
+    uint16_t offset;
+    uint8_t  width;
+    uint8_t  decimals;
+} msg_template_slot_t;
+
+typedef struct
+{
+    fixed_fmt_t         fmt;
+    int32_t             len;
+    uint32_t            slot_count;
+    msg_template_slot_t slots[MSG_TEMPLATE_MAX_SLOTS];
+} msg_template_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+/**
+ * Start rendering a template into a buffer. The buffer holds the message from then on.
+ *
+ * @param[out] tpl    : Template
+ * @param[in]  buffer : Message buffer
+ * @param[in]  size   : Size of buffer including the terminating NUL
+ */
+void msg_template_init(msg_template_t* tpl, char* buffer, uint32_t size);
+
+/**
+ * Append constant text.
+ */
+void msg_template_text(msg_template_t* tpl, const char* text);
+
+/**
+ * Append a value slot, initially 0.
+ *
+ * @param[in] tpl      : Template
+ * @param[in] width    : Characters reserved, sign and decimal point included
+ * @param[in] decimals : Digits after the decimal point, 0 to 9
+ *
+ * @return slot number for msg_template_set(), or -1 if there are too many slots
+ */
+int32_t msg_template_slot(msg_template_t* tpl, uint32_t width, uint32_t decimals);
+
+/**
+ * Terminate the template.
+ *
+ * @return length of the message, or -1 if the template did not fit the buffer
+ */
+int32_t msg_template_finish(msg_template_t* tpl);
+
+/**
+ * Write a fixed-point value into a slot.
+ *
+ * @param[in] tpl   : Finished template
+ * @param[in] slot  : Slot number
+ * @param[in] value : The value times 10^decimals of the slot
+ *
+ * @return 0, or -1 if the value is wider than the slot; the slot is then left unchanged
+ */
+int32_t msg_template_set(msg_template_t* tpl, int32_t slot, int32_t value);
+
+/**
+ * Write an unsigned integer into a slot, e.g. a time stamp.
+ *
+ * @return 0, or -1 if the value is wider than the slot; the slot is then left unchanged
+ */
+int32_t msg_template_set_uint(msg_template_t* tpl, int32_t slot, uint32_t value);
+
+/**
+ * The message, NUL terminated.
+ */
+const char* msg_template_data(const msg_template_t* tpl);
+
+/**
+ * Length of the message, the same after every msg_template_set().
+ */
+int32_t msg_template_length(const msg_template_t* tpl);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_MSG_TEMPLATE_H_ */
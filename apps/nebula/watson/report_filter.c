@@ -0,0 +1,120 @@
+/** @file
+ *  Report by exception: decides which readings are worth publishing.
+ */
+
+#include <string.h>
+#include "report_filter.h"
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+#define MS_PER_MINUTE           (60000)
+#define BASIS_POINTS            (10000)
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+static uint32_t magnitude(int64_t value);
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+void report_filter_init(report_filter_t* filter, const report_filter_config_t* config)
+{
+    memset(filter, 0, sizeof(*filter));
+    filter->config = *config;
+}
+
+uint32_t report_filter_check(report_filter_t* filter, const watson_sample_t* sample)
+{
+    int32_t values[WATSON_CHANNELS];
+    uint32_t reasons = 0;
+    uint32_t elapsed;
+    uint8_t alarm = 0;
+    uint32_t i;
+
+    watson_sample_to_channels(&sample->data, values);
+    filter->stats.checked++;
+
+    /* Rates are measured against a reference at least rate_interval_ms old, so that two readings
+     * taken close together (a button press) do not turn sensor noise into an alarm */
+    if ( !filter->have_rate_ref )
+    {
+        filter->have_rate_ref = 1;
+        filter->rate_ref_time = sample->time_ms;
+        memcpy(filter->rate_ref, values, sizeof(values));
+    }
+    elapsed = sample->time_ms - filter->rate_ref_time;
+    if ( ( elapsed != 0 ) && ( elapsed >= filter->config.rate_interval_ms ) )
+    {
+        for ( i = 0; i < WATSON_CHANNELS; i++ )
+        {
+            const report_filter_channel_t* channel = &filter->config.channel[i];
+
+            if ( ( channel->rate_limit > 0 ) &&
+                 ( magnitude((int64_t)values[i] - filter->rate_ref[i]) * (uint64_t)MS_PER_MINUTE >= (uint64_t)channel->rate_limit * elapsed ) )
+            {
+                alarm |= (uint8_t)( 1 << i );
+            }
+        }
+        /* Only the rising edge of an alarm is reported, a steady ramp then goes by its deadband */
+        if ( alarm & ~filter->alarm )
+        {
+            reasons |= REPORT_FILTER_RATE_ALARM;
+            filter->stats.rate_alarms++;
+        }
+        filter->alarm = alarm;
+        filter->rate_ref_time = sample->time_ms;
+        memcpy(filter->rate_ref, values, sizeof(values));
+    }
+
+    if ( !filter->have_report )
+    {
+        reasons |= REPORT_FILTER_FIRST;
+    }
+    else
+    {
+        for ( i = 0; i < WATSON_CHANNELS; i++ )
+        {
+            const report_filter_channel_t* channel = &filter->config.channel[i];
+            uint32_t change = magnitude((int64_t)values[i] - filter->reported[i]);
+
+            if ( ( ( channel->abs_deadband > 0 ) && ( change >= (uint32_t)channel->abs_deadband ) ) ||
+                 ( ( channel->rel_deadband_bp != 0 ) && ( change != 0 ) &&
+                   ( (uint64_t)change * BASIS_POINTS >= (uint64_t)channel->rel_deadband_bp * magnitude(filter->reported[i]) ) ) )
+            {
+                reasons |= REPORT_FILTER_CHANGE;
+            }
+        }
+        if ( ( filter->config.heartbeat_ms != 0 ) && ( sample->time_ms - filter->report_time >= filter->config.heartbeat_ms ) )
+        {
+            reasons |= REPORT_FILTER_HEARTBEAT;
+        }
+    }
+    if ( sample->flags & WATSON_SAMPLE_ON_DEMAND )
+    {
+        reasons |= REPORT_FILTER_ON_DEMAND;
+    }
+
+    if ( reasons != 0 )
+    {
+        filter->have_report = 1;
+        filter->report_time = sample->time_ms;
+        memcpy(filter->reported, values, sizeof(values));
+        filter->stats.reported++;
+    }
+    return reasons;
+}
+
+void report_filter_get_stats(const report_filter_t* filter, report_filter_stats_t* stats)
+{
+    *stats = filter->stats;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+static uint32_t magnitude(int64_t value)
+{
+    return (uint32_t)( ( value < 0 ) ? -value : value );
+}
@@ -0,0 +1,102 @@
+/** @file
+ *  Report by exception: decides which readings are worth publishing.
+ *
+ *  A reading is reported when a channel has moved beyond its deadband since the last report, when
+ *  a channel starts changing faster than its rate limit, when nothing was reported for the
+ *  heartbeat period, or when it was taken on demand. Everything else is suppressed, which keeps the
+ *  radio off and the broker quiet for the mostly stable readings of an indoor sensor.
+ *
+ *  Works on integer hundredths (watson_centi_t), so no floating point is involved.
+ */
+
+#ifndef APPS_NEBULA_WATSON_REPORT_FILTER_H_
+#define APPS_NEBULA_WATSON_REPORT_FILTER_H_
+
+#include <stdint.h>
+#include "watson_sample.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                      Macros
+ ******************************************************/
+/* Reasons for a report, combined in the result of report_filter_check() */
+#define REPORT_FILTER_FIRST         (1 << 0)    /**< First reading since init */
+#define REPORT_FILTER_ON_DEMAND     (1 << 1)    /**< Reading flagged WATSON_SAMPLE_ON_DEMAND */
+#define REPORT_FILTER_CHANGE        (1 << 2)    /**< A channel left its deadband */
+#define REPORT_FILTER_HEARTBEAT     (1 << 3)    /**< Nothing reported for heartbeat_ms */
+#define REPORT_FILTER_RATE_ALARM    (1 << 4)    /**< A channel went over its rate limit */
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+/**
+ * Limits of one channel, in the hundredths of watson_centi_t. A zero limit is not checked.
+ */
+typedef struct
+{
+    int32_t  abs_deadband;      /**< Change from the last report, e.g. 20 for 0.2 degC */
+    uint32_t rel_deadband_bp;   /**< Change relative to the last report in 0.01 %, e.g. 500 for 5 % */
+    int32_t  rate_limit;        /**< Change per minute that raises an alarm */
+} report_filter_channel_t;
+
+typedef struct
+{
+    report_filter_channel_t channel[WATSON_CHANNELS];
+    uint32_t heartbeat_ms;          /**< Longest silence, 0 for none */
+    uint32_t rate_interval_ms;      /**< Shortest time a rate is measured over, damps sensor noise */
+} report_filter_config_t;
+
+typedef struct
+{
+    uint32_t checked;
+    uint32_t reported;
+    uint32_t rate_alarms;
+} report_filter_stats_t;
+
+typedef struct
+{
+    report_filter_config_t config;
+    report_filter_stats_t  stats;
+    uint8_t  have_report;
+    uint8_t  have_rate_ref;
+    uint8_t  alarm;                         /* Channels over their rate limit, one bit each */
+    uint32_t report_time;
+    int32_t  reported[WATSON_CHANNELS];     /* Values of the last report */
+    uint32_t rate_ref_time;
+    int32_t  rate_ref[WATSON_CHANNELS];     /* Values the rate is measured from */
+} report_filter_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+/**
+ * Initialise a filter. The next reading is always reported.
+ *
+ * @param[out] filter : Filter
+ * @param[in]  config : Limits, copied
+ */
+void report_filter_init(report_filter_t* filter, const report_filter_config_t* config);
+
+/**
+ * Decide whether to report a reading. Readings must be checked in time order.
+ *
+ * @param[in] filter : Filter
+ * @param[in] sample : The reading
+ *
+ * @return REPORT_FILTER_xxx reasons to report it, 0 to suppress it
+ */
+uint32_t report_filter_check(report_filter_t* filter, const watson_sample_t* sample);
+
+/**
+ * Counters since init.
+ */
+void report_filter_get_stats(const report_filter_t* filter, report_filter_stats_t* stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_REPORT_FILTER_H_ */
@@ -0,0 +1,76 @@
+/** @file
+ *  Collects samples into multi-reading MQTT payloads.
+ */
+
+#include <string.h>
+#include "sample_batch.h"
+#include "fixed_fmt.h"
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+void sample_batch_init(sample_batch_t* batch, uint32_t max_samples, uint32_t linger_ms)
+{
+    memset(batch, 0, sizeof(*batch));
+    batch->max_samples = ( max_samples == 0 ) ? 1 : max_samples;
+    batch->max_samples = ( batch->max_samples > SAMPLE_BATCH_MAX_SAMPLES ) ? SAMPLE_BATCH_MAX_SAMPLES : batch->max_samples;
+    batch->linger_ms = linger_ms;
+}
+
+int sample_batch_add(sample_batch_t* batch, const watson_sample_t* sample)
+{
+    if ( batch->count < batch->max_samples )
+    {
+        batch->samples[batch->count++] = *sample;
+    }
+    return ( batch->count >= batch->max_samples );
+}
+
+uint32_t sample_batch_time_left(const sample_batch_t* batch, uint32_t now_ms)
+{
+    uint32_t age;
+
+    if ( batch->count == 0 )
+    {
+        return SAMPLE_BATCH_NO_DEADLINE;
+    }
+    age = now_ms - batch->samples[0].time_ms;
+    return ( age >= batch->linger_ms ) ? 0 : batch->linger_ms - age;
+}
+
+void sample_batch_clear(sample_batch_t* batch)
+{
+    batch->count = 0;
+}
+
+int32_t sample_batch_to_json(const sample_batch_t* batch, const char* device_id, char* buffer, uint32_t size)
+{
+    fixed_fmt_t fmt;
+    watson_centi_t centi;
+    uint32_t i;
+
+    fixed_fmt_init(&fmt, buffer, size);
+    fixed_fmt_str(&fmt, "{\"d\":{\"id\":\"");
+    fixed_fmt_str(&fmt, device_id);
+    fixed_fmt_str(&fmt, "\",\"units\":{\"t\":\"C\",\"p\":\"Pa\",\"h\":\"%\"},\"n\":");
+    fixed_fmt_uint(&fmt, batch->count);
+    fixed_fmt_str(&fmt, ",\"s\":[");
+    for ( i = 0; i < batch->count; i++ )
+    {
+        watson_sample_to_centi(&batch->samples[i].data, &centi);
+        fixed_fmt_str(&fmt, ( i == 0 ) ? "{\"seq\":" : ",{\"seq\":");
+        fixed_fmt_uint(&fmt, batch->samples[i].seq);
+        fixed_fmt_str(&fmt, ",\"ts\":");
+        fixed_fmt_uint(&fmt, batch->samples[i].time_ms);
+        fixed_fmt_str(&fmt, ",\"t\":");
+        fixed_fmt_decimal(&fmt, centi.temperature, 2);
+        fixed_fmt_str(&fmt, ",\"p\":");
+        fixed_fmt_decimal(&fmt, centi.pressure, 2);
+        fixed_fmt_str(&fmt, ",\"h\":");
+        fixed_fmt_decimal(&fmt, centi.humidity, 2);
+        fixed_fmt_char(&fmt, '}');
+    }
+    fixed_fmt_str(&fmt, "]}}");
+
+    return fixed_fmt_finish(&fmt);
+}
@@ -0,0 +1,117 @@
+/** @file
+ *  Collects samples into multi-reading MQTT payloads.
+ *
+ *  A batch is emitted when it holds max_samples readings or when its oldest reading is linger_ms
+ *  old, whichever comes first, so one PUBLISH carries many readings without holding any of them
+ *  back for longer than the linger time.
+ */
+
+#ifndef APPS_NEBULA_WATSON_SAMPLE_BATCH_H_
+#define APPS_NEBULA_WATSON_SAMPLE_BATCH_H_
+
+#include <stdint.h>
+#include "watson_sample.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+/**
+ * Largest batch.
+ */
+#ifndef SAMPLE_BATCH_MAX_SAMPLES
+#define SAMPLE_BATCH_MAX_SAMPLES    (16)
+#endif
+
+/**
+ * sample_batch_time_left() of an empty batch.
+ */
+#define SAMPLE_BATCH_NO_DEADLINE    (0xFFFFFFFFU)
+
+/**
+ * Longest JSON rendering of one reading, see sample_batch_to_json(): names and punctuation, seq
+ * and ts of up to ten digits and three channels in hundredths across the whole int32_t range, as
+ * wide as -21474836.48.
+ */
+#define SAMPLE_BATCH_JSON_SAMPLE_LEN (8 + 6 + 3 * 5 + 1 + 2 * 10 + 3 * 12)
+
+/**
+ * Longest JSON rendering of the rest of the event but the device id: names and punctuation, a
+ * count of up to ten digits and the NUL.
+ */
+#define SAMPLE_BATCH_JSON_HEADER_LEN (62 + 10 + 1)
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+typedef struct
+{
+    uint32_t        max_samples;
+    uint32_t        linger_ms;
+    uint32_t        count;
+    watson_sample_t samples[SAMPLE_BATCH_MAX_SAMPLES];
+} sample_batch_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+/**
+ * Set up an empty batch.
+ *
+ * @param[out] batch       : The batch
+ * @param[in]  max_samples : Readings per payload, 1 to SAMPLE_BATCH_MAX_SAMPLES; clamped
+ * @param[in]  linger_ms   : Age of the oldest reading at which the batch is emitted anyway
+ */
+void sample_batch_init(sample_batch_t* batch, uint32_t max_samples, uint32_t linger_ms);
+
+/**
+ * Add a reading.
+ *
+ * @param[in] batch  : The batch, not full
+ * @param[in] sample : The reading, copied
+ *
+ * @return non-zero once the batch is full and must be emitted before the next add
+ */
+int sample_batch_add(sample_batch_t* batch, const watson_sample_t* sample);
+
+/**
+ * Time until the batch must be emitted because of its linger time.
+ *
+ * @param[in] batch  : The batch
+ * @param[in] now_ms : Current system time, same clock as watson_sample_t.time_ms
+ *
+ * @return milliseconds left, 0 if due, SAMPLE_BATCH_NO_DEADLINE if the batch is empty
+ */
+uint32_t sample_batch_time_left(const sample_batch_t* batch, uint32_t now_ms);
+
+/**
+ * Empty the batch after it was emitted.
+ */
+void sample_batch_clear(sample_batch_t* batch);
+
+/**
+ * Render the batch as a Watson IoT event:
+ *
+ *   {"d":{"id":"<device_id>","units":{"t":"C","p":"Pa","h":"%"},"n":2,
+ *         "s":[{"seq":7,"ts":35000,"t":21.50,"p":98765.43,"h":40.12},{...}]}}
+ *
+ * where ts is the system time of each reading in ms.
+ *
+ * @param[in]  batch     : The batch
+ * @param[in]  device_id : Device name put in the payload
+ * @param[out] buffer    : Output, NUL terminated
+ * @param[in]  size      : Size of buffer; strlen(device_id) + SAMPLE_BATCH_JSON_HEADER_LEN +
+ *                         count * SAMPLE_BATCH_JSON_SAMPLE_LEN suffices for any reading
+ *
+ * @return length of the payload, or -1 if it did not fit
+ */
+int32_t sample_batch_to_json(const sample_batch_t* batch, const char* device_id, char* buffer, uint32_t size);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_SAMPLE_BATCH_H_ */
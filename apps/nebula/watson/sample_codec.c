@@ -0,0 +1,117 @@
+/** @file
+ *  Packed binary encoding of sample batches.
+ */
+
+#include <string.h>
+#include "sample_codec.h"
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+#define U16_MAX                     (0xFFFFU)
+#define U24_MAX                     (0xFFFFFFU)
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+static void put_le(uint8_t* out, uint32_t value, uint32_t bytes);
+static uint32_t get_le(const uint8_t* in, uint32_t bytes);
+
+static int32_t clip(int32_t value, int32_t min, int32_t max);
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+int32_t sample_codec_encode(const watson_sample_t* samples, uint32_t count, uint8_t* buffer, uint32_t size)
+{
+    uint8_t* out = buffer;
+    watson_centi_t centi;
+    uint32_t i;
+
+    if ( ( count > SAMPLE_CODEC_MAX_SAMPLES ) || ( size < SAMPLE_CODEC_LEN(count) ) )
+    {
+        return -1;
+    }
+
+    out[0] = SAMPLE_CODEC_VERSION;
+    out[1] = (uint8_t)count;
+    put_le(&out[2], ( count != 0 ) ? samples[0].seq : 0, 4);
+    put_le(&out[6], ( count != 0 ) ? samples[0].time_ms : 0, 4);
+    out += SAMPLE_CODEC_HEADER_LEN;
+
+    for ( i = 0; i < count; i++, out += SAMPLE_CODEC_SAMPLE_LEN )
+    {
+        watson_sample_to_centi(&samples[i].data, &centi);
+        put_le(&out[0], samples[i].seq - samples[0].seq, 2);
+        put_le(&out[2], samples[i].time_ms - samples[0].time_ms, 3);
+        put_le(&out[5], (uint32_t)clip(centi.temperature, INT16_MIN, INT16_MAX), 2);
+        put_le(&out[7], (uint32_t)clip(centi.pressure, 0, U24_MAX), 3);
+        put_le(&out[10], (uint32_t)clip(centi.humidity, 0, U16_MAX), 2);
+    }
+
+    return (int32_t)SAMPLE_CODEC_LEN(count);
+}
+
+int32_t sample_codec_decode(const uint8_t* payload, uint32_t len, watson_sample_t* samples, uint32_t max_samples)
+{
+    const uint8_t* in = payload + SAMPLE_CODEC_HEADER_LEN;
+    watson_centi_t centi;
+    uint32_t count;
+    uint32_t first_seq;
+    uint32_t first_time;
+    uint32_t i;
+
+    if ( ( len < SAMPLE_CODEC_HEADER_LEN ) || ( payload[0] != SAMPLE_CODEC_VERSION ) )
+    {
+        return -1;
+    }
+    count = payload[1];
+    if ( ( len != SAMPLE_CODEC_LEN(count) ) || ( count > max_samples ) )
+    {
+        return -1;
+    }
+    first_seq = get_le(&payload[2], 4);
+    first_time = get_le(&payload[6], 4);
+
+    for ( i = 0; i < count; i++, in += SAMPLE_CODEC_SAMPLE_LEN )
+    {
+        samples[i].seq = first_seq + get_le(&in[0], 2);
+        samples[i].time_ms = first_time + get_le(&in[2], 3);
+        samples[i].flags = 0;
+        centi.temperature = (int16_t)get_le(&in[5], 2);
+        centi.pressure = (int32_t)get_le(&in[7], 3);
+        centi.humidity = (int32_t)get_le(&in[10], 2);
+        watson_sample_from_centi(&centi, &samples[i].data);
+    }
+
+    return (int32_t)count;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+static void put_le(uint8_t* out, uint32_t value, uint32_t bytes)
+{
+    uint32_t i;
+
+    for ( i = 0; i < bytes; i++, value >>= 8 )
+    {
+        out[i] = (uint8_t)value;
+    }
+}
+
+static uint32_t get_le(const uint8_t* in, uint32_t bytes)
+{
+    uint32_t value = 0;
+
+    while ( bytes-- != 0 )
+    {
+        value = ( value << 8 ) | in[bytes];
+    }
+    return value;
+}
+
+static int32_t clip(int32_t value, int32_t min, int32_t max)
+{
+    return ( value < min ) ? min : ( ( value > max ) ? max : value );
+}
@@ -0,0 +1,79 @@
+/** @file
+ *  Packed binary encoding of sample batches, the compact alternative to the JSON events.
+ *
+ *  Layout, version 1, all fields little endian:
+ *
+ *    header, SAMPLE_CODEC_HEADER_LEN bytes
+ *      0   u8   schema version, SAMPLE_CODEC_VERSION
+ *      1   u8   number of samples
+ *      2   u32  seq of the first sample
+ *      6   u32  time_ms of the first sample
+ *
+ *    per sample, SAMPLE_CODEC_SAMPLE_LEN bytes
+ *      0   u16  seq - first seq
+ *      2   u24  time_ms - first time_ms
+ *      5   s16  temperature, 0.01 degC
+ *      7   u24  pressure, 0.01 Pa
+ *      10  u16  humidity, 0.01 %RH
+ *
+ *  The device is identified by the MQTT client id, so the payload does not repeat it. The encoder
+ *  runs on the device, the decoder is meant for the hosts that read the payloads.
+ */
+
+#ifndef APPS_NEBULA_WATSON_SAMPLE_CODEC_H_
+#define APPS_NEBULA_WATSON_SAMPLE_CODEC_H_
+
+#include <stdint.h>
+#include "watson_sample.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+#define SAMPLE_CODEC_VERSION        (1)
+#define SAMPLE_CODEC_HEADER_LEN     (10)
+#define SAMPLE_CODEC_SAMPLE_LEN     (12)
+#define SAMPLE_CODEC_MAX_SAMPLES    (255)
+
+/**
+ * Encoded size of a batch of n samples.
+ */
+#define SAMPLE_CODEC_LEN(n)         (SAMPLE_CODEC_HEADER_LEN + (n) * SAMPLE_CODEC_SAMPLE_LEN)
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+/**
+ * Encode samples. Values are rounded to the resolution of the layout and clipped to its range;
+ * the samples must be in seq and time order and span less than 65536 samples and 4.6 hours.
+ *
+ * @param[in]  samples : The samples
+ * @param[in]  count   : Number of samples, at most SAMPLE_CODEC_MAX_SAMPLES
+ * @param[out] buffer  : Output
+ * @param[in]  size    : Size of buffer, SAMPLE_CODEC_LEN(count) suffices
+ *
+ * @return length of the payload, or -1 if count is too large or the payload did not fit
+ */
+int32_t sample_codec_encode(const watson_sample_t* samples, uint32_t count, uint8_t* buffer, uint32_t size);
+
+/**
+ * Decode a payload into struct bme280_data units.
+ *
+ * @param[in]  payload     : The payload
+ * @param[in]  len         : Its length
+ * @param[out] samples     : Output
+ * @param[in]  max_samples : Room in samples
+ *
+ * @return number of samples, or -1 for an unknown version, a length that does not match the
+ *         sample count, or too little room
+ */
+int32_t sample_codec_decode(const uint8_t* payload, uint32_t len, watson_sample_t* samples, uint32_t max_samples);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_SAMPLE_CODEC_H_ */
@@ -0,0 +1,547 @@
+/** @file
+ *  Store-and-forward journal of readings in NOR flash.
+ */
+
+#include <string.h>
+#include "sample_journal.h"
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+#define JOURNAL_MAGIC               (0x314A5357U)   /* "WSJ1" */
+#define JOURNAL_RECORD_MARKER       (0x5B)
+#define JOURNAL_CRC_OFFSET          (SAMPLE_JOURNAL_RECORD_LEN - 2)
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+static uint32_t sector_address(const sample_journal_t* journal, uint32_t sector);
+static uint32_t record_address(const sample_journal_t* journal, const sample_journal_pos_t* pos);
+static uint32_t next_sector(const sample_journal_t* journal, uint32_t sector);
+static int32_t read_header(const sample_journal_t* journal, uint32_t sector, uint32_t* seq, uint32_t* consumed);
+static int32_t find_head_record(sample_journal_t* journal);
+static int32_t advance_head(sample_journal_t* journal);
+static int32_t mark_consumed(sample_journal_t* journal, uint32_t sector, uint32_t from, uint32_t to);
+static int32_t write_record(sample_journal_t* journal);
+static int32_t check_record(const uint8_t* in);
+static uint32_t record_samples(const uint8_t* in);
+static int32_t is_blank(const uint8_t* data, uint32_t len);
+static uint16_t crc16(const uint8_t* data, uint32_t len);
+static void put_le(uint8_t* out, uint32_t value, uint32_t bytes);
+static uint32_t get_le(const uint8_t* in, uint32_t bytes);
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+int32_t sample_journal_open(sample_journal_t* journal, const sample_journal_flash_t* flash, uint32_t base, uint32_t size)
+{
+    uint32_t sector_size = flash->sector_size;
+    uint32_t records;
+    uint32_t sector;
+    uint32_t seq;
+    uint32_t head_seq = 0;
+    uint32_t consumed;
+    uint32_t used;
+    uint32_t i;
+    int32_t valid = 0;
+    int32_t found = 0;
+
+    memset(journal, 0, sizeof(*journal));
+    ts_codec_encoder_init(&journal->stage, journal->stage_buffer, sizeof(journal->stage_buffer));
+    if ( ( sector_size <= SAMPLE_JOURNAL_HEADER_LEN + SAMPLE_JOURNAL_RECORD_LEN + 1 ) || ( base % sector_size != 0 ) ||
+         ( size / sector_size < 2 ) )
+    {
+        return -1;
+    }
+
+    /* Most records that fit next to their bitmap */
+    records = ( ( sector_size - SAMPLE_JOURNAL_HEADER_LEN ) * 8 ) / ( SAMPLE_JOURNAL_RECORD_LEN * 8 + 1 );
+    while ( SAMPLE_JOURNAL_HEADER_LEN + ( records + 7 ) / 8 + records * SAMPLE_JOURNAL_RECORD_LEN > sector_size )
+    {
+        records--;
+    }
+    if ( records > SAMPLE_JOURNAL_MAX_BITMAP_LEN * 8 )
+    {
+        records = SAMPLE_JOURNAL_MAX_BITMAP_LEN * 8;
+    }
+    journal->flash = flash;
+    journal->base = base;
+    journal->sector_count = size / sector_size;
+    journal->records_per_sector = records;
+    journal->bitmap_len = ( records + 7 ) / 8;
+    journal->stats.capacity = journal->sector_count * records;
+
+    /* The head is the sector written last */
+    for ( sector = 0; sector < journal->sector_count; sector++ )
+    {
+        valid = read_header(journal, sector, &seq, NULL);
+        if ( valid < 0 )
+        {
+            return -1;
+        }
+        if ( valid && ( !found || ( (int32_t)( seq - head_seq ) > 0 ) ) )
+        {
+            found = 1;
+            head_seq = seq;
+            journal->head.sector = sector;
+        }
+    }
+    if ( !found )
+    {
+        /* Empty region: the first append starts at sector 0 */
+        journal->head.sector = journal->sector_count - 1;
+        journal->head.record = records;
+        journal->tail = journal->head;
+        return 0;
+    }
+    journal->head_seq = head_seq;
+    if ( find_head_record(journal) != 0 )
+    {
+        return -1;
+    }
+
+    /* Walk back over the sectors written before the head, in sequence, to the oldest one */
+    sector = journal->head.sector;
+    for ( i = 1; i < journal->sector_count; i++ )
+    {
+        uint32_t prev = ( sector + journal->sector_count - 1 ) % journal->sector_count;
+
+        valid = read_header(journal, prev, &seq, NULL);
+        if ( valid < 0 )
+        {
+            return -1;
+        }
+        if ( !valid || ( seq != head_seq - i ) )
+        {
+            break;
+        }
+        sector = prev;
+    }
+
+    /* The tail is the first record not marked consumed, everything from there on is pending */
+    found = 0;
+    journal->tail = journal->head;
+    for ( ; ; sector = next_sector(journal, sector) )
+    {
+        if ( read_header(journal, sector, &seq, &consumed) < 0 )
+        {
+            return -1;
+        }
+        used = ( sector == journal->head.sector ) ? journal->head.record : records;
+        if ( consumed > used )
+        {
+            consumed = used;
+        }
+        if ( !found && ( consumed < used ) )
+        {
+            found = 1;
+            journal->tail.sector = sector;
+            journal->tail.record = consumed;
+        }
+        if ( found )
+        {
+            journal->stats.pending += used - consumed;
+        }
+        if ( sector == journal->head.sector )
+        {
+            break;
+        }
+    }
+    return 0;
+}
+
+int32_t sample_journal_append(sample_journal_t* journal, const watson_sample_t* sample)
+{
+    int32_t result = 0;
+
+    if ( ( journal->stage.count >= SAMPLE_JOURNAL_RECORD_SAMPLES ) || ( ts_codec_append(&journal->stage, sample) != 0 ) )
+    {
+        result = sample_journal_flush(journal);
+        /* A reading always fits an empty stream */
+        ts_codec_append(&journal->stage, sample);
+    }
+    journal->stats.appended++;
+    journal->stats.staged = journal->stage.count;
+    return result;
+}
+
+int32_t sample_journal_flush(sample_journal_t* journal)
+{
+    int32_t result;
+
+    if ( journal->stage.count == 0 )
+    {
+        return 0;
+    }
+    result = write_record(journal);
+    if ( result != 0 )
+    {
+        journal->stats.dropped += journal->stage.count;
+    }
+    ts_codec_encoder_init(&journal->stage, journal->stage_buffer, sizeof(journal->stage_buffer));
+    journal->stats.staged = 0;
+    return result;
+}
+
+int32_t sample_journal_peek(sample_journal_t* journal, watson_sample_t* samples, uint32_t max_samples)
+{
+    journal->peeked = 0;
+    return sample_journal_peek_more(journal, samples, max_samples);
+}
+
+int32_t sample_journal_peek_more(sample_journal_t* journal, watson_sample_t* samples, uint32_t max_samples)
+{
+    const sample_journal_flash_t* flash = journal->flash;
+    ts_codec_t decoder;
+    uint32_t n = 0;
+    int32_t count;
+
+    sample_journal_flush(journal);
+    if ( !journal->peeked )
+    {
+        journal->peek_pos = journal->tail;
+        journal->peek_slots = 0;
+        journal->peek_corrupt = 0;
+        journal->peek_samples = 0;
+        journal->peeked = 1;
+    }
+    while ( journal->peek_slots < journal->stats.pending )
+    {
+        if ( journal->peek_pos.record >= journal->records_per_sector )
+        {
+            journal->peek_pos.sector = next_sector(journal, journal->peek_pos.sector);
+            journal->peek_pos.record = 0;
+        }
+        if ( flash->read(flash->context, record_address(journal, &journal->peek_pos), journal->record, SAMPLE_JOURNAL_RECORD_LEN) != 0 )
+        {
+            journal->peeked = 0;
+            return -1;
+        }
+        count = -1;
+        if ( check_record(journal->record) == 0 )
+        {
+            count = ts_codec_decoder_init(&decoder, &journal->record[4], get_le(&journal->record[2], 2));
+            if ( count > (int32_t)( max_samples - n ) )
+            {
+                /* Records are consumed whole, this one waits for the next peek */
+                break;
+            }
+            if ( ( count >= 0 ) && ( ts_codec_decode(&decoder, &samples[n], (uint32_t)count) != count ) )
+            {
+                count = -1;
+            }
+        }
+        if ( count >= 0 )
+        {
+            n += (uint32_t)count;
+            journal->peek_samples += (uint32_t)count;
+        }
+        else
+        {
+            journal->peek_corrupt++;
+        }
+        journal->peek_pos.record++;
+        journal->peek_slots++;
+    }
+    if ( ( journal->peek_samples == 0 ) && ( journal->peek_slots != 0 ) )
+    {
+        /* Nothing but torn records: drop them */
+        if ( sample_journal_consume(journal) != 0 )
+        {
+            return -1;
+        }
+    }
+    return (int32_t)n;
+}
+
+int32_t sample_journal_consume(sample_journal_t* journal)
+{
+    sample_journal_pos_t pos = journal->tail;
+    uint32_t left = journal->peek_slots;
+    uint32_t count;
+
+    if ( !journal->peeked )
+    {
+        return -1;
+    }
+    journal->peeked = 0;
+    while ( left != 0 )
+    {
+        if ( pos.record >= journal->records_per_sector )
+        {
+            pos.sector = next_sector(journal, pos.sector);
+            pos.record = 0;
+        }
+        count = journal->records_per_sector - pos.record;
+        count = ( count < left ) ? count : left;
+        if ( mark_consumed(journal, pos.sector, pos.record, pos.record + count) != 0 )
+        {
+            return -1;
+        }
+        pos.record += count;
+        left -= count;
+    }
+    journal->tail = pos;
+    journal->stats.pending -= journal->peek_slots;
+    journal->stats.sent += journal->peek_samples;
+    journal->stats.corrupt += journal->peek_corrupt;
+    if ( journal->stats.pending == 0 )
+    {
+        journal->tail = journal->head;
+    }
+    return 0;
+}
+
+uint32_t sample_journal_pending(const sample_journal_t* journal)
+{
+    return journal->stats.pending + ( ( journal->stage.count != 0 ) ? 1 : 0 );
+}
+
+void sample_journal_get_stats(const sample_journal_t* journal, sample_journal_stats_t* stats)
+{
+    *stats = journal->stats;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+static uint32_t sector_address(const sample_journal_t* journal, uint32_t sector)
+{
+    return journal->base + sector * journal->flash->sector_size;
+}
+
+static uint32_t record_address(const sample_journal_t* journal, const sample_journal_pos_t* pos)
+{
+    return sector_address(journal, pos->sector) + SAMPLE_JOURNAL_HEADER_LEN + journal->bitmap_len + pos->record * SAMPLE_JOURNAL_RECORD_LEN;
+}
+
+static uint32_t next_sector(const sample_journal_t* journal, uint32_t sector)
+{
+    return ( sector + 1 ) % journal->sector_count;
+}
+
+/* Returns 1 for a valid sector, 0 for a blank or torn one, -1 on a flash error. consumed may be NULL. */
+static int32_t read_header(const sample_journal_t* journal, uint32_t sector, uint32_t* seq, uint32_t* consumed)
+{
+    const sample_journal_flash_t* flash = journal->flash;
+    uint8_t header[SAMPLE_JOURNAL_HEADER_LEN + SAMPLE_JOURNAL_MAX_BITMAP_LEN];
+    uint32_t len = SAMPLE_JOURNAL_HEADER_LEN + ( ( consumed != NULL ) ? journal->bitmap_len : 0 );
+    uint32_t count = 0;
+
+    if ( flash->read(flash->context, sector_address(journal, sector), header, len) != 0 )
+    {
+        return -1;
+    }
+    if ( ( get_le(&header[0], 4) != JOURNAL_MAGIC ) || ( get_le(&header[8], 2) != crc16(header, 8) ) )
+    {
+        if ( consumed != NULL )
+        {
+            *consumed = 0;
+        }
+        return 0;
+    }
+    *seq = get_le(&header[4], 4);
+    if ( consumed != NULL )
+    {
+        /* Records are consumed in order, so the cleared bits form a prefix */
+        while ( ( count < journal->records_per_sector ) &&
+                ( ( header[SAMPLE_JOURNAL_HEADER_LEN + count / 8] & ( 1 << ( count % 8 ) ) ) == 0 ) )
+        {
+            count++;
+        }
+        *consumed = count;
+    }
+    return 1;
+}
+
+/* The head record follows the last record that is not blank */
+static int32_t find_head_record(sample_journal_t* journal)
+{
+    const sample_journal_flash_t* flash = journal->flash;
+    sample_journal_pos_t pos;
+    uint32_t end;
+
+    pos.sector = journal->head.sector;
+    for ( end = journal->records_per_sector; end != 0; end-- )
+    {
+        pos.record = end - 1;
+        if ( flash->read(flash->context, record_address(journal, &pos), journal->record, SAMPLE_JOURNAL_RECORD_LEN) != 0 )
+        {
+            return -1;
+        }
+        if ( !is_blank(journal->record, SAMPLE_JOURNAL_RECORD_LEN) )
+        {
+            break;
+        }
+    }
+    journal->head.record = end;
+    return 0;
+}
+
+/* Start the next sector, giving up its unsent records if the journal is full */
+static int32_t advance_head(sample_journal_t* journal)
+{
+    const sample_journal_flash_t* flash = journal->flash;
+    uint8_t header[SAMPLE_JOURNAL_HEADER_LEN];
+    uint32_t next = next_sector(journal, journal->head.sector);
+    sample_journal_pos_t pos;
+
+    if ( ( journal->stats.pending != 0 ) && ( journal->tail.sector == next ) )
+    {
+        /* Count the readings given up; a torn record counts for none */
+        for ( pos = journal->tail; pos.record < journal->records_per_sector; pos.record++ )
+        {
+            if ( flash->read(flash->context, record_address(journal, &pos), journal->record, SAMPLE_JOURNAL_RECORD_LEN) != 0 )
+            {
+                return -1;
+            }
+            journal->stats.dropped += record_samples(journal->record);
+        }
+        journal->stats.pending -= journal->records_per_sector - journal->tail.record;
+        journal->tail.sector = next_sector(journal, next);
+        journal->tail.record = 0;
+        journal->peeked = 0;
+    }
+
+    if ( flash->erase(flash->context, sector_address(journal, next)) != 0 )
+    {
+        return -1;
+    }
+    journal->stats.erases++;
+    memset(header, 0xFF, sizeof(header));
+    put_le(&header[0], JOURNAL_MAGIC, 4);
+    put_le(&header[4], journal->head_seq + 1, 4);
+    put_le(&header[8], crc16(header, 8), 2);
+    if ( flash->write(flash->context, sector_address(journal, next), header, sizeof(header)) != 0 )
+    {
+        return -1;
+    }
+    journal->head_seq++;
+    journal->head.sector = next;
+    journal->head.record = 0;
+    if ( journal->stats.pending == 0 )
+    {
+        journal->tail = journal->head;
+    }
+    return 0;
+}
+
+/* Clear the bits of records from..to-1, the records before from are already cleared */
+static int32_t mark_consumed(sample_journal_t* journal, uint32_t sector, uint32_t from, uint32_t to)
+{
+    const sample_journal_flash_t* flash = journal->flash;
+    uint8_t bits[SAMPLE_JOURNAL_MAX_BITMAP_LEN];
+    uint32_t first = from / 8;
+    uint32_t last = ( to - 1 ) / 8;
+    uint32_t i;
+
+    for ( i = first; i <= last; i++ )
+    {
+        bits[i - first] = ( to >= ( i + 1 ) * 8 ) ? 0x00 : (uint8_t)( 0xFF << ( to - i * 8 ) );
+    }
+    return flash->write(flash->context, sector_address(journal, sector) + SAMPLE_JOURNAL_HEADER_LEN + first, bits, last - first + 1);
+}
+
+/* Write the stage into the next record */
+static int32_t write_record(sample_journal_t* journal)
+{
+    const sample_journal_flash_t* flash = journal->flash;
+    uint8_t* record = journal->record;
+    uint32_t len = ts_codec_length(&journal->stage);
+    uint32_t address;
+
+    if ( ( journal->head.record >= journal->records_per_sector ) && ( advance_head(journal) != 0 ) )
+    {
+        return -1;
+    }
+    memset(record, 0xFF, SAMPLE_JOURNAL_RECORD_LEN);
+    record[0] = JOURNAL_RECORD_MARKER;
+    put_le(&record[2], len, 2);
+    memcpy(&record[4], journal->stage_buffer, len);
+    put_le(&record[JOURNAL_CRC_OFFSET], crc16(record, JOURNAL_CRC_OFFSET), 2);
+    address = record_address(journal, &journal->head);
+    /* The slot is used even if programming fails, a blank slot must never be followed by data */
+    journal->head.record++;
+    journal->stats.pending++;
+    if ( flash->write(flash->context, address, record, SAMPLE_JOURNAL_RECORD_LEN) != 0 )
+    {
+        memset(record, 0, SAMPLE_JOURNAL_RECORD_LEN);
+        flash->write(flash->context, address, record, SAMPLE_JOURNAL_RECORD_LEN);
+        return -1;
+    }
+    return 0;
+}
+
+static int32_t check_record(const uint8_t* in)
+{
+    if ( ( in[0] != JOURNAL_RECORD_MARKER ) || ( get_le(&in[2], 2) > SAMPLE_JOURNAL_STREAM_LEN ) ||
+         ( get_le(&in[JOURNAL_CRC_OFFSET], 2) != crc16(in, JOURNAL_CRC_OFFSET) ) )
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static uint32_t record_samples(const uint8_t* in)
+{
+    ts_codec_t decoder;
+    int32_t count;
+
+    if ( check_record(in) != 0 )
+    {
+        return 0;
+    }
+    count = ts_codec_decoder_init(&decoder, &in[4], get_le(&in[2], 2));
+    return ( count > 0 ) ? (uint32_t)count : 0;
+}
+
+static int32_t is_blank(const uint8_t* data, uint32_t len)
+{
+    while ( len-- != 0 )
+    {
+        if ( *data++ != 0xFF )
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* CRC-16/CCITT-FALSE */
+static uint16_t crc16(const uint8_t* data, uint32_t len)
+{
+    uint16_t crc = 0xFFFF;
+    uint32_t bit;
+
+    while ( len-- != 0 )
+    {
+        crc ^= (uint16_t)( *data++ << 8 );
+        for ( bit = 0; bit < 8; bit++ )
+        {
+            crc = ( crc & 0x8000 ) ? (uint16_t)( ( crc << 1 ) ^ 0x1021 ) : (uint16_t)( crc << 1 );
+        }
+    }
+    return crc;
+}
+
+static void put_le(uint8_t* out, uint32_t value, uint32_t bytes)
+{
+    uint32_t i;
+
+    for ( i = 0; i < bytes; i++ )
+    {
+        out[i] = (uint8_t)( value >> ( 8 * i ) );
+    }
+}
+
+static uint32_t get_le(const uint8_t* in, uint32_t bytes)
+{
+    uint32_t value = 0;
+    uint32_t i;
+
+    for ( i = 0; i < bytes; i++ )
+    {
+        value |= (uint32_t)in[i] << ( 8 * i );
+    }
+    return value;
+}
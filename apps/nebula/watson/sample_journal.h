@@ -0,0 +1,194 @@
+/** @file
+ *  Store-and-forward journal of readings in NOR flash.
+ *
+ *  Readings that could not be published are appended to a log in a flash region and read back, in
+ *  order and in large batches, once the connection returns. Readings are staged in RAM as a
+ *  ts_codec.h stream and written as one record of up to SAMPLE_JOURNAL_RECORD_SAMPLES readings, so
+ *  a reading takes about 4 bytes of flash instead of the 40 of a watson_sample_t. The region is a ring of erase sectors
+ *  written strictly in address order, so every sector is erased once per trip round the ring and
+ *  wear is spread evenly. A sector is only erased when the write head needs it again; if it still
+ *  holds unsent readings when the journal is full, the oldest readings are given up.
+ *
+ *  Sector layout, little endian:
+ *      0   u32 magic "WSJ1"
+ *      4   u32 sequence number, one more than the previous sector written
+ *      8   u16 CRC-16/CCITT of bytes 0..7
+ *      10  6 bytes reserved
+ *      16  consumed bitmap, one bit per record, cleared once the record has been sent
+ *      ..  records of SAMPLE_JOURNAL_RECORD_LEN bytes:
+ *          u8 marker, u8 reserved, u16 stream length, the ts_codec.h stream padded with 0xFF,
+ *          u16 CRC-16/CCITT of the preceding bytes
+ *
+ *  Nothing is ever rewritten except by clearing bits, so the journal relies on the program and
+ *  erase operations only. After a reset sample_journal_open() finds the write head from the sector
+ *  with the highest sequence number and its first blank record, and the read tail from the consumed
+ *  bitmaps. A record torn by a reset fails its CRC and is skipped. Readings whose consumed bits
+ *  were not yet written when the reset hit are sent again, so delivery is at least once and the seq
+ *  numbers let the receiver drop repeats. Staged readings are lost on a reset; sample_journal_flush()
+ *  bounds how many.
+ *
+ *  The flash is reached through sample_journal_flash_t, so the journal runs on the serial flash of
+ *  the board as well as on the file backed emulator of the host build.
+ *
+ *  Not thread safe: one thread appends and drains.
+ */
+
+#ifndef APPS_NEBULA_WATSON_SAMPLE_JOURNAL_H_
+#define APPS_NEBULA_WATSON_SAMPLE_JOURNAL_H_
+
+#include <stdint.h>
+#include "watson_sample.h"
+#include "ts_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+#define SAMPLE_JOURNAL_RECORD_LEN       (254)           /* Sixteen to a 4 KB sector */
+#define SAMPLE_JOURNAL_HEADER_LEN       (16)
+#define SAMPLE_JOURNAL_STREAM_LEN       (SAMPLE_JOURNAL_RECORD_LEN - 6)
+
+/**
+ * Most readings in a record, and so the least room sample_journal_peek() needs.
+ */
+#define SAMPLE_JOURNAL_RECORD_SAMPLES   (64)
+
+/**
+ * Largest consumed bitmap, which bounds the records per sector and so the sector size (about 128 KB).
+ */
+#define SAMPLE_JOURNAL_MAX_BITMAP_LEN   (64)
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+/**
+ * Flash access. Addresses are absolute; each function returns 0 on success.
+ */
+typedef struct
+{
+    void*    context;
+    int32_t  (*read)(void* context, uint32_t address, void* data, uint32_t len);
+    /** Program: may only clear bits */
+    int32_t  (*write)(void* context, uint32_t address, const void* data, uint32_t len);
+    /** Erase the sector holding address to all 0xFF */
+    int32_t  (*erase)(void* context, uint32_t address);
+    uint32_t sector_size;
+} sample_journal_flash_t;
+
+typedef struct
+{
+    uint32_t appended;      /**< Readings appended */
+    uint32_t sent;          /**< Readings consumed after a drain */
+    uint32_t dropped;       /**< Unsent readings given up to a full journal or a failed write */
+    uint32_t corrupt;       /**< Torn records skipped */
+    uint32_t erases;
+    uint32_t staged;        /**< Readings in RAM, not yet written */
+    uint32_t pending;       /**< Records waiting to be sent */
+    uint32_t capacity;      /**< Records the region holds */
+} sample_journal_stats_t;
+
+typedef struct
+{
+    uint32_t sector;
+    uint32_t record;
+} sample_journal_pos_t;
+
+typedef struct
+{
+    const sample_journal_flash_t* flash;
+    uint32_t               base;
+    uint32_t               sector_count;
+    uint32_t               records_per_sector;
+    uint32_t               bitmap_len;
+    uint32_t               head_seq;    /* Sequence number of the head sector */
+    sample_journal_pos_t   head;        /* Next record to write */
+    sample_journal_pos_t   tail;        /* Oldest record not consumed */
+    sample_journal_pos_t   peek_pos;    /* Next record to peek */
+    uint32_t               peek_slots;  /* Records covered by the peeks since the last consume */
+    uint32_t               peek_corrupt;
+    uint32_t               peek_samples;
+    uint8_t                peeked;
+    sample_journal_stats_t stats;
+    ts_codec_t             stage;
+    uint8_t                stage_buffer[SAMPLE_JOURNAL_STREAM_LEN];
+    uint8_t                record[SAMPLE_JOURNAL_RECORD_LEN];
+} sample_journal_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+/**
+ * Mount the journal in a flash region, recovering the write head and the read tail left by the
+ * previous run. A region without valid sectors is an empty journal; nothing is erased until the
+ * first append.
+ *
+ * @param[out] journal : Journal
+ * @param[in]  flash   : Flash access, must stay valid
+ * @param[in]  base    : Start of the region, sector aligned
+ * @param[in]  size    : Size of the region, at least two sectors
+ *
+ * @return 0, or -1 for an unusable region or a flash error
+ */
+int32_t sample_journal_open(sample_journal_t* journal, const sample_journal_flash_t* flash, uint32_t base, uint32_t size);
+
+/**
+ * Append a reading to the stage. A full stage is written first, giving up the oldest sector when
+ * the journal is full. Readings must come in seq order.
+ *
+ * @return 0, or -1 if the stage could not be written; its readings are dropped
+ */
+int32_t sample_journal_append(sample_journal_t* journal, const watson_sample_t* sample);
+
+/**
+ * Write the staged readings as a record, even if it is not full.
+ *
+ * @return 0 once the record is programmed or if nothing was staged, -1 on a flash error; the
+ *         staged readings are dropped
+ */
+int32_t sample_journal_flush(sample_journal_t* journal);
+
+/**
+ * Read the oldest unsent readings without consuming them, whole records at a time. The stage is
+ * written first. Each call starts again from the oldest.
+ *
+ * @param[in]  journal     : Journal
+ * @param[out] samples     : Output
+ * @param[in]  max_samples : Room in samples, at least SAMPLE_JOURNAL_RECORD_SAMPLES
+ *
+ * @return number of readings, 0 when the journal is empty, -1 on a flash error
+ */
+int32_t sample_journal_peek(sample_journal_t* journal, watson_sample_t* samples, uint32_t max_samples);
+
+/**
+ * Read on from where the previous peek stopped, so that several batches can be in flight before
+ * the consume. Starts from the oldest when nothing has been peeked since the last consume.
+ *
+ * @return as sample_journal_peek()
+ */
+int32_t sample_journal_peek_more(sample_journal_t* journal, watson_sample_t* samples, uint32_t max_samples);
+
+/**
+ * Mark the readings returned by the peeks since the last consume as sent.
+ *
+ * @return 0, or -1 on a flash error or if the peeked records were overwritten since
+ */
+int32_t sample_journal_consume(sample_journal_t* journal);
+
+/**
+ * Records waiting to be sent, with the stage counting as one when it holds readings.
+ */
+uint32_t sample_journal_pending(const sample_journal_t* journal);
+
+/**
+ * Counters since open; pending and capacity are current.
+ */
+void sample_journal_get_stats(const sample_journal_t* journal, sample_journal_stats_t* stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_SAMPLE_JOURNAL_H_ */
@@ -0,0 +1,122 @@
+/** @file
+ *  Fixed capacity single-producer/single-consumer ring of samples.
+ *
+ *  Each slot carries a sequence word in the manner of a seqlock: the producer makes it odd while it
+ *  copies a sample in and sets it to 2 * position + 2 afterwards. The consumer only trusts a copy
+ *  taken while the word held the value expected for its position. With SAMPLE_RING_DROP_NEWEST the
+ *  producer never reaches a slot the consumer has not released, so the check always passes; with
+ *  SAMPLE_RING_DROP_OLDEST it detects a producer that lapped the consumer during the copy.
+ */
+
+#include <string.h>
+#include "sample_ring.h"
+
+/******************************************************
+ *                      Macros
+ ******************************************************/
+#define SAMPLE_RING_MASK            (SAMPLE_RING_CAPACITY - 1)
+
+#define SLOT_SEQ_WRITING(pos)       ((uint32_t)(2 * (pos) + 1))
+#define SLOT_SEQ_WRITTEN(pos)       ((uint32_t)(2 * (pos) + 2))
+
+/* Counters have a single writer and are read from anywhere */
+#define COUNTER_ADD(counter, n)     __atomic_store_n(&(counter), (counter) + (n), __ATOMIC_RELAXED)
+#define COUNTER_READ(counter)       __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+typedef char sample_ring_capacity_is_power_of_two[((SAMPLE_RING_CAPACITY & SAMPLE_RING_MASK) == 0) ? 1 : -1];
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+void sample_ring_init(sample_ring_t* ring, sample_ring_policy_t policy)
+{
+    memset(ring, 0, sizeof(*ring));
+    ring->prod.policy = (uint8_t)policy;
+}
+
+sample_ring_result_t sample_ring_push(sample_ring_t* ring, const watson_sample_t* sample)
+{
+    uint32_t head = ring->prod.head;
+    uint32_t level = head - ring->prod.tail_cache;
+    sample_ring_slot_t* slot;
+
+    if ( level >= SAMPLE_RING_CAPACITY )
+    {
+        /* Looks full from the cached tail, see how far the consumer really is */
+        ring->prod.tail_cache = __atomic_load_n(&ring->cons.tail, __ATOMIC_ACQUIRE);
+        level = head - ring->prod.tail_cache;
+        if ( level >= SAMPLE_RING_CAPACITY )
+        {
+            if ( ring->prod.policy == SAMPLE_RING_DROP_NEWEST )
+            {
+                COUNTER_ADD(ring->prod.dropped, 1);
+                return SAMPLE_RING_FULL;
+            }
+            level = SAMPLE_RING_CAPACITY - 1;
+        }
+    }
+
+    slot = &ring->slots[head & SAMPLE_RING_MASK];
+    __atomic_store_n(&slot->seq, SLOT_SEQ_WRITING(head), __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&slot->sample, sample, sizeof(*sample));
+    __atomic_store_n(&slot->seq, SLOT_SEQ_WRITTEN(head), __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->prod.head, head + 1, __ATOMIC_RELEASE);
+
+    COUNTER_ADD(ring->prod.pushed, 1);
+    if ( level + 1 > ring->prod.high_water )
+    {
+        __atomic_store_n(&ring->prod.high_water, level + 1, __ATOMIC_RELAXED);
+    }
+    return SAMPLE_RING_OK;
+}
+
+sample_ring_result_t sample_ring_pop(sample_ring_t* ring, watson_sample_t* sample)
+{
+    uint32_t tail = ring->cons.tail;
+    uint32_t head = __atomic_load_n(&ring->prod.head, __ATOMIC_ACQUIRE);
+    const sample_ring_slot_t* slot;
+    uint32_t seq_before;
+    uint32_t seq_after;
+
+    if ( head == tail )
+    {
+        return SAMPLE_RING_EMPTY;
+    }
+    if ( head - tail > SAMPLE_RING_CAPACITY )
+    {
+        /* Lapped by a SAMPLE_RING_DROP_OLDEST producer, skip to the oldest sample still held */
+        COUNTER_ADD(ring->cons.overwritten, head - tail - SAMPLE_RING_CAPACITY);
+        tail = head - SAMPLE_RING_CAPACITY;
+    }
+
+    slot = &ring->slots[tail & SAMPLE_RING_MASK];
+    seq_before = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    memcpy(sample, &slot->sample, sizeof(*sample));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    seq_after = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&ring->cons.tail, tail + 1, __ATOMIC_RELEASE);
+
+    if ( ( seq_before != SLOT_SEQ_WRITTEN(tail) ) || ( seq_after != seq_before ) )
+    {
+        COUNTER_ADD(ring->cons.overwritten, 1);
+        return SAMPLE_RING_OVERRUN;
+    }
+    COUNTER_ADD(ring->cons.popped, 1);
+    return SAMPLE_RING_OK;
+}
+
+void sample_ring_get_stats(const sample_ring_t* ring, sample_ring_stats_t* stats)
+{
+    uint32_t level = __atomic_load_n(&ring->prod.head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring->cons.tail, __ATOMIC_ACQUIRE);
+
+    stats->pushed = COUNTER_READ(ring->prod.pushed);
+    stats->popped = COUNTER_READ(ring->cons.popped);
+    stats->dropped = COUNTER_READ(ring->prod.dropped);
+    stats->overwritten = COUNTER_READ(ring->cons.overwritten);
+    stats->high_water = COUNTER_READ(ring->prod.high_water);
+    stats->level = ( level > SAMPLE_RING_CAPACITY ) ? SAMPLE_RING_CAPACITY : level;
+}
@@ -0,0 +1,151 @@
+/** @file
+ *  Fixed capacity single-producer/single-consumer ring of samples.
+ *
+ *  One context pushes (a thread or an interrupt) and one context pops. Neither side ever waits for
+ *  the other: push and pop are wait-free, bounded in time and safe to call from interrupt context.
+ *  The indices of the two sides live in separate cache lines so that they do not bounce between
+ *  cores on a host; on the Cortex-M4 the padding only costs RAM.
+ */
+
+#ifndef APPS_NEBULA_WATSON_SAMPLE_RING_H_
+#define APPS_NEBULA_WATSON_SAMPLE_RING_H_
+
+#include <stdint.h>
+#include "watson_sample.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+/**
+ * Number of samples a ring holds, a power of two.
+ */
+#ifndef SAMPLE_RING_CAPACITY
+#define SAMPLE_RING_CAPACITY        (32)
+#endif
+
+/**
+ * Alignment that keeps the producer and the consumer state apart.
+ */
+#ifndef SAMPLE_RING_CACHE_LINE
+#define SAMPLE_RING_CACHE_LINE      (64)
+#endif
+
+/******************************************************
+ *                   Enumerations
+ ******************************************************/
+/**
+ * What a push does when the ring is full.
+ */
+typedef enum
+{
+    SAMPLE_RING_DROP_NEWEST, /**< The new sample is rejected and counted in dropped */
+    SAMPLE_RING_DROP_OLDEST, /**< The new sample overwrites the oldest, counted in overwritten */
+} sample_ring_policy_t;
+
+typedef enum
+{
+    SAMPLE_RING_OK,
+    SAMPLE_RING_EMPTY,      /**< pop: nothing to read */
+    SAMPLE_RING_FULL,       /**< push, SAMPLE_RING_DROP_NEWEST: the sample was dropped */
+    SAMPLE_RING_OVERRUN,    /**< pop, SAMPLE_RING_DROP_OLDEST: the producer overwrote the sample being
+                                 read, it is counted in overwritten; pop again for the next one */
+} sample_ring_result_t;
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+typedef struct
+{
+    uint32_t        seq;    /* 2 * position + 2 once written, odd while being written */
+    watson_sample_t sample;
+} sample_ring_slot_t;
+
+/**
+ * A ring. Initialise it with sample_ring_init() before either side uses it; the fields are private.
+ */
+typedef struct
+{
+    /* Producer side */
+    struct
+    {
+        uint32_t head;          /* next position to write */
+        uint32_t tail_cache;    /* last tail seen, spares reading the consumer line on every push */
+        uint32_t pushed;
+        uint32_t dropped;
+        uint32_t high_water;
+        uint8_t  policy;
+    } prod __attribute__((aligned(SAMPLE_RING_CACHE_LINE)));
+
+    /* Consumer side */
+    struct
+    {
+        uint32_t tail;          /* next position to read */
+        uint32_t popped;
+        uint32_t overwritten;
+    } cons __attribute__((aligned(SAMPLE_RING_CACHE_LINE)));
+
+    sample_ring_slot_t slots[SAMPLE_RING_CAPACITY] __attribute__((aligned(SAMPLE_RING_CACHE_LINE)));
+} sample_ring_t;
+
+/**
+ * Counters of a ring. They are free running and wrap at 2^32.
+ */
+typedef struct
+{
+    uint32_t pushed;        /**< Samples accepted by push */
+    uint32_t popped;        /**< Samples returned by pop */
+    uint32_t dropped;       /**< Samples rejected by a full SAMPLE_RING_DROP_NEWEST ring */
+    uint32_t overwritten;   /**< Samples lost to a full SAMPLE_RING_DROP_OLDEST ring */
+    uint32_t high_water;    /**< Highest fill level seen by the producer */
+    uint32_t level;         /**< Samples waiting, a snapshot */
+} sample_ring_stats_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+/**
+ * Empty a ring and set its overflow policy. Neither side may use the ring meanwhile.
+ *
+ * @param[out] ring   : The ring
+ * @param[in]  policy : What a push into a full ring does
+ */
+void sample_ring_init(sample_ring_t* ring, sample_ring_policy_t policy);
+
+/**
+ * Add a sample, producer side only.
+ *
+ * @param[in] ring   : The ring
+ * @param[in] sample : The sample, copied into the ring
+ *
+ * @return SAMPLE_RING_OK, or SAMPLE_RING_FULL if a SAMPLE_RING_DROP_NEWEST ring was full
+ */
+sample_ring_result_t sample_ring_push(sample_ring_t* ring, const watson_sample_t* sample);
+
+/**
+ * Take the oldest sample, consumer side only.
+ *
+ * @param[in]  ring   : The ring
+ * @param[out] sample : The sample, valid for SAMPLE_RING_OK
+ *
+ * @return SAMPLE_RING_OK, SAMPLE_RING_EMPTY or SAMPLE_RING_OVERRUN
+ */
+sample_ring_result_t sample_ring_pop(sample_ring_t* ring, watson_sample_t* sample);
+
+/**
+ * Read the counters. Callable from either side or a third context; the values are read without
+ * stopping the ring and need not be consistent with each other.
+ *
+ * @param[in]  ring  : The ring
+ * @param[out] stats : The counters
+ */
+void sample_ring_get_stats(const sample_ring_t* ring, sample_ring_stats_t* stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_SAMPLE_RING_H_ */
@@ -0,0 +1,94 @@
+/** @file
+ *  TLS session cache for resuming the connection to the broker, with handshake timing.
+ */
+
+#include <string.h>
+#include "tls_session.h"
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+void tls_session_cache_init(tls_session_cache_t* cache, uint32_t lifetime_ms)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->lifetime_ms = lifetime_ms;
+}
+
+void tls_session_cache_load(tls_session_cache_t* cache, const tls_session_t* session, uint32_t now_ms)
+{
+    if ( ( session->id_length == 0 ) || ( session->id_length > TLS_SESSION_ID_LEN ) )
+    {
+        return;
+    }
+    cache->session = *session;
+    cache->session_time_ms = now_ms;
+}
+
+const tls_session_t* tls_session_offer(tls_session_cache_t* cache, uint32_t peer, uint32_t now_ms)
+{
+    cache->offered = 0;
+    if ( cache->session.id_length == 0 )
+    {
+        return NULL;
+    }
+    if ( ( cache->session.peer != peer ) || ( now_ms - cache->session_time_ms >= cache->lifetime_ms ) )
+    {
+        /* Another broker behind the name, or the server has surely dropped it by now */
+        tls_session_forget( cache );
+        return NULL;
+    }
+    cache->offered = 1;
+    return &cache->session;
+}
+
+int32_t tls_session_done(tls_session_cache_t* cache, const tls_session_t* session, uint32_t now_ms, uint32_t handshake_ms)
+{
+    int32_t resumed = 0;
+
+    cache->stats.last_ms = handshake_ms;
+    if ( session == NULL )
+    {
+        /* Do not offer it again, in case the session is what the server choked on */
+        cache->stats.failed++;
+        tls_session_forget( cache );
+        return 0;
+    }
+    if ( cache->offered && ( session->id_length == cache->session.id_length ) &&
+         ( memcmp( session->id, cache->session.id, session->id_length ) == 0 ) )
+    {
+        resumed = 1;
+        cache->stats.resumed++;
+        cache->stats.resumed_ms += handshake_ms;
+    }
+    else
+    {
+        if ( cache->offered )
+        {
+            cache->stats.refused++;
+        }
+        cache->stats.full++;
+        cache->stats.full_ms += handshake_ms;
+        /* A new session, kept from now; a resumed one keeps the age of the full handshake */
+        cache->session_time_ms = now_ms;
+    }
+    cache->offered = 0;
+    if ( ( session->id_length == 0 ) || ( session->id_length > TLS_SESSION_ID_LEN ) )
+    {
+        /* The server does not cache sessions */
+        memset( &cache->session, 0, sizeof(cache->session) );
+        return resumed;
+    }
+    cache->session = *session;
+    return resumed;
+}
+
+void tls_session_forget(tls_session_cache_t* cache)
+{
+    memset( &cache->session, 0, sizeof(cache->session) );
+    cache->offered = 0;
+}
+
+void tls_session_get_stats(const tls_session_cache_t* cache, tls_session_stats_t* stats)
+{
+    *stats = cache->stats;
+}
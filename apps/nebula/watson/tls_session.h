@@ -0,0 +1,113 @@
+/** @file
+ *  TLS session cache for resuming the connection to the broker, with handshake timing.
+ *
+ *  A full TLS handshake costs the device seconds of public key arithmetic and radio time. A
+ *  client that offers the session id of an earlier connection in its ClientHello gets an
+ *  abbreviated handshake (RFC 5246, 7.3) when the server still has that session: both sides
+ *  derive the keys from the cached master secret and no certificate is sent or checked.
+ *
+ *  The cache holds the one session of the broker connection, in a TLS library neutral form that
+ *  can also be kept in the DCT. A session is offered only to the server it came from and for at
+ *  most lifetime_ms; the server decides whether to resume, and answers a session it no longer
+ *  knows with a full handshake. A handshake counts as resumed when the server kept the offered
+ *  session id.
+ */
+
+#ifndef APPS_NEBULA_WATSON_TLS_SESSION_H_
+#define APPS_NEBULA_WATSON_TLS_SESSION_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+#define TLS_SESSION_ID_LEN              (32)
+#define TLS_SESSION_MASTER_LEN          (48)
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+/**
+ * A session to resume. All zeros is no session.
+ */
+typedef struct
+{
+    uint8_t  id_length;         /**< 0 when there is no session */
+    uint8_t  id[TLS_SESSION_ID_LEN];
+    uint8_t  master[TLS_SESSION_MASTER_LEN];
+    uint16_t cipher;            /**< Cipher suite number, as sent in the ServerHello */
+    uint32_t peer;              /**< IPv4 address of the server */
+} tls_session_t;
+
+/**
+ * Handshakes since tls_session_cache_init(). Times are the TCP connect plus the TLS handshake.
+ */
+typedef struct
+{
+    uint32_t full;
+    uint32_t resumed;
+    uint32_t refused;           /**< Sessions offered that the server did not resume */
+    uint32_t failed;
+    uint32_t full_ms;           /**< Total time of the full handshakes */
+    uint32_t resumed_ms;
+    uint32_t last_ms;
+} tls_session_stats_t;
+
+typedef struct
+{
+    tls_session_t       session;
+    uint32_t            session_time_ms;    /* When the session was made or loaded */
+    uint32_t            lifetime_ms;
+    uint8_t             offered;            /* The session went out with the current handshake */
+    tls_session_stats_t stats;
+} tls_session_cache_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+/**
+ * Start empty.
+ *
+ * @param[in] lifetime_ms : Longest a session is offered after it was made
+ */
+void tls_session_cache_init(tls_session_cache_t* cache, uint32_t lifetime_ms);
+
+/**
+ * Take a session kept from an earlier run. Its age is not known, it is offered for lifetime_ms
+ * from now.
+ */
+void tls_session_cache_load(tls_session_cache_t* cache, const tls_session_t* session, uint32_t now_ms);
+
+/**
+ * The session to offer in a handshake with peer, before it starts.
+ *
+ * @return The session, or NULL for a full handshake
+ */
+const tls_session_t* tls_session_offer(tls_session_cache_t* cache, uint32_t peer, uint32_t now_ms);
+
+/**
+ * A handshake finished. Keeps the session the server gave and counts the handshake.
+ *
+ * @param[in] session      : Session of the connection, NULL when the handshake failed
+ * @param[in] handshake_ms : Time the handshake took
+ *
+ * @return 1 if the offered session was resumed, 0 otherwise
+ */
+int32_t tls_session_done(tls_session_cache_t* cache, const tls_session_t* session, uint32_t now_ms, uint32_t handshake_ms);
+
+/**
+ * Drop the session, the next handshake is a full one.
+ */
+void tls_session_forget(tls_session_cache_t* cache);
+
+void tls_session_get_stats(const tls_session_cache_t* cache, tls_session_stats_t* stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_TLS_SESSION_H_ */
@@ -0,0 +1,274 @@
+/** @file
+ *  Streaming time-series compression of readings.
+ */
+
+#include <string.h>
+#include "ts_codec.h"
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+/* Value bits after each prefix of the signed code: 10, 110, 1110, 1111 */
+static const uint8_t value_bits[] = { 3, 6, 12, 32 };
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+static int32_t put_bits(ts_codec_t* codec, uint32_t value, uint32_t bits);
+static int32_t get_bits(ts_codec_t* codec, uint32_t bits, uint32_t* value);
+static int32_t put_signed(ts_codec_t* codec, int32_t value);
+static int32_t get_signed(ts_codec_t* codec, int32_t* value);
+static int32_t put_sample(ts_codec_t* codec, const watson_sample_t* sample);
+static int32_t get_sample(ts_codec_t* codec, watson_sample_t* sample);
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+void ts_codec_encoder_init(ts_codec_t* codec, uint8_t* buffer, uint32_t size)
+{
+    memset(codec, 0, sizeof(*codec));
+    codec->buffer = buffer;
+    codec->size = size;
+    if ( size >= TS_CODEC_HEADER_LEN )
+    {
+        buffer[0] = TS_CODEC_VERSION;
+        buffer[1] = 0;
+        buffer[2] = 0;
+    }
+}
+
+int32_t ts_codec_append(ts_codec_t* codec, const watson_sample_t* sample)
+{
+    ts_codec_t saved = *codec;
+
+    if ( ( codec->size < TS_CODEC_HEADER_LEN ) || ( codec->count == TS_CODEC_MAX_SAMPLES ) || ( put_sample(codec, sample) != 0 ) )
+    {
+        *codec = saved;
+        /* The failed append may have written into the padding of the last byte */
+        if ( ( codec->bit % 8 ) != 0 )
+        {
+            codec->buffer[TS_CODEC_HEADER_LEN + codec->bit / 8] &= (uint8_t)( 0xFF00U >> ( codec->bit % 8 ) );
+        }
+        return -1;
+    }
+    codec->count++;
+    codec->buffer[1] = (uint8_t)codec->count;
+    codec->buffer[2] = (uint8_t)( codec->count >> 8 );
+    return 0;
+}
+
+uint32_t ts_codec_length(const ts_codec_t* codec)
+{
+    return TS_CODEC_HEADER_LEN + ( codec->bit + 7 ) / 8;
+}
+
+uint32_t ts_codec_count(const ts_codec_t* codec)
+{
+    return codec->count;
+}
+
+int32_t ts_codec_decoder_init(ts_codec_t* codec, const uint8_t* payload, uint32_t len)
+{
+    memset(codec, 0, sizeof(*codec));
+    if ( ( len < TS_CODEC_HEADER_LEN ) || ( payload[0] != TS_CODEC_VERSION ) )
+    {
+        return -1;
+    }
+    /* Decoding only reads the buffer */
+    codec->buffer = (uint8_t*)payload;
+    codec->size = len;
+    codec->count = payload[1] | ( (uint32_t)payload[2] << 8 );
+    return (int32_t)codec->count;
+}
+
+int32_t ts_codec_decode(ts_codec_t* codec, watson_sample_t* samples, uint32_t max_samples)
+{
+    uint32_t n = 0;
+
+    while ( ( n < max_samples ) && ( codec->count != 0 ) )
+    {
+        if ( get_sample(codec, &samples[n]) != 0 )
+        {
+            return -1;
+        }
+        codec->count--;
+        n++;
+    }
+    return (int32_t)n;
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+static int32_t put_sample(ts_codec_t* codec, const watson_sample_t* sample)
+{
+    int32_t values[WATSON_CHANNELS];
+    uint32_t period = sample->time_ms - codec->time_ms;
+    uint32_t flags = sample->flags & 0xFF;
+    uint32_t c;
+
+    watson_sample_to_channels(&sample->data, values);
+    if ( ( put_signed(codec, (int32_t)( sample->seq - codec->seq - 1 )) != 0 ) ||
+         ( put_signed(codec, (int32_t)( period - codec->period_ms )) != 0 ) )
+    {
+        return -1;
+    }
+    if ( ( flags == codec->flags ) ? ( put_bits(codec, 0, 1) != 0 ) : ( put_bits(codec, 0x100 | flags, 9) != 0 ) )
+    {
+        return -1;
+    }
+    for ( c = 0; c < WATSON_CHANNELS; c++ )
+    {
+        if ( put_signed(codec, (int32_t)( (uint32_t)values[c] - (uint32_t)codec->values[c] )) != 0 )
+        {
+            return -1;
+        }
+    }
+
+    codec->seq = sample->seq;
+    codec->time_ms = sample->time_ms;
+    codec->period_ms = period;
+    codec->flags = flags;
+    memcpy(codec->values, values, sizeof(values));
+    return 0;
+}
+
+static int32_t get_sample(ts_codec_t* codec, watson_sample_t* sample)
+{
+    watson_centi_t centi;
+    int32_t delta[WATSON_CHANNELS];
+    int32_t seq_delta;
+    int32_t period_delta;
+    uint32_t changed;
+    uint32_t flags = codec->flags;
+    uint32_t c;
+
+    if ( ( get_signed(codec, &seq_delta) != 0 ) || ( get_signed(codec, &period_delta) != 0 ) || ( get_bits(codec, 1, &changed) != 0 ) ||
+         ( changed && ( get_bits(codec, 8, &flags) != 0 ) ) )
+    {
+        return -1;
+    }
+    for ( c = 0; c < WATSON_CHANNELS; c++ )
+    {
+        if ( get_signed(codec, &delta[c]) != 0 )
+        {
+            return -1;
+        }
+        codec->values[c] = (int32_t)( (uint32_t)codec->values[c] + (uint32_t)delta[c] );
+    }
+    codec->seq += (uint32_t)seq_delta + 1;
+    codec->period_ms += (uint32_t)period_delta;
+    codec->time_ms += codec->period_ms;
+    codec->flags = flags;
+
+    sample->seq = codec->seq;
+    sample->time_ms = codec->time_ms;
+    sample->flags = flags;
+    centi.temperature = codec->values[WATSON_CHANNEL_TEMPERATURE];
+    centi.pressure = codec->values[WATSON_CHANNEL_PRESSURE];
+    centi.humidity = codec->values[WATSON_CHANNEL_HUMIDITY];
+    watson_sample_from_centi(&centi, &sample->data);
+    return 0;
+}
+
+static int32_t put_signed(ts_codec_t* codec, int32_t value)
+{
+    uint32_t zigzag = ( (uint32_t)value << 1 ) ^ (uint32_t)( value >> 31 );
+    uint32_t prefix;
+
+    if ( zigzag == 0 )
+    {
+        return put_bits(codec, 0, 1);
+    }
+    for ( prefix = 0; prefix < sizeof(value_bits) - 1; prefix++ )
+    {
+        if ( zigzag < ( 1UL << value_bits[prefix] ) )
+        {
+            break;
+        }
+    }
+    /* prefix + 1 ones, then a zero unless it is the last prefix */
+    if ( put_bits(codec, ( 1UL << ( prefix + 1 ) ) - 1, prefix + 1) != 0 )
+    {
+        return -1;
+    }
+    if ( ( prefix < sizeof(value_bits) - 1 ) && ( put_bits(codec, 0, 1) != 0 ) )
+    {
+        return -1;
+    }
+    return put_bits(codec, zigzag, value_bits[prefix]);
+}
+
+static int32_t get_signed(ts_codec_t* codec, int32_t* value)
+{
+    uint32_t prefix = 0;
+    uint32_t bit;
+    uint32_t zigzag;
+
+    if ( get_bits(codec, 1, &bit) != 0 )
+    {
+        return -1;
+    }
+    if ( bit == 0 )
+    {
+        *value = 0;
+        return 0;
+    }
+    while ( prefix < sizeof(value_bits) - 1 )
+    {
+        if ( get_bits(codec, 1, &bit) != 0 )
+        {
+            return -1;
+        }
+        if ( bit == 0 )
+        {
+            break;
+        }
+        prefix++;
+    }
+    if ( get_bits(codec, value_bits[prefix], &zigzag) != 0 )
+    {
+        return -1;
+    }
+    *value = (int32_t)( ( zigzag >> 1 ) ^ ( 0U - ( zigzag & 1 ) ) );
+    return 0;
+}
+
+static int32_t put_bits(ts_codec_t* codec, uint32_t value, uint32_t bits)
+{
+    uint8_t* out;
+    uint32_t mask;
+
+    if ( TS_CODEC_HEADER_LEN + ( codec->bit + bits + 7 ) / 8 > codec->size )
+    {
+        return -1;
+    }
+    while ( bits != 0 )
+    {
+        bits--;
+        out = &codec->buffer[TS_CODEC_HEADER_LEN + codec->bit / 8];
+        mask = 0x80U >> ( codec->bit % 8 );
+        /* Set or clear, a rolled back append may have left bits behind */
+        *out = ( ( value >> bits ) & 1 ) ? (uint8_t)( *out | mask ) : (uint8_t)( *out & ~mask );
+        codec->bit++;
+    }
+    return 0;
+}
+
+static int32_t get_bits(ts_codec_t* codec, uint32_t bits, uint32_t* value)
+{
+    uint32_t result = 0;
+
+    if ( TS_CODEC_HEADER_LEN + ( codec->bit + bits + 7 ) / 8 > codec->size )
+    {
+        return -1;
+    }
+    while ( bits != 0 )
+    {
+        bits--;
+        result = ( result << 1 ) | ( ( codec->buffer[TS_CODEC_HEADER_LEN + codec->bit / 8] >> ( 7 - codec->bit % 8 ) ) & 1 );
+        codec->bit++;
+    }
+    *value = result;
+    return 0;
+}
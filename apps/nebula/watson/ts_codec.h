@@ -0,0 +1,119 @@
+/** @file
+ *  Streaming time-series compression of readings.
+ *
+ *  Each reading is coded against the one before it, in a bit stream:
+ *    - time: delta of delta, so a steady sampling period costs one bit;
+ *    - seq: delta minus one, one bit for consecutive readings;
+ *    - flags: one bit when unchanged;
+ *    - temperature, pressure and humidity: zig-zag delta of the hundredths of watson_centi_t.
+ *  Signed values go into a prefix code: 0 for zero, then 10, 110, 1110 and 1111 followed by 3, 6,
+ *  12 and 32 bits of zig-zag value. A slowly moving indoor reading takes about 4 bytes against 12 in
+ *  the packed layout of sample_codec.h and 40 as a watson_sample_t.
+ *
+ *  Stream layout: u8 version, u16 little endian reading count, then the bits, most significant bit
+ *  of each byte first, padded with zeros to a whole byte. The stream is complete after each
+ *  ts_codec_append(), so it can be published or stored at any point and appended to afterwards.
+ */
+
+#ifndef APPS_NEBULA_WATSON_TS_CODEC_H_
+#define APPS_NEBULA_WATSON_TS_CODEC_H_
+
+#include <stdint.h>
+#include "watson_sample.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+#define TS_CODEC_VERSION            (1)
+#define TS_CODEC_HEADER_LEN         (3)
+#define TS_CODEC_MAX_SAMPLES        (0xFFFF)
+
+/**
+ * Longest coding of one reading: 4 + 32 bits for seq, time and each channel, and 1 + 8 for flags.
+ */
+#define TS_CODEC_MAX_SAMPLE_LEN     (24)
+
+/**
+ * Buffer size that holds any n readings.
+ */
+#define TS_CODEC_LEN(n)             (TS_CODEC_HEADER_LEN + (n) * TS_CODEC_MAX_SAMPLE_LEN)
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+/**
+ * Encoder or decoder state: the stream and the previous reading.
+ */
+typedef struct
+{
+    uint8_t* buffer;
+    uint32_t size;
+    uint32_t bit;           /* Next bit of the stream, after the header */
+    uint32_t count;         /* Readings coded, or left to decode */
+    uint32_t seq;
+    uint32_t time_ms;
+    uint32_t period_ms;
+    uint32_t flags;
+    int32_t  values[WATSON_CHANNELS];
+} ts_codec_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+/**
+ * Start an empty stream.
+ *
+ * @param[out] codec  : Encoder
+ * @param[in]  buffer : Stream
+ * @param[in]  size   : Size of buffer, at least TS_CODEC_HEADER_LEN
+ */
+void ts_codec_encoder_init(ts_codec_t* codec, uint8_t* buffer, uint32_t size);
+
+/**
+ * Append a reading. Readings must come in seq order.
+ *
+ * @return 0, or -1 if it does not fit; the stream is then unchanged
+ */
+int32_t ts_codec_append(ts_codec_t* codec, const watson_sample_t* sample);
+
+/**
+ * Length of the stream in bytes.
+ */
+uint32_t ts_codec_length(const ts_codec_t* codec);
+
+/**
+ * Readings in the stream.
+ */
+uint32_t ts_codec_count(const ts_codec_t* codec);
+
+/**
+ * Start decoding a stream.
+ *
+ * @param[out] codec   : Decoder
+ * @param[in]  payload : The stream; not modified
+ * @param[in]  len     : Its length
+ *
+ * @return number of readings in the stream, or -1 for an unknown version
+ */
+int32_t ts_codec_decoder_init(ts_codec_t* codec, const uint8_t* payload, uint32_t len);
+
+/**
+ * Decode the next readings.
+ *
+ * @param[in]  codec       : Decoder
+ * @param[out] samples     : Output
+ * @param[in]  max_samples : Room in samples
+ *
+ * @return number of readings, 0 at the end of the stream, -1 if the stream is cut short
+ */
+int32_t ts_codec_decode(ts_codec_t* codec, watson_sample_t* samples, uint32_t max_samples);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_TS_CODEC_H_ */
@@ -13,6 +13,21 @@
 #include "../bme280_test/bme280_test.h"
 #include "../bme280_test/bme280_wiced_wrapper.h"
 #include "watson.h"
+#include "watson_sample.h"
+#include "sample_ring.h"
+#include "sample_batch.h"
+#include "sample_codec.h"
+#include "fixed_fmt.h"
+#include "msg_template.h"
+#include "report_filter.h"
+#include "window_stats.h"
+#include "ts_codec.h"
+#include "sample_journal.h"
+#include "journal_sflash.h"
+#include "mqtt_link.h"
+#include "boot_cache.h"
+#include "tls_session.h"
+#include "watson_dct.h"
 #include "wiced.h"
 #include "wiced_management.h"
 
@@ -28,6 +43,77 @@
 #define WICED_MQTT_DELAY_IN_MILLISECONDS    (1000)
 
 #define MQTT_MAX_RESOURCE_SIZE              (0x7fffffff)
+/* Messages waiting for their acknowledgement at the same time, see mqtt_app_publish_async() */
+#define MQTT_PUBLISH_WINDOW                 (4)
+/* Reconnects resume the TLS session for this long, see tls_session.h. With TLS_SESSION_PERSIST
+ * the session also survives a reset, at the price of its master secret in the DCT in the clear. */
+#define TLS_SESSION_LIFETIME_MS             (12 * 60 * 60 * 1000)
+#define TLS_SESSION_PERSIST                 (0)
+
+/* The sampler runs ahead of the publisher so that a slow publish never delays a reading */
+#define SAMPLER_THREAD_PRIORITY             (WICED_APPLICATION_PRIORITY - 1)
+#define SAMPLER_THREAD_STACK_SIZE           (2048)
+#define PUBLISHER_THREAD_PRIORITY           (WICED_APPLICATION_PRIORITY)
+#define PUBLISHER_THREAD_STACK_SIZE         (4096)
+
+/* Fixed sampling rate, kept up while the network is slow */
+#define SAMPLE_PERIOD_MS                    (5000)
+
+/* Readings per MQTT message, and the longest a reading waits for its batch to fill */
+#define BATCH_MAX_SAMPLES                   (10)
+#define BATCH_LINGER_MS                     (60000)
+#define BATCH_PAYLOAD_LEN                   (sizeof(DEVICE_ID) + SAMPLE_BATCH_JSON_HEADER_LEN + BATCH_MAX_SAMPLES * SAMPLE_BATCH_JSON_SAMPLE_LEN)
+
+/* Single reading message and console line. The message has fixed-width slots, wide enough for any
+ * reading inside the sensor operating range and for a 32 bit time stamp, plus 79 characters of keys
+ * and units; sizeof(DEVICE_ID) covers the id and the terminating NUL */
+#define SENSOR_MESSAGE_P_WIDTH              (10)
+#define SENSOR_MESSAGE_T_WIDTH              (7)
+#define SENSOR_MESSAGE_H_WIDTH              (7)
+#define SENSOR_MESSAGE_TS_WIDTH             (10)
+#define SENSOR_MESSAGE_LEN                  (sizeof(DEVICE_ID) + 79 + SENSOR_MESSAGE_P_WIDTH + SENSOR_MESSAGE_T_WIDTH + \
+                                             SENSOR_MESSAGE_H_WIDTH + SENSOR_MESSAGE_TS_WIDTH)
+#define PRINT_LINE_LEN                      (96)
+
+/* Report by exception: only readings that left a deadband, started changing faster than a rate
+ * limit, broke REPORT_HEARTBEAT_MS of silence or were taken on demand are published. 0 publishes
+ * every reading. */
+#define REPORT_BY_EXCEPTION                 (1)
+#define REPORT_HEARTBEAT_MS                 (15 * 60 * 1000)
+#define REPORT_RATE_INTERVAL_MS             (20000)
+
+/* Windowed summaries on PUB_TOPIC_STATS: each covers STATS_WINDOW_MS and a new one closes every
+ * STATS_HOP_MS. Equal values give back to back windows, a smaller hop overlapping sliding ones.
+ * A window of 0 turns the summaries off. */
+#define STATS_WINDOW_MS                     (5 * 60 * 1000)
+#define STATS_HOP_MS                        (5 * 60 * 1000)
+#define STATS_PAYLOAD_LEN                   (sizeof(DEVICE_ID) + WINDOW_STATS_JSON_LEN)
+/* Summaries kept while the broker is out of reach, the oldest go first */
+#define STATS_QUEUE_LEN                     (8)
+
+/* Store and forward: readings that cannot be published are journaled in the top 512 KB of the
+ * serial flash and sent JOURNAL_DRAIN_SAMPLES per message, compressed on PUB_TOPIC_TS, once
+ * publishing works again. The region must stay clear of the images of the apps lookup table; this
+ * is checked at start up and the journal is left off otherwise. Readings are staged in RAM until a
+ * record fills up; at most JOURNAL_STAGE_MS of them are lost on a reset. */
+#define JOURNAL_FLASH_BASE                  (0x180000)
+#define JOURNAL_FLASH_SIZE                  (0x080000)
+#define JOURNAL_DRAIN_SAMPLES               (SAMPLE_JOURNAL_RECORD_SAMPLES)
+#define JOURNAL_DRAIN_MESSAGES              (8)
+#define JOURNAL_DRAIN_TIMEOUT_MS            (5000)
+#define JOURNAL_STAGE_MS                    (2 * 60 * 1000)
+
+/* Message encoding: json events on PUB_TOPIC, the packed layout of sample_codec.h on PUB_TOPIC_BIN,
+ * or the compressed stream of ts_codec.h on PUB_TOPIC_TS */
+#define PAYLOAD_FORMAT_JSON                 (0)
+#define PAYLOAD_FORMAT_BINARY               (1)
+#define PAYLOAD_FORMAT_TS                   (2)
+#define PAYLOAD_FORMAT                      (PAYLOAD_FORMAT_JSON)
+
+/* Sampler and connection to publisher signals */
+#define SAMPLE_READY_EVENT                  (1 << 0)
+#define BATCH_FLUSH_EVENT                   (1 << 1)
+#define LINK_EVENT                          (1 << 2)
 /******************************************************
  *                   Enumerations
  ******************************************************/
@@ -56,69 +142,697 @@ static wiced_event_flags_t button_events;
  *
  * @return void
  */
-static void print_sensor_data(struct bme280_data *comp_data);
+static void print_sensor_data(const struct bme280_data *comp_data);
+static void take_sample(uint32_t publisher_event);
+static void sampler_thread_main(wiced_thread_arg_t arg);
+static void publish_batch(void);
+/**
+ * mount the store and forward journal, picking up readings left by the previous run
+ */
+static void journal_setup(void);
+/**
+ * keep the batch in the journal until it can be published
+ */
+static void journal_store_batch(void);
+/**
+ * publish journaled readings, up to JOURNAL_DRAIN_MESSAGES messages
+ */
+static void journal_drain(void);
 /**
- * format sensor data, returns the sensor readings in a json format
+ * completion of a journaled message, counts the acknowledged ones and frees the payload
  */
-static char * format_sensor_data(struct bme280_data *comp_data);
+static void journal_sent(wiced_mqtt_msgid_t msgid, wiced_result_t result, void* arg);
+/**
+ * compress readings into a ts_codec.h stream, returns its length or -1 if it does not fit
+ */
+static int32_t encode_ts(const watson_sample_t* samples, uint32_t count, uint8_t* buffer, uint32_t size);
+/**
+ * queue the summaries of the windows that closed at or before now and publish the queue
+ */
+static void publish_stats(uint32_t now);
+/**
+ * publish queued summaries, oldest first, while the connection is up
+ */
+static void stats_send(void);
+/**
+ * keep the connection up and catch up on what queued while it was down
+ */
+static uint32_t link_service(wiced_time_t now);
+/**
+ * a message went out: report the time to the first one and keep the boot cache and the TLS session
+ */
+static void report_first_publish(void);
+/**
+ * keep the TLS session in the DCT when it changed
+ */
+static void tls_session_persist(void);
+static void publisher_thread_main(wiced_thread_arg_t arg);
+/**
+ * render the constant part of the single reading message once
+ */
+static void sensor_message_init(void);
+/**
+ * format sensor data, returns the sensor readings in a json format, or NULL if a reading does not fit
+ */
+static const char * format_sensor_data(const watson_sample_t *sample);
 
 /******************************************************
  *               Variable Definitions
  ******************************************************/
 struct bme280_dev dev_bme280;
 struct bme280_data sensor_data;
+static struct bme280_shadow bme280_shadow;
+static bme280_wiced_intf_t bme280_intf;
+static bme280_wiced_meas_t one_shot_meas;
+static wiced_event_flags_t meas_events;
 static wiced_event_flags_t button_events;
-static wiced_ip_address_t    broker_address;
 static wiced_mqtt_callback_t callbacks = mqtt_connection_event_cb;
+/* No ca_cert: the broker certificate is not checked, see mqtt_app_set_tls_session_cache() */
 static wiced_mqtt_security_t security;
 static wiced_mqtt_object_t mqtt_object;
+static mqtt_link_t mqtt_link;
+static tls_session_cache_t tls_sessions;
+static tls_session_t tls_session_stored;
+static wiced_thread_t sampler_thread;
+static wiced_thread_t publisher_thread;
+static wiced_event_flags_t publisher_events;
+static sample_ring_t sample_ring;
+static sample_batch_t sample_batch;
+static char batch_payload[BATCH_PAYLOAD_LEN];
+static uint32_t sample_seq;
+static report_filter_t report_filter;
+/* Deadbands and rate limits in hundredths: temperature, pressure, humidity */
+static const report_filter_config_t report_config =
+{
+    .channel =
+    {
+        [WATSON_CHANNEL_TEMPERATURE] = { .abs_deadband = 20,   .rel_deadband_bp = 0,   .rate_limit = 100 },   /* 0.2 degC, 1 degC/min */
+        [WATSON_CHANNEL_PRESSURE]    = { .abs_deadband = 5000, .rel_deadband_bp = 0,   .rate_limit = 10000 }, /* 50 Pa, 100 Pa/min */
+        [WATSON_CHANNEL_HUMIDITY]    = { .abs_deadband = 200,  .rel_deadband_bp = 500, .rate_limit = 500 },   /* 2 %RH or 5 %, 5 %RH/min */
+    },
+    .heartbeat_ms = REPORT_HEARTBEAT_MS,
+    .rate_interval_ms = REPORT_RATE_INTERVAL_MS,
+};
+static journal_sflash_t journal_flash;
+static sample_journal_t journal;
+static wiced_bool_t journal_ready;
+static uint32_t journal_stage_ms;
+static watson_sample_t journal_samples[JOURNAL_DRAIN_SAMPLES];
+/* One payload per message in flight, the library may send it again until its PUBACK */
+static uint8_t journal_payload[MQTT_PUBLISH_WINDOW][TS_CODEC_LEN(JOURNAL_DRAIN_SAMPLES)];
+static volatile wiced_bool_t journal_payload_busy[MQTT_PUBLISH_WINDOW];
+static volatile uint32_t journal_acked;
+static window_stats_t window_stats;
+static char stats_payload[STATS_PAYLOAD_LEN];
+static window_stats_summary_t stats_queue[STATS_QUEUE_LEN];
+static uint32_t stats_queue_head;
+static uint32_t stats_queue_count;
+static wiced_bool_t first_publish_done;
+static msg_template_t sensor_message;
+static char sensor_message_buffer[SENSOR_MESSAGE_LEN];
+static int32_t sensor_message_p;
+static int32_t sensor_message_t;
+static int32_t sensor_message_h;
+static int32_t sensor_message_ts;
+/* Written by the button interrupt only */
+static volatile uint32_t button_presses;
+
 /**
  * event handler for button 1 clicks
- * When the button is clicked, the system will get a reading from the sensor, format it (json) and publish it to Watson IoT.
- * Led1 will be on while publishing
- * if we're publishing already, nothing will happen
+ * Runs in interrupt context: it only counts the press and wakes the sampler thread, which reads the
+ * sensor and hands the reading to the publisher thread. Presses arriving while a publish is in
+ * progress are counted and served in order.
  */
-static wiced_bool_t publishing = WICED_FALSE;
 static void button_isr_event(void* arg)
 {
-   int8_t bme_rslt;
-   if(publishing == WICED_FALSE)
-   {
-       wiced_gpio_output_high( WICED_LED1 );
-       publishing = WICED_TRUE;
-       if((bme_rslt = bme280_get_sensor_data(BME280_ALL, &sensor_data, &dev_bme280)) == BME280_OK){
-           WPRINT_APP_INFO(("Normal Mode Measurement: "));
-           print_sensor_data(&sensor_data);
-           char * formattedMessage;
-           formattedMessage = format_sensor_data(&sensor_data);
-           WPRINT_APP_INFO(("Topic :%s\n", PUB_TOPIC));
-           wiced_result_t ret = mqtt_app_publish( mqtt_object, WICED_MQTT_QOS_DELIVER_AT_MOST_ONCE, PUB_TOPIC, (uint8_t*)formattedMessage ,strlen(formattedMessage));
-       }
-       else{
-           WPRINT_APP_INFO(("Error %d reading BME280 sensor data!\n", bme_rslt));
-       }
-       wiced_gpio_output_low( WICED_LED1 );
-       publishing = WICED_FALSE;
-   }
-   else
-   {
-       WPRINT_APP_INFO(("we're here now, and we shouldn't\n"));
-   }
+    UNUSED_PARAMETER( arg );
+    button_presses++;
+    wiced_rtos_set_event_flags( &button_events, BUTTON1_EVENT );
+}
+
+/**
+ * Read the sensor and hand the reading to the publisher. Never blocks on the publisher: a full ring
+ * gives up its oldest reading.
+ *
+ * @param[in] publisher_event : SAMPLE_READY_EVENT, or with BATCH_FLUSH_EVENT to publish without waiting
+ *                              for the batch to fill
+ */
+static void take_sample(uint32_t publisher_event)
+{
+    watson_sample_t sample;
+    wiced_time_t now;
+    int8_t bme_rslt;
+
+    if ( ( bme_rslt = bme280_get_sensor_data( BME280_ALL, &sample.data, &dev_bme280 ) ) != BME280_OK )
+    {
+        WPRINT_APP_INFO(("Error %d reading BME280 sensor data!\n", bme_rslt));
+        return;
+    }
+    wiced_time_get_time( &now );
+    sample.seq = ++sample_seq;
+    sample.time_ms = now;
+    sample.flags = ( publisher_event & BATCH_FLUSH_EVENT ) ? WATSON_SAMPLE_ON_DEMAND : 0;
+    sample_ring_push( &sample_ring, &sample );
+    wiced_rtos_set_event_flags( &publisher_events, publisher_event );
 }
 
 /**
- * bring network up
+ * sampler thread
+ * Takes a reading every SAMPLE_PERIOD_MS, whatever the state of the network, and one per button
+ * press. Event flags do not count, so the presses since the last wake-up are taken from the counter
+ * kept by the interrupt.
+ */
+static void sampler_thread_main(wiced_thread_arg_t arg)
+{
+    uint32_t events;
+    uint32_t handled = 0;
+    wiced_time_t now;
+    wiced_time_t next_sample;
+
+    UNUSED_PARAMETER( arg );
+    wiced_time_get_time( &next_sample );
+    while ( 1 )
+    {
+        wiced_time_get_time( &now );
+        if ( (int32_t)( now - next_sample ) >= 0 )
+        {
+            take_sample( SAMPLE_READY_EVENT );
+            next_sample += SAMPLE_PERIOD_MS;
+            if ( (int32_t)( now - next_sample ) >= 0 )
+            {
+                /* Fell more than a period behind, restart the schedule rather than catching up */
+                next_sample = now + SAMPLE_PERIOD_MS;
+            }
+        }
+        while ( handled != button_presses )
+        {
+            handled++;
+            /* On demand: the press publishes what has been collected so far */
+            take_sample( SAMPLE_READY_EVENT | BATCH_FLUSH_EVENT );
+        }
+        wiced_time_get_time( &now );
+        if ( (int32_t)( next_sample - now ) > 0 )
+        {
+            wiced_rtos_wait_for_event_flags( &button_events, BUTTON1_EVENT, &events, WICED_TRUE, WAIT_FOR_ANY_EVENT, next_sample - now );
+        }
+    }
+}
+
+/**
+ * Publish the batch to Watson IoT and empty it. Led1 is on while publishing.
+ * In json a batch of one reading keeps the single reading message of format_sensor_data().
+ */
+static void publish_batch(void)
+{
+    const char * formattedMessage;
+    char * topic = PUB_TOPIC;
+    int32_t len;
+    wiced_result_t ret;
+    report_filter_stats_t report_stats;
+
+    if ( sample_batch.count == 0 )
+    {
+        return;
+    }
+    if ( !mqtt_link_is_up( &mqtt_link ) || ( journal_ready && ( sample_journal_pending( &journal ) != 0 ) ) )
+    {
+        /* Offline, or older readings are still waiting: go through the journal to keep the order */
+        journal_store_batch( );
+        sample_batch_clear( &sample_batch );
+        if ( mqtt_link_is_up( &mqtt_link ) )
+        {
+            journal_drain( );
+        }
+        return;
+    }
+    if ( PAYLOAD_FORMAT == PAYLOAD_FORMAT_BINARY )
+    {
+        topic = PUB_TOPIC_BIN;
+        formattedMessage = batch_payload;
+        len = sample_codec_encode(sample_batch.samples, sample_batch.count, (uint8_t*)batch_payload, sizeof(batch_payload));
+    }
+    else if ( PAYLOAD_FORMAT == PAYLOAD_FORMAT_TS )
+    {
+        topic = PUB_TOPIC_TS;
+        formattedMessage = batch_payload;
+        len = encode_ts(sample_batch.samples, sample_batch.count, (uint8_t*)batch_payload, sizeof(batch_payload));
+    }
+    else if ( sample_batch.max_samples == 1 )
+    {
+        formattedMessage = format_sensor_data(&sample_batch.samples[0]);
+        len = ( formattedMessage != NULL ) ? msg_template_length(&sensor_message) : -1;
+    }
+    else
+    {
+        formattedMessage = batch_payload;
+        len = sample_batch_to_json(&sample_batch, DEVICE_ID, batch_payload, sizeof(batch_payload));
+    }
+    if ( len < 0 )
+    {
+        WPRINT_APP_INFO(("Batch of %lu readings does not fit the payload buffer, dropped\n", (unsigned long)sample_batch.count));
+        sample_batch_clear(&sample_batch);
+        return;
+    }
+
+    wiced_gpio_output_high( WICED_LED1 );
+    WPRINT_APP_INFO(("Topic :%s, %lu readings, %ld bytes\n", topic, (unsigned long)sample_batch.count, (long)len));
+    ret = mqtt_app_publish( mqtt_object, WICED_MQTT_QOS_DELIVER_AT_MOST_ONCE, topic, (uint8_t*)formattedMessage, (uint32_t)len);
+    mqtt_link_check( &mqtt_link, ret );
+    if ( ret != WICED_SUCCESS )
+    {
+        WPRINT_APP_INFO(("Error publishing measurements %lu to %lu\n", (unsigned long)sample_batch.samples[0].seq,
+                (unsigned long)sample_batch.samples[sample_batch.count - 1].seq));
+        journal_store_batch( );
+    }
+    if ( ret == WICED_SUCCESS )
+    {
+        report_first_publish( );
+        /* Back online: catch up on what was journaled meanwhile */
+        journal_drain( );
+    }
+    wiced_gpio_output_low( WICED_LED1 );
+    sample_batch_clear(&sample_batch);
+    if ( REPORT_BY_EXCEPTION )
+    {
+        report_filter_get_stats( &report_filter, &report_stats );
+        WPRINT_APP_INFO(("%lu of %lu readings reported, %lu rate alarms\n", (unsigned long)report_stats.reported,
+                (unsigned long)report_stats.checked, (unsigned long)report_stats.rate_alarms));
+    }
+}
+
+static void journal_setup(void)
+{
+    sample_journal_stats_t stats;
+    uint8_t app_id;
+
+    if ( ( journal_sflash_init( &journal_flash ) != WICED_SUCCESS ) || ( journal_flash.size < JOURNAL_FLASH_BASE + JOURNAL_FLASH_SIZE ) )
+    {
+        WPRINT_APP_INFO(("Serial flash not available, readings taken while offline are lost\n"));
+        return;
+    }
+    /* A resource filesystem or OTA image grown into the journal would be erased by it */
+    if ( journal_sflash_check_apps( JOURNAL_FLASH_BASE, JOURNAL_FLASH_SIZE, &app_id ) != WICED_SUCCESS )
+    {
+        WPRINT_APP_INFO(("Image %u of the apps lookup table overlaps the journal at 0x%lx, readings taken while offline are lost\n",
+                (unsigned)app_id, (unsigned long)JOURNAL_FLASH_BASE));
+        return;
+    }
+    if ( sample_journal_open( &journal, &journal_flash.flash, JOURNAL_FLASH_BASE, JOURNAL_FLASH_SIZE ) != 0 )
+    {
+        WPRINT_APP_INFO(("Error reading the journal, readings taken while offline are lost\n"));
+        return;
+    }
+    journal_ready = WICED_TRUE;
+    sample_journal_get_stats( &journal, &stats );
+    WPRINT_APP_INFO(("Journal holds %lu of %lu records to send\n", (unsigned long)stats.pending, (unsigned long)stats.capacity));
+}
+
+static void journal_store_batch(void)
+{
+    sample_journal_stats_t stats;
+    uint32_t i;
+
+    if ( !journal_ready )
+    {
+        WPRINT_APP_INFO(("%lu readings lost while offline\n", (unsigned long)sample_batch.count));
+        return;
+    }
+    for ( i = 0; i < sample_batch.count; i++ )
+    {
+        if ( sample_journal_append( &journal, &sample_batch.samples[i] ) != 0 )
+        {
+            WPRINT_APP_INFO(("Error journaling measurements before %lu\n", (unsigned long)sample_batch.samples[i].seq));
+        }
+        sample_journal_get_stats( &journal, &stats );
+        if ( stats.staged == 1 )
+        {
+            /* First reading of a new stage */
+            journal_stage_ms = sample_batch.samples[i].time_ms;
+        }
+    }
+    /* Bound what a reset can take with it */
+    if ( ( sample_batch.count != 0 ) && ( sample_batch.samples[sample_batch.count - 1].time_ms - journal_stage_ms >= JOURNAL_STAGE_MS ) &&
+         ( sample_journal_flush( &journal ) != 0 ) )
+    {
+        WPRINT_APP_INFO(("Error journaling measurements up to %lu\n", (unsigned long)sample_batch.samples[sample_batch.count - 1].seq));
+    }
+    sample_journal_get_stats( &journal, &stats );
+    WPRINT_APP_INFO(("%lu readings journaled, %lu staged, %lu records waiting, %lu readings given up\n", (unsigned long)sample_batch.count,
+            (unsigned long)stats.staged, (unsigned long)stats.pending, (unsigned long)stats.dropped));
+}
+
+static void journal_drain(void)
+{
+    uint32_t messages;
+    uint32_t readings = 0;
+    uint32_t slot;
+    int32_t count;
+    int32_t len;
+    wiced_result_t ret = WICED_SUCCESS;
+
+    if ( !journal_ready || !mqtt_link_is_up( &mqtt_link ) )
+    {
+        return;
+    }
+    /* Messages of an earlier drain that gave up must complete first, their acknowledgements are
+     * not counted for this one */
+    for ( slot = 0; slot < MQTT_PUBLISH_WINDOW; slot++ )
+    {
+        if ( journal_payload_busy[slot] && ( mqtt_app_publish_flush( JOURNAL_DRAIN_TIMEOUT_MS ) != WICED_SUCCESS ) )
+        {
+            return;
+        }
+    }
+    /* At QoS 1 the journal only lets go of readings the broker acknowledged. Up to
+     * MQTT_PUBLISH_WINDOW messages wait for their PUBACK at the same time, each in a payload
+     * buffer of its own, and the consume waits for all of them. */
+    journal_acked = 0;
+    for ( messages = 0; messages < JOURNAL_DRAIN_MESSAGES; messages++ )
+    {
+        slot = messages % MQTT_PUBLISH_WINDOW;
+        /* The window is shared with other publishers and only a soft limit, so check the buffer */
+        if ( journal_payload_busy[slot] && ( mqtt_app_publish_flush( JOURNAL_DRAIN_TIMEOUT_MS ) != WICED_SUCCESS ) )
+        {
+            ret = WICED_TIMEOUT;
+            break;
+        }
+        if ( messages == 0 )
+        {
+            count = sample_journal_peek( &journal, journal_samples, JOURNAL_DRAIN_SAMPLES );
+        }
+        else
+        {
+            count = sample_journal_peek_more( &journal, journal_samples, JOURNAL_DRAIN_SAMPLES );
+        }
+        if ( count <= 0 )
+        {
+            break;
+        }
+        len = encode_ts( journal_samples, (uint32_t)count, journal_payload[slot], sizeof(journal_payload[slot]) );
+        if ( len < 0 )
+        {
+            ret = WICED_ERROR;
+            break;
+        }
+        journal_payload_busy[slot] = WICED_TRUE;
+        ret = mqtt_app_publish_async( mqtt_object, WICED_MQTT_QOS_DELIVER_AT_LEAST_ONCE, PUB_TOPIC_TS, journal_payload[slot],
+                (uint32_t)len, journal_sent, (void*)&journal_payload_busy[slot], JOURNAL_DRAIN_TIMEOUT_MS );
+        if ( ret != WICED_SUCCESS )
+        {
+            /* No callback follows */
+            journal_payload_busy[slot] = WICED_FALSE;
+            break;
+        }
+        readings += (uint32_t)count;
+    }
+    if ( ( ret == WICED_SUCCESS ) && ( messages != 0 ) )
+    {
+        ret = mqtt_app_publish_flush( JOURNAL_DRAIN_TIMEOUT_MS );
+        if ( ( ret == WICED_SUCCESS ) && ( journal_acked != messages ) )
+        {
+            ret = WICED_ERROR;
+        }
+    }
+    if ( ret != WICED_SUCCESS )
+    {
+        /* Not consumed: the messages acknowledged so far go out again with the rest next time */
+        mqtt_link_check( &mqtt_link, WICED_ERROR );
+        WPRINT_APP_INFO(("Error sending journaled measurements, %lu records waiting\n", (unsigned long)sample_journal_pending( &journal )));
+        return;
+    }
+    if ( readings == 0 )
+    {
+        return;
+    }
+    mqtt_link_check( &mqtt_link, WICED_SUCCESS );
+    report_first_publish( );
+    if ( sample_journal_consume( &journal ) != 0 )
+    {
+        /* The broker has them, but the journal may send them again or has lost them to a wrap */
+        WPRINT_APP_INFO(("Error consuming %lu journaled readings, %lu records waiting\n", (unsigned long)readings,
+                (unsigned long)sample_journal_pending( &journal )));
+        return;
+    }
+    WPRINT_APP_INFO(("Topic :%s, %lu journaled readings in %lu messages, %lu records waiting\n", PUB_TOPIC_TS, (unsigned long)readings,
+            (unsigned long)messages, (unsigned long)sample_journal_pending( &journal )));
+}
+
+static void journal_sent(wiced_mqtt_msgid_t msgid, wiced_result_t result, void* arg)
+{
+    volatile wiced_bool_t* busy = arg;
+
+    UNUSED_PARAMETER( msgid );
+    if ( result == WICED_SUCCESS )
+    {
+        journal_acked++;
+    }
+    *busy = WICED_FALSE;
+}
+
+static int32_t encode_ts(const watson_sample_t* samples, uint32_t count, uint8_t* buffer, uint32_t size)
+{
+    ts_codec_t codec;
+    uint32_t i;
+
+    ts_codec_encoder_init( &codec, buffer, size );
+    for ( i = 0; i < count; i++ )
+    {
+        if ( ts_codec_append( &codec, &samples[i] ) != 0 )
+        {
+            return -1;
+        }
+    }
+    return (int32_t)ts_codec_length( &codec );
+}
+
+static void publish_stats(uint32_t now)
+{
+    window_stats_summary_t summary;
+
+    while ( window_stats_close( &window_stats, now, &summary ) )
+    {
+        if ( summary.count == 0 )
+        {
+            continue;
+        }
+        if ( stats_queue_count == STATS_QUEUE_LEN )
+        {
+            WPRINT_APP_INFO(("Summary of %lu to %lums not sent, queue full\n", (unsigned long)stats_queue[stats_queue_head].start_ms,
+                    (unsigned long)stats_queue[stats_queue_head].end_ms));
+            stats_queue_head = ( stats_queue_head + 1 ) % STATS_QUEUE_LEN;
+            stats_queue_count--;
+        }
+        stats_queue[( stats_queue_head + stats_queue_count ) % STATS_QUEUE_LEN] = summary;
+        stats_queue_count++;
+    }
+    stats_send( );
+}
+
+static void stats_send(void)
+{
+    const window_stats_summary_t* summary;
+    int32_t len;
+    wiced_result_t ret;
+
+    while ( ( stats_queue_count != 0 ) && mqtt_link_is_up( &mqtt_link ) )
+    {
+        summary = &stats_queue[stats_queue_head];
+        len = window_stats_to_json( summary, DEVICE_ID, stats_payload, sizeof(stats_payload) );
+        if ( len < 0 )
+        {
+            WPRINT_APP_INFO(("Summary does not fit the payload buffer, dropped\n"));
+        }
+        else
+        {
+            WPRINT_APP_INFO(("Topic :%s, summary of %lu readings, %ld bytes\n", PUB_TOPIC_STATS, (unsigned long)summary->count, (long)len));
+            ret = mqtt_app_publish( mqtt_object, WICED_MQTT_QOS_DELIVER_AT_MOST_ONCE, PUB_TOPIC_STATS, (uint8_t*)stats_payload, (uint32_t)len );
+            mqtt_link_check( &mqtt_link, ret );
+            if ( ret != WICED_SUCCESS )
+            {
+                WPRINT_APP_INFO(("Error publishing summary of %lu to %lums\n", (unsigned long)summary->start_ms, (unsigned long)summary->end_ms));
+                return;
+            }
+        }
+        stats_queue_head = ( stats_queue_head + 1 ) % STATS_QUEUE_LEN;
+        stats_queue_count--;
+    }
+}
+
+static void report_first_publish(void)
+{
+    wiced_time_t now;
+
+    if ( !first_publish_done )
+    {
+        first_publish_done = WICED_TRUE;
+        wiced_time_get_time( &now );
+        WPRINT_APP_INFO(("First message out %lums after boot\n", (unsigned long)now));
+    }
+    /* Nothing to write unless the access point or the broker address changed, or a boot was counted */
+    if ( boot_cache_save( ) != WICED_SUCCESS )
+    {
+        WPRINT_APP_INFO(("Error writing the boot cache\n"));
+    }
+    tls_session_persist( );
+}
+
+static void tls_session_persist(void)
+{
+    if ( !TLS_SESSION_PERSIST || ( tls_sessions.session.id_length == 0 ) ||
+         ( ( tls_sessions.session.id_length == tls_session_stored.id_length ) &&
+           ( memcmp( tls_sessions.session.id, tls_session_stored.id, tls_session_stored.id_length ) == 0 ) ) )
+    {
+        return;
+    }
+    if ( wiced_dct_write( &tls_sessions.session, DCT_APP_SECTION, OFFSETOF( app_config_dct_t, tls_session ), sizeof(tls_session_t) ) == WICED_SUCCESS )
+    {
+        tls_session_stored = tls_sessions.session;
+    }
+}
+
+static uint32_t link_service(wiced_time_t now)
+{
+    uint32_t timeout;
+    uint32_t pending;
+
+    if ( mqtt_link.object == NULL )
+    {
+        /* mqtt_setup() failed, there is nothing to connect with */
+        return MQTT_LINK_NO_DEADLINE;
+    }
+    timeout = mqtt_link_service( &mqtt_link, now );
+    if ( !mqtt_link_is_up( &mqtt_link ) )
+    {
+        return timeout;
+    }
+    stats_send( );
+    if ( !journal_ready || ( ( pending = sample_journal_pending( &journal ) ) == 0 ) )
+    {
+        return timeout;
+    }
+    /* One drain of up to JOURNAL_DRAIN_MESSAGES per turn, new readings are handled in between */
+    journal_drain( );
+    if ( mqtt_link_is_up( &mqtt_link ) && ( sample_journal_pending( &journal ) != 0 ) && ( sample_journal_pending( &journal ) < pending ) )
+    {
+        return 0;
+    }
+    return timeout;
+}
+
+/**
+ * publisher thread
+ * Drains the sample ring whenever the sampler signals and collects the readings into batches. A
+ * batch goes out when it is full, when its oldest reading is BATCH_LINGER_MS old, or right away
+ * after a button press or a rate of change alarm. With REPORT_BY_EXCEPTION unremarkable readings
+ * are left out of the batches. Every reading goes into the windowed summaries, which are
+ * published as their windows close. Keeps the MQTT connection up, and once it is back after a drop
+ * sends the summaries and the journaled readings queued meanwhile. Also reports readings the ring
+ * had to give up while the network was slow.
+ */
+static void publisher_thread_main(wiced_thread_arg_t arg)
+{
+    watson_sample_t sample;
+    sample_ring_result_t ring_rslt;
+    sample_ring_stats_t stats;
+    uint32_t lost_reported = 0;
+    uint32_t reasons;
+    uint32_t events;
+    uint32_t timeout;
+    uint32_t batch_timeout;
+    uint32_t stats_timeout;
+    wiced_time_t now;
+
+    UNUSED_PARAMETER( arg );
+    sample_batch_init( &sample_batch, BATCH_MAX_SAMPLES, BATCH_LINGER_MS );
+    sensor_message_init( );
+    report_filter_init( &report_filter, &report_config );
+    journal_setup( );
+    if ( ( window_stats_init( &window_stats, STATS_WINDOW_MS, STATS_HOP_MS ) != 0 ) && ( STATS_WINDOW_MS != 0 ) )
+    {
+        WPRINT_APP_INFO(("Summary window of %lums in steps of %lums is not supported, summaries are off\n",
+                (unsigned long)STATS_WINDOW_MS, (unsigned long)STATS_HOP_MS));
+    }
+    while ( 1 )
+    {
+        wiced_time_get_time( &now );
+        timeout = link_service( now );
+        /* A connect attempt may have taken a while */
+        wiced_time_get_time( &now );
+        batch_timeout = sample_batch_time_left( &sample_batch, now );
+        if ( batch_timeout < timeout )
+        {
+            timeout = batch_timeout;
+        }
+        stats_timeout = window_stats_time_left( &window_stats, now );
+        if ( stats_timeout < timeout )
+        {
+            timeout = stats_timeout;
+        }
+        events = 0;
+        if ( timeout != 0 )
+        {
+            /* SAMPLE_BATCH_NO_DEADLINE, WINDOW_STATS_NO_DEADLINE and MQTT_LINK_NO_DEADLINE are all the largest uint32_t */
+            wiced_rtos_wait_for_event_flags( &publisher_events, SAMPLE_READY_EVENT | BATCH_FLUSH_EVENT | LINK_EVENT, &events, WICED_TRUE, WAIT_FOR_ANY_EVENT,
+                    ( timeout == SAMPLE_BATCH_NO_DEADLINE ) ? WICED_WAIT_FOREVER : timeout );
+        }
+        while ( ( ring_rslt = sample_ring_pop( &sample_ring, &sample ) ) != SAMPLE_RING_EMPTY )
+        {
+            if ( ring_rslt != SAMPLE_RING_OK )
+            {
+                continue;
+            }
+            WPRINT_APP_INFO(("Normal Mode Measurement %lu at %lums: ", (unsigned long)sample.seq, (unsigned long)sample.time_ms));
+            print_sensor_data(&sample.data);
+            publish_stats( sample.time_ms );
+            window_stats_add( &window_stats, &sample );
+            reasons = REPORT_BY_EXCEPTION ? report_filter_check( &report_filter, &sample ) : REPORT_FILTER_CHANGE;
+            if ( reasons == 0 )
+            {
+                continue;
+            }
+            if ( sample_batch_add( &sample_batch, &sample ) || ( reasons & REPORT_FILTER_RATE_ALARM ) )
+            {
+                publish_batch( );
+            }
+        }
+        wiced_time_get_time( &now );
+        publish_stats( now );
+        if ( ( events & BATCH_FLUSH_EVENT ) || ( sample_batch_time_left( &sample_batch, now ) == 0 ) )
+        {
+            publish_batch( );
+        }
+        sample_ring_get_stats( &sample_ring, &stats );
+        if ( stats.overwritten + stats.dropped != lost_reported )
+        {
+            lost_reported = stats.overwritten + stats.dropped;
+            WPRINT_APP_INFO(("%lu readings lost to a full sample ring so far (high water %lu of %u)\n",
+                    (unsigned long)lost_reported, (unsigned long)stats.high_water, (unsigned)SAMPLE_RING_CAPACITY));
+        }
+    }
+}
+
+/**
+ * bring network up, straight to the access point joined last if it is still there
  */
 void netword_setup()
 {
     wiced_result_t        ret = WICED_SUCCESS;
+    wiced_time_t          start;
+    wiced_time_t          end;
+    boot_cache_stats_t    stats;
+
+    boot_cache_init( OFFSETOF( app_config_dct_t, boot_cache ) );
     /* Bring up the network interface */
-    ret = wiced_network_up( WICED_STA_INTERFACE, WICED_USE_EXTERNAL_DHCP_SERVER, NULL );
+    wiced_time_get_time( &start );
+    ret = boot_cache_network_up( WICED_STA_INTERFACE );
+    wiced_time_get_time( &end );
     if ( ret != WICED_SUCCESS )
     {
         WPRINT_APP_INFO( ( "\nNot able to join the requested AP\n\n" ) );
         return;
     }
+    boot_cache_get_stats( &stats );
+    WPRINT_APP_INFO(("Network up in %lums, %s\n", (unsigned long)( end - start ), ( stats.ap_joins != 0 ) ? "cached access point" : "scanned"));
 }
 
 /**
@@ -142,55 +856,54 @@ static char *random_string(char *random, size_t size)
  * mqtt setup
  * this method will
  * 1. setup the wiced_mqtt_object_t
- * 2. resolve ip of mqtt broker defined in scriptr.h
- * 3. init mqtt client
- * 4. open connection to resolved ip
- * 5. subscribe to topic specified in scriptr.h
+ * 2. init the mqtt client
+ * 3. hand both to the connection manager, with the topic to subscribe to specified in watson.h
+ *    and the broker address cached in the DCT
+ * 4. resume TLS sessions on reconnect, and with TLS_SESSION_PERSIST after a reset
+ * 5. make the first connection attempt; the publisher thread retries with backoff and reconnects
+ *    after a drop
  */
 void mqtt_setup()
 {
+    wiced_ip_address_t address;
+    wiced_time_t now;
+
     mqtt_object = (wiced_mqtt_object_t) malloc( WICED_MQTT_OBJECT_MEMORY_SIZE_REQUIREMENT );
-    wiced_result_t ret = WICED_SUCCESS;
-    uint32_t size_out;
     if ( mqtt_object == NULL )
     {
         WPRINT_APP_ERROR(("Dont have memory to allocate for mqtt object...\n"));
         return;
     }
 
-    WPRINT_APP_INFO( ( "Resolving IP address of MQTT broker?!...\n" ) );
-    ret = wiced_hostname_lookup( MQTT_BROKER_ADDRESS, &broker_address, 10000, WICED_STA_INTERFACE );
-    WPRINT_APP_INFO(("Resolved Broker IP: %u.%u.%u.%u\n\n", (uint8_t)(GET_IPV4_ADDRESS(broker_address) >> 24),
-            (uint8_t)(GET_IPV4_ADDRESS(broker_address) >> 16),
-            (uint8_t)(GET_IPV4_ADDRESS(broker_address) >> 8),
-            (uint8_t)(GET_IPV4_ADDRESS(broker_address) >> 0)));
-    if ( ret == WICED_ERROR || broker_address.ip.v4 == 0 )
+    if ( mqtt_app_init( MQTT_PUBLISH_WINDOW ) != WICED_SUCCESS )
     {
-        WPRINT_APP_INFO(("Error in resolving DNS\n"));
+        WPRINT_APP_ERROR(("Error setting up the mqtt client\n"));
         return;
     }
-
-    wiced_mqtt_init( mqtt_object );
-    ret = mqtt_conn_open( mqtt_object,&broker_address, WICED_STA_INTERFACE, callbacks, &security, CLIENT_ID);
-    if ( ret == WICED_SUCCESS )
+    wiced_time_get_time( &now );
+    tls_session_cache_init( &tls_sessions, TLS_SESSION_LIFETIME_MS );
+    if ( TLS_SESSION_PERSIST &&
+         ( wiced_dct_read_with_copy( &tls_session_stored, DCT_APP_SECTION, OFFSETOF( app_config_dct_t, tls_session ), sizeof(tls_session_t) ) == WICED_SUCCESS ) )
     {
-            WPRINT_APP_INFO(( "OK.\n\n" ));
+        tls_session_cache_load( &tls_sessions, &tls_session_stored, now );
     }
-    else
+    mqtt_app_set_tls_session_cache( &tls_sessions );
+    mqtt_link_init( &mqtt_link, mqtt_object, MQTT_BROKER_ADDRESS, CLIENT_ID, WICED_STA_INTERFACE, callbacks, &security );
+#ifdef SUB_TOPIC
+    mqtt_link_subscribe( &mqtt_link, SUB_TOPIC, WICED_MQTT_QOS_DELIVER_AT_MOST_ONCE );
+#endif
+    mqtt_app_set_disconnect_callback( mqtt_link_dropped, &mqtt_link );
+    /* Rejoin and reconnect through the boot cache, and keep the broker address that worked */
+    mqtt_link.network_up = boot_cache_network_up;
+    mqtt_link.address_callback = boot_cache_set_broker;
+    if ( boot_cache_get_broker( &address ) )
     {
-            WPRINT_APP_INFO(( "ERROR.\n\n" ));
+        mqtt_link_set_address( &mqtt_link, &address );
     }
+    wiced_time_get_time( &now );
+    mqtt_link_service( &mqtt_link, now );
 }
 
-/**
- * struct to hold the randomly generated Watson IoT client id.
- * This id will be stored in the dct and will be used after each reset.
- */
-typedef struct
-{
-    char     clientId[8];
-} app_config_dct_t;
-
 /**
  * main application thread.
  * This will setup all needed parts
@@ -199,8 +912,8 @@ typedef struct
  * 3. mqtt
  * 4. bme
  * 5. generate / fetch clientid
- * 6. register listeners for button clicks
- * 7. run main loop
+ * 6. start the sampler and publisher threads
+ * 7. register listeners for button clicks
  */
 void application_start( )
 {
@@ -219,17 +932,28 @@ void application_start( )
     WPRINT_APP_INFO(("Protocol: MQTTS\n"));
     WPRINT_APP_INFO(("URL: %s\n", MQTT_BROKER_ADDRESS));
     WPRINT_APP_INFO(("Port: 8883\n"));
-    WPRINT_APP_INFO(("Topic: %s\n", PUB_TOPIC));
+    WPRINT_APP_INFO(("Topic: %s\n", ( PAYLOAD_FORMAT == PAYLOAD_FORMAT_BINARY ) ? PUB_TOPIC_BIN :
+            ( PAYLOAD_FORMAT == PAYLOAD_FORMAT_TS ) ? PUB_TOPIC_TS : PUB_TOPIC));
+    if ( STATS_WINDOW_MS != 0 )
+    {
+        WPRINT_APP_INFO(("Summary topic: %s\n", PUB_TOPIC_STATS));
+    }
     WPRINT_APP_INFO(("ClientId: %s\n", CLIENT_ID));
 
     /* Initialise network using wifi */
     netword_setup();
     mqtt_setup();
+    /* Answer control register reads from the shadow instead of the bus */
+    dev_bme280.shadow = &bme280_shadow;
 #ifndef BME280_USE_SPI
-    wres = bme280_wiced_init_i2c(&dev_bme280, BME280_I2C, BME280_I2C_ADDR_PRIM);
+    wres = bme280_wiced_init_i2c(&dev_bme280, &bme280_intf, BME280_I2C, BME280_I2C_ADDR_PRIM);
 #else
-    wres = bme280_wiced_init_spi(&dev_bme280, BME280_SPI, BME280_SPI_CS);
+    wres = bme280_wiced_init_spi(&dev_bme280, &bme280_intf, BME280_SPI, BME280_SPI_CS);
 #endif
+    /* Let DMA move the data reads while the network threads run */
+    bme280_wiced_set_xfer_mode(&dev_bme280, BME280_WICED_XFER_DMA);
+    /* Compensate on the FPU, doubles are emulated in software */
+    bme280_set_comp_backend(BME280_COMP_FLOAT, &dev_bme280);
 
     if(wres != WICED_SUCCESS){
         WPRINT_APP_INFO( ( "BME280 successfully initialized.\n") );
@@ -253,15 +977,25 @@ void application_start( )
     typ_meas_time = bme280_wiced_get_meas_time(&dev_bme280);
     WPRINT_APP_INFO(("Typical measurement time for current settings: %ums\n", (unsigned)typ_meas_time));
 
-    /* One-shot read of temperature, humidity, and pressure */
-    if((bme_rslt = bme280_set_sensor_mode(BME280_FORCED_MODE, &dev_bme280)) == BME280_OK){
-        wiced_rtos_delay_milliseconds(typ_meas_time);
-        bme280_get_sensor_data(BME280_ALL, &sensor_data, &dev_bme280);
-        WPRINT_APP_INFO(("One-Shot Forced Measurement: "));
-        print_sensor_data(&sensor_data);
+    /* One-shot read of temperature, humidity, and pressure, completed by the hardware IO
+     * worker thread as soon as the sensor clears its measuring bit */
+    wiced_rtos_init_event_flags(&meas_events);
+    one_shot_meas.event_flags = &meas_events;
+    one_shot_meas.event_flag = BME280_WICED_MEAS_DONE_EVENT;
+    if((wres = bme280_wiced_measure_async(&one_shot_meas, &dev_bme280, BME280_ALL)) == WICED_SUCCESS){
+        wiced_rtos_wait_for_event_flags(&meas_events, BME280_WICED_MEAS_DONE_EVENT, &events,
+                WICED_TRUE, WAIT_FOR_ANY_EVENT, WICED_WAIT_FOREVER);
+        if(one_shot_meas.result == WICED_SUCCESS){
+            sensor_data = one_shot_meas.data;
+            WPRINT_APP_INFO(("One-Shot Forced Measurement: "));
+            print_sensor_data(&sensor_data);
+        }
+        else{
+            WPRINT_APP_INFO(("Error %u during BME280 forced measurement!\n", (unsigned)one_shot_meas.result));
+        }
     }
     else{
-        WPRINT_APP_INFO(("Error %d setting BME280 sensor mode!\n", bme_rslt));
+        WPRINT_APP_INFO(("Error %u starting BME280 forced measurement!\n", (unsigned)wres));
     }
 
     /* Start periodic measurements */
@@ -272,28 +1006,86 @@ void application_start( )
     }
     bme280_set_sensor_mode(BME280_NORMAL_MODE, &dev_bme280);
     wiced_rtos_delay_milliseconds(typ_meas_time);
-    wiced_gpio_input_irq_enable( WICED_BUTTON1, IRQ_TRIGGER_FALLING_EDGE, button_isr_event, NULL );
+
+    /* Everything the interrupt and the threads use must exist before the button is armed */
     wiced_rtos_init_event_flags(&button_events);
-    WPRINT_APP_INFO(("Starting event loop\n"));
-    while ( 1 )
+    /* Keep the freshest readings when the publisher falls behind */
+    sample_ring_init(&sample_ring, SAMPLE_RING_DROP_OLDEST);
+    result = wiced_rtos_init_event_flags(&publisher_events);
+    if ( result == WICED_SUCCESS )
     {
-        events = 0;
-        WPRINT_APP_INFO(("In event loop, waiting for event\n"));
-
-        result = wiced_rtos_wait_for_event_flags(&button_events, BUTTON1_EVENT, &events,
-                                                         WICED_TRUE, WAIT_FOR_ANY_EVENT, WICED_WAIT_FOREVER);
+        /* Wake the publisher on a drop to start reconnecting */
+        mqtt_link.event_flags = &publisher_events;
+        mqtt_link.event_flag = LINK_EVENT;
+        result = wiced_rtos_create_thread(&publisher_thread, PUBLISHER_THREAD_PRIORITY, "publisher",
+                publisher_thread_main, PUBLISHER_THREAD_STACK_SIZE, NULL);
+    }
+    if ( result == WICED_SUCCESS )
+    {
+        result = wiced_rtos_create_thread(&sampler_thread, SAMPLER_THREAD_PRIORITY, "sampler",
+                sampler_thread_main, SAMPLER_THREAD_STACK_SIZE, NULL);
     }
+    if ( result != WICED_SUCCESS )
+    {
+        WPRINT_APP_INFO(("Error %u starting the sampler and publisher threads!\n", (unsigned)result));
+        return;
+    }
+    wiced_gpio_input_irq_enable( WICED_BUTTON1, IRQ_TRIGGER_FALLING_EDGE, button_isr_event, NULL );
+    WPRINT_APP_INFO(("Waiting for button presses\n"));
 }
 
 
-static void print_sensor_data(struct bme280_data *comp_data)
+static void print_sensor_data(const struct bme280_data *comp_data)
+{
+    char line[PRINT_LINE_LEN];
+    fixed_fmt_t fmt;
+    watson_centi_t centi;
+
+    watson_sample_to_centi(comp_data, &centi);
+    fixed_fmt_init(&fmt, line, sizeof(line));
+    fixed_fmt_str(&fmt, "Temperature = ");
+    fixed_fmt_decimal(&fmt, centi.temperature, 2);
+    fixed_fmt_str(&fmt, "\xf8""C, Humidity = ");
+    fixed_fmt_decimal(&fmt, centi.humidity, 2);
+    fixed_fmt_str(&fmt, "%, Pressure = ");
+    fixed_fmt_decimal(&fmt, centi.pressure, 2);
+    fixed_fmt_str(&fmt, "Pa\n");
+    fixed_fmt_finish(&fmt);
+    WPRINT_APP_INFO(("%s", line));
+}
+static void sensor_message_init(void)
 {
-    WPRINT_APP_INFO(("Temperature = %.2f\xf8""C, Humidity = %.2f%%, Pressure = %.2fPa\n", comp_data->temperature, comp_data->humidity, comp_data->pressure));
+    msg_template_init(&sensor_message, sensor_message_buffer, sizeof(sensor_message_buffer));
+    msg_template_text(&sensor_message, "{\"d\": {\"p\":");
+    sensor_message_p = msg_template_slot(&sensor_message, SENSOR_MESSAGE_P_WIDTH, 2);
+    msg_template_text(&sensor_message, ",\"h_unit\":\"%\",\"p_unit\":\"Pa\",\"t\":");
+    sensor_message_t = msg_template_slot(&sensor_message, SENSOR_MESSAGE_T_WIDTH, 2);
+    msg_template_text(&sensor_message, ",\"h\":");
+    sensor_message_h = msg_template_slot(&sensor_message, SENSOR_MESSAGE_H_WIDTH, 2);
+    msg_template_text(&sensor_message, ",\"t_unit\":\"C\", \"id\":\"" DEVICE_ID "\", \"ts\":");
+    sensor_message_ts = msg_template_slot(&sensor_message, SENSOR_MESSAGE_TS_WIDTH, 0);
+    msg_template_text(&sensor_message, "}}");
+    if ( msg_template_finish(&sensor_message) < 0 )
+    {
+        WPRINT_APP_INFO(("Single reading message does not fit %u bytes\n", (unsigned)sizeof(sensor_message_buffer)));
+    }
 }
-static char out[102];
-static char* format_sensor_data(struct bme280_data *comp_data)
+static const char* format_sensor_data(const watson_sample_t *sample)
 {
-    sprintf(out, "{\"d\": {\"p\":%.2f,\"h_unit\":\"%%\",\"p_unit\":\"Pa\",\"t\":%.2f,\"h\":%.2f,\"t_unit\":\"C\", \"id\":\"%s\"}}",
-            comp_data->pressure, comp_data->temperature, comp_data->humidity, DEVICE_ID);
-    return out;
+    watson_centi_t centi;
+
+    if ( msg_template_length(&sensor_message) < 0 )
+    {
+        return NULL;
+    }
+    watson_sample_to_centi(&sample->data, &centi);
+    /* Only the digits change, the length of the message stays the same */
+    if ( ( msg_template_set(&sensor_message, sensor_message_p, centi.pressure) != 0 ) ||
+         ( msg_template_set(&sensor_message, sensor_message_t, centi.temperature) != 0 ) ||
+         ( msg_template_set(&sensor_message, sensor_message_h, centi.humidity) != 0 ) ||
+         ( msg_template_set_uint(&sensor_message, sensor_message_ts, sample->time_ms) != 0 ) )
+    {
+        return NULL;
+    }
+    return msg_template_data(&sensor_message);
 }
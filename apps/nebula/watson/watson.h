@@ -3,5 +3,9 @@
  ******************************************************/
 #define MQTT_BROKER_ADDRESS                 "quickstart.messaging.internetofthings.ibmcloud.com"
 #define PUB_TOPIC                           "iot-2/evt/scriptr-<TOKEN>/fmt/json"
+#define PUB_TOPIC_BIN                       "iot-2/evt/scriptr-<TOKEN>/fmt/bin" //packed binary readings, see sample_codec.h
+#define PUB_TOPIC_TS                        "iot-2/evt/scriptr-<TOKEN>/fmt/ts" //compressed readings, see ts_codec.h
+#define PUB_TOPIC_STATS                     "iot-2/evt/scriptr-<TOKEN>-stats/fmt/json" //windowed summaries, see window_stats.h
+//#define SUB_TOPIC                         "iot-2/cmd/+/fmt/json" //commands, subscribed again on every reconnect; quickstart does not allow them
 #define CLIENT_ID                           "d:quickstart:sensors:device<TOKEN>"
 #define DEVICE_ID                           "myNebula20" //default, replace if you are connecting a second device
@@ -3,11 +3,29 @@ NAME := Nebuwatson_V1
 
 $(NAME)_SOURCES :=  mqtt.c \
 					bme280_wiced_wrapper.c \
+					sample_ring.c \
+					sample_batch.c \
+					sample_codec.c \
+					fixed_fmt.c \
+					msg_template.c \
+					report_filter.c \
+					window_stats.c \
+					ts_codec.c \
+					sample_journal.c \
+					journal_sflash.c \
+					mqtt_link.c \
+					boot_cache.c \
+					tls_session.c \
+					watson_sample.c \
 					watson.c
 
 $(NAME)_COMPONENTS := drivers/sensors/BME280 \
 				protocols/MQTT
 
 WIFI_CONFIG_DCT_H := wifi_config_dct.h
+APPLICATION_DCT := watson_dct.c
+
+# Lets mqtt.c put the cached TLS session into the context the MQTT library sets up
+GLOBAL_LDFLAGS += -Wl,--wrap=wiced_tls_init_context
 
 $(NAME)_RESOURCES  := apps/secure_mqtt/secure_mqtt_root_cacert.cer
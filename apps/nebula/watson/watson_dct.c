@@ -0,0 +1,13 @@
+/** @file
+ *  Initial contents of the application DCT: no client id, empty boot caches and no TLS session.
+ */
+
+#include "wiced_framework.h"
+#include "watson_dct.h"
+
+DEFINE_APP_DCT(app_config_dct_t)
+{
+    .clientId    = { 0 },
+    .boot_cache  = { 0 },
+    .tls_session = { 0 },
+};
@@ -0,0 +1,32 @@
+/** @file
+ *  Layout of the application DCT.
+ */
+
+#ifndef APPS_NEBULA_WATSON_WATSON_DCT_H_
+#define APPS_NEBULA_WATSON_WATSON_DCT_H_
+
+#include "boot_cache.h"
+#include "tls_session.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+typedef struct
+{
+    /** Room for a randomly generated Watson IoT client id, kept across resets */
+    char             clientId[8];
+    /** Access point and broker address for a fast start, see boot_cache.h */
+    boot_cache_dct_t boot_cache;
+    /** TLS session of the broker connection, only kept with TLS_SESSION_PERSIST, see tls_session.h */
+    tls_session_t    tls_session;
+} app_config_dct_t;
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_WATSON_DCT_H_ */
@@ -0,0 +1,71 @@
+/** @file
+ *  Conversion of BME280 readings to and from integer hundredths.
+ */
+
+#include "watson_sample.h"
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+#ifdef FLOATING_POINT_REPRESENTATION
+static int32_t round_centi(double value);
+#endif
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+void watson_sample_to_centi(const struct bme280_data* data, watson_centi_t* centi)
+{
+#ifdef FLOATING_POINT_REPRESENTATION
+    centi->temperature = round_centi(data->temperature);
+    centi->pressure = round_centi(data->pressure);
+    centi->humidity = round_centi(data->humidity);
+#else
+    centi->temperature = data->temperature;
+#ifdef MACHINE_64_BIT
+    centi->pressure = (int32_t)data->pressure;
+#else
+    centi->pressure = (int32_t)data->pressure * 100;
+#endif
+    /* 1/1024 %RH */
+    centi->humidity = (int32_t)( ( data->humidity * 100 + 512 ) / 1024 );
+#endif
+}
+
+void watson_sample_to_channels(const struct bme280_data* data, int32_t* values)
+{
+    watson_centi_t centi;
+
+    watson_sample_to_centi(data, &centi);
+    values[WATSON_CHANNEL_TEMPERATURE] = centi.temperature;
+    values[WATSON_CHANNEL_PRESSURE] = centi.pressure;
+    values[WATSON_CHANNEL_HUMIDITY] = centi.humidity;
+}
+
+void watson_sample_from_centi(const watson_centi_t* centi, struct bme280_data* data)
+{
+#ifdef FLOATING_POINT_REPRESENTATION
+    data->temperature = centi->temperature / 100.0;
+    data->pressure = centi->pressure / 100.0;
+    data->humidity = centi->humidity / 100.0;
+#else
+    data->temperature = centi->temperature;
+#ifdef MACHINE_64_BIT
+    data->pressure = (uint32_t)centi->pressure;
+#else
+    data->pressure = (uint32_t)( ( centi->pressure + 50 ) / 100 );
+#endif
+    data->humidity = (uint32_t)( ( centi->humidity * 1024 + 50 ) / 100 );
+#endif
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+#ifdef FLOATING_POINT_REPRESENTATION
+static int32_t round_centi(double value)
+{
+    value *= 100.0;
+    return (int32_t)( ( value >= 0.0 ) ? ( value + 0.5 ) : ( value - 0.5 ) );
+}
+#endif
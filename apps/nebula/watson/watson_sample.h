@@ -0,0 +1,68 @@
+/** @file
+ *  A timestamped BME280 reading as it moves through the watson pipeline, and its conversion to
+ *  integer hundredths for the message encoders.
+ */
+
+#ifndef APPS_NEBULA_WATSON_WATSON_SAMPLE_H_
+#define APPS_NEBULA_WATSON_WATSON_SAMPLE_H_
+
+#include <stdint.h>
+#include "bme280_defs.h"
+
+/* watson_sample_t flags */
+#define WATSON_SAMPLE_ON_DEMAND     (1 << 0)    /**< Taken for a button press rather than on schedule */
+
+typedef struct
+{
+    uint32_t           seq;         /**< Sample number, counted from 1; gaps show lost samples */
+    uint32_t           time_ms;     /**< System time of the reading */
+    uint32_t           flags;       /**< WATSON_SAMPLE_xxx */
+    struct bme280_data data;
+} watson_sample_t;
+
+/**
+ * Channel order of the per-channel arrays of the pipeline stages.
+ */
+typedef enum
+{
+    WATSON_CHANNEL_TEMPERATURE,
+    WATSON_CHANNEL_PRESSURE,
+    WATSON_CHANNEL_HUMIDITY,
+    WATSON_CHANNELS
+} watson_channel_t;
+
+/**
+ * The channels of a reading as integers, whatever the struct bme280_data layout of the build.
+ */
+typedef struct
+{
+    int32_t temperature;    /**< 0.01 degC */
+    int32_t pressure;       /**< 0.01 Pa */
+    int32_t humidity;       /**< 0.01 %RH */
+} watson_centi_t;
+
+/**
+ * Convert a reading to hundredths, rounded to nearest.
+ *
+ * @param[in]  data  : The reading
+ * @param[out] centi : The channels in hundredths
+ */
+void watson_sample_to_centi(const struct bme280_data* data, watson_centi_t* centi);
+
+/**
+ * Convert a reading to hundredths indexed by watson_channel_t.
+ *
+ * @param[in]  data   : The reading
+ * @param[out] values : WATSON_CHANNELS values in hundredths
+ */
+void watson_sample_to_channels(const struct bme280_data* data, int32_t* values);
+
+/**
+ * Convert hundredths back to the struct bme280_data layout of the build.
+ *
+ * @param[in]  centi : The channels in hundredths
+ * @param[out] data  : The reading
+ */
+void watson_sample_from_centi(const watson_centi_t* centi, struct bme280_data* data);
+
+#endif /* APPS_NEBULA_WATSON_WATSON_SAMPLE_H_ */
@@ -0,0 +1,236 @@
+/** @file
+ *  Windowed summaries of the readings: count, min, max, mean and variance per channel.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "fixed_fmt.h"
+#include "window_stats.h"
+
+/******************************************************
+ *               Static Function Declarations
+ ******************************************************/
+static void acc_add(window_stats_acc_t* acc, uint32_t count, int32_t value);
+static void acc_merge(window_stats_acc_t* acc, uint32_t count, const window_stats_acc_t* other, uint32_t other_count);
+static int32_t round_float(float value);
+static void channel_to_json(fixed_fmt_t* fmt, const char* name, const window_stats_channel_t* channel);
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+int32_t window_stats_init(window_stats_t* stats, uint32_t duration_ms, uint32_t hop_ms)
+{
+    memset(stats, 0, sizeof(*stats));
+    if ( ( hop_ms == 0 ) || ( duration_ms % hop_ms != 0 ) || ( duration_ms / hop_ms == 0 ) ||
+         ( duration_ms / hop_ms > WINDOW_STATS_MAX_PANES ) )
+    {
+        return -1;
+    }
+    stats->duration_ms = duration_ms;
+    stats->hop_ms = hop_ms;
+    stats->pane_count = duration_ms / hop_ms;
+    return 0;
+}
+
+int32_t window_stats_close(window_stats_t* stats, uint32_t now_ms, window_stats_summary_t* summary)
+{
+    window_stats_acc_t merged[WATSON_CHANNELS];
+    uint32_t count = 0;
+    uint32_t i;
+    uint32_t c;
+
+    if ( !stats->started || ( (int32_t)( now_ms - stats->end_ms ) < 0 ) )
+    {
+        return 0;
+    }
+
+    memset(summary, 0, sizeof(*summary));
+    summary->end_ms = stats->end_ms;
+    summary->start_ms = stats->end_ms - stats->duration_ms;
+    if ( (int32_t)( summary->start_ms - stats->origin_ms ) < 0 )
+    {
+        summary->start_ms = stats->origin_ms;
+    }
+    /* Oldest pane first, so first_ms and last_ms come out in order */
+    for ( i = 1; i <= stats->pane_count; i++ )
+    {
+        const window_stats_pane_t* pane = &stats->panes[( stats->current + i ) % stats->pane_count];
+
+        if ( pane->count == 0 )
+        {
+            continue;
+        }
+        if ( count == 0 )
+        {
+            summary->first_ms = pane->first_ms;
+            memcpy(merged, pane->channel, sizeof(merged));
+        }
+        else
+        {
+            for ( c = 0; c < WATSON_CHANNELS; c++ )
+            {
+                acc_merge(&merged[c], count, &pane->channel[c], pane->count);
+            }
+        }
+        count += pane->count;
+        summary->last_ms = pane->last_ms;
+    }
+    summary->count = count;
+    for ( c = 0; ( count != 0 ) && ( c < WATSON_CHANNELS ); c++ )
+    {
+        float variance = ( count > 1 ) ? merged[c].m2 / (float)( count - 1 ) : 0.0f;
+
+        summary->channel[c].min = merged[c].min;
+        summary->channel[c].max = merged[c].max;
+        summary->channel[c].mean = merged[c].ref + round_float(merged[c].mean);
+        summary->channel[c].variance = ( variance < 2147483520.0f ) ? round_float(variance) : INT32_MAX;
+        summary->channel[c].stddev = round_float(sqrtf(variance));
+    }
+
+    /* The oldest pane leaves the window and takes the readings of the next hop */
+    stats->current = ( stats->current + 1 ) % stats->pane_count;
+    stats->panes[stats->current].count = 0;
+    stats->end_ms += stats->hop_ms;
+    if ( count == 0 )
+    {
+        /* Nothing left in any pane, skip the empty windows up to now */
+        stats->end_ms = now_ms - now_ms % stats->hop_ms + stats->hop_ms;
+        stats->origin_ms = stats->end_ms - stats->hop_ms;
+    }
+    return 1;
+}
+
+void window_stats_add(window_stats_t* stats, const watson_sample_t* sample)
+{
+    window_stats_pane_t* pane;
+    int32_t values[WATSON_CHANNELS];
+    uint32_t c;
+
+    if ( stats->pane_count == 0 )
+    {
+        return;
+    }
+    if ( !stats->started )
+    {
+        stats->started = 1;
+        stats->end_ms = sample->time_ms - sample->time_ms % stats->hop_ms + stats->hop_ms;
+        stats->origin_ms = stats->end_ms - stats->hop_ms;
+    }
+    pane = &stats->panes[stats->current];
+    watson_sample_to_channels(&sample->data, values);
+    if ( pane->count == 0 )
+    {
+        pane->first_ms = sample->time_ms;
+    }
+    pane->count++;
+    pane->last_ms = sample->time_ms;
+    for ( c = 0; c < WATSON_CHANNELS; c++ )
+    {
+        acc_add(&pane->channel[c], pane->count, values[c]);
+    }
+}
+
+uint32_t window_stats_time_left(const window_stats_t* stats, uint32_t now_ms)
+{
+    if ( !stats->started )
+    {
+        return WINDOW_STATS_NO_DEADLINE;
+    }
+    return ( (int32_t)( stats->end_ms - now_ms ) > 0 ) ? stats->end_ms - now_ms : 0;
+}
+
+int32_t window_stats_to_json(const window_stats_summary_t* summary, const char* device_id, char* buffer, uint32_t size)
+{
+    fixed_fmt_t fmt;
+
+    fixed_fmt_init(&fmt, buffer, size);
+    fixed_fmt_str(&fmt, "{\"d\":{\"id\":\"");
+    fixed_fmt_str(&fmt, device_id);
+    fixed_fmt_str(&fmt, "\",\"start\":");
+    fixed_fmt_uint(&fmt, summary->start_ms);
+    fixed_fmt_str(&fmt, ",\"end\":");
+    fixed_fmt_uint(&fmt, summary->end_ms);
+    fixed_fmt_str(&fmt, ",\"n\":");
+    fixed_fmt_uint(&fmt, summary->count);
+    fixed_fmt_str(&fmt, ",\"first\":");
+    fixed_fmt_uint(&fmt, summary->first_ms);
+    fixed_fmt_str(&fmt, ",\"last\":");
+    fixed_fmt_uint(&fmt, summary->last_ms);
+    channel_to_json(&fmt, ",\"t\":", &summary->channel[WATSON_CHANNEL_TEMPERATURE]);
+    channel_to_json(&fmt, ",\"p\":", &summary->channel[WATSON_CHANNEL_PRESSURE]);
+    channel_to_json(&fmt, ",\"h\":", &summary->channel[WATSON_CHANNEL_HUMIDITY]);
+    fixed_fmt_str(&fmt, "}}");
+
+    return fixed_fmt_finish(&fmt);
+}
+
+/******************************************************
+ *               Static Function Definitions
+ ******************************************************/
+/* Welford's update, count includes the new value */
+static void acc_add(window_stats_acc_t* acc, uint32_t count, int32_t value)
+{
+    float x;
+    float delta;
+
+    if ( count == 1 )
+    {
+        acc->ref = value;
+        acc->mean = 0.0f;
+        acc->m2 = 0.0f;
+        acc->min = value;
+        acc->max = value;
+        return;
+    }
+    x = (float)( value - acc->ref );
+    delta = x - acc->mean;
+    acc->mean += delta / (float)count;
+    acc->m2 += delta * ( x - acc->mean );
+    if ( value < acc->min )
+    {
+        acc->min = value;
+    }
+    if ( value > acc->max )
+    {
+        acc->max = value;
+    }
+}
+
+/* Chan's combination of two partial results, kept relative to the reference of acc */
+static void acc_merge(window_stats_acc_t* acc, uint32_t count, const window_stats_acc_t* other, uint32_t other_count)
+{
+    float total = (float)( count + other_count );
+    float delta = other->mean + (float)( other->ref - acc->ref ) - acc->mean;
+
+    acc->mean += delta * (float)other_count / total;
+    acc->m2 += other->m2 + delta * delta * (float)count * (float)other_count / total;
+    if ( other->min < acc->min )
+    {
+        acc->min = other->min;
+    }
+    if ( other->max > acc->max )
+    {
+        acc->max = other->max;
+    }
+}
+
+static int32_t round_float(float value)
+{
+    return ( value >= 0.0f ) ? (int32_t)( value + 0.5f ) : -(int32_t)( 0.5f - value );
+}
+
+static void channel_to_json(fixed_fmt_t* fmt, const char* name, const window_stats_channel_t* channel)
+{
+    fixed_fmt_str(fmt, name);
+    fixed_fmt_str(fmt, "{\"min\":");
+    fixed_fmt_decimal(fmt, channel->min, 2);
+    fixed_fmt_str(fmt, ",\"max\":");
+    fixed_fmt_decimal(fmt, channel->max, 2);
+    fixed_fmt_str(fmt, ",\"mean\":");
+    fixed_fmt_decimal(fmt, channel->mean, 2);
+    fixed_fmt_str(fmt, ",\"sd\":");
+    fixed_fmt_decimal(fmt, channel->stddev, 2);
+    fixed_fmt_str(fmt, ",\"var\":");
+    fixed_fmt_decimal(fmt, channel->variance, 4);
+    fixed_fmt_char(fmt, '}');
+}
@@ -0,0 +1,150 @@
+/** @file
+ *  Windowed summaries of the readings: count, min, max, mean and variance per channel.
+ *
+ *  Statistics are updated in constant time per reading (Welford) and no reading is buffered. A
+ *  window of duration_ms advances in steps of hop_ms: equal values give tumbling windows, a smaller
+ *  hop gives sliding windows that overlap. A sliding window is kept as duration_ms / hop_ms partial
+ *  accumulators (panes), one per hop, which are merged when the window closes.
+ *
+ *  Windows are aligned to multiples of hop_ms of the sample clock. Means are accumulated in single
+ *  precision relative to the first value of each pane, so pressure keeps its 0.01 Pa resolution on
+ *  an FPU without double precision.
+ */
+
+#ifndef APPS_NEBULA_WATSON_WINDOW_STATS_H_
+#define APPS_NEBULA_WATSON_WINDOW_STATS_H_
+
+#include <stdint.h>
+#include "watson_sample.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+/**
+ * Most hops per window.
+ */
+#ifndef WINDOW_STATS_MAX_PANES
+#define WINDOW_STATS_MAX_PANES      (12)
+#endif
+
+/**
+ * window_stats_time_left() before the first reading.
+ */
+#define WINDOW_STATS_NO_DEADLINE    (0xFFFFFFFFU)
+
+/**
+ * Longest JSON rendering of a summary without the device id, see window_stats_to_json().
+ */
+#define WINDOW_STATS_JSON_LEN       (448)
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+/* Running statistics of one channel over one pane */
+typedef struct
+{
+    int32_t ref;        /* First value; mean is relative to it */
+    float   mean;
+    float   m2;         /* Sum of squared differences from the mean */
+    int32_t min;
+    int32_t max;
+} window_stats_acc_t;
+
+typedef struct
+{
+    uint32_t           count;
+    uint32_t           first_ms;
+    uint32_t           last_ms;
+    window_stats_acc_t channel[WATSON_CHANNELS];
+} window_stats_pane_t;
+
+typedef struct
+{
+    uint32_t            duration_ms;
+    uint32_t            hop_ms;
+    uint32_t            pane_count;
+    uint32_t            current;    /* Pane taking readings */
+    uint32_t            end_ms;     /* End of the current pane */
+    uint32_t            origin_ms;  /* Start of the oldest pane since readings began */
+    uint8_t             started;
+    window_stats_pane_t panes[WINDOW_STATS_MAX_PANES];
+} window_stats_t;
+
+/**
+ * One channel of a summary, in the hundredths of watson_centi_t.
+ */
+typedef struct
+{
+    int32_t  min;
+    int32_t  max;
+    int32_t  mean;
+    int32_t  stddev;
+    int32_t  variance;  /**< Sample variance in 0.0001 units squared */
+} window_stats_channel_t;
+
+typedef struct
+{
+    uint32_t               start_ms;    /**< Window, start included, end excluded; windows closed
+                                             *   before a full duration of readings start later */
+    uint32_t               end_ms;
+    uint32_t               count;       /**< Readings in the window, the rest is invalid when 0 */
+    uint32_t               first_ms;    /**< Time of the first and last reading */
+    uint32_t               last_ms;
+    window_stats_channel_t channel[WATSON_CHANNELS];
+} window_stats_summary_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+/**
+ * Set up the windows.
+ *
+ * @param[out] stats       : Window state
+ * @param[in]  duration_ms : Window length
+ * @param[in]  hop_ms      : Window step; a divisor of duration_ms, at least duration_ms / WINDOW_STATS_MAX_PANES
+ *
+ * @return 0, or -1 if the durations are not usable
+ */
+int32_t window_stats_init(window_stats_t* stats, uint32_t duration_ms, uint32_t hop_ms);
+
+/**
+ * Close the next window that ended at or before now_ms. Call until it returns 0 before adding a
+ * reading, with the time of the reading, and whenever window_stats_time_left() expires.
+ *
+ * @param[in]  stats   : Window state
+ * @param[in]  now_ms  : Current time
+ * @param[out] summary : The closed window; its count is 0 if no reading fell in it
+ *
+ * @return 1 if a window was closed, 0 if none has ended yet
+ */
+int32_t window_stats_close(window_stats_t* stats, uint32_t now_ms, window_stats_summary_t* summary);
+
+/**
+ * Add a reading to the open windows, in constant time.
+ */
+void window_stats_add(window_stats_t* stats, const watson_sample_t* sample);
+
+/**
+ * Time until the next window closes.
+ *
+ * @return milliseconds, 0 if overdue, WINDOW_STATS_NO_DEADLINE before the first reading
+ */
+uint32_t window_stats_time_left(const window_stats_t* stats, uint32_t now_ms);
+
+/**
+ * Render a summary as a Watson IoT json event:
+ * {"d":{"id":..,"start":..,"end":..,"n":..,"first":..,"last":..,"t":{"min":..,"max":..,"mean":..,"sd":..,"var":..},"p":{..},"h":{..}}}
+ *
+ * @return length of the text, or -1 if it does not fit
+ */
+int32_t window_stats_to_json(const window_stats_summary_t* summary, const char* device_id, char* buffer, uint32_t size);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* APPS_NEBULA_WATSON_WINDOW_STATS_H_ */
@@ -33,5 +33,6 @@
 
 NAME := Lib_BME280
 
-$(NAME)_SOURCES := bme280.c
+$(NAME)_SOURCES := bme280.c \
+                   bme280_batch.c
 GLOBAL_INCLUDES := .
@@ -0,0 +1,558 @@
+/*! @file bme280_bench.c
+    @brief Host accuracy and speed benchmark of the compensation backends
+
+    Sweeps the raw temperature, pressure and humidity codes over their full
+    20/20/16 bit range for a number of calibration sets and runs every
+    compensation path of the driver over the same samples. Each path is timed
+    and compared with the datasheet floating point formulas evaluated in long
+    double. Results are written to stdout as CSV, or as JSON with --json.
+
+    Errors are reported twice: over every code ("full"), which exposes
+    overflow of the integer paths on codes a sensor never produces, and over
+    the samples whose reference result is inside the sensor operating range
+    ("valid"), which is what a deployed sensor sees.
+
+    The calibration sets are made by a fixed pseudo random generator around
+    the trimming values seen on production parts, so two runs of the same
+    build compare the same samples. Set 0 is the simulator default part. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC
+#endif
+#include "bme280.h"
+#include "bme280_sim.h"
+
+/**\name Sweep configuration, overridable with -D */
+/* Calibration sets */
+#ifndef BENCH_CALIB_SETS
+#define BENCH_CALIB_SETS		16
+#endif
+/* Raw codes per channel, spread evenly over the full code range */
+#ifndef BENCH_T_STEPS
+#define BENCH_T_STEPS			129
+#endif
+#ifndef BENCH_P_STEPS
+#define BENCH_P_STEPS			257
+#endif
+#ifndef BENCH_H_STEPS
+#define BENCH_H_STEPS			33
+#endif
+/* Samples per timed call, one temperature code with all P/H codes */
+#define BENCH_ROW_LEN			(BENCH_P_STEPS * BENCH_H_STEPS)
+/* Seed of the calibration generator */
+#define BENCH_SEED			UINT32_C(0x42E280)
+
+/**\name Largest raw codes */
+#define BENCH_RAW_PT_MAX		UINT32_C(0xFFFFF)
+#define BENCH_RAW_H_MAX			UINT32_C(0xFFFF)
+
+/*!
+ * @brief Compensation paths under test.
+ */
+enum bench_path {
+	BENCH_DOUBLE,
+	BENCH_FLOAT,
+	BENCH_INT32,
+	BENCH_INT64,
+	BENCH_BATCH_FLOAT,
+	BENCH_BATCH_INT32,
+	BENCH_BATCH_INT64,
+	BENCH_PATHS
+};
+
+/*!
+ * @brief Name and scalar backend of each path, backend zero for the batch
+ * APIs.
+ */
+static const struct {
+	const char *name;
+	uint8_t backend;
+} bench_paths[BENCH_PATHS] = {
+	{ "double", BME280_COMP_DOUBLE },
+	{ "float", BME280_COMP_FLOAT },
+	{ "int32", BME280_COMP_INT32 },
+	{ "int64", BME280_COMP_INT64 },
+	{ "batch_float", 0 },
+	{ "batch_int32", 0 },
+	{ "batch_int64", 0 }
+};
+
+/*!
+ * @brief Error domains.
+ */
+enum bench_domain {
+	BENCH_FULL,
+	BENCH_VALID,
+	BENCH_DOMAINS
+};
+
+static const char *const bench_domains[BENCH_DOMAINS] = { "full", "valid" };
+
+/*!
+ * @brief Error accumulator of one channel, in physical units.
+ */
+struct bench_err {
+	uint64_t count;
+	long double max;
+	long double sum_sq;
+};
+
+/*!
+ * @brief Timing and accuracy totals of one path.
+ */
+struct bench_result {
+	uint64_t samples;
+	uint64_t ns;
+	uint64_t cycles;
+	struct bench_err temperature[BENCH_DOMAINS];
+	struct bench_err pressure[BENCH_DOMAINS];
+	struct bench_err humidity[BENCH_DOMAINS];
+};
+
+/*!
+ * @brief Compensated row in physical units: degC, Pa and %RH.
+ */
+struct bench_row {
+	double temperature[BENCH_ROW_LEN];
+	double pressure[BENCH_ROW_LEN];
+	double humidity[BENCH_ROW_LEN];
+};
+
+/*!
+ * @brief Reference row with the operating range flags of each sample. A
+ * channel is valid when it and the temperature it depends on are unclipped.
+ */
+struct bench_ref_row {
+	struct bench_row value;
+	uint8_t t_valid[BENCH_ROW_LEN];
+	uint8_t p_valid[BENCH_ROW_LEN];
+	uint8_t h_valid[BENCH_ROW_LEN];
+};
+
+/*!
+ * @brief Row buffers, static as they are too large for the stack.
+ */
+static uint32_t raw_t[BENCH_ROW_LEN];
+static uint32_t raw_p[BENCH_ROW_LEN];
+static uint32_t raw_h[BENCH_ROW_LEN];
+static struct bme280_uncomp_data raw_aos[BENCH_ROW_LEN];
+static struct bme280_data out_aos[BENCH_ROW_LEN];
+static int32_t out_t_int[BENCH_ROW_LEN];
+static uint32_t out_p_int[BENCH_ROW_LEN];
+static uint32_t out_h_int[BENCH_ROW_LEN];
+static float out_t_flt[BENCH_ROW_LEN];
+static float out_p_flt[BENCH_ROW_LEN];
+static float out_h_flt[BENCH_ROW_LEN];
+static struct bench_ref_row ref_row;
+static struct bench_row path_row;
+static struct bench_result results[BENCH_PATHS];
+
+/*!
+ * @brief Keeps the compiler from dropping untimed results.
+ */
+static volatile uint32_t bench_sink;
+
+/*!
+ * @brief This internal API reads the monotonic clock in nanoseconds.
+ */
+static uint64_t now_ns(void);
+
+/*!
+ * @brief This internal API reads the time stamp counter, zero where there
+ * is none.
+ */
+static uint64_t now_cycles(void);
+
+/*!
+ * @brief This internal API returns the next value of the calibration
+ * generator, uniform in [lo, hi].
+ */
+static int32_t bench_rand(uint32_t *state, int32_t lo, int32_t hi);
+
+/*!
+ * @brief This internal API fills calibration set @p set.
+ */
+static void make_calib(uint32_t set, struct bme280_calib_data *calib);
+
+/*!
+ * @brief This internal API evaluates the datasheet floating point formulas
+ * in long double for one row.
+ */
+static void reference_row(const struct bme280_calib_data *calib, uint32_t len);
+
+/*!
+ * @brief This internal API runs and times one path over a row and converts
+ * its results to physical units.
+ */
+static int8_t run_path(enum bench_path path, struct bme280_dev *dev, uint32_t len, struct bench_result *res);
+
+/*!
+ * @brief This internal API folds the deviation of a row from the reference
+ * into @p res.
+ */
+static void accumulate(const struct bench_row *row, uint32_t len, struct bench_result *res);
+
+/*!
+ * @brief This internal API folds the deviation of one channel into the
+ * accumulators of both domains.
+ */
+static void accumulate_channel(const double *out, const double *ref, const uint8_t *valid, uint32_t len,
+				struct bench_err *err);
+
+/*!
+ * @brief This internal API returns the RMS of an error accumulator.
+ */
+static long double rms(const struct bench_err *err);
+
+/*!
+ * @brief This internal API prints the results.
+ */
+static void report(int json);
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * UINT64_C(1000000000) + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t now_cycles(void)
+{
+#ifdef BENCH_HAVE_TSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+int main(int argc, char **argv)
+{
+	int8_t rslt = BME280_OK;
+	int json = 0;
+	struct bme280_sim sim;
+	struct bme280_dev dev;
+	uint32_t set;
+	uint32_t ti;
+	uint32_t pi;
+	uint32_t hi;
+	uint32_t i;
+	int p;
+
+	for (i = 1; i < (uint32_t)argc; i++) {
+		if (strcmp(argv[i], "--json") == 0) {
+			json = 1;
+		} else if (strcmp(argv[i], "--csv") != 0) {
+			fprintf(stderr, "usage: %s [--csv|--json]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	for (set = 0; (rslt == BME280_OK) && (set < BENCH_CALIB_SETS); set++) {
+		/* Load the set through the simulator so that the driver parses
+		   the NVM image and prepares its coefficients as on a sensor */
+		bme280_sim_set_defaults(&sim, BME280_I2C_ADDR_PRIM, BME280_I2C_INTF);
+		make_calib(set, &sim.calib);
+		memset(&dev, 0, sizeof(dev));
+		rslt = bme280_sim_init(&sim);
+		if (rslt == BME280_OK) {
+			bme280_sim_attach(&sim, &dev);
+			rslt = bme280_init(&dev);
+		}
+
+		for (ti = 0; (rslt == BME280_OK) && (ti < BENCH_T_STEPS); ti++) {
+			i = 0;
+			for (pi = 0; pi < BENCH_P_STEPS; pi++) {
+				for (hi = 0; hi < BENCH_H_STEPS; hi++) {
+					raw_t[i] = (uint32_t)(((uint64_t)BENCH_RAW_PT_MAX * ti) / (BENCH_T_STEPS - 1));
+					raw_p[i] = (uint32_t)(((uint64_t)BENCH_RAW_PT_MAX * pi) / (BENCH_P_STEPS - 1));
+					raw_h[i] = (uint32_t)(((uint64_t)BENCH_RAW_H_MAX * hi) / (BENCH_H_STEPS - 1));
+					raw_aos[i].temperature = raw_t[i];
+					raw_aos[i].pressure = raw_p[i];
+					raw_aos[i].humidity = raw_h[i];
+					i++;
+				}
+			}
+			reference_row(&dev.calib_data, BENCH_ROW_LEN);
+			for (p = 0; (rslt == BME280_OK) && (p < BENCH_PATHS); p++)
+				rslt = run_path((enum bench_path)p, &dev, BENCH_ROW_LEN, &results[p]);
+		}
+
+		bme280_sim_deinit(&sim);
+	}
+
+	if (rslt != BME280_OK) {
+		fprintf(stderr, "bme280_bench: driver error %d\n", rslt);
+		return EXIT_FAILURE;
+	}
+
+	report(json);
+
+	return EXIT_SUCCESS;
+}
+
+static int32_t bench_rand(uint32_t *state, int32_t lo, int32_t hi)
+{
+	/* Numerical Recipes LCG, upper bits only */
+	*state = (*state * UINT32_C(1664525)) + UINT32_C(1013904223);
+
+	return lo + (int32_t)(((uint64_t)(*state >> 8) * (uint64_t)(hi - lo + 1)) >> 24);
+}
+
+static void make_calib(uint32_t set, struct bme280_calib_data *calib)
+{
+	uint32_t state = BENCH_SEED + set;
+
+	/* Set 0 keeps the simulator defaults */
+	if (set != 0) {
+		calib->dig_T1 = (uint16_t)bench_rand(&state, 26000, 30000);
+		calib->dig_T2 = (int16_t)bench_rand(&state, 25000, 28000);
+		calib->dig_T3 = (int16_t)bench_rand(&state, -1500, 100);
+		calib->dig_P1 = (uint16_t)bench_rand(&state, 35000, 39000);
+		calib->dig_P2 = (int16_t)bench_rand(&state, -11500, -10000);
+		calib->dig_P3 = (int16_t)bench_rand(&state, 2500, 3500);
+		calib->dig_P4 = (int16_t)bench_rand(&state, 2000, 9000);
+		calib->dig_P5 = (int16_t)bench_rand(&state, -200, 300);
+		calib->dig_P6 = (int16_t)bench_rand(&state, -7, -7);
+		calib->dig_P7 = (int16_t)bench_rand(&state, 9900, 15500);
+		calib->dig_P8 = (int16_t)bench_rand(&state, -14600, -10230);
+		calib->dig_P9 = (int16_t)bench_rand(&state, 4285, 6000);
+		calib->dig_H1 = (uint8_t)bench_rand(&state, 0, 100);
+		calib->dig_H2 = (int16_t)bench_rand(&state, 300, 400);
+		calib->dig_H3 = (uint8_t)bench_rand(&state, 0, 0);
+		calib->dig_H4 = (int16_t)bench_rand(&state, 280, 340);
+		calib->dig_H5 = (int16_t)bench_rand(&state, 0, 50);
+		calib->dig_H6 = (int8_t)bench_rand(&state, 20, 40);
+	}
+}
+
+static void reference_row(const struct bme280_calib_data *calib, uint32_t len)
+{
+	long double var1;
+	long double var2;
+	long double var3;
+	long double var4;
+	long double var5;
+	long double var6;
+	long double value;
+	long double t_fine;
+	uint32_t i;
+
+	for (i = 0; i < len; i++) {
+		/* Temperature; t_fine is an integer in the datasheet */
+		var1 = ((long double)raw_t[i] / 16384.0L - (long double)calib->dig_T1 / 1024.0L)
+			* (long double)calib->dig_T2;
+		var2 = (long double)raw_t[i] / 131072.0L - (long double)calib->dig_T1 / 8192.0L;
+		var2 = var2 * var2 * (long double)calib->dig_T3;
+		t_fine = (long double)(int32_t)(var1 + var2);
+		value = (var1 + var2) / 5120.0L;
+		ref_row.t_valid[i] = (value > -40.0L) && (value < 85.0L);
+		value = (value < -40.0L) ? -40.0L : ((value > 85.0L) ? 85.0L : value);
+		ref_row.value.temperature[i] = (double)value;
+
+		/* Pressure */
+		var1 = t_fine / 2.0L - 64000.0L;
+		var2 = var1 * var1 * (long double)calib->dig_P6 / 32768.0L;
+		var2 = var2 + var1 * (long double)calib->dig_P5 * 2.0L;
+		var2 = var2 / 4.0L + (long double)calib->dig_P4 * 65536.0L;
+		var1 = ((long double)calib->dig_P3 * var1 * var1 / 524288.0L + (long double)calib->dig_P2 * var1)
+			/ 524288.0L;
+		var1 = (1.0L + var1 / 32768.0L) * (long double)calib->dig_P1;
+		if (var1 != 0.0L) {
+			value = 1048576.0L - (long double)raw_p[i];
+			value = (value - var2 / 4096.0L) * 6250.0L / var1;
+			var1 = (long double)calib->dig_P9 * value * value / 2147483648.0L;
+			var2 = value * (long double)calib->dig_P8 / 32768.0L;
+			value = value + (var1 + var2 + (long double)calib->dig_P7) / 16.0L;
+			ref_row.p_valid[i] = ref_row.t_valid[i] && (value > 30000.0L) && (value < 110000.0L);
+			value = (value < 30000.0L) ? 30000.0L : ((value > 110000.0L) ? 110000.0L : value);
+		} else {
+			ref_row.p_valid[i] = 0;
+			value = 30000.0L;
+		}
+		ref_row.value.pressure[i] = (double)value;
+
+		/* Humidity */
+		var1 = t_fine - 76800.0L;
+		var2 = (long double)calib->dig_H4 * 64.0L + (long double)calib->dig_H5 / 16384.0L * var1;
+		var3 = (long double)raw_h[i] - var2;
+		var4 = (long double)calib->dig_H2 / 65536.0L;
+		var5 = 1.0L + (long double)calib->dig_H3 / 67108864.0L * var1;
+		var6 = 1.0L + (long double)calib->dig_H6 / 67108864.0L * var1 * var5;
+		var6 = var3 * var4 * (var5 * var6);
+		value = var6 * (1.0L - (long double)calib->dig_H1 * var6 / 524288.0L);
+		ref_row.h_valid[i] = ref_row.t_valid[i] && (value > 0.0L) && (value < 100.0L);
+		value = (value < 0.0L) ? 0.0L : ((value > 100.0L) ? 100.0L : value);
+		ref_row.value.humidity[i] = (double)value;
+	}
+}
+
+static int8_t run_path(enum bench_path path, struct bme280_dev *dev, uint32_t len, struct bench_result *res)
+{
+	int8_t rslt = BME280_OK;
+	struct bme280_uncomp_batch uncomp = { raw_p, raw_t, raw_h };
+	struct bme280_batch_int out_int = { out_p_int, out_t_int, out_h_int };
+	struct bme280_batch_float out_flt = { out_p_flt, out_t_flt, out_h_flt };
+	uint64_t ns;
+	uint64_t cycles;
+	uint32_t i;
+
+	if (bench_paths[path].backend != 0)
+		rslt = bme280_set_comp_backend(bench_paths[path].backend, dev);
+
+	ns = now_ns();
+	cycles = now_cycles();
+	switch (path) {
+	case BENCH_BATCH_FLOAT:
+		rslt = bme280_compensate_batch_float(BME280_ALL, &uncomp, &out_flt, len, &dev->calib_data);
+		break;
+	case BENCH_BATCH_INT32:
+		rslt = bme280_compensate_batch_int32(BME280_ALL, &uncomp, &out_int, len, &dev->calib_data);
+		break;
+	case BENCH_BATCH_INT64:
+		rslt = bme280_compensate_batch_int64(BME280_ALL, &uncomp, &out_int, len, &dev->calib_data);
+		break;
+	default:
+		for (i = 0; (rslt == BME280_OK) && (i < len); i++)
+			rslt = bme280_compensate_data(BME280_ALL, &raw_aos[i], &out_aos[i], dev);
+		break;
+	}
+	res->cycles += now_cycles() - cycles;
+	res->ns += now_ns() - ns;
+	res->samples += len;
+
+	for (i = 0; (rslt == BME280_OK) && (i < len); i++) {
+		switch (path) {
+		case BENCH_BATCH_FLOAT:
+			path_row.temperature[i] = out_t_flt[i];
+			path_row.pressure[i] = out_p_flt[i];
+			path_row.humidity[i] = out_h_flt[i];
+			break;
+		case BENCH_BATCH_INT32:
+		case BENCH_BATCH_INT64:
+			path_row.temperature[i] = out_t_int[i] / 100.0;
+			path_row.pressure[i] = out_p_int[i] / ((path == BENCH_BATCH_INT64) ? 100.0 : 1.0);
+			path_row.humidity[i] = out_h_int[i] / 1024.0;
+			break;
+		default:
+#ifdef FLOATING_POINT_REPRESENTATION
+			path_row.temperature[i] = out_aos[i].temperature;
+			path_row.pressure[i] = out_aos[i].pressure;
+			path_row.humidity[i] = out_aos[i].humidity;
+#else
+			path_row.temperature[i] = out_aos[i].temperature / 100.0;
+#ifdef MACHINE_64_BIT
+			path_row.pressure[i] = out_aos[i].pressure / 100.0;
+#else
+			path_row.pressure[i] = out_aos[i].pressure;
+#endif
+			path_row.humidity[i] = out_aos[i].humidity / 1024.0;
+#endif
+			break;
+		}
+	}
+	bench_sink += (uint32_t)path_row.pressure[len - 1];
+
+	if (rslt == BME280_OK)
+		accumulate(&path_row, len, res);
+
+	return rslt;
+}
+
+static void accumulate_channel(const double *out, const double *ref, const uint8_t *valid, uint32_t len,
+				struct bench_err *err)
+{
+	long double diff;
+	uint32_t i;
+	int d;
+
+	for (i = 0; i < len; i++) {
+		diff = fabsl((long double)out[i] - (long double)ref[i]);
+		for (d = 0; d < BENCH_DOMAINS; d++) {
+			if ((d == BENCH_VALID) && !valid[i])
+				continue;
+			err[d].count++;
+			err[d].max = (diff > err[d].max) ? diff : err[d].max;
+			err[d].sum_sq += diff * diff;
+		}
+	}
+}
+
+static void accumulate(const struct bench_row *row, uint32_t len, struct bench_result *res)
+{
+	accumulate_channel(row->temperature, ref_row.value.temperature, ref_row.t_valid, len, res->temperature);
+	accumulate_channel(row->pressure, ref_row.value.pressure, ref_row.p_valid, len, res->pressure);
+	accumulate_channel(row->humidity, ref_row.value.humidity, ref_row.h_valid, len, res->humidity);
+}
+
+static long double rms(const struct bench_err *err)
+{
+	return (err->count != 0) ? sqrtl(err->sum_sq / err->count) : 0.0L;
+}
+
+static void report(int json)
+{
+	static const char *const channels[3] = { "temperature", "pressure", "humidity" };
+	const struct bench_result *res;
+	const struct bench_err *err[3];
+	double ns;
+	int p;
+	int d;
+	int c;
+
+	if (json)
+		printf("{\n\t\"calib_sets\": %d,\n\t\"samples_per_set\": %d,\n\t\"units\": "
+			"{ \"temperature\": \"degC\", \"pressure\": \"Pa\", \"humidity\": \"%%RH\" },\n"
+			"\t\"paths\": [\n", BENCH_CALIB_SETS, BENCH_T_STEPS * BENCH_ROW_LEN);
+	else
+		printf("path,domain,samples,ns_per_sample,cycles_per_sample,"
+			"t_count,t_max_degc,t_rms_degc,p_count,p_max_pa,p_rms_pa,h_count,h_max_rh,h_rms_rh\n");
+
+	for (p = 0; p < BENCH_PATHS; p++) {
+		res = &results[p];
+		ns = (double)res->ns / (double)res->samples;
+		if (json) {
+			printf("\t\t{ \"path\": \"%s\", \"samples\": %llu, \"ns_per_sample\": %.3f, ",
+				bench_paths[p].name, (unsigned long long)res->samples, ns);
+#ifdef BENCH_HAVE_TSC
+			printf("\"cycles_per_sample\": %.3f", (double)res->cycles / (double)res->samples);
+#else
+			printf("\"cycles_per_sample\": null");
+#endif
+		}
+		for (d = 0; d < BENCH_DOMAINS; d++) {
+			err[0] = &res->temperature[d];
+			err[1] = &res->pressure[d];
+			err[2] = &res->humidity[d];
+			if (json) {
+				printf(",\n\t\t  \"%s\": {", bench_domains[d]);
+				for (c = 0; c < 3; c++)
+					printf("%s\n\t\t\t\"%s\": { \"count\": %llu, \"max\": %.6Le, \"rms\": %.6Le }",
+						(c != 0) ? "," : "", channels[c], (unsigned long long)err[c]->count,
+						err[c]->max, rms(err[c]));
+				printf(" }");
+			} else {
+				printf("%s,%s,%llu,%.3f,", bench_paths[p].name, bench_domains[d],
+					(unsigned long long)res->samples, ns);
+#ifdef BENCH_HAVE_TSC
+				printf("%.3f", (double)res->cycles / (double)res->samples);
+#endif
+				for (c = 0; c < 3; c++)
+					printf(",%llu,%.6Le,%.6Le", (unsigned long long)err[c]->count, err[c]->max,
+						rms(err[c]));
+				printf("\n");
+			}
+		}
+		if (json)
+			printf(" }%s\n", (p + 1 < BENCH_PATHS) ? "," : "");
+	}
+
+	if (json)
+		printf("\t]\n}\n");
+}
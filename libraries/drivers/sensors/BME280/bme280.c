@@ -129,6 +129,87 @@ static void parse_temp_press_calib_data(const uint8_t *reg_data, struct bme280_d
  */
 static void parse_humidity_calib_data(const uint8_t *reg_data, struct bme280_dev *dev);
 
+/*!
+ *  @brief This internal API derives the prepared compensation coefficients
+ *  from the calibration data in the device structure.
+ *
+ *  @param[in,out] dev : Structure instance of bme280_dev.
+ */
+static void prepare_calib_data(struct bme280_dev *dev);
+
+/*!
+ * @brief This internal API converts an oversampling macro into the number of
+ * samples taken.
+ *
+ * @param[in] osr : Oversampling macro.
+ *
+ * @return Number of samples, zero for a skipped measurement.
+ */
+static uint32_t osr_to_samples(uint8_t osr);
+
+/*!
+ * @brief This internal API maps a register address onto its slot in the
+ * register shadow. The shadowed registers all have bit 7 set, so addresses
+ * with the SPI read/write bit applied or cleared map to the same slot.
+ *
+ * @param[in] reg_addr : Register address.
+ *
+ * @return Shadow slot, BME280_SHADOW_LEN if the register is not shadowed.
+ */
+static uint8_t shadow_slot(uint8_t reg_addr);
+
+/*!
+ * @brief This internal API answers a register read from the register shadow
+ * when every requested register is shadowed and valid.
+ *
+ * @param[in] reg_addr : Register address from where the data to be read.
+ * @param[out] reg_data : Pointer to data buffer to store the read data.
+ * @param[in] len : No of bytes of data to be read.
+ * @param[in] dev : Structure instance of bme280_dev.
+ *
+ * @return TRUE if the read was answered from the shadow, FALSE otherwise.
+ */
+static uint8_t shadow_read(uint8_t reg_addr, uint8_t *reg_data, uint16_t len, const struct bme280_dev *dev);
+
+/*!
+ * @brief This internal API refreshes the register shadow with the data of a
+ * bus read.
+ *
+ * @param[in] reg_addr : Register address the data was read from.
+ * @param[in] reg_data : Data read from the sensor.
+ * @param[in] len : No of bytes read.
+ * @param[in] dev : Structure instance of bme280_dev.
+ */
+static void shadow_fill(uint8_t reg_addr, const uint8_t *reg_data, uint16_t len, const struct bme280_dev *dev);
+
+/*!
+ * @brief This internal API updates the register shadow after a register
+ * write. A soft reset command resets the shadow to the power-on values, a
+ * failed write invalidates the registers it addressed.
+ *
+ * @param[in] reg_addr : Register addresses written.
+ * @param[in] reg_data : Data written.
+ * @param[in] len : No of registers written.
+ * @param[in] rslt : Result of the write.
+ * @param[in] dev : Structure instance of bme280_dev.
+ */
+static void shadow_write(const uint8_t *reg_addr, const uint8_t *reg_data, uint8_t len, int8_t rslt,
+				const struct bme280_dev *dev);
+
+/*!
+ * @brief This internal API reads the ctrl_hum, status, ctrl_meas and config
+ * registers, taking the control registers from the shadow when it holds all
+ * of them. The status byte is then left zero; callers only use the
+ * settings.
+ *
+ * @param[out] reg_data : Buffer of 4 bytes for registers 0xF2 to 0xF5.
+ * @param[in] dev : Structure instance of bme280_dev.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / -ve value -> Error
+ */
+static int8_t get_ctrl_regs(uint8_t *reg_data, const struct bme280_dev *dev);
+
 /*!
  *  @brief This internal API is used to parse the pressure, temperature and
  *  humidity data and store it in the bme280_uncomp_data structure instance.
@@ -140,9 +221,9 @@ static void parse_humidity_calib_data(const uint8_t *reg_data, struct bme280_dev
 static void parse_sensor_data(const uint8_t *reg_data, struct bme280_uncomp_data *uncomp_data);
 
 /*!
- * @brief This internal API is used to compensate the pressure and/or
- * temperature and/or humidity data according to the component selected by the
- * user.
+ * @brief Signature of a compensation backend: compensates the pressure
+ * and/or temperature and/or humidity data according to the component selected
+ * by the user and stores them in the units of struct bme280_data.
  *
  * @param[in] sensor_comp : Used to select pressure and/or temperature and/or
  * humidity.
@@ -151,26 +232,115 @@ static void parse_sensor_data(const uint8_t *reg_data, struct bme280_uncomp_data
  * @param[out] comp_data : Contains the compensated pressure and/or temperature
  * and/or humidity data.
  * @param[in] calib_data : Pointer to the calibration data structure.
+ * @param[in] prep : Pointer to the prepared coefficients.
+ */
+typedef void (*compensate_fptr_t)(uint8_t sensor_comp, const struct bme280_uncomp_data *uncomp_data,
+				struct bme280_data *comp_data, struct bme280_calib_data *calib_data,
+				const struct bme280_calib_prep *prep);
+
+/*!
+ * @brief This internal API is used to compensate the pressure and/or
+ * temperature and/or humidity data with the backend selected for the device.
+ *
+ * @param[in] sensor_comp : Used to select pressure and/or temperature and/or
+ * humidity.
+ * @param[in] uncomp_data : Contains the uncompensated pressure, temperature and
+ * humidity data.
+ * @param[out] comp_data : Contains the compensated pressure and/or temperature
+ * and/or humidity data.
+ * @param[in] dev : Structure instance of bme280_dev.
  *
  * @return Result of API execution status.
  * @retval zero -> Success / -ve value -> Error
  */
 static int8_t compensate_data(uint8_t sensor_comp, const struct bme280_uncomp_data *uncomp_data,
-				     struct bme280_data *comp_data, struct bme280_calib_data *calib_data);
+				     struct bme280_data *comp_data, struct bme280_dev *dev);
+
+/*!
+ * @brief Compensation backend evaluating the reference floating point formulas
+ * in double precision. Software emulated on the Cortex-M4.
+ */
+static void compensate_data_double(uint8_t sensor_comp, const struct bme280_uncomp_data *uncomp_data,
+				struct bme280_data *comp_data, struct bme280_calib_data *calib_data,
+				const struct bme280_calib_prep *prep);
+
+/*!
+ * @brief Compensation backend evaluating the floating point formulas in single
+ * precision, which the Cortex-M4 FPU executes in hardware.
+ */
+static void compensate_data_float(uint8_t sensor_comp, const struct bme280_uncomp_data *uncomp_data,
+				struct bme280_data *comp_data, struct bme280_calib_data *calib_data,
+				const struct bme280_calib_prep *prep);
+
+/*!
+ * @brief Compensation backend using the 32 bit integer formulas.
+ */
+static void compensate_data_int32(uint8_t sensor_comp, const struct bme280_uncomp_data *uncomp_data,
+				struct bme280_data *comp_data, struct bme280_calib_data *calib_data,
+				const struct bme280_calib_prep *prep);
+
+/*!
+ * @brief Compensation backend using the 32 bit integer formulas for
+ * temperature and humidity and the 64 bit formula for pressure.
+ */
+static void compensate_data_int64(uint8_t sensor_comp, const struct bme280_uncomp_data *uncomp_data,
+				struct bme280_data *comp_data, struct bme280_calib_data *calib_data,
+				const struct bme280_calib_prep *prep);
+
+/*!
+ * @brief This internal API stores floating point results in struct
+ * bme280_data, converting them if the structure holds integers.
+ *
+ * @param[in] temperature : Temperature in degC.
+ * @param[in] pressure : Pressure in Pa.
+ * @param[in] humidity : Relative humidity in %.
+ * @param[out] comp_data : Structure instance of bme280_data.
+ */
+static void store_real_data(double temperature, double pressure, double humidity,
+				struct bme280_data *comp_data);
+
+/*!
+ * @brief This internal API stores integer results in struct bme280_data,
+ * converting them to the units of the structure.
+ *
+ * @param[in] temperature : Temperature in 0.01 degC.
+ * @param[in] pressure : Pressure in Pa, or in 0.01 Pa if press_centi is set.
+ * @param[in] press_centi : TRUE if the pressure is in 0.01 Pa.
+ * @param[in] humidity : Relative humidity in 1/1024 %.
+ * @param[out] comp_data : Structure instance of bme280_data.
+ */
+static void store_int_data(int32_t temperature, uint32_t pressure, uint8_t press_centi,
+				uint32_t humidity, struct bme280_data *comp_data);
+
+/*!
+ * @brief This internal API is used to compensate the raw temperature data and
+ * return the compensated temperature data in double data type.
+ *
+ * @param[in] uncomp_data : Contains the uncompensated temperature data.
+ * @param[in] calib_data : Pointer to calibration data structure.
+ * @param[in] prep : Pointer to the prepared coefficients.
+ *
+ * @return Compensated temperature data.
+ * @retval Compensated temperature data in double.
+ */
+static double compensate_temperature_double(const struct bme280_uncomp_data *uncomp_data,
+						struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_double *prep);
 
-#ifdef FLOATING_POINT_REPRESENTATION
 /*!
  * @brief This internal API is used to compensate the raw pressure data and
  * return the compensated pressure data in double data type.
  *
  * @param[in] uncomp_data : Contains the uncompensated pressure data.
  * @param[in] calib_data : Pointer to the calibration data structure.
+ * @param[in] prep : Pointer to the prepared coefficients.
  *
  * @return Compensated pressure data.
  * @retval Compensated pressure data in double.
  */
-static double compensate_pressure(const struct bme280_uncomp_data *uncomp_data,
-						const struct bme280_calib_data *calib_data);
+static double compensate_pressure_double(const struct bme280_uncomp_data *uncomp_data,
+						const struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_double *prep);
 
 /*!
  * @brief This internal API is used to compensate the raw humidity data and
@@ -178,27 +348,59 @@ static double compensate_pressure(const struct bme280_uncomp_data *uncomp_data,
  *
  * @param[in] uncomp_data : Contains the uncompensated humidity data.
  * @param[in] calib_data : Pointer to the calibration data structure.
+ * @param[in] prep : Pointer to the prepared coefficients.
  *
  * @return Compensated humidity data.
  * @retval Compensated humidity data in double.
  */
-static double compensate_humidity(const struct bme280_uncomp_data *uncomp_data,
-						const struct bme280_calib_data *calib_data);
+static double compensate_humidity_double(const struct bme280_uncomp_data *uncomp_data,
+						const struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_double *prep);
 
 /*!
  * @brief This internal API is used to compensate the raw temperature data and
- * return the compensated temperature data in double data type.
+ * return the compensated temperature data in float data type.
  *
  * @param[in] uncomp_data : Contains the uncompensated temperature data.
  * @param[in] calib_data : Pointer to calibration data structure.
+ * @param[in] prep : Pointer to the prepared coefficients.
  *
  * @return Compensated temperature data.
- * @retval Compensated temperature data in double.
+ * @retval Compensated temperature data in float.
  */
-static  double compensate_temperature(const struct bme280_uncomp_data *uncomp_data,
-						struct bme280_calib_data *calib_data);
+static float compensate_temperature_float(const struct bme280_uncomp_data *uncomp_data,
+						struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_float *prep);
 
-#else
+/*!
+ * @brief This internal API is used to compensate the raw pressure data and
+ * return the compensated pressure data in float data type.
+ *
+ * @param[in] uncomp_data : Contains the uncompensated pressure data.
+ * @param[in] calib_data : Pointer to the calibration data structure.
+ * @param[in] prep : Pointer to the prepared coefficients.
+ *
+ * @return Compensated pressure data.
+ * @retval Compensated pressure data in float.
+ */
+static float compensate_pressure_float(const struct bme280_uncomp_data *uncomp_data,
+						const struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_float *prep);
+
+/*!
+ * @brief This internal API is used to compensate the raw humidity data and
+ * return the compensated humidity data in float data type.
+ *
+ * @param[in] uncomp_data : Contains the uncompensated humidity data.
+ * @param[in] calib_data : Pointer to the calibration data structure.
+ * @param[in] prep : Pointer to the prepared coefficients.
+ *
+ * @return Compensated humidity data.
+ * @retval Compensated humidity data in float.
+ */
+static float compensate_humidity_float(const struct bme280_uncomp_data *uncomp_data,
+						const struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_float *prep);
 
 /*!
  * @brief This internal API is used to compensate the raw temperature data and
@@ -206,12 +408,14 @@ static  double compensate_temperature(const struct bme280_uncomp_data *uncomp_da
  *
  * @param[in] uncomp_data : Contains the uncompensated temperature data.
  * @param[in] calib_data : Pointer to calibration data structure.
+ * @param[in] prep : Pointer to the prepared coefficients.
  *
  * @return Compensated temperature data.
  * @retval Compensated temperature data in integer.
  */
-static int32_t compensate_temperature(const struct bme280_uncomp_data *uncomp_data,
-						struct bme280_calib_data *calib_data);
+static int32_t compensate_temperature_int32(const struct bme280_uncomp_data *uncomp_data,
+						struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_int *prep);
 
 /*!
  * @brief This internal API is used to compensate the raw pressure data and
@@ -219,11 +423,27 @@ static int32_t compensate_temperature(const struct bme280_uncomp_data *uncomp_da
  *
  * @param[in] uncomp_data : Contains the uncompensated pressure data.
  * @param[in] calib_data : Pointer to the calibration data structure.
+ * @param[in] prep : Pointer to the prepared coefficients.
  *
  * @return Compensated pressure data.
  * @retval Compensated pressure data in integer.
  */
-static uint32_t compensate_pressure(const struct bme280_uncomp_data *uncomp_data,
+static uint32_t compensate_pressure_int32(const struct bme280_uncomp_data *uncomp_data,
+						const struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_int *prep);
+
+/*!
+ * @brief This internal API is used to compensate the raw pressure data and
+ * return the compensated pressure data in integer data type with higher
+ * accuracy.
+ *
+ * @param[in] uncomp_data : Contains the uncompensated pressure data.
+ * @param[in] calib_data : Pointer to the calibration data structure.
+ *
+ * @return Compensated pressure data.
+ * @retval Compensated pressure data in 0.01 Pa.
+ */
+static uint32_t compensate_pressure_int64(const struct bme280_uncomp_data *uncomp_data,
 						const struct bme280_calib_data *calib_data);
 
 /*!
@@ -232,14 +452,14 @@ static uint32_t compensate_pressure(const struct bme280_uncomp_data *uncomp_data
  *
  * @param[in] uncomp_data : Contains the uncompensated humidity data.
  * @param[in] calib_data : Pointer to the calibration data structure.
+ * @param[in] prep : Pointer to the prepared coefficients.
  *
  * @return Compensated humidity data.
  * @retval Compensated humidity data in integer.
  */
-static uint32_t compensate_humidity(const struct bme280_uncomp_data *uncomp_data,
-						const struct bme280_calib_data *calib_data);
-
-#endif
+static uint32_t compensate_humidity_int32(const struct bme280_uncomp_data *uncomp_data,
+						const struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_int *prep);
 
 /*!
  * @brief This internal API is used to identify the settings which the user
@@ -424,7 +644,8 @@ int8_t bme280_get_regs(uint8_t reg_addr, uint8_t *reg_data, uint16_t len, const
 	/* Check for null pointer in the device structure*/
 	rslt = null_ptr_check(dev);
 	/* Proceed if null check is fine */
-	if (rslt == BME280_OK) {
+	/* Proceed if null check is fine and the shadow cannot answer */
+	if ((rslt == BME280_OK) && !shadow_read(reg_addr, reg_data, len, dev)) {
 		/* If interface selected is SPI */
 		if (dev->interface != BME280_I2C_INTF)
 			reg_addr = reg_addr | 0x80;
@@ -433,6 +654,8 @@ int8_t bme280_get_regs(uint8_t reg_addr, uint8_t *reg_data, uint16_t len, const
 		/* Check for communication error */
 		if (rslt != BME280_OK)
 			rslt = BME280_E_COMM_FAIL;
+		else
+			shadow_fill(reg_addr, reg_data, len, dev);
 	}
 
 	return rslt;
@@ -473,6 +696,8 @@ int8_t bme280_set_regs(uint8_t *reg_addr, const uint8_t *reg_data, uint8_t len,
 			/* Check for communication error */
 			if (rslt != BME280_OK)
 				rslt = BME280_E_COMM_FAIL;
+			/* Keep the register shadow coherent */
+			shadow_write(reg_addr, reg_data, len, rslt, dev);
 		} else {
 			rslt = BME280_E_INVALID_LEN;
 		}
@@ -528,7 +753,7 @@ int8_t bme280_get_sensor_settings(struct bme280_dev *dev)
 	rslt = null_ptr_check(dev);
 	/* Proceed if null check is fine */
 	if (rslt == BME280_OK) {
-		rslt = bme280_get_regs(BME280_CTRL_HUM_ADDR, reg_data, 4, dev);
+		rslt = get_ctrl_regs(reg_data, dev);
 		if (rslt == BME280_OK)
 			parse_device_settings(reg_data, &dev->settings);
 	}
@@ -604,6 +829,51 @@ int8_t bme280_soft_reset(const struct bme280_dev *dev)
 	return rslt;
 }
 
+/*!
+ * @brief This API reads the status register of the sensor.
+ */
+int8_t bme280_get_status(uint8_t *status, const struct bme280_dev *dev)
+{
+	int8_t rslt;
+
+	if (status != NULL)
+		rslt = bme280_get_regs(BME280_STATUS_ADDR, status, 1, dev);
+	else
+		rslt = BME280_E_NULL_PTR;
+
+	return rslt;
+}
+
+/*!
+ * @brief This API calculates the duration of one conversion for the given
+ * oversampling settings.
+ */
+uint32_t bme280_cal_meas_delay_us(const struct bme280_settings *settings, uint8_t bound)
+{
+	uint32_t meas_time = 0;
+	uint32_t base = 1000;
+	uint32_t per_sample = 2000;
+	uint32_t overhead = 500;
+	uint32_t samples;
+
+	if (settings != NULL) {
+		if (bound == BME280_MEAS_TIME_MAX) {
+			base = 1250;
+			per_sample = 2300;
+			overhead = 575;
+		}
+		meas_time = base + per_sample * osr_to_samples(settings->osr_t);
+		samples = osr_to_samples(settings->osr_p);
+		if (samples)
+			meas_time += per_sample * samples + overhead;
+		samples = osr_to_samples(settings->osr_h);
+		if (samples)
+			meas_time += per_sample * samples + overhead;
+	}
+
+	return meas_time;
+}
+
 /*!
  * @brief This API reads the pressure, temperature and humidity data from the
  * sensor, compensates the data and store it in the bme280_data structure
@@ -629,7 +899,7 @@ int8_t bme280_get_sensor_data(uint8_t sensor_comp, struct bme280_data *comp_data
 			parse_sensor_data(reg_data, &uncomp_data);
 			/* Compensate the pressure and/or temperature and/or
 			   humidity data from the sensor */
-			rslt = compensate_data(sensor_comp, &uncomp_data, comp_data, &dev->calib_data);
+			rslt = compensate_data(sensor_comp, &uncomp_data, comp_data, dev);
 		}
 	} else {
 		rslt = BME280_E_NULL_PTR;
@@ -638,6 +908,43 @@ int8_t bme280_get_sensor_data(uint8_t sensor_comp, struct bme280_data *comp_data
 	return rslt;
 }
 
+/*!
+ * @brief This API compensates raw data with the compensation backend and
+ * calibration data of the device.
+ */
+int8_t bme280_compensate_data(uint8_t sensor_comp, const struct bme280_uncomp_data *uncomp_data,
+				struct bme280_data *comp_data, struct bme280_dev *dev)
+{
+	int8_t rslt;
+
+	/* Check for null pointer in the device structure*/
+	rslt = null_ptr_check(dev);
+
+	if (rslt == BME280_OK)
+		rslt = compensate_data(sensor_comp, uncomp_data, comp_data, dev);
+
+	return rslt;
+}
+
+/*!
+ * @brief This API selects the compensation backend of the device.
+ */
+int8_t bme280_set_comp_backend(uint8_t backend, struct bme280_dev *dev)
+{
+	int8_t rslt = BME280_OK;
+
+	if (dev != NULL) {
+		if (backend < BME280_COMP_BACKEND_MAX)
+			dev->comp_backend = backend;
+		else
+			rslt = BME280_E_INVALID_BACKEND;
+	} else {
+		rslt = BME280_E_NULL_PTR;
+	}
+
+	return rslt;
+}
+
 /*!
  * @brief This internal API sets the oversampling settings for pressure,
  * temperature and humidity in the sensor.
@@ -810,7 +1117,7 @@ static int8_t put_device_to_sleep(const struct bme280_dev *dev)
 	uint8_t reg_data[4];
 	struct bme280_settings settings;
 
-	rslt = bme280_get_regs(BME280_CTRL_HUM_ADDR, reg_data, 4, dev);
+	rslt = get_ctrl_regs(reg_data, dev);
 	if (rslt == BME280_OK) {
 		parse_device_settings(reg_data, &settings);
 		rslt = bme280_soft_reset(dev);
@@ -836,6 +1143,168 @@ static int8_t reload_device_settings(const struct bme280_settings *settings, con
 	return rslt;
 }
 
+/*!
+ * @brief This internal API converts an oversampling macro into the number of
+ * samples taken.
+ */
+static uint32_t osr_to_samples(uint8_t osr)
+{
+	uint32_t samples = 0;
+
+	if (osr != BME280_NO_OVERSAMPLING) {
+		/* Settings above 16x all select 16x */
+		if (osr > BME280_OVERSAMPLING_16X)
+			osr = BME280_OVERSAMPLING_16X;
+		samples = UINT32_C(1) << (osr - 1);
+	}
+
+	return samples;
+}
+
+/*!
+ * @brief This internal API maps a register address onto its slot in the
+ * register shadow.
+ */
+static uint8_t shadow_slot(uint8_t reg_addr)
+{
+	uint8_t slot;
+
+	switch (reg_addr | 0x80) {
+	case BME280_CTRL_HUM_ADDR:
+		slot = BME280_SHADOW_CTRL_HUM;
+		break;
+	case BME280_CTRL_MEAS_ADDR:
+		slot = BME280_SHADOW_CTRL_MEAS;
+		break;
+	case BME280_CONFIG_ADDR:
+		slot = BME280_SHADOW_CONFIG;
+		break;
+	default:
+		slot = BME280_SHADOW_LEN;
+		break;
+	}
+
+	return slot;
+}
+
+/*!
+ * @brief This internal API answers a register read from the register shadow
+ * when every requested register is shadowed and valid.
+ */
+static uint8_t shadow_read(uint8_t reg_addr, uint8_t *reg_data, uint16_t len, const struct bme280_dev *dev)
+{
+	struct bme280_shadow *shadow = dev->shadow;
+	uint8_t hit = FALSE;
+	uint8_t slot;
+	uint8_t mode;
+	uint16_t i;
+
+	if ((shadow != NULL) && (len != 0) && (len <= BME280_SHADOW_LEN)) {
+		hit = TRUE;
+		for (i = 0; (i < len) && hit; i++) {
+			slot = shadow_slot((uint8_t)(reg_addr + i));
+			if ((slot == BME280_SHADOW_LEN) || !(shadow->valid & (1 << slot))) {
+				hit = FALSE;
+			} else if (slot == BME280_SHADOW_CTRL_MEAS) {
+				/* A forced conversion returns the sensor to sleep on
+				   its own, so the mode bits must come from the bus */
+				mode = BME280_GET_BITS_POS_0(shadow->regs[slot], BME280_SENSOR_MODE);
+				if ((mode != BME280_SLEEP_MODE) && (mode != BME280_NORMAL_MODE))
+					hit = FALSE;
+			}
+		}
+		if (hit) {
+			for (i = 0; i < len; i++)
+				reg_data[i] = shadow->regs[shadow_slot((uint8_t)(reg_addr + i))];
+			shadow->reads_saved++;
+		}
+	}
+
+	return hit;
+}
+
+/*!
+ * @brief This internal API refreshes the register shadow with the data of a
+ * bus read.
+ */
+static void shadow_fill(uint8_t reg_addr, const uint8_t *reg_data, uint16_t len, const struct bme280_dev *dev)
+{
+	struct bme280_shadow *shadow = dev->shadow;
+	uint8_t slot;
+	uint16_t i;
+
+	if (shadow != NULL) {
+		for (i = 0; i < len; i++) {
+			slot = shadow_slot((uint8_t)(reg_addr + i));
+			if (slot != BME280_SHADOW_LEN) {
+				shadow->regs[slot] = reg_data[i];
+				shadow->valid |= (1 << slot);
+			}
+		}
+	}
+}
+
+/*!
+ * @brief This internal API updates the register shadow after a register
+ * write.
+ */
+static void shadow_write(const uint8_t *reg_addr, const uint8_t *reg_data, uint8_t len, int8_t rslt,
+				const struct bme280_dev *dev)
+{
+	struct bme280_shadow *shadow = dev->shadow;
+	uint8_t slot;
+	uint8_t i;
+
+	if (shadow != NULL) {
+		for (i = 0; i < len; i++) {
+			if ((reg_addr[i] | 0x80) == BME280_RESET_ADDR) {
+				if (rslt != BME280_OK) {
+					/* Unknown whether the reset happened */
+					shadow->valid = 0;
+				} else if (reg_data[i] == 0xB6) {
+					/* Power-on values of the control registers */
+					for (slot = 0; slot < BME280_SHADOW_LEN; slot++)
+						shadow->regs[slot] = 0;
+					shadow->valid = BME280_SHADOW_ALL_VALID;
+				}
+			} else {
+				slot = shadow_slot(reg_addr[i]);
+				if (slot == BME280_SHADOW_LEN)
+					continue;
+				if (rslt == BME280_OK) {
+					shadow->regs[slot] = reg_data[i];
+					shadow->valid |= (1 << slot);
+				} else {
+					shadow->valid &= ~(1 << slot);
+				}
+			}
+		}
+	}
+}
+
+/*!
+ * @brief This internal API reads the ctrl_hum, status, ctrl_meas and config
+ * registers, taking the control registers from the shadow when it holds all
+ * of them.
+ */
+static int8_t get_ctrl_regs(uint8_t *reg_data, const struct bme280_dev *dev)
+{
+	int8_t rslt = BME280_OK;
+	struct bme280_shadow *shadow = dev->shadow;
+
+	if ((shadow != NULL) && (shadow->valid == BME280_SHADOW_ALL_VALID)) {
+		reg_data[0] = shadow->regs[BME280_SHADOW_CTRL_HUM];
+		reg_data[1] = 0;
+		reg_data[2] = shadow->regs[BME280_SHADOW_CTRL_MEAS];
+		reg_data[3] = shadow->regs[BME280_SHADOW_CONFIG];
+		shadow->reads_saved++;
+	} else {
+		rslt = bme280_get_regs(BME280_CTRL_HUM_ADDR, reg_data, 4, dev);
+	}
+
+	return rslt;
+}
+
 /*!
  *  @brief This internal API is used to parse the pressure, temperature and
  *  humidity data and store it in the bme280_uncomp_data structure instance.
@@ -848,15 +1317,15 @@ static void parse_sensor_data(const uint8_t *reg_data, struct bme280_uncomp_data
 	uint32_t data_msb;
 
 	/* Store the parsed register values for pressure data */
-	data_xlsb = (uint32_t)reg_data[0] << 12;
+	data_msb = (uint32_t)reg_data[0] << 12;
 	data_lsb = (uint32_t)reg_data[1] << 4;
-	data_msb = (uint32_t)reg_data[2] << 4;
+	data_xlsb = (uint32_t)reg_data[2] >> 4;
 	uncomp_data->pressure = data_msb | data_lsb | data_xlsb;
 
 	/* Store the parsed register values for temperature data */
-	data_xlsb = (uint32_t)reg_data[3] << 12;
+	data_msb = (uint32_t)reg_data[3] << 12;
 	data_lsb = (uint32_t)reg_data[4] << 4;
-	data_msb = (uint32_t)reg_data[5] << 4;
+	data_xlsb = (uint32_t)reg_data[5] >> 4;
 	uncomp_data->temperature = data_msb | data_lsb | data_xlsb;
 
 	/* Store the parsed register values for temperature data */
@@ -865,33 +1334,38 @@ static void parse_sensor_data(const uint8_t *reg_data, struct bme280_uncomp_data
 	uncomp_data->humidity = data_msb | data_lsb;
 }
 
+/*!
+ * @brief Compensation backends, indexed by bme280_dev.comp_backend.
+ */
+static const compensate_fptr_t comp_backends[BME280_COMP_BACKEND_MAX] = {
+#if defined(FLOATING_POINT_REPRESENTATION)
+	compensate_data_double,		/* BME280_COMP_DEFAULT */
+#elif defined(MACHINE_64_BIT)
+	compensate_data_int64,		/* BME280_COMP_DEFAULT */
+#else
+	compensate_data_int32,		/* BME280_COMP_DEFAULT */
+#endif
+	compensate_data_double,		/* BME280_COMP_DOUBLE */
+	compensate_data_float,		/* BME280_COMP_FLOAT */
+	compensate_data_int32,		/* BME280_COMP_INT32 */
+	compensate_data_int64		/* BME280_COMP_INT64 */
+};
+
 /*!
  * @brief This internal API is used to compensate the pressure and/or
- * temperature and/or humidity data according to the component selected
- * by the user.
+ * temperature and/or humidity data with the backend selected for the device.
  */
 static int8_t compensate_data(uint8_t sensor_comp, const struct bme280_uncomp_data *uncomp_data,
-				     struct bme280_data *comp_data, struct bme280_calib_data *calib_data)
+				     struct bme280_data *comp_data, struct bme280_dev *dev)
 {
 	int8_t rslt = BME280_OK;
 
-	if ((uncomp_data != NULL) && (comp_data != NULL) && (calib_data != NULL)) {
-		/* Initialize to zero */
-		comp_data->temperature = 0;
-		comp_data->pressure = 0;
-		comp_data->humidity = 0;
-		/* If pressure or temperature component is selected */
-		if (sensor_comp & (BME280_PRESS | BME280_TEMP | BME280_HUM)) {
-			/* Compensate the temperature data */
-			comp_data->temperature = compensate_temperature(uncomp_data, calib_data);
-		}
-		if (sensor_comp & BME280_PRESS) {
-			/* Compensate the pressure data */
-			comp_data->pressure = compensate_pressure(uncomp_data, calib_data);
-		}
-		if (sensor_comp & BME280_HUM) {
-			/* Compensate the humidity data */
-			comp_data->humidity = compensate_humidity(uncomp_data, calib_data);
+	if ((uncomp_data != NULL) && (comp_data != NULL)) {
+		if (dev->comp_backend < BME280_COMP_BACKEND_MAX) {
+			comp_backends[dev->comp_backend](sensor_comp, uncomp_data, comp_data, &dev->calib_data,
+							&dev->calib_prep);
+		} else {
+			rslt = BME280_E_INVALID_BACKEND;
 		}
 	} else {
 		rslt = BME280_E_NULL_PTR;
@@ -900,13 +1374,145 @@ static int8_t compensate_data(uint8_t sensor_comp, const struct bme280_uncomp_da
 	return rslt;
 }
 
+/*!
+ * @brief Compensation backend evaluating the reference floating point formulas
+ * in double precision.
+ */
+static void compensate_data_double(uint8_t sensor_comp, const struct bme280_uncomp_data *uncomp_data,
+				struct bme280_data *comp_data, struct bme280_calib_data *calib_data,
+				const struct bme280_calib_prep *prep)
+{
+	double temperature = 0;
+	double pressure = 0;
+	double humidity = 0;
+
+	/* Temperature provides t_fine for the other two components */
+	if (sensor_comp & (BME280_PRESS | BME280_TEMP | BME280_HUM))
+		temperature = compensate_temperature_double(uncomp_data, calib_data, &prep->dbl);
+	if (sensor_comp & BME280_PRESS)
+		pressure = compensate_pressure_double(uncomp_data, calib_data, &prep->dbl);
+	if (sensor_comp & BME280_HUM)
+		humidity = compensate_humidity_double(uncomp_data, calib_data, &prep->dbl);
+
+	store_real_data(temperature, pressure, humidity, comp_data);
+}
+
+/*!
+ * @brief Compensation backend evaluating the floating point formulas in single
+ * precision.
+ */
+static void compensate_data_float(uint8_t sensor_comp, const struct bme280_uncomp_data *uncomp_data,
+				struct bme280_data *comp_data, struct bme280_calib_data *calib_data,
+				const struct bme280_calib_prep *prep)
+{
+	float temperature = 0;
+	float pressure = 0;
+	float humidity = 0;
+
+	if (sensor_comp & (BME280_PRESS | BME280_TEMP | BME280_HUM))
+		temperature = compensate_temperature_float(uncomp_data, calib_data, &prep->flt);
+	if (sensor_comp & BME280_PRESS)
+		pressure = compensate_pressure_float(uncomp_data, calib_data, &prep->flt);
+	if (sensor_comp & BME280_HUM)
+		humidity = compensate_humidity_float(uncomp_data, calib_data, &prep->flt);
+
+	store_real_data(temperature, pressure, humidity, comp_data);
+}
+
+/*!
+ * @brief Compensation backend using the 32 bit integer formulas.
+ */
+static void compensate_data_int32(uint8_t sensor_comp, const struct bme280_uncomp_data *uncomp_data,
+				struct bme280_data *comp_data, struct bme280_calib_data *calib_data,
+				const struct bme280_calib_prep *prep)
+{
+	int32_t temperature = 0;
+	uint32_t pressure = 0;
+	uint32_t humidity = 0;
+
+	if (sensor_comp & (BME280_PRESS | BME280_TEMP | BME280_HUM))
+		temperature = compensate_temperature_int32(uncomp_data, calib_data, &prep->i32);
+	if (sensor_comp & BME280_PRESS)
+		pressure = compensate_pressure_int32(uncomp_data, calib_data, &prep->i32);
+	if (sensor_comp & BME280_HUM)
+		humidity = compensate_humidity_int32(uncomp_data, calib_data, &prep->i32);
+
+	store_int_data(temperature, pressure, FALSE, humidity, comp_data);
+}
+
+/*!
+ * @brief Compensation backend using the 64 bit integer formula for pressure.
+ */
+static void compensate_data_int64(uint8_t sensor_comp, const struct bme280_uncomp_data *uncomp_data,
+				struct bme280_data *comp_data, struct bme280_calib_data *calib_data,
+				const struct bme280_calib_prep *prep)
+{
+	int32_t temperature = 0;
+	uint32_t pressure = 0;
+	uint32_t humidity = 0;
+
+	if (sensor_comp & (BME280_PRESS | BME280_TEMP | BME280_HUM))
+		temperature = compensate_temperature_int32(uncomp_data, calib_data, &prep->i32);
+	if (sensor_comp & BME280_PRESS)
+		pressure = compensate_pressure_int64(uncomp_data, calib_data);
+	if (sensor_comp & BME280_HUM)
+		humidity = compensate_humidity_int32(uncomp_data, calib_data, &prep->i32);
+
+	store_int_data(temperature, pressure, TRUE, humidity, comp_data);
+}
+
+/*!
+ * @brief This internal API stores floating point results in struct
+ * bme280_data.
+ */
+static void store_real_data(double temperature, double pressure, double humidity,
+				struct bme280_data *comp_data)
+{
 #ifdef FLOATING_POINT_REPRESENTATION
+	comp_data->temperature = temperature;
+	comp_data->pressure = pressure;
+	comp_data->humidity = humidity;
+#else
+	/* Round to the nearest step of the integer representation. The values
+	   were clipped to their valid (positive for pressure and humidity) range */
+	comp_data->temperature = (int32_t)(temperature * 100.0 + ((temperature < 0) ? -0.5 : 0.5));
+#ifdef MACHINE_64_BIT
+	comp_data->pressure = (uint32_t)(pressure * 100.0 + 0.5);
+#else
+	comp_data->pressure = (uint32_t)(pressure + 0.5);
+#endif
+	comp_data->humidity = (uint32_t)(humidity * 1024.0 + 0.5);
+#endif
+}
+
+/*!
+ * @brief This internal API stores integer results in struct bme280_data.
+ */
+static void store_int_data(int32_t temperature, uint32_t pressure, uint8_t press_centi,
+				uint32_t humidity, struct bme280_data *comp_data)
+{
+#ifdef FLOATING_POINT_REPRESENTATION
+	comp_data->temperature = ((double)temperature) / 100.0;
+	comp_data->pressure = press_centi ? (((double)pressure) / 100.0) : (double)pressure;
+	comp_data->humidity = ((double)humidity) / 1024.0;
+#else
+	comp_data->temperature = temperature;
+#ifdef MACHINE_64_BIT
+	comp_data->pressure = press_centi ? pressure : (pressure * 100);
+#else
+	comp_data->pressure = press_centi ? ((pressure + 50) / 100) : pressure;
+#endif
+	comp_data->humidity = humidity;
+#endif
+}
+
 /*!
  * @brief This internal API is used to compensate the raw temperature data and
  * return the compensated temperature data in double data type.
  */
-static double compensate_temperature(const struct bme280_uncomp_data *uncomp_data,
-						struct bme280_calib_data *calib_data)
+static double compensate_temperature_double(const struct bme280_uncomp_data *uncomp_data,
+						struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_double *prep)
 {
 	double var1;
 	double var2;
@@ -914,10 +1520,10 @@ static double compensate_temperature(const struct bme280_uncomp_data *uncomp_dat
 	double temperature_min = -40;
 	double temperature_max = 85;
 
-	var1 = ((double)uncomp_data->temperature) / 16384.0 - ((double)calib_data->dig_T1) / 1024.0;
-	var1 = var1 * ((double)calib_data->dig_T2);
-	var2 = (((double)uncomp_data->temperature) / 131072.0 - ((double)calib_data->dig_T1) / 8192.0);
-	var2 = (var2 * var2) * ((double)calib_data->dig_T3);
+	var1 = ((double)uncomp_data->temperature) / 16384.0 - prep->t1_1024;
+	var1 = var1 * prep->t2;
+	var2 = (((double)uncomp_data->temperature) / 131072.0 - prep->t1_8192);
+	var2 = (var2 * var2) * prep->t3;
 	calib_data->t_fine = (int32_t)(var1 + var2);
 	temperature = (var1 + var2) / 5120.0;
 
@@ -933,8 +1539,9 @@ static double compensate_temperature(const struct bme280_uncomp_data *uncomp_dat
  * @brief This internal API is used to compensate the raw pressure data and
  * return the compensated pressure data in double data type.
  */
-static double compensate_pressure(const struct bme280_uncomp_data *uncomp_data,
-						const struct bme280_calib_data *calib_data)
+static double compensate_pressure_double(const struct bme280_uncomp_data *uncomp_data,
+						const struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_double *prep)
 {
 	double var1;
 	double var2;
@@ -944,19 +1551,21 @@ static double compensate_pressure(const struct bme280_uncomp_data *uncomp_data,
 	double pressure_max = 110000.0;
 
 	var1 = ((double)calib_data->t_fine / 2.0) - 64000.0;
-	var2 = var1 * var1 * ((double)calib_data->dig_P6) / 32768.0;
-	var2 = var2 + var1 * ((double)calib_data->dig_P5) * 2.0;
-	var2 = (var2 / 4.0) + (((double)calib_data->dig_P4) * 65536.0);
-	var3 = ((double)calib_data->dig_P3) * var1 * var1 / 524288.0;
-	var1 = (var3 + ((double)calib_data->dig_P2) * var1) / 524288.0;
-	var1 = (1.0 + var1 / 32768.0) * ((double)calib_data->dig_P1);
-	/* avoid exception caused by division by zero */
+	var2 = var1 * var1 * prep->p6;
+	var2 = var2 + var1 * prep->p5;
+	var2 = (var2 / 4.0) + prep->p4;
+	/* p3 and p2 carry the / 524288 / 524288 / 32768 scaling */
+	var3 = prep->p3 * var1 * var1;
+	var1 = var3 + prep->p2 * var1;
+	var1 = (1.0 + var1) * prep->p1;
+	/* avoid exception caused by division by zero. The division by var1
+	   depends on t_fine and stays on the per-sample path */
 	if (var1) {
 		pressure = 1048576.0 - (double) uncomp_data->pressure;
 		pressure = (pressure - (var2 / 4096.0)) * 6250.0 / var1;
-		var1 = ((double)calib_data->dig_P9) * pressure * pressure / 2147483648.0;
-		var2 = pressure * ((double)calib_data->dig_P8) / 32768.0;
-		pressure = pressure + (var1 + var2 + ((double)calib_data->dig_P7)) / 16.0;
+		var1 = prep->p9 * pressure * pressure;
+		var2 = pressure * prep->p8;
+		pressure = pressure + (var1 + var2 + prep->p7) / 16.0;
 
 		if (pressure < pressure_min)
 			pressure = pressure_min;
@@ -973,8 +1582,9 @@ static double compensate_pressure(const struct bme280_uncomp_data *uncomp_data,
  * @brief This internal API is used to compensate the raw humidity data and
  * return the compensated humidity data in double data type.
  */
-static double compensate_humidity(const struct bme280_uncomp_data *uncomp_data,
-						const struct bme280_calib_data *calib_data)
+static double compensate_humidity_double(const struct bme280_uncomp_data *uncomp_data,
+						const struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_double *prep)
 {
 	double humidity;
 	double humidity_min = 0.0;
@@ -987,13 +1597,115 @@ static double compensate_humidity(const struct bme280_uncomp_data *uncomp_data,
 	double var6;
 
 	var1 = ((double)calib_data->t_fine) - 76800.0;
-	var2 = (((double)calib_data->dig_H4) * 64.0 + (((double)calib_data->dig_H5) / 16384.0) * var1);
+	var2 = (prep->h4 + prep->h5 * var1);
 	var3 = uncomp_data->humidity - var2;
-	var4 = ((double)calib_data->dig_H2) / 65536.0;
-	var5 = (1.0 + (((double)calib_data->dig_H3) / 67108864.0) * var1);
-	var6 = 1.0 + (((double)calib_data->dig_H6) / 67108864.0) * var1 * var5;
+	var4 = prep->h2;
+	var5 = (1.0 + prep->h3 * var1);
+	var6 = 1.0 + prep->h6 * var1 * var5;
 	var6 = var3 * var4 * (var5 * var6);
-	humidity = var6 * (1.0 - ((double)calib_data->dig_H1) * var6 / 524288.0);
+	humidity = var6 * (1.0 - prep->h1 * var6);
+
+	if (humidity > humidity_max)
+		humidity = humidity_max;
+	else if (humidity < humidity_min)
+		humidity = humidity_min;
+
+	return humidity;
+}
+
+/*!
+ * @brief This internal API is used to compensate the raw temperature data and
+ * return the compensated temperature data in float data type.
+ */
+static float compensate_temperature_float(const struct bme280_uncomp_data *uncomp_data,
+						struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_float *prep)
+{
+	float var1;
+	float var2;
+	float temperature;
+	float temperature_min = -40.0f;
+	float temperature_max = 85.0f;
+
+	/* Divisions by powers of two are exact multiplications */
+	var1 = ((float)uncomp_data->temperature) * (1.0f / 16384.0f) - prep->t1_1024;
+	var1 = var1 * prep->t2;
+	var2 = ((float)uncomp_data->temperature) * (1.0f / 131072.0f) - prep->t1_8192;
+	var2 = (var2 * var2) * prep->t3;
+	calib_data->t_fine = (int32_t)(var1 + var2);
+	temperature = (var1 + var2) * (1.0f / 5120.0f);
+
+	if (temperature < temperature_min)
+		temperature = temperature_min;
+	else if (temperature > temperature_max)
+		temperature = temperature_max;
+
+	return temperature;
+}
+
+/*!
+ * @brief This internal API is used to compensate the raw pressure data and
+ * return the compensated pressure data in float data type.
+ */
+static float compensate_pressure_float(const struct bme280_uncomp_data *uncomp_data,
+						const struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_float *prep)
+{
+	float var1;
+	float var2;
+	float var3;
+	float pressure;
+	float pressure_min = 30000.0f;
+	float pressure_max = 110000.0f;
+
+	var1 = ((float)calib_data->t_fine * 0.5f) - 64000.0f;
+	var2 = var1 * var1 * prep->p6;
+	var2 = var2 + var1 * prep->p5;
+	var2 = (var2 * 0.25f) + prep->p4;
+	var3 = prep->p3 * var1 * var1;
+	var1 = var3 + prep->p2 * var1;
+	var1 = (1.0f + var1) * prep->p1;
+	/* avoid exception caused by division by zero */
+	if (var1 != 0.0f) {
+		pressure = 1048576.0f - (float)uncomp_data->pressure;
+		pressure = (pressure - (var2 * (1.0f / 4096.0f))) * 6250.0f / var1;
+		var1 = prep->p9 * pressure * pressure;
+		var2 = pressure * prep->p8;
+		pressure = pressure + (var1 + var2 + prep->p7) * 0.0625f;
+
+		if (pressure < pressure_min)
+			pressure = pressure_min;
+		else if (pressure > pressure_max)
+			pressure = pressure_max;
+	} else { /* Invalid case */
+		pressure = pressure_min;
+	}
+
+	return pressure;
+}
+
+/*!
+ * @brief This internal API is used to compensate the raw humidity data and
+ * return the compensated humidity data in float data type.
+ */
+static float compensate_humidity_float(const struct bme280_uncomp_data *uncomp_data,
+						const struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_float *prep)
+{
+	float humidity;
+	float humidity_min = 0.0f;
+	float humidity_max = 100.0f;
+	float var1;
+	float var3;
+	float var5;
+	float var6;
+
+	var1 = ((float)calib_data->t_fine) - 76800.0f;
+	var3 = (float)uncomp_data->humidity - (prep->h4 + prep->h5 * var1);
+	var5 = 1.0f + prep->h3 * var1;
+	var6 = 1.0f + prep->h6 * var1 * var5;
+	var6 = var3 * prep->h2 * (var5 * var6);
+	humidity = var6 * (1.0f - prep->h1 * var6);
 
 	if (humidity > humidity_max)
 		humidity = humidity_max;
@@ -1003,13 +1715,13 @@ static double compensate_humidity(const struct bme280_uncomp_data *uncomp_data,
 	return humidity;
 }
 
-#else
 /*!
  * @brief This internal API is used to compensate the raw temperature data and
  * return the compensated temperature data in integer data type.
  */
-static int32_t compensate_temperature(const struct bme280_uncomp_data *uncomp_data,
-						struct bme280_calib_data *calib_data)
+static int32_t compensate_temperature_int32(const struct bme280_uncomp_data *uncomp_data,
+						struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_int *prep)
 {
 	int32_t var1;
 	int32_t var2;
@@ -1017,7 +1729,7 @@ static int32_t compensate_temperature(const struct bme280_uncomp_data *uncomp_da
 	int32_t temperature_min = -4000;
 	int32_t temperature_max = 8500;
 
-	var1 = (int32_t)((uncomp_data->temperature / 8) - ((int32_t)calib_data->dig_T1 * 2));
+	var1 = (int32_t)((uncomp_data->temperature / 8) - prep->t1_x2);
 	var1 = (var1 * ((int32_t)calib_data->dig_T2)) / 2048;
 	var2 = (int32_t)((uncomp_data->temperature / 16) - ((int32_t)calib_data->dig_T1));
 	var2 = (((var2 * var2) / 4096) * ((int32_t)calib_data->dig_T3)) / 16384;
@@ -1031,13 +1743,13 @@ static int32_t compensate_temperature(const struct bme280_uncomp_data *uncomp_da
 
 	return temperature;
 }
-#ifdef MACHINE_64_BIT
+
 /*!
  * @brief This internal API is used to compensate the raw pressure data and
  * return the compensated pressure data in integer data type with higher
  * accuracy.
  */
-static uint32_t compensate_pressure(const struct bme280_uncomp_data *uncomp_data,
+static uint32_t compensate_pressure_int64(const struct bme280_uncomp_data *uncomp_data,
 						const struct bme280_calib_data *calib_data)
 {
 	int64_t var1;
@@ -1075,13 +1787,14 @@ static uint32_t compensate_pressure(const struct bme280_uncomp_data *uncomp_data
 
 	return pressure;
 }
-#else
+
 /*!
  * @brief This internal API is used to compensate the raw pressure data and
  * return the compensated pressure data in integer data type.
  */
-static uint32_t compensate_pressure(const struct bme280_uncomp_data *uncomp_data,
-						const struct bme280_calib_data *calib_data)
+static uint32_t compensate_pressure_int32(const struct bme280_uncomp_data *uncomp_data,
+						const struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_int *prep)
 {
 	int32_t var1;
 	int32_t var2;
@@ -1095,7 +1808,7 @@ static uint32_t compensate_pressure(const struct bme280_uncomp_data *uncomp_data
 	var1 = (((int32_t)calib_data->t_fine) / 2) - (int32_t)64000;
 	var2 = (((var1 / 4) * (var1 / 4)) / 2048) * ((int32_t)calib_data->dig_P6);
 	var2 = var2 + ((var1 * ((int32_t)calib_data->dig_P5)) * 2);
-	var2 = (var2 / 4) + (((int32_t)calib_data->dig_P4) * 65536);
+	var2 = (var2 / 4) + prep->p4;
 	var3 = (calib_data->dig_P3 * (((var1 / 4) * (var1 / 4)) / 8192)) / 8;
 	var4 = (((int32_t)calib_data->dig_P2) * var1) / 2;
 	var1 = (var3 + var4) / 262144;
@@ -1123,14 +1836,14 @@ static uint32_t compensate_pressure(const struct bme280_uncomp_data *uncomp_data
 
 	return pressure;
 }
-#endif
 
 /*!
  * @brief This internal API is used to compensate the raw humidity data and
  * return the compensated humidity data in integer data type.
  */
-static uint32_t compensate_humidity(const struct bme280_uncomp_data *uncomp_data,
-						const struct bme280_calib_data *calib_data)
+static uint32_t compensate_humidity_int32(const struct bme280_uncomp_data *uncomp_data,
+						const struct bme280_calib_data *calib_data,
+						const struct bme280_calib_prep_int *prep)
 {
 	int32_t var1;
 	int32_t var2;
@@ -1142,7 +1855,7 @@ static uint32_t compensate_humidity(const struct bme280_uncomp_data *uncomp_data
 
 	var1 = calib_data->t_fine - ((int32_t)76800);
 	var2 = (int32_t)(uncomp_data->humidity * 16384);
-	var3 = (int32_t)(((int32_t)calib_data->dig_H4) * 1048576);
+	var3 = prep->h4;
 	var4 = ((int32_t)calib_data->dig_H5) * var1;
 	var5 = (((var2 - var3) - var4) + (int32_t)16384) / 32768;
 	var2 = (var1 * ((int32_t)calib_data->dig_H6)) / 1024;
@@ -1161,7 +1874,6 @@ static uint32_t compensate_humidity(const struct bme280_uncomp_data *uncomp_data
 
 	return humidity;
 }
-#endif
 
 /*!
  * @brief This internal API reads the calibration data from the sensor, parse
@@ -1189,6 +1901,8 @@ static int8_t get_calib_data(struct bme280_dev *dev)
 			/* Parse humidity calibration data and store it in
 			   device structure */
 			parse_humidity_calib_data(calib_data, dev);
+			/* Derive the coefficients used on every sample */
+			prepare_calib_data(dev);
 		}
 	}
 
@@ -1258,6 +1972,64 @@ static void parse_humidity_calib_data(const uint8_t *reg_data, struct bme280_dev
 	calib_data->dig_H6 = (int8_t)reg_data[6];
 }
 
+/*!
+ * @brief This internal API derives the prepared compensation coefficients
+ * from the calibration data in the device structure.
+ */
+static void prepare_calib_data(struct bme280_dev *dev)
+{
+	const struct bme280_calib_data *calib_data = &dev->calib_data;
+	struct bme280_calib_prep_double *dbl = &dev->calib_prep.dbl;
+	struct bme280_calib_prep_float *flt = &dev->calib_prep.flt;
+	struct bme280_calib_prep_int *i32 = &dev->calib_prep.i32;
+
+	/* All backends are prepared, so that switching between them is free */
+	dbl->t1_1024 = ((double)calib_data->dig_T1) / 1024.0;
+	dbl->t1_8192 = ((double)calib_data->dig_T1) / 8192.0;
+	dbl->t2 = (double)calib_data->dig_T2;
+	dbl->t3 = (double)calib_data->dig_T3;
+	dbl->p1 = (double)calib_data->dig_P1;
+	dbl->p2 = ((double)calib_data->dig_P2) / 17179869184.0;
+	dbl->p3 = ((double)calib_data->dig_P3) / 9007199254740992.0;
+	dbl->p4 = ((double)calib_data->dig_P4) * 65536.0;
+	dbl->p5 = ((double)calib_data->dig_P5) * 2.0;
+	dbl->p6 = ((double)calib_data->dig_P6) / 32768.0;
+	dbl->p7 = (double)calib_data->dig_P7;
+	dbl->p8 = ((double)calib_data->dig_P8) / 32768.0;
+	dbl->p9 = ((double)calib_data->dig_P9) / 2147483648.0;
+	dbl->h1 = ((double)calib_data->dig_H1) / 524288.0;
+	dbl->h2 = ((double)calib_data->dig_H2) / 65536.0;
+	dbl->h3 = ((double)calib_data->dig_H3) / 67108864.0;
+	dbl->h4 = ((double)calib_data->dig_H4) * 64.0;
+	dbl->h5 = ((double)calib_data->dig_H5) / 16384.0;
+	dbl->h6 = ((double)calib_data->dig_H6) / 67108864.0;
+
+	/* Rounded from the exact power of two scaled values */
+	flt->t1_1024 = (float)dbl->t1_1024;
+	flt->t1_8192 = (float)dbl->t1_8192;
+	flt->t2 = (float)dbl->t2;
+	flt->t3 = (float)dbl->t3;
+	flt->p1 = (float)dbl->p1;
+	flt->p2 = (float)dbl->p2;
+	flt->p3 = (float)dbl->p3;
+	flt->p4 = (float)dbl->p4;
+	flt->p5 = (float)dbl->p5;
+	flt->p6 = (float)dbl->p6;
+	flt->p7 = (float)dbl->p7;
+	flt->p8 = (float)dbl->p8;
+	flt->p9 = (float)dbl->p9;
+	flt->h1 = (float)dbl->h1;
+	flt->h2 = (float)dbl->h2;
+	flt->h3 = (float)dbl->h3;
+	flt->h4 = (float)dbl->h4;
+	flt->h5 = (float)dbl->h5;
+	flt->h6 = (float)dbl->h6;
+
+	i32->t1_x2 = (int32_t)calib_data->dig_T1 * 2;
+	i32->p4 = ((int32_t)calib_data->dig_P4) * 65536;
+	i32->h4 = (int32_t)(((int32_t)calib_data->dig_H4) * 1048576);
+}
+
 /*!
  * @brief This internal API is used to identify the settings which the user
  * wants to modify in the sensor.
@@ -181,6 +181,34 @@ int8_t bme280_get_sensor_mode(uint8_t *sensor_mode, const struct bme280_dev *dev
  */
 int8_t bme280_soft_reset(const struct bme280_dev *dev);
 
+/*!
+ * @brief This API reads the status register of the sensor. It is never
+ * answered from the register shadow.
+ *
+ * @param[out] status : Status register value. BME280_STATUS_MEAS_MSK is set
+ * while a conversion is running, BME280_STATUS_IM_UPDATE_MSK while the NVM
+ * data are copied to the image registers.
+ * @param[in] dev : Structure instance of bme280_dev.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / +ve value -> Warning / -ve value -> Error
+ */
+int8_t bme280_get_status(uint8_t *status, const struct bme280_dev *dev);
+
+/*!
+ * @brief This API calculates the duration of one conversion for the given
+ * oversampling settings, as given in datasheet section 9.1:
+ * t_meas,typ = 1 + [2 * T_osr] + [2 * P_osr + 0.5] + [2 * H_osr + 0.5] ms and
+ * t_meas,max = 1.25 + [2.3 * T_osr] + [2.3 * P_osr + 0.575] + [2.3 * H_osr + 0.575] ms,
+ * where the bracketed terms are left out for a skipped measurement.
+ *
+ * @param[in] settings : Oversampling settings.
+ * @param[in] bound : BME280_MEAS_TIME_TYP or BME280_MEAS_TIME_MAX.
+ *
+ * @return Conversion time in microseconds.
+ */
+uint32_t bme280_cal_meas_delay_us(const struct bme280_settings *settings, uint8_t bound);
+
 /*!
  * @brief This API reads the pressure, temperature and humidity data from the
  * sensor, compensates the data and store it in the bme280_data structure
@@ -204,6 +232,99 @@ int8_t bme280_soft_reset(const struct bme280_dev *dev);
  */
 int8_t bme280_get_sensor_data(uint8_t sensor_comp, struct bme280_data *comp_data, struct bme280_dev *dev);
 
+/*!
+ * @brief This API compensates raw data that were read earlier (or recorded)
+ * with the compensation backend and calibration data of the device.
+ *
+ * @param[in] sensor_comp : Components to compensate (BME280_PRESS,
+ * BME280_TEMP, BME280_HUM or BME280_ALL).
+ * @param[in] uncomp_data : The raw pressure, temperature and humidity data.
+ * @param[out] comp_data : Structure instance of bme280_data.
+ * @param[in] dev : Structure instance of bme280_dev.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / -ve value -> Error
+ */
+int8_t bme280_compensate_data(uint8_t sensor_comp, const struct bme280_uncomp_data *uncomp_data,
+				struct bme280_data *comp_data, struct bme280_dev *dev);
+
+/*!
+ * @brief This API selects the compensation backend of the device. Every
+ * backend is built in and stores its results in the units of struct
+ * bme280_data, so they can be swapped at run time.
+ *
+ * @param[in] backend : Compensation backend.
+ *
+ *    backend              |   Arithmetic
+ * ------------------------|--------------------------------------------------
+ *  BME280_COMP_DEFAULT    | Chosen by FLOATING_POINT_REPRESENTATION/MACHINE_64_BIT
+ *  BME280_COMP_DOUBLE     | Double precision (software emulated on Cortex-M4)
+ *  BME280_COMP_FLOAT      | Single precision (Cortex-M4 FPU)
+ *  BME280_COMP_INT32      | 32 bit integer
+ *  BME280_COMP_INT64      | 32 bit integer, 64 bit integer pressure
+ *
+ * @param[in,out] dev : Structure instance of bme280_dev.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / -ve value -> Error
+ */
+int8_t bme280_set_comp_backend(uint8_t backend, struct bme280_dev *dev);
+
+/*!
+ * @brief This API compensates a run of raw samples held as a structure of
+ * arrays with the 32 bit integer algorithms. Results are bit exact with
+ * the BME280_COMP_INT32 backend: temperature in 0.01 degC, pressure in Pa and
+ * humidity in 1/1024 %RH.
+ *
+ * @param[in] sensor_comp : Components to compensate (BME280_PRESS,
+ * BME280_TEMP, BME280_HUM or BME280_ALL).
+ * @param[in] uncomp : Raw samples. The temperature array is always needed.
+ * @param[out] comp : Output arrays for the selected components.
+ * @param[in] len : Number of samples.
+ * @param[in] calib_data : Trimming parameters of the sensor.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / -ve value -> Error
+ */
+int8_t bme280_compensate_batch_int32(uint8_t sensor_comp, const struct bme280_uncomp_batch *uncomp,
+				struct bme280_batch_int *comp, uint32_t len, const struct bme280_calib_data *calib_data);
+
+/*!
+ * @brief This API is the 64 bit integer flavour of
+ * bme280_compensate_batch_int32(). Pressure is returned in 0.01 Pa, bit
+ * exact with the BME280_COMP_INT64 backend; temperature and humidity are
+ * identical to the 32 bit flavour.
+ *
+ * @param[in] sensor_comp : Components to compensate.
+ * @param[in] uncomp : Raw samples. The temperature array is always needed.
+ * @param[out] comp : Output arrays for the selected components.
+ * @param[in] len : Number of samples.
+ * @param[in] calib_data : Trimming parameters of the sensor.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / -ve value -> Error
+ */
+int8_t bme280_compensate_batch_int64(uint8_t sensor_comp, const struct bme280_uncomp_batch *uncomp,
+				struct bme280_batch_int *comp, uint32_t len, const struct bme280_calib_data *calib_data);
+
+/*!
+ * @brief This API compensates a run of raw samples with the floating point
+ * algorithms evaluated in single precision, which maps onto the Cortex-M4
+ * FPU and onto SSE/AVX lanes on a host. Temperature in degC, pressure in Pa
+ * and humidity in %RH, clipped like the double precision driver path.
+ *
+ * @param[in] sensor_comp : Components to compensate.
+ * @param[in] uncomp : Raw samples. The temperature array is always needed.
+ * @param[out] comp : Output arrays for the selected components.
+ * @param[in] len : Number of samples.
+ * @param[in] calib_data : Trimming parameters of the sensor.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / -ve value -> Error
+ */
+int8_t bme280_compensate_batch_float(uint8_t sensor_comp, const struct bme280_uncomp_batch *uncomp,
+				struct bme280_batch_float *comp, uint32_t len, const struct bme280_calib_data *calib_data);
+
 #ifdef __cplusplus
 }
 #endif /* End of CPP guard */
@@ -0,0 +1,433 @@
+/*! @file bme280_batch.c
+    @brief Batch compensation of buffered BME280 raw samples */
+#include "bme280.h"
+
+/*!
+ * Samples are processed in blocks of BME280_BATCH_BLOCK_LEN: temperature
+ * first, which leaves t_fine for the block on the stack, then pressure and
+ * humidity. Every kernel is a straight loop over contiguous arrays with the
+ * trimming parameters hoisted into locals, so the compiler keeps them in
+ * registers and, where the arithmetic allows it, vectorizes the loop
+ * (SSE/AVX on a host, the single precision kernels stay in FPU registers on
+ * the Cortex-M4).
+ *
+ * The integer kernels repeat the driver expressions literally, including the
+ * signed divisions by powers of two, so the results are bit exact with
+ * bme280_get_sensor_data().
+ */
+
+#if defined(__GNUC__)
+#define BATCH_RESTRICT			__restrict__
+#else
+#define BATCH_RESTRICT
+#endif
+
+/*!
+ * @brief This internal API validates the arguments common to the batch APIs.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / -ve value -> Error
+ */
+static int8_t batch_args_check(uint8_t sensor_comp, const struct bme280_uncomp_batch *uncomp,
+				const void *press, const void *hum, const struct bme280_calib_data *calib_data);
+
+/*!
+ * @brief Integer temperature kernel. Always produces t_fine, writes the
+ * temperature only when @p out is not NULL.
+ */
+static void temperature_int32(const uint32_t *BATCH_RESTRICT adc, int32_t *BATCH_RESTRICT out,
+				int32_t *BATCH_RESTRICT t_fine, uint32_t len, const struct bme280_calib_data *calib_data);
+
+/*!
+ * @brief 32 bit integer pressure kernel.
+ */
+static void pressure_int32(const uint32_t *BATCH_RESTRICT adc, uint32_t *BATCH_RESTRICT out,
+				const int32_t *BATCH_RESTRICT t_fine, uint32_t len, const struct bme280_calib_data *calib_data);
+
+/*!
+ * @brief 64 bit integer pressure kernel.
+ */
+static void pressure_int64(const uint32_t *BATCH_RESTRICT adc, uint32_t *BATCH_RESTRICT out,
+				const int32_t *BATCH_RESTRICT t_fine, uint32_t len, const struct bme280_calib_data *calib_data);
+
+/*!
+ * @brief Integer humidity kernel.
+ */
+static void humidity_int32(const uint32_t *BATCH_RESTRICT adc, uint32_t *BATCH_RESTRICT out,
+				const int32_t *BATCH_RESTRICT t_fine, uint32_t len, const struct bme280_calib_data *calib_data);
+
+/*!
+ * @brief Single precision temperature kernel. Always produces t_fine, writes
+ * the temperature only when @p out is not NULL.
+ */
+static void temperature_float(const uint32_t *BATCH_RESTRICT adc, float *BATCH_RESTRICT out,
+				float *BATCH_RESTRICT t_fine, uint32_t len, const struct bme280_calib_data *calib_data);
+
+/*!
+ * @brief Single precision pressure kernel.
+ */
+static void pressure_float(const uint32_t *BATCH_RESTRICT adc, float *BATCH_RESTRICT out,
+				const float *BATCH_RESTRICT t_fine, uint32_t len, const struct bme280_calib_data *calib_data);
+
+/*!
+ * @brief Single precision humidity kernel.
+ */
+static void humidity_float(const uint32_t *BATCH_RESTRICT adc, float *BATCH_RESTRICT out,
+				const float *BATCH_RESTRICT t_fine, uint32_t len, const struct bme280_calib_data *calib_data);
+
+/****************** Global Function Definitions *******************************/
+
+/*!
+ * @brief This API compensates a run of raw samples with the 32 bit integer
+ * algorithms.
+ */
+int8_t bme280_compensate_batch_int32(uint8_t sensor_comp, const struct bme280_uncomp_batch *uncomp,
+				struct bme280_batch_int *comp, uint32_t len, const struct bme280_calib_data *calib_data)
+{
+	int8_t rslt;
+	int32_t t_fine[BME280_BATCH_BLOCK_LEN];
+	uint32_t done;
+	uint32_t block;
+
+	rslt = (comp != NULL) ? batch_args_check(sensor_comp, uncomp, comp->pressure, comp->humidity, calib_data)
+			: BME280_E_NULL_PTR;
+
+	for (done = 0; (rslt == BME280_OK) && (done < len); done += block) {
+		block = ((len - done) < BME280_BATCH_BLOCK_LEN) ? (len - done) : BME280_BATCH_BLOCK_LEN;
+		temperature_int32(&uncomp->temperature[done],
+				((sensor_comp & BME280_TEMP) && (comp->temperature != NULL)) ? &comp->temperature[done] : NULL,
+				t_fine, block, calib_data);
+		if (sensor_comp & BME280_PRESS)
+			pressure_int32(&uncomp->pressure[done], &comp->pressure[done], t_fine, block, calib_data);
+		if (sensor_comp & BME280_HUM)
+			humidity_int32(&uncomp->humidity[done], &comp->humidity[done], t_fine, block, calib_data);
+	}
+
+	return rslt;
+}
+
+/*!
+ * @brief This API compensates a run of raw samples with the 64 bit integer
+ * pressure algorithm.
+ */
+int8_t bme280_compensate_batch_int64(uint8_t sensor_comp, const struct bme280_uncomp_batch *uncomp,
+				struct bme280_batch_int *comp, uint32_t len, const struct bme280_calib_data *calib_data)
+{
+	int8_t rslt;
+	int32_t t_fine[BME280_BATCH_BLOCK_LEN];
+	uint32_t done;
+	uint32_t block;
+
+	rslt = (comp != NULL) ? batch_args_check(sensor_comp, uncomp, comp->pressure, comp->humidity, calib_data)
+			: BME280_E_NULL_PTR;
+
+	for (done = 0; (rslt == BME280_OK) && (done < len); done += block) {
+		block = ((len - done) < BME280_BATCH_BLOCK_LEN) ? (len - done) : BME280_BATCH_BLOCK_LEN;
+		temperature_int32(&uncomp->temperature[done],
+				((sensor_comp & BME280_TEMP) && (comp->temperature != NULL)) ? &comp->temperature[done] : NULL,
+				t_fine, block, calib_data);
+		if (sensor_comp & BME280_PRESS)
+			pressure_int64(&uncomp->pressure[done], &comp->pressure[done], t_fine, block, calib_data);
+		if (sensor_comp & BME280_HUM)
+			humidity_int32(&uncomp->humidity[done], &comp->humidity[done], t_fine, block, calib_data);
+	}
+
+	return rslt;
+}
+
+/*!
+ * @brief This API compensates a run of raw samples with the floating point
+ * algorithms in single precision.
+ */
+int8_t bme280_compensate_batch_float(uint8_t sensor_comp, const struct bme280_uncomp_batch *uncomp,
+				struct bme280_batch_float *comp, uint32_t len, const struct bme280_calib_data *calib_data)
+{
+	int8_t rslt;
+	float t_fine[BME280_BATCH_BLOCK_LEN];
+	uint32_t done;
+	uint32_t block;
+
+	rslt = (comp != NULL) ? batch_args_check(sensor_comp, uncomp, comp->pressure, comp->humidity, calib_data)
+			: BME280_E_NULL_PTR;
+
+	for (done = 0; (rslt == BME280_OK) && (done < len); done += block) {
+		block = ((len - done) < BME280_BATCH_BLOCK_LEN) ? (len - done) : BME280_BATCH_BLOCK_LEN;
+		temperature_float(&uncomp->temperature[done],
+				((sensor_comp & BME280_TEMP) && (comp->temperature != NULL)) ? &comp->temperature[done] : NULL,
+				t_fine, block, calib_data);
+		if (sensor_comp & BME280_PRESS)
+			pressure_float(&uncomp->pressure[done], &comp->pressure[done], t_fine, block, calib_data);
+		if (sensor_comp & BME280_HUM)
+			humidity_float(&uncomp->humidity[done], &comp->humidity[done], t_fine, block, calib_data);
+	}
+
+	return rslt;
+}
+
+/****************** Static Function Definitions *******************************/
+
+static int8_t batch_args_check(uint8_t sensor_comp, const struct bme280_uncomp_batch *uncomp,
+				const void *press, const void *hum, const struct bme280_calib_data *calib_data)
+{
+	int8_t rslt = BME280_OK;
+
+	if ((uncomp == NULL) || (calib_data == NULL) || (uncomp->temperature == NULL))
+		rslt = BME280_E_NULL_PTR;
+	else if ((sensor_comp & BME280_PRESS) && ((uncomp->pressure == NULL) || (press == NULL)))
+		rslt = BME280_E_NULL_PTR;
+	else if ((sensor_comp & BME280_HUM) && ((uncomp->humidity == NULL) || (hum == NULL)))
+		rslt = BME280_E_NULL_PTR;
+
+	return rslt;
+}
+
+static void temperature_int32(const uint32_t *BATCH_RESTRICT adc, int32_t *BATCH_RESTRICT out,
+				int32_t *BATCH_RESTRICT t_fine, uint32_t len, const struct bme280_calib_data *calib_data)
+{
+	const int32_t dig_t1 = (int32_t)calib_data->dig_T1;
+	const int32_t dig_t2 = (int32_t)calib_data->dig_T2;
+	const int32_t dig_t3 = (int32_t)calib_data->dig_T3;
+	int32_t var1;
+	int32_t var2;
+	int32_t temperature;
+	uint32_t i;
+
+	for (i = 0; i < len; i++) {
+		var1 = (int32_t)((adc[i] / 8) - (dig_t1 * 2));
+		var1 = (var1 * dig_t2) / 2048;
+		var2 = (int32_t)((adc[i] / 16) - dig_t1);
+		var2 = (((var2 * var2) / 4096) * dig_t3) / 16384;
+		t_fine[i] = var1 + var2;
+	}
+
+	if (out == NULL)
+		return;
+
+	for (i = 0; i < len; i++) {
+		temperature = (t_fine[i] * 5 + 128) / 256;
+		temperature = (temperature < -4000) ? -4000 : temperature;
+		temperature = (temperature > 8500) ? 8500 : temperature;
+		out[i] = temperature;
+	}
+}
+
+static void pressure_int32(const uint32_t *BATCH_RESTRICT adc, uint32_t *BATCH_RESTRICT out,
+				const int32_t *BATCH_RESTRICT t_fine, uint32_t len, const struct bme280_calib_data *calib_data)
+{
+	const int32_t dig_p1 = (int32_t)calib_data->dig_P1;
+	const int32_t dig_p2 = (int32_t)calib_data->dig_P2;
+	const int32_t dig_p3 = (int32_t)calib_data->dig_P3;
+	const int32_t dig_p4 = (int32_t)calib_data->dig_P4;
+	const int32_t dig_p5 = (int32_t)calib_data->dig_P5;
+	const int32_t dig_p6 = (int32_t)calib_data->dig_P6;
+	const int32_t dig_p7 = (int32_t)calib_data->dig_P7;
+	const int32_t dig_p8 = (int32_t)calib_data->dig_P8;
+	const int32_t dig_p9 = (int32_t)calib_data->dig_P9;
+	int32_t var1;
+	int32_t var2;
+	int32_t var3;
+	int32_t var4;
+	uint32_t var5;
+	uint32_t pressure;
+	uint32_t i;
+
+	for (i = 0; i < len; i++) {
+		var1 = (t_fine[i] / 2) - (int32_t)64000;
+		var2 = (((var1 / 4) * (var1 / 4)) / 2048) * dig_p6;
+		var2 = var2 + ((var1 * dig_p5) * 2);
+		var2 = (var2 / 4) + (dig_p4 * 65536);
+		var3 = (dig_p3 * (((var1 / 4) * (var1 / 4)) / 8192)) / 8;
+		var4 = (dig_p2 * var1) / 2;
+		var1 = (var3 + var4) / 262144;
+		var1 = ((32768 + var1) * dig_p1) / 32768;
+		if (var1) {
+			var5 = (uint32_t)((uint32_t)1048576) - adc[i];
+			pressure = ((uint32_t)(var5 - (uint32_t)(var2 / 4096))) * 3125;
+			if (pressure < 0x80000000)
+				pressure = (pressure << 1) / ((uint32_t)var1);
+			else
+				pressure = (pressure / (uint32_t)var1) * 2;
+			var1 = (dig_p9 * ((int32_t)(((pressure / 8) * (pressure / 8)) / 8192))) / 4096;
+			var2 = (((int32_t)(pressure / 4)) * dig_p8) / 8192;
+			pressure = (uint32_t)((int32_t)pressure + ((var1 + var2 + dig_p7) / 16));
+			pressure = (pressure < 30000) ? 30000 : pressure;
+			pressure = (pressure > 110000) ? 110000 : pressure;
+		} else {
+			pressure = 30000;
+		}
+		out[i] = pressure;
+	}
+}
+
+static void pressure_int64(const uint32_t *BATCH_RESTRICT adc, uint32_t *BATCH_RESTRICT out,
+				const int32_t *BATCH_RESTRICT t_fine, uint32_t len, const struct bme280_calib_data *calib_data)
+{
+	const int64_t dig_p1 = (int64_t)calib_data->dig_P1;
+	const int64_t dig_p2 = (int64_t)calib_data->dig_P2;
+	const int64_t dig_p3 = (int64_t)calib_data->dig_P3;
+	const int64_t dig_p4 = (int64_t)calib_data->dig_P4;
+	const int64_t dig_p5 = (int64_t)calib_data->dig_P5;
+	const int64_t dig_p6 = (int64_t)calib_data->dig_P6;
+	const int64_t dig_p7 = (int64_t)calib_data->dig_P7;
+	const int64_t dig_p8 = (int64_t)calib_data->dig_P8;
+	const int64_t dig_p9 = (int64_t)calib_data->dig_P9;
+	int64_t var1;
+	int64_t var2;
+	int64_t var4;
+	uint32_t pressure;
+	uint32_t i;
+
+	for (i = 0; i < len; i++) {
+		var1 = ((int64_t)t_fine[i]) - 128000;
+		var2 = var1 * var1 * dig_p6;
+		var2 = var2 + ((var1 * dig_p5) * 131072);
+		var2 = var2 + (dig_p4 * INT64_C(34359738368));
+		var1 = ((var1 * var1 * dig_p3) / 256) + ((var1 * dig_p2) * 4096);
+		var1 = (INT64_C(140737488355328) + var1) * dig_p1 / INT64_C(8589934592);
+		if (var1 != 0) {
+			var4 = 1048576 - (int64_t)adc[i];
+			var4 = (((var4 * INT64_C(2147483648)) - var2) * 3125) / var1;
+			var1 = (dig_p9 * (var4 / 8192) * (var4 / 8192)) / 33554432;
+			var2 = (dig_p8 * var4) / 524288;
+			var4 = ((var4 + var1 + var2) / 256) + (dig_p7 * 16);
+			pressure = (uint32_t)(((var4 / 2) * 100) / 128);
+			pressure = (pressure < 3000000) ? 3000000 : pressure;
+			pressure = (pressure > 11000000) ? 11000000 : pressure;
+		} else {
+			pressure = 3000000;
+		}
+		out[i] = pressure;
+	}
+}
+
+static void humidity_int32(const uint32_t *BATCH_RESTRICT adc, uint32_t *BATCH_RESTRICT out,
+				const int32_t *BATCH_RESTRICT t_fine, uint32_t len, const struct bme280_calib_data *calib_data)
+{
+	const int32_t dig_h1 = (int32_t)calib_data->dig_H1;
+	const int32_t dig_h2 = (int32_t)calib_data->dig_H2;
+	const int32_t dig_h3 = (int32_t)calib_data->dig_H3;
+	const int32_t dig_h4 = (int32_t)calib_data->dig_H4 * 1048576;
+	const int32_t dig_h5 = (int32_t)calib_data->dig_H5;
+	const int32_t dig_h6 = (int32_t)calib_data->dig_H6;
+	int32_t var1;
+	int32_t var2;
+	int32_t var3;
+	int32_t var4;
+	int32_t var5;
+	uint32_t humidity;
+	uint32_t i;
+
+	for (i = 0; i < len; i++) {
+		var1 = t_fine[i] - ((int32_t)76800);
+		var2 = (int32_t)(adc[i] * 16384);
+		var4 = dig_h5 * var1;
+		var5 = (((var2 - dig_h4) - var4) + (int32_t)16384) / 32768;
+		var2 = (var1 * dig_h6) / 1024;
+		var3 = (var1 * dig_h3) / 2048;
+		var4 = ((var2 * (var3 + (int32_t)32768)) / 1024) + (int32_t)2097152;
+		var2 = ((var4 * dig_h2) + 8192) / 16384;
+		var3 = var5 * var2;
+		var4 = ((var3 / 32768) * (var3 / 32768)) / 128;
+		var5 = var3 - ((var4 * dig_h1) / 16);
+		var5 = (var5 < 0) ? 0 : var5;
+		var5 = (var5 > 419430400) ? 419430400 : var5;
+		humidity = (uint32_t)(var5 / 4096);
+		out[i] = (humidity > 100000) ? 100000 : humidity;
+	}
+}
+
+static void temperature_float(const uint32_t *BATCH_RESTRICT adc, float *BATCH_RESTRICT out,
+				float *BATCH_RESTRICT t_fine, uint32_t len, const struct bme280_calib_data *calib_data)
+{
+	const float dig_t1_1024 = (float)calib_data->dig_T1 / 1024.0f;
+	const float dig_t1_8192 = (float)calib_data->dig_T1 / 8192.0f;
+	const float dig_t2 = (float)calib_data->dig_T2;
+	const float dig_t3 = (float)calib_data->dig_T3;
+	float var1;
+	float var2;
+	float temperature;
+	uint32_t i;
+
+	for (i = 0; i < len; i++) {
+		var1 = ((float)adc[i] * (1.0f / 16384.0f) - dig_t1_1024) * dig_t2;
+		var2 = (float)adc[i] * (1.0f / 131072.0f) - dig_t1_8192;
+		var2 = (var2 * var2) * dig_t3;
+		/* Pressure and humidity use the truncated value, as in the
+		   double precision driver path */
+		t_fine[i] = (float)(int32_t)(var1 + var2);
+		if (out != NULL) {
+			temperature = (var1 + var2) * (1.0f / 5120.0f);
+			temperature = (temperature < -40.0f) ? -40.0f : temperature;
+			temperature = (temperature > 85.0f) ? 85.0f : temperature;
+			out[i] = temperature;
+		}
+	}
+}
+
+static void pressure_float(const uint32_t *BATCH_RESTRICT adc, float *BATCH_RESTRICT out,
+				const float *BATCH_RESTRICT t_fine, uint32_t len, const struct bme280_calib_data *calib_data)
+{
+	const float dig_p1 = (float)calib_data->dig_P1;
+	const float dig_p2 = (float)calib_data->dig_P2;
+	const float dig_p3 = (float)calib_data->dig_P3;
+	const float dig_p4 = (float)calib_data->dig_P4 * 65536.0f;
+	const float dig_p5 = (float)calib_data->dig_P5 * 2.0f;
+	const float dig_p6 = (float)calib_data->dig_P6 / 32768.0f;
+	const float dig_p7 = (float)calib_data->dig_P7;
+	const float dig_p8 = (float)calib_data->dig_P8 / 32768.0f;
+	const float dig_p9 = (float)calib_data->dig_P9 / 2147483648.0f;
+	float var1;
+	float var2;
+	float var3;
+	float pressure;
+	uint32_t i;
+
+	for (i = 0; i < len; i++) {
+		var1 = (t_fine[i] * 0.5f) - 64000.0f;
+		var2 = var1 * var1 * dig_p6;
+		var2 = var2 + var1 * dig_p5;
+		var2 = (var2 * 0.25f) + dig_p4;
+		var3 = dig_p3 * var1 * var1 * (1.0f / 524288.0f);
+		var1 = (var3 + dig_p2 * var1) * (1.0f / 524288.0f);
+		var1 = (1.0f + var1 * (1.0f / 32768.0f)) * dig_p1;
+		pressure = 1048576.0f - (float)adc[i];
+		pressure = (pressure - (var2 * (1.0f / 4096.0f))) * 6250.0f / var1;
+		var3 = dig_p9 * pressure * pressure;
+		var2 = pressure * dig_p8;
+		pressure = pressure + (var3 + var2 + dig_p7) * (1.0f / 16.0f);
+		pressure = (pressure < 30000.0f) ? 30000.0f : pressure;
+		pressure = (pressure > 110000.0f) ? 110000.0f : pressure;
+		/* Division by zero: select instead of branch to keep the loop
+		   vectorizable */
+		out[i] = (var1 != 0.0f) ? pressure : 30000.0f;
+	}
+}
+
+static void humidity_float(const uint32_t *BATCH_RESTRICT adc, float *BATCH_RESTRICT out,
+				const float *BATCH_RESTRICT t_fine, uint32_t len, const struct bme280_calib_data *calib_data)
+{
+	const float dig_h1 = (float)calib_data->dig_H1 / 524288.0f;
+	const float dig_h2 = (float)calib_data->dig_H2 / 65536.0f;
+	const float dig_h3 = (float)calib_data->dig_H3 / 67108864.0f;
+	const float dig_h4 = (float)calib_data->dig_H4 * 64.0f;
+	const float dig_h5 = (float)calib_data->dig_H5 / 16384.0f;
+	const float dig_h6 = (float)calib_data->dig_H6 / 67108864.0f;
+	float var1;
+	float var3;
+	float var5;
+	float var6;
+	float humidity;
+	uint32_t i;
+
+	for (i = 0; i < len; i++) {
+		var1 = t_fine[i] - 76800.0f;
+		var3 = (float)adc[i] - (dig_h4 + dig_h5 * var1);
+		var5 = 1.0f + dig_h3 * var1;
+		var6 = 1.0f + dig_h6 * var1 * var5;
+		var6 = var3 * dig_h2 * (var5 * var6);
+		humidity = var6 * (1.0f - dig_h1 * var6);
+		humidity = (humidity > 100.0f) ? 100.0f : humidity;
+		humidity = (humidity < 0.0f) ? 0.0f : humidity;
+		out[i] = humidity;
+	}
+}
@@ -120,8 +120,12 @@
 #endif
 #endif
 
+/* Layout of struct bme280_data and the BME280_COMP_DEFAULT backend: floating point unless the
+ * build defines BME280_INTEGER_REPRESENTATION, then integer with 64 bit pressure when it also
+ * defines MACHINE_64_BIT */
+#if !defined(FLOATING_POINT_REPRESENTATION) && !defined(BME280_INTEGER_REPRESENTATION)
 #define FLOATING_POINT_REPRESENTATION
-//#define MACHINE_64_BIT
+#endif
 
 #ifndef TRUE
 #define TRUE                UINT8_C(1)
@@ -144,6 +148,7 @@
 #define BME280_HUMIDITY_CALIB_DATA_ADDR		UINT8_C(0xE1)
 #define BME280_PWR_CTRL_ADDR			UINT8_C(0xF4)
 #define BME280_CTRL_HUM_ADDR			UINT8_C(0xF2)
+#define BME280_STATUS_ADDR			UINT8_C(0xF3)
 #define BME280_CTRL_MEAS_ADDR			UINT8_C(0xF4)
 #define BME280_CONFIG_ADDR			UINT8_C(0xF5)
 #define BME280_DATA_ADDR			UINT8_C(0xF7)
@@ -156,6 +161,7 @@
 #define BME280_E_INVALID_LEN			INT8_C(-3)
 #define BME280_E_COMM_FAIL			INT8_C(-4)
 #define BME280_E_SLEEP_MODE_FAIL		INT8_C(-5)
+#define BME280_E_INVALID_BACKEND		INT8_C(-6)
 /**\name API warning codes */
 #define BME280_W_INVALID_OSR_MACRO		UINT8_C(1)
 
@@ -163,6 +169,31 @@
 #define BME280_TEMP_PRESS_CALIB_DATA_LEN	UINT8_C(26)
 #define BME280_HUMIDITY_CALIB_DATA_LEN		UINT8_C(7)
 #define BME280_P_T_H_DATA_LEN			UINT8_C(8)
+/* Samples compensated per inner block by the batch APIs */
+#define BME280_BATCH_BLOCK_LEN			UINT8_C(32)
+
+/**\name Register shadow slots */
+#define BME280_SHADOW_CTRL_HUM			UINT8_C(0)
+#define BME280_SHADOW_CTRL_MEAS			UINT8_C(1)
+#define BME280_SHADOW_CONFIG			UINT8_C(2)
+#define BME280_SHADOW_LEN			UINT8_C(3)
+#define BME280_SHADOW_ALL_VALID			UINT8_C(0x07)
+
+/**\name Measurement time bounds */
+#define BME280_MEAS_TIME_TYP			UINT8_C(0)
+#define BME280_MEAS_TIME_MAX			UINT8_C(1)
+
+/**\name Compensation backends
+ * BME280_COMP_DEFAULT is the backend chosen by FLOATING_POINT_REPRESENTATION
+ * and MACHINE_64_BIT. Whatever the backend, results are stored in the units of
+ * struct bme280_data.
+ */
+#define BME280_COMP_DEFAULT			UINT8_C(0)
+#define BME280_COMP_DOUBLE			UINT8_C(1)
+#define BME280_COMP_FLOAT			UINT8_C(2)
+#define BME280_COMP_INT32			UINT8_C(3)
+#define BME280_COMP_INT64			UINT8_C(4)
+#define BME280_COMP_BACKEND_MAX			UINT8_C(5)
 
 /**\name Sensor power modes */
 #define	BME280_SLEEP_MODE			UINT8_C(0x00)
@@ -202,6 +233,9 @@
 #define BME280_STANDBY_MSK		UINT8_C(0xE0)
 #define BME280_STANDBY_POS		UINT8_C(0x05)
 
+#define BME280_STATUS_IM_UPDATE_MSK	UINT8_C(0x01)
+#define BME280_STATUS_MEAS_MSK		UINT8_C(0x08)
+
 /**\name Sensor component selection macros
    These values are internal for API implementation. Don't relate this to
    data sheet.*/
@@ -291,6 +325,111 @@ struct bme280_calib_data {
 /**@}*/
 };
 
+/*!
+ * @brief Coefficients of the double precision backend, derived once from the
+ * trimming parameters so the compensation formulas only have to multiply and
+ * add per sample. Every scale factor is a power of two, which keeps the
+ * results bit exact with the formulas written out in the datasheet.
+ */
+struct bme280_calib_prep_double {
+	/*! dig_T1 / 1024 */
+	double t1_1024;
+	/*! dig_T1 / 8192 */
+	double t1_8192;
+	double t2;
+	double t3;
+	double p1;
+	/*! dig_P2 / 2^34 */
+	double p2;
+	/*! dig_P3 / 2^53 */
+	double p3;
+	/*! dig_P4 * 65536 */
+	double p4;
+	/*! dig_P5 * 2 */
+	double p5;
+	/*! dig_P6 / 32768 */
+	double p6;
+	double p7;
+	/*! dig_P8 / 32768 */
+	double p8;
+	/*! dig_P9 / 2^31 */
+	double p9;
+	/*! dig_H1 / 524288 */
+	double h1;
+	/*! dig_H2 / 65536 */
+	double h2;
+	/*! dig_H3 / 2^26 */
+	double h3;
+	/*! dig_H4 * 64 */
+	double h4;
+	/*! dig_H5 / 16384 */
+	double h5;
+	/*! dig_H6 / 2^26 */
+	double h6;
+};
+
+/*!
+ * @brief Coefficients of the single precision backend, the values of
+ * bme280_calib_prep_double rounded to float.
+ */
+struct bme280_calib_prep_float {
+	/*! dig_T1 / 1024 */
+	float t1_1024;
+	/*! dig_T1 / 8192 */
+	float t1_8192;
+	float t2;
+	float t3;
+	float p1;
+	/*! dig_P2 / 2^34 */
+	float p2;
+	/*! dig_P3 / 2^53 */
+	float p3;
+	/*! dig_P4 * 65536 */
+	float p4;
+	/*! dig_P5 * 2 */
+	float p5;
+	/*! dig_P6 / 32768 */
+	float p6;
+	float p7;
+	/*! dig_P8 / 32768 */
+	float p8;
+	/*! dig_P9 / 2^31 */
+	float p9;
+	/*! dig_H1 / 524288 */
+	float h1;
+	/*! dig_H2 / 65536 */
+	float h2;
+	/*! dig_H3 / 2^26 */
+	float h3;
+	/*! dig_H4 * 64 */
+	float h4;
+	/*! dig_H5 / 16384 */
+	float h5;
+	/*! dig_H6 / 2^26 */
+	float h6;
+};
+
+/*!
+ * @brief Coefficients of the integer backends.
+ */
+struct bme280_calib_prep_int {
+	/*! dig_T1 * 2 */
+	int32_t t1_x2;
+	/*! dig_P4 * 65536 */
+	int32_t p4;
+	/*! dig_H4 * 1048576 */
+	int32_t h4;
+};
+
+/*!
+ * @brief Prepared coefficients of all compensation backends
+ */
+struct bme280_calib_prep {
+	struct bme280_calib_prep_double dbl;
+	struct bme280_calib_prep_float flt;
+	struct bme280_calib_prep_int i32;
+};
+
 /*!
  * @brief bme280 sensor structure which comprises of temperature, pressure and
  * humidity data
@@ -328,6 +467,45 @@ struct bme280_uncomp_data {
 	uint32_t humidity;
 };
 
+/*!
+ * @brief Structure of arrays holding a run of uncompensated samples for the
+ * batch compensation APIs. Element i of each array belongs to sample i.
+ */
+struct bme280_uncomp_batch {
+	/*! un-compensated pressure */
+	const uint32_t *pressure;
+	/*! un-compensated temperature, always required */
+	const uint32_t *temperature;
+	/*! un-compensated humidity */
+	const uint32_t *humidity;
+};
+
+/*!
+ * @brief Structure of arrays receiving integer batch compensation results.
+ * Arrays of components which are not selected may be NULL.
+ */
+struct bme280_batch_int {
+	/*! Compensated pressure */
+	uint32_t *pressure;
+	/*! Compensated temperature */
+	int32_t *temperature;
+	/*! Compensated humidity */
+	uint32_t *humidity;
+};
+
+/*!
+ * @brief Structure of arrays receiving single precision batch compensation
+ * results. Arrays of components which are not selected may be NULL.
+ */
+struct bme280_batch_float {
+	/*! Compensated pressure in Pa */
+	float *pressure;
+	/*! Compensated temperature in degC */
+	float *temperature;
+	/*! Compensated humidity in %RH */
+	float *humidity;
+};
+
 /*!
  * @brief bme280 sensor settings structure which comprises of mode,
  * oversampling and filter settings.
@@ -345,6 +523,21 @@ struct bme280_settings {
 	uint8_t standby_time;
 };
 
+/*!
+ * @brief Write-through shadow of the ctrl_hum, ctrl_meas and config
+ * registers. Reads of those registers are answered from here instead of the
+ * bus, except ctrl_meas while a forced conversion may be returning the
+ * sensor to sleep. The status register is never shadowed.
+ */
+struct bme280_shadow {
+	/*! Register contents, indexed by the BME280_SHADOW_* slots */
+	uint8_t regs[BME280_SHADOW_LEN];
+	/*! Bit n set when slot n holds the sensor's value */
+	uint8_t valid;
+	/*! Bus reads answered from the shadow */
+	uint32_t reads_saved;
+};
+
 /*!
  * @brief bme280 device structure
  */
@@ -363,8 +556,14 @@ struct bme280_dev {
 	bme280_delay_fptr_t delay_ms;
 	/*! Trim data */
 	struct bme280_calib_data calib_data;
+	/*! Coefficients derived from the trim data */
+	struct bme280_calib_prep calib_prep;
 	/*! Sensor settings */
 	struct bme280_settings settings;
+	/*! Optional register shadow, NULL to always read from the bus */
+	struct bme280_shadow *shadow;
+	/*! Compensation backend (BME280_COMP_...), zero for the build default */
+	uint8_t comp_backend;
 };
 
 #endif /* BME280_DEFS_H_ */
@@ -0,0 +1,672 @@
+/*! @file bme280_sim.c
+    @brief Register level BME280 simulator for board-less builds */
+#include <math.h>
+#include <string.h>
+#include "bme280_sim.h"
+
+#ifndef M_PI
+#define M_PI				3.14159265358979323846
+#endif
+
+/**\name Internal macros */
+/* Soft reset command written to BME280_RESET_ADDR */
+#define SIM_SOFT_RESET_CMD		UINT8_C(0xB6)
+/* NVM copy time after power-on or soft reset, datasheet t_startup */
+#define SIM_NVM_COPY_US			UINT32_C(2000)
+/* Raw code reported for a skipped pressure/temperature channel */
+#define SIM_SKIPPED_PT			UINT32_C(0x80000)
+/* Raw code reported for a skipped humidity channel */
+#define SIM_SKIPPED_H			UINT32_C(0x8000)
+/* Largest raw codes */
+#define SIM_RAW_PT_MAX			UINT32_C(0xFFFFF)
+#define SIM_RAW_H_MAX			UINT32_C(0xFFFF)
+/* Normal mode cycles replayed after a long clock jump; older ones would be
+   overwritten anyway and only matter for the IIR filter history */
+#define SIM_MAX_CATCHUP_CYCLES		UINT32_C(64)
+
+/*!
+ * @brief Registered simulator instances, looked up by device id from the
+ * bus callbacks which carry no other context.
+ */
+static struct bme280_sim *sim_devices[BME280_SIM_MAX_DEVICES];
+
+/*!
+ * @brief Virtual clock shared by all instances.
+ */
+static uint64_t sim_now_us;
+
+/*!
+ * @brief Normal mode standby durations in microseconds indexed by the
+ * t_sb field of the config register.
+ */
+static const uint32_t sim_standby_us[8] = {
+	500, 62500, 125000, 250000, 500000, 1000000, 10000, 20000
+};
+
+/*!
+ * @brief This internal API returns the number of samples averaged for an
+ * oversampling macro, or zero when the channel is skipped.
+ */
+static uint32_t osr_count(uint8_t osr);
+
+/*!
+ * @brief This internal API finds the registered instance for a device id.
+ */
+static struct bme280_sim *find_sim(uint8_t dev_id);
+
+/*!
+ * @brief This internal API loads the power-on register contents.
+ */
+static void power_on_reset(struct bme280_sim *sim);
+
+/*!
+ * @brief This internal API writes the trimming parameters into the
+ * calibration register blocks.
+ */
+static void store_calib(struct bme280_sim *sim);
+
+/*!
+ * @brief This internal API brings the instance up to the current virtual
+ * time, completing any conversion that ended in the meantime.
+ */
+static void update(struct bme280_sim *sim);
+
+/*!
+ * @brief This internal API runs one conversion and latches the result into
+ * the data registers.
+ */
+static void convert(struct bme280_sim *sim, uint64_t at_us);
+
+/*!
+ * @brief This internal API handles a single register write.
+ */
+static void write_reg(struct bme280_sim *sim, uint8_t reg_addr, uint8_t value);
+
+/*!
+ * @brief This internal API evaluates a trace at the given time.
+ */
+static double trace_value(const struct bme280_sim_trace *trace, uint64_t time_us);
+
+/*!
+ * @brief This internal API returns a standard normal random number.
+ */
+static double gaussian(struct bme280_sim *sim);
+
+/*!
+ * @brief Forward compensation, identical to the double precision driver
+ * path without output clipping, used to invert the transfer functions.
+ */
+static double forward_temperature(uint32_t adc_t, const struct bme280_calib_data *calib, int32_t *t_fine);
+static double forward_pressure(uint32_t adc_p, const struct bme280_calib_data *calib, int32_t t_fine);
+static double forward_humidity(uint32_t adc_h, const struct bme280_calib_data *calib, int32_t t_fine);
+static double forward_temperature_code(uint32_t adc_t, const struct bme280_calib_data *calib, int32_t t_fine);
+
+/*!
+ * @brief This internal API finds the raw code whose compensated value is
+ * closest to the target. The transfer functions are monotonic over the
+ * operating range, so a bisection over the code space is sufficient.
+ */
+static uint32_t invert(double target, uint32_t max_code, uint8_t rising, const struct bme280_calib_data *calib,
+		int32_t t_fine, double (*fwd)(uint32_t, const struct bme280_calib_data *, int32_t));
+
+/****************** Global Function Definitions *******************************/
+
+void bme280_sim_set_defaults(struct bme280_sim *sim, uint8_t id, enum bme280_intf interface)
+{
+	struct bme280_calib_data *calib;
+
+	if (sim == NULL)
+		return;
+
+	memset(sim, 0, sizeof(*sim));
+	sim->id = id;
+	sim->interface = interface;
+
+	/* Trimming parameters from the datasheet compensation example, humidity
+	   from a production part */
+	calib = &sim->calib;
+	calib->dig_T1 = 27504;
+	calib->dig_T2 = 26435;
+	calib->dig_T3 = -1000;
+	calib->dig_P1 = 36477;
+	calib->dig_P2 = -10685;
+	calib->dig_P3 = 3024;
+	calib->dig_P4 = 2855;
+	calib->dig_P5 = 140;
+	calib->dig_P6 = -7;
+	calib->dig_P7 = 15500;
+	calib->dig_P8 = -14600;
+	calib->dig_P9 = 6000;
+	calib->dig_H1 = 75;
+	calib->dig_H2 = 370;
+	calib->dig_H3 = 0;
+	calib->dig_H4 = 299;
+	calib->dig_H5 = 50;
+	calib->dig_H6 = 30;
+
+	/* Indoor environment with datasheet RMS noise at 1x oversampling */
+	sim->temperature.base = 22.0;
+	sim->temperature.noise = 0.01;
+	sim->pressure.base = 101325.0;
+	sim->pressure.noise = 3.3;
+	sim->humidity.base = 45.0;
+	sim->humidity.noise = 0.02;
+
+	sim->seed = 0x2545F491;
+}
+
+int8_t bme280_sim_init(struct bme280_sim *sim)
+{
+	int8_t rslt = BME280_E_DEV_NOT_FOUND;
+	uint8_t i;
+
+	if (sim == NULL)
+		return BME280_E_NULL_PTR;
+
+	/* Replace an instance with the same id, otherwise take a free slot */
+	for (i = 0; i < BME280_SIM_MAX_DEVICES; i++) {
+		if ((sim_devices[i] != NULL) && (sim_devices[i]->id == sim->id)) {
+			sim_devices[i] = sim;
+			rslt = BME280_OK;
+			break;
+		}
+	}
+	for (i = 0; (rslt != BME280_OK) && (i < BME280_SIM_MAX_DEVICES); i++) {
+		if (sim_devices[i] == NULL) {
+			sim_devices[i] = sim;
+			rslt = BME280_OK;
+		}
+	}
+
+	if (rslt == BME280_OK) {
+		sim->prng = (sim->seed != 0) ? sim->seed : 1;
+		sim->reads = 0;
+		sim->writes = 0;
+		sim->bytes = 0;
+		sim->conversions = 0;
+		power_on_reset(sim);
+	}
+
+	return rslt;
+}
+
+void bme280_sim_deinit(struct bme280_sim *sim)
+{
+	uint8_t i;
+
+	for (i = 0; i < BME280_SIM_MAX_DEVICES; i++) {
+		if (sim_devices[i] == sim)
+			sim_devices[i] = NULL;
+	}
+}
+
+void bme280_sim_attach(const struct bme280_sim *sim, struct bme280_dev *dev)
+{
+	if ((sim == NULL) || (dev == NULL))
+		return;
+
+	dev->id = sim->id;
+	dev->interface = sim->interface;
+	dev->read = bme280_sim_read;
+	dev->write = bme280_sim_write;
+	dev->delay_ms = bme280_sim_delay_ms;
+}
+
+int8_t bme280_sim_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len)
+{
+	struct bme280_sim *sim = find_sim(dev_id);
+	uint16_t i;
+	uint16_t reg;
+
+	if ((sim == NULL) || (data == NULL))
+		return BME280_E_COMM_FAIL;
+
+	update(sim);
+
+	/* Status is derived from the conversion and NVM copy state */
+	sim->regs[BME280_STATUS_ADDR] = (sim->measuring ? BME280_STATUS_MEAS_MSK : 0) |
+			((sim_now_us < sim->nvm_end_us) ? BME280_STATUS_IM_UPDATE_MSK : 0);
+
+	/* All registers live at 0x80 and above, bit 7 is the SPI read flag */
+	reg = reg_addr | 0x80;
+	for (i = 0; i < len; i++, reg++)
+		data[i] = (reg < BME280_SIM_REG_COUNT) ? sim->regs[reg] : 0xFF;
+
+	sim->reads++;
+	sim->bytes += len + 1;
+	sim_now_us += (uint64_t)sim->bus_us_per_byte * (len + 1);
+
+	return BME280_OK;
+}
+
+int8_t bme280_sim_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len)
+{
+	struct bme280_sim *sim = find_sim(dev_id);
+	uint16_t i;
+
+	if ((sim == NULL) || (data == NULL) || (len == 0))
+		return BME280_E_COMM_FAIL;
+
+	update(sim);
+
+	/* SPI clears bit 7 to flag a write, all registers live at 0x80 and
+	   above. Burst writes interleave further address/data pairs. */
+	write_reg(sim, reg_addr | 0x80, data[0]);
+	for (i = 1; (i + 1) < len; i += 2)
+		write_reg(sim, data[i] | 0x80, data[i + 1]);
+
+	sim->writes++;
+	sim->bytes += len + 1;
+	sim_now_us += (uint64_t)sim->bus_us_per_byte * (len + 1);
+
+	return BME280_OK;
+}
+
+void bme280_sim_delay_ms(uint32_t period)
+{
+	sim_now_us += (uint64_t)period * 1000;
+}
+
+void bme280_sim_advance_us(uint64_t period_us)
+{
+	sim_now_us += period_us;
+}
+
+uint64_t bme280_sim_time_us(void)
+{
+	return sim_now_us;
+}
+
+void bme280_sim_reset_time(void)
+{
+	struct bme280_sim *sim;
+	uint8_t i;
+
+	sim_now_us = 0;
+	for (i = 0; i < BME280_SIM_MAX_DEVICES; i++) {
+		sim = sim_devices[i];
+		if (sim == NULL)
+			continue;
+		sim->nvm_end_us = 0;
+		sim->meas_end_us -= sim->meas_start_us;
+		sim->meas_start_us = 0;
+	}
+}
+
+uint32_t bme280_sim_meas_time_us(uint8_t osr_t, uint8_t osr_p, uint8_t osr_h)
+{
+	uint32_t meas_time = 1000 + 2000 * osr_count(osr_t);
+
+	if (osr_count(osr_p))
+		meas_time += 2000 * osr_count(osr_p) + 500;
+	if (osr_count(osr_h))
+		meas_time += 2000 * osr_count(osr_h) + 500;
+
+	return meas_time;
+}
+
+/****************** Static Function Definitions *******************************/
+
+static uint32_t osr_count(uint8_t osr)
+{
+	if (osr == BME280_NO_OVERSAMPLING)
+		return 0;
+	if (osr > BME280_OVERSAMPLING_16X)
+		osr = BME280_OVERSAMPLING_16X;
+
+	return UINT32_C(1) << (osr - 1);
+}
+
+static struct bme280_sim *find_sim(uint8_t dev_id)
+{
+	uint8_t i;
+
+	for (i = 0; i < BME280_SIM_MAX_DEVICES; i++) {
+		if ((sim_devices[i] != NULL) && (sim_devices[i]->id == dev_id))
+			return sim_devices[i];
+	}
+
+	return NULL;
+}
+
+static void power_on_reset(struct bme280_sim *sim)
+{
+	memset(sim->regs, 0, sizeof(sim->regs));
+	sim->regs[BME280_CHIP_ID_ADDR] = BME280_CHIP_ID;
+	store_calib(sim);
+
+	/* Data registers read back as "skipped" until the first conversion */
+	sim->regs[BME280_DATA_ADDR] = 0x80;
+	sim->regs[BME280_DATA_ADDR + 3] = 0x80;
+	sim->regs[BME280_DATA_ADDR + 6] = 0x80;
+
+	sim->osr_h_active = 0;
+	sim->measuring = 0;
+	sim->filter_valid = 0;
+	sim->meas_start_us = 0;
+	sim->meas_end_us = 0;
+	sim->nvm_end_us = sim_now_us + SIM_NVM_COPY_US;
+}
+
+static void store_calib(struct bme280_sim *sim)
+{
+	const struct bme280_calib_data *calib = &sim->calib;
+	uint8_t *tp = &sim->regs[BME280_TEMP_PRESS_CALIB_DATA_ADDR];
+	uint8_t *h = &sim->regs[BME280_HUMIDITY_CALIB_DATA_ADDR];
+	const uint16_t words[12] = {
+		calib->dig_T1, (uint16_t)calib->dig_T2, (uint16_t)calib->dig_T3,
+		calib->dig_P1, (uint16_t)calib->dig_P2, (uint16_t)calib->dig_P3,
+		(uint16_t)calib->dig_P4, (uint16_t)calib->dig_P5, (uint16_t)calib->dig_P6,
+		(uint16_t)calib->dig_P7, (uint16_t)calib->dig_P8, (uint16_t)calib->dig_P9
+	};
+	uint8_t i;
+
+	/* 0x88..0x9F little endian words, 0xA0 reserved, 0xA1 dig_H1 */
+	for (i = 0; i < 12; i++) {
+		tp[i * 2] = (uint8_t)(words[i] & 0xFF);
+		tp[i * 2 + 1] = (uint8_t)(words[i] >> 8);
+	}
+	tp[25] = calib->dig_H1;
+
+	/* 0xE1..0xE7, dig_H4/dig_H5 are 12 bit values sharing 0xE5 */
+	h[0] = (uint8_t)((uint16_t)calib->dig_H2 & 0xFF);
+	h[1] = (uint8_t)((uint16_t)calib->dig_H2 >> 8);
+	h[2] = calib->dig_H3;
+	h[3] = (uint8_t)(((uint16_t)calib->dig_H4 >> 4) & 0xFF);
+	h[4] = (uint8_t)((((uint16_t)calib->dig_H5 & 0x0F) << 4) | ((uint16_t)calib->dig_H4 & 0x0F));
+	h[5] = (uint8_t)(((uint16_t)calib->dig_H5 >> 4) & 0xFF);
+	h[6] = (uint8_t)calib->dig_H6;
+}
+
+static void update(struct bme280_sim *sim)
+{
+	uint8_t ctrl_meas = sim->regs[BME280_CTRL_MEAS_ADDR];
+	uint8_t mode = BME280_GET_BITS_POS_0(ctrl_meas, BME280_SENSOR_MODE);
+	uint8_t t_sb = BME280_GET_BITS(sim->regs[BME280_CONFIG_ADDR], BME280_STANDBY);
+	uint64_t meas_time;
+	uint64_t period;
+	uint64_t cycles;
+
+	if (mode == BME280_NORMAL_MODE) {
+		meas_time = sim->meas_end_us - sim->meas_start_us;
+		period = meas_time + sim_standby_us[t_sb];
+		/* Skip cycles that would be overwritten before anyone reads them */
+		if (sim_now_us > sim->meas_end_us) {
+			cycles = (sim_now_us - sim->meas_end_us) / period;
+			if (cycles > SIM_MAX_CATCHUP_CYCLES) {
+				sim->meas_start_us += (cycles - SIM_MAX_CATCHUP_CYCLES) * period;
+				sim->meas_end_us += (cycles - SIM_MAX_CATCHUP_CYCLES) * period;
+			}
+		}
+		while (sim->meas_end_us <= sim_now_us) {
+			convert(sim, sim->meas_end_us);
+			sim->meas_start_us += period;
+			sim->meas_end_us += period;
+		}
+		sim->measuring = (sim_now_us >= sim->meas_start_us);
+	} else if (sim->measuring && (sim_now_us >= sim->meas_end_us)) {
+		/* Forced conversion done, the part drops back to sleep */
+		convert(sim, sim->meas_end_us);
+		sim->measuring = 0;
+		sim->regs[BME280_CTRL_MEAS_ADDR] = BME280_SET_BITS_POS_0(ctrl_meas, BME280_SENSOR_MODE,
+				BME280_SLEEP_MODE);
+	}
+}
+
+static void convert(struct bme280_sim *sim, uint64_t at_us)
+{
+	const struct bme280_calib_data *calib = &sim->calib;
+	uint8_t ctrl_meas = sim->regs[BME280_CTRL_MEAS_ADDR];
+	uint8_t osr_t = BME280_GET_BITS(ctrl_meas, BME280_CTRL_TEMP);
+	uint8_t osr_p = BME280_GET_BITS(ctrl_meas, BME280_CTRL_PRESS);
+	uint8_t filter = BME280_GET_BITS(sim->regs[BME280_CONFIG_ADDR], BME280_FILTER);
+	uint8_t *data = &sim->regs[BME280_DATA_ADDR];
+	double temperature;
+	double pressure;
+	double humidity;
+	double coeff;
+	uint32_t raw_t;
+	uint32_t raw_p;
+	uint32_t raw_h;
+	uint32_t mask;
+	int32_t t_fine;
+
+	if (sim->env != NULL) {
+		sim->env(at_us, &temperature, &pressure, &humidity, sim->env_ctx);
+	} else {
+		temperature = trace_value(&sim->temperature, at_us);
+		pressure = trace_value(&sim->pressure, at_us);
+		humidity = trace_value(&sim->humidity, at_us);
+	}
+
+	/* Temperature is always converted internally, pressure and humidity
+	   compensation depend on it */
+	if (osr_count(osr_t))
+		temperature += gaussian(sim) * sim->temperature.noise / sqrt((double)osr_count(osr_t));
+	raw_t = invert(temperature, SIM_RAW_PT_MAX, 1, calib, 0, NULL);
+	forward_temperature(raw_t, calib, &t_fine);
+
+	raw_p = SIM_SKIPPED_PT;
+	if (osr_count(osr_p)) {
+		pressure += gaussian(sim) * sim->pressure.noise / sqrt((double)osr_count(osr_p));
+		raw_p = invert(pressure, SIM_RAW_PT_MAX, 0, calib, t_fine, forward_pressure);
+	}
+
+	raw_h = SIM_SKIPPED_H;
+	if (osr_count(sim->osr_h_active)) {
+		humidity += gaussian(sim) * sim->humidity.noise / sqrt((double)osr_count(sim->osr_h_active));
+		if (humidity < 0.0)
+			humidity = 0.0;
+		else if (humidity > 100.0)
+			humidity = 100.0;
+		raw_h = invert(humidity, SIM_RAW_H_MAX, 1, calib, t_fine, forward_humidity);
+	}
+
+	if (filter == BME280_FILTER_COEFF_OFF) {
+		/* Without the IIR filter the resolution is 16 bit + (osr - 1); the
+		   register values above 16x also mean 16x */
+		sim->filter_valid = 0;
+		if (osr_t > BME280_OVERSAMPLING_16X)
+			osr_t = BME280_OVERSAMPLING_16X;
+		if (osr_p > BME280_OVERSAMPLING_16X)
+			osr_p = BME280_OVERSAMPLING_16X;
+		if (osr_count(osr_t)) {
+			mask = SIM_RAW_PT_MAX << (5 - osr_t);
+			raw_t &= mask;
+		}
+		if (osr_count(osr_p)) {
+			mask = SIM_RAW_PT_MAX << (5 - osr_p);
+			raw_p &= mask;
+		}
+	} else {
+		/* data = (data_prev * (coeff - 1) + data_new) / coeff on the 20 bit
+		   codes, humidity is not filtered */
+		coeff = (double)(UINT32_C(1) << (filter > BME280_FILTER_COEFF_16 ? BME280_FILTER_COEFF_16 : filter));
+		if (!sim->filter_valid) {
+			sim->filter_t = raw_t;
+			sim->filter_p = raw_p;
+			sim->filter_valid = 1;
+		} else {
+			sim->filter_t = (sim->filter_t * (coeff - 1.0) + raw_t) / coeff;
+			sim->filter_p = (sim->filter_p * (coeff - 1.0) + raw_p) / coeff;
+		}
+		raw_t = (uint32_t)(sim->filter_t + 0.5);
+		if (osr_count(osr_p))
+			raw_p = (uint32_t)(sim->filter_p + 0.5);
+	}
+	if (!osr_count(osr_t))
+		raw_t = SIM_SKIPPED_PT;
+
+	/* 0xF7..0xFE: press msb/lsb/xlsb[7:4], temp msb/lsb/xlsb[7:4], hum msb/lsb */
+	data[0] = (uint8_t)(raw_p >> 12);
+	data[1] = (uint8_t)(raw_p >> 4);
+	data[2] = (uint8_t)((raw_p & 0x0F) << 4);
+	data[3] = (uint8_t)(raw_t >> 12);
+	data[4] = (uint8_t)(raw_t >> 4);
+	data[5] = (uint8_t)((raw_t & 0x0F) << 4);
+	data[6] = (uint8_t)(raw_h >> 8);
+	data[7] = (uint8_t)raw_h;
+
+	sim->conversions++;
+}
+
+static void write_reg(struct bme280_sim *sim, uint8_t reg_addr, uint8_t value)
+{
+	uint8_t mode;
+	uint8_t osr_t;
+	uint8_t osr_p;
+
+	switch (reg_addr) {
+	case BME280_RESET_ADDR:
+		if (value == SIM_SOFT_RESET_CMD)
+			power_on_reset(sim);
+		break;
+	case BME280_CTRL_HUM_ADDR:
+		sim->regs[reg_addr] = value & BME280_CTRL_HUM_MSK;
+		break;
+	case BME280_CTRL_MEAS_ADDR:
+		sim->regs[reg_addr] = value;
+		/* ctrl_hum only takes effect after a write to ctrl_meas */
+		sim->osr_h_active = sim->regs[BME280_CTRL_HUM_ADDR];
+		mode = BME280_GET_BITS_POS_0(value, BME280_SENSOR_MODE);
+		osr_t = BME280_GET_BITS(value, BME280_CTRL_TEMP);
+		osr_p = BME280_GET_BITS(value, BME280_CTRL_PRESS);
+		if (mode == BME280_SLEEP_MODE) {
+			sim->measuring = 0;
+		} else {
+			/* Forced (01 or 10) and normal mode both start converting now */
+			sim->meas_start_us = sim_now_us;
+			sim->meas_end_us = sim_now_us + bme280_sim_meas_time_us(osr_t, osr_p, sim->osr_h_active);
+			sim->measuring = 1;
+		}
+		break;
+	case BME280_CONFIG_ADDR:
+		sim->regs[reg_addr] = value & 0xFD;
+		break;
+	default:
+		/* Read-only or reserved */
+		break;
+	}
+}
+
+static double trace_value(const struct bme280_sim_trace *trace, uint64_t time_us)
+{
+	double t = (double)time_us / 1000000.0;
+	double value = trace->base + trace->slope * t;
+
+	if (trace->period_s > 0.0)
+		value += trace->amplitude * sin(2.0 * M_PI * t / trace->period_s);
+
+	return value;
+}
+
+static double gaussian(struct bme280_sim *sim)
+{
+	double u1;
+	double u2;
+
+	/* xorshift32 feeding a Box-Muller transform */
+	sim->prng ^= sim->prng << 13;
+	sim->prng ^= sim->prng >> 17;
+	sim->prng ^= sim->prng << 5;
+	u1 = ((double)sim->prng + 1.0) / 4294967297.0;
+	sim->prng ^= sim->prng << 13;
+	sim->prng ^= sim->prng >> 17;
+	sim->prng ^= sim->prng << 5;
+	u2 = (double)sim->prng / 4294967296.0;
+
+	return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static double forward_temperature(uint32_t adc_t, const struct bme280_calib_data *calib, int32_t *t_fine)
+{
+	double var1;
+	double var2;
+
+	var1 = ((double)adc_t) / 16384.0 - ((double)calib->dig_T1) / 1024.0;
+	var1 = var1 * ((double)calib->dig_T2);
+	var2 = (((double)adc_t) / 131072.0 - ((double)calib->dig_T1) / 8192.0);
+	var2 = (var2 * var2) * ((double)calib->dig_T3);
+	if (t_fine != NULL)
+		*t_fine = (int32_t)(var1 + var2);
+
+	return (var1 + var2) / 5120.0;
+}
+
+static double forward_pressure(uint32_t adc_p, const struct bme280_calib_data *calib, int32_t t_fine)
+{
+	double var1;
+	double var2;
+	double var3;
+	double pressure;
+
+	var1 = ((double)t_fine / 2.0) - 64000.0;
+	var2 = var1 * var1 * ((double)calib->dig_P6) / 32768.0;
+	var2 = var2 + var1 * ((double)calib->dig_P5) * 2.0;
+	var2 = (var2 / 4.0) + (((double)calib->dig_P4) * 65536.0);
+	var3 = ((double)calib->dig_P3) * var1 * var1 / 524288.0;
+	var1 = (var3 + ((double)calib->dig_P2) * var1) / 524288.0;
+	var1 = (1.0 + var1 / 32768.0) * ((double)calib->dig_P1);
+	if (var1 == 0.0)
+		return 0.0;
+	pressure = 1048576.0 - (double)adc_p;
+	pressure = (pressure - (var2 / 4096.0)) * 6250.0 / var1;
+	var1 = ((double)calib->dig_P9) * pressure * pressure / 2147483648.0;
+	var2 = pressure * ((double)calib->dig_P8) / 32768.0;
+
+	return pressure + (var1 + var2 + ((double)calib->dig_P7)) / 16.0;
+}
+
+static double forward_humidity(uint32_t adc_h, const struct bme280_calib_data *calib, int32_t t_fine)
+{
+	double var1;
+	double var2;
+	double var3;
+	double var4;
+	double var5;
+	double var6;
+
+	var1 = ((double)t_fine) - 76800.0;
+	var2 = (((double)calib->dig_H4) * 64.0 + (((double)calib->dig_H5) / 16384.0) * var1);
+	var3 = adc_h - var2;
+	var4 = ((double)calib->dig_H2) / 65536.0;
+	var5 = (1.0 + (((double)calib->dig_H3) / 67108864.0) * var1);
+	var6 = 1.0 + (((double)calib->dig_H6) / 67108864.0) * var1 * var5;
+	var6 = var3 * var4 * (var5 * var6);
+
+	return var6 * (1.0 - ((double)calib->dig_H1) * var6 / 524288.0);
+}
+
+static double forward_temperature_code(uint32_t adc_t, const struct bme280_calib_data *calib, int32_t t_fine)
+{
+	(void)t_fine;
+
+	return forward_temperature(adc_t, calib, NULL);
+}
+
+static uint32_t invert(double target, uint32_t max_code, uint8_t rising, const struct bme280_calib_data *calib,
+		int32_t t_fine, double (*fwd)(uint32_t, const struct bme280_calib_data *, int32_t))
+{
+	uint32_t lo = 0;
+	uint32_t hi = max_code;
+	uint32_t mid;
+	double value;
+
+	if (fwd == NULL)
+		fwd = forward_temperature_code;
+
+	/* Smallest code whose value is at or past the target */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		value = fwd(mid, calib, t_fine);
+		if (rising ? (value < target) : (value > target))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	/* The previous code may be closer */
+	if ((lo > 0) && (fabs(fwd(lo - 1, calib, t_fine) - target) < fabs(fwd(lo, calib, t_fine) - target)))
+		lo--;
+
+	return lo;
+}
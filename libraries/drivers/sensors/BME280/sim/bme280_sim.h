@@ -0,0 +1,213 @@
+/*! @file bme280_sim.h
+    @brief Register level BME280 simulator for board-less builds */
+/*!
+ * @defgroup BME280 SIMULATOR
+ * @brief
+ * The simulator implements the bme280_dev read, write and delay_ms
+ * callbacks on top of a model of the BME280 register map. Temperature,
+ * pressure and humidity follow configurable traces and are converted back
+ * into raw ADC codes through the device trimming parameters, so the stock
+ * driver, the WICED wrapper logic and the applications can be exercised on
+ * a Linux host without a Nebula board.
+ *
+ * Time is virtual: it only advances through bme280_sim_delay_ms(),
+ * bme280_sim_advance_us() and (optionally) the modelled bus transfer time,
+ * so benchmarks run at full host speed while keeping datasheet timing.
+ * @{*/
+#ifndef BME280_SIM_H_
+#define BME280_SIM_H_
+
+/*! CPP guard */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Header includes */
+#include "bme280_defs.h"
+
+/**\name Simulator limits */
+#define BME280_SIM_MAX_DEVICES		UINT8_C(4)
+#define BME280_SIM_REG_COUNT		UINT16_C(256)
+
+/*!
+ * @brief Trace of one physical quantity over virtual time.
+ *
+ * value(t) = base + slope * t + amplitude * sin(2 * pi * t / period_s),
+ * plus gaussian noise of RMS @ref noise at 1x oversampling. The noise RMS
+ * shrinks with the square root of the oversampling ratio, as on the part.
+ */
+struct bme280_sim_trace {
+	/*! Value at t = 0 (degC, Pa or %RH) */
+	double base;
+	/*! Linear drift per second */
+	double slope;
+	/*! Sinusoid amplitude */
+	double amplitude;
+	/*! Sinusoid period in seconds, 0 disables the sinusoid */
+	double period_s;
+	/*! RMS noise at 1x oversampling */
+	double noise;
+};
+
+/*!
+ * @brief Optional environment callback. When set it overrides the traces and
+ * must fill in the noise-free temperature (degC), pressure (Pa) and humidity
+ * (%RH) at the given virtual time.
+ */
+typedef void (*bme280_sim_env_fptr_t)(uint64_t time_us, double *temperature, double *pressure,
+		double *humidity, void *ctx);
+
+/*!
+ * @brief Simulated BME280 instance.
+ *
+ * Fill in the configuration part (or call bme280_sim_set_defaults()), then
+ * bme280_sim_init() it. The state and statistics parts are owned by the
+ * simulator.
+ */
+struct bme280_sim {
+	/* Configuration */
+	/*! Device id the driver passes to the callbacks (I2C address or CS index) */
+	uint8_t id;
+	/*! SPI/I2C interface, selects the register address decoding */
+	enum bme280_intf interface;
+	/*! Trimming parameters exposed at 0x88..0xA1 and 0xE1..0xE7 */
+	struct bme280_calib_data calib;
+	/*! Temperature trace (degC) */
+	struct bme280_sim_trace temperature;
+	/*! Pressure trace (Pa) */
+	struct bme280_sim_trace pressure;
+	/*! Humidity trace (%RH) */
+	struct bme280_sim_trace humidity;
+	/*! Optional environment callback, overrides the traces */
+	bme280_sim_env_fptr_t env;
+	/*! Context handed to the environment callback */
+	void *env_ctx;
+	/*! Modelled bus time per transferred byte in microseconds, 0 for none */
+	uint32_t bus_us_per_byte;
+	/*! Noise generator seed */
+	uint32_t seed;
+
+	/* State */
+	/*! Register file */
+	uint8_t regs[BME280_SIM_REG_COUNT];
+	/*! Humidity oversampling latched by the last ctrl_meas write */
+	uint8_t osr_h_active;
+	/*! Non-zero while a conversion is in progress */
+	uint8_t measuring;
+	/*! Non-zero once the IIR filter holds a value */
+	uint8_t filter_valid;
+	/*! Start of the current conversion */
+	uint64_t meas_start_us;
+	/*! End of the current conversion */
+	uint64_t meas_end_us;
+	/*! End of the NVM copy after reset */
+	uint64_t nvm_end_us;
+	/*! IIR filter state for pressure and temperature raw codes */
+	double filter_p;
+	double filter_t;
+	/*! Noise generator state */
+	uint32_t prng;
+
+	/* Statistics */
+	/*! Number of read transactions */
+	uint32_t reads;
+	/*! Number of write transactions */
+	uint32_t writes;
+	/*! Number of bytes transferred in either direction */
+	uint32_t bytes;
+	/*! Number of completed conversions */
+	uint32_t conversions;
+};
+
+/*!
+ * @brief This API fills a simulator instance with a typical configuration:
+ * datasheet example trimming parameters, an indoor environment
+ * (22 degC, 1013.25 hPa, 45 %RH) and datasheet noise figures.
+ *
+ * @param[out] sim : Simulator instance.
+ * @param[in] id : Device id the driver will use.
+ * @param[in] interface : SPI/I2C interface.
+ */
+void bme280_sim_set_defaults(struct bme280_sim *sim, uint8_t id, enum bme280_intf interface);
+
+/*!
+ * @brief This API performs a power-on reset of the simulator instance and
+ * registers it so the callbacks can find it by device id.
+ *
+ * @param[in,out] sim : Simulator instance.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / -ve value -> Error
+ */
+int8_t bme280_sim_init(struct bme280_sim *sim);
+
+/*!
+ * @brief This API unregisters a simulator instance.
+ *
+ * @param[in] sim : Simulator instance.
+ */
+void bme280_sim_deinit(struct bme280_sim *sim);
+
+/*!
+ * @brief This API points the bus and delay callbacks of a bme280_dev at the
+ * simulator instance.
+ *
+ * @param[in] sim : Simulator instance.
+ * @param[out] dev : Structure instance of bme280_dev.
+ */
+void bme280_sim_attach(const struct bme280_sim *sim, struct bme280_dev *dev);
+
+/*!
+ * @brief Read callback, signature of @ref bme280_com_fptr_t.
+ */
+int8_t bme280_sim_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len);
+
+/*!
+ * @brief Write callback, signature of @ref bme280_com_fptr_t. Accepts the
+ * interleaved address/data layout bme280_set_regs() uses for burst writes.
+ */
+int8_t bme280_sim_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len);
+
+/*!
+ * @brief Delay callback, signature of @ref bme280_delay_fptr_t. Advances the
+ * virtual clock without sleeping.
+ */
+void bme280_sim_delay_ms(uint32_t period);
+
+/*!
+ * @brief This API advances the virtual clock.
+ *
+ * @param[in] period_us : Number of microseconds to advance.
+ */
+void bme280_sim_advance_us(uint64_t period_us);
+
+/*!
+ * @brief This API returns the virtual clock.
+ *
+ * @return Microseconds since the clock was last reset.
+ */
+uint64_t bme280_sim_time_us(void);
+
+/*!
+ * @brief This API resets the virtual clock to zero. Registered instances
+ * keep their register contents but any conversion in flight is restarted.
+ */
+void bme280_sim_reset_time(void);
+
+/*!
+ * @brief This API returns the typical measurement time for the given
+ * oversampling settings, as given in datasheet section 9.1.
+ *
+ * @param[in] osr_t : Temperature oversampling macro.
+ * @param[in] osr_p : Pressure oversampling macro.
+ * @param[in] osr_h : Humidity oversampling macro.
+ *
+ * @return Measurement time in microseconds.
+ */
+uint32_t bme280_sim_meas_time_us(uint8_t osr_t, uint8_t osr_p, uint8_t osr_h);
+
+#ifdef __cplusplus
+}
+#endif /* End of CPP guard */
+#endif /* BME280_SIM_H_ */
+/** @}*/
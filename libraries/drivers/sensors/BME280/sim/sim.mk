@@ -0,0 +1,11 @@
+#
+# Register level BME280 simulator. Link it instead of a bus wrapper to run
+# the driver and the applications without a sensor attached; the sources are
+# plain C99 and also build on a Linux host (see ../README.md).
+#
+
+NAME := Lib_BME280_Sim
+
+$(NAME)_SOURCES := bme280_sim.c
+$(NAME)_COMPONENTS := drivers/sensors/BME280
+GLOBAL_INCLUDES := .
@@ -84,6 +84,9 @@ GLOBAL_DEFINES += $$(if $$(NO_CRLF_STDIO_REPLACEMENT),,CRLF_STDIO_REPLACEMENT)
 
 GLOBAL_DEFINES += WICED_DCT_INCLUDE_BT_CONFIG
 
+# platform_shared_dma.h arbitrates the DMA streams shared between the SPI and I2C ports
+GLOBAL_DEFINES += PLATFORM_HAS_SHARED_DMA_LOCKS
+
 # Components
 $(NAME)_COMPONENTS += drivers/spi_flash \
                       inputs/gpio_button
@@ -47,6 +47,7 @@
 #include "platform_mfi.h"
 #include "platform_button.h"
 #include "gpio_button.h"
+#include "platform_shared_dma.h"
 
 /******************************************************
  *                      Macros
@@ -64,6 +65,12 @@
  *                 Type Definitions
  ******************************************************/
 
+typedef struct
+{
+    DMA_Stream_TypeDef* stream;
+    volatile uint32_t   owner;  /* Peripheral currently transferring on the stream, 0 if free */
+} platform_shared_dma_lock_t;
+
 /******************************************************
  *                    Structures
  ******************************************************/
@@ -72,10 +79,21 @@
  *               Static Function Declarations
  ******************************************************/
 
+static platform_result_t platform_shared_dma_claim  ( DMA_Stream_TypeDef* stream, uint32_t owner );
+static void              platform_shared_dma_release( DMA_Stream_TypeDef* stream, uint32_t owner );
+
 /******************************************************
  *               Variable Definitions
  ******************************************************/
 
+/* DMA streams used by more than one peripheral. Used by platform_shared_dma.h */
+static platform_shared_dma_lock_t platform_shared_dma_locks[] =
+{
+    { .stream = DMA2_Stream0, .owner = 0 }, /* WICED_SPI_1 RX & WICED_SPI_3 RX */
+    { .stream = DMA2_Stream5, .owner = 0 }, /* WICED_SPI_1 TX & WICED_SPI_4 TX */
+    { .stream = DMA1_Stream7, .owner = 0 }, /* WICED_I2C_1 TX & WICED_I2C_2 TX */
+};
+
 /* GPIO pin table. Used by WICED/platform/MCU/wiced_platform_common.c */
 const platform_gpio_t platform_gpio_pins[] =
 {
@@ -765,6 +783,118 @@ uint32_t  platform_get_factory_reset_button_time ( uint32_t max_time )
     return platform_get_button_press_time ( PLATFORM_FACTORY_RESET_BUTTON_INDEX, PLATFORM_RED_LED_INDEX, max_time );
 }
 
+platform_result_t platform_spi_dma_lock( wiced_spi_t port )
+{
+    const platform_spi_t* spi;
+
+    if ( port >= WICED_SPI_MAX )
+    {
+        return PLATFORM_BADARG;
+    }
+
+    spi = &platform_spi_peripherals[port];
+    if ( platform_shared_dma_claim( spi->rx_dma.stream, (uint32_t)spi ) != PLATFORM_SUCCESS )
+    {
+        return PLATFORM_ERROR;
+    }
+    if ( platform_shared_dma_claim( spi->tx_dma.stream, (uint32_t)spi ) != PLATFORM_SUCCESS )
+    {
+        platform_shared_dma_release( spi->rx_dma.stream, (uint32_t)spi );
+        return PLATFORM_ERROR;
+    }
+    return PLATFORM_SUCCESS;
+}
+
+void platform_spi_dma_unlock( wiced_spi_t port )
+{
+    const platform_spi_t* spi;
+
+    if ( port < WICED_SPI_MAX )
+    {
+        spi = &platform_spi_peripherals[port];
+        platform_shared_dma_release( spi->tx_dma.stream, (uint32_t)spi );
+        platform_shared_dma_release( spi->rx_dma.stream, (uint32_t)spi );
+    }
+}
+
+platform_result_t platform_i2c_dma_lock( wiced_i2c_t port )
+{
+    const platform_i2c_t* i2c;
+
+    if ( port >= WICED_I2C_MAX )
+    {
+        return PLATFORM_BADARG;
+    }
+
+    i2c = &platform_i2c_peripherals[port];
+    if ( platform_shared_dma_claim( i2c->rx_dma_stream, (uint32_t)i2c ) != PLATFORM_SUCCESS )
+    {
+        return PLATFORM_ERROR;
+    }
+    if ( platform_shared_dma_claim( i2c->tx_dma_stream, (uint32_t)i2c ) != PLATFORM_SUCCESS )
+    {
+        platform_shared_dma_release( i2c->rx_dma_stream, (uint32_t)i2c );
+        return PLATFORM_ERROR;
+    }
+    return PLATFORM_SUCCESS;
+}
+
+void platform_i2c_dma_unlock( wiced_i2c_t port )
+{
+    const platform_i2c_t* i2c;
+
+    if ( port < WICED_I2C_MAX )
+    {
+        i2c = &platform_i2c_peripherals[port];
+        platform_shared_dma_release( i2c->tx_dma_stream, (uint32_t)i2c );
+        platform_shared_dma_release( i2c->rx_dma_stream, (uint32_t)i2c );
+    }
+}
+
+static platform_result_t platform_shared_dma_claim( DMA_Stream_TypeDef* stream, uint32_t owner )
+{
+    platform_result_t result = PLATFORM_SUCCESS;
+    uint32_t          primask;
+    uint32_t          i;
+
+    for ( i = 0; i < sizeof( platform_shared_dma_locks ) / sizeof( platform_shared_dma_locks[0] ); i++ )
+    {
+        if ( platform_shared_dma_locks[i].stream == stream )
+        {
+            /* Test and set with interrupts masked, the locks may be taken from any thread */
+            primask = __get_PRIMASK( );
+            __disable_irq( );
+            if ( platform_shared_dma_locks[i].owner == 0 )
+            {
+                platform_shared_dma_locks[i].owner = owner;
+            }
+            else
+            {
+                result = PLATFORM_ERROR;
+            }
+            __set_PRIMASK( primask );
+            break;
+        }
+    }
+
+    /* Streams that are not shared are always available */
+    return result;
+}
+
+static void platform_shared_dma_release( DMA_Stream_TypeDef* stream, uint32_t owner )
+{
+    uint32_t i;
+
+    for ( i = 0; i < sizeof( platform_shared_dma_locks ) / sizeof( platform_shared_dma_locks[0] ); i++ )
+    {
+        if ( ( platform_shared_dma_locks[i].stream == stream ) && ( platform_shared_dma_locks[i].owner == owner ) )
+        {
+            platform_shared_dma_locks[i].owner = 0;
+            break;
+        }
+    }
+}
+
 /******************************************************
  *           Interrupt Handler Definitions
  ******************************************************/
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2017, Cypress Semiconductor Corporation or a subsidiary of 
+ * Cypress Semiconductor Corporation. All Rights Reserved.
+ * 
+ * This software, associated documentation and materials ("Software"),
+ * is owned by Cypress Semiconductor Corporation
+ * or one of its subsidiaries ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products. Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ * Arbitration of the DMA streams that are shared between peripherals of the NEB1DX_02 board
+ *
+ * The STM32F429 has only sixteen DMA streams, so some peripherals of this board are mapped onto
+ * the same stream on different channels (see platform_spi_peripherals[] and
+ * platform_i2c_peripherals[] in platform.c):
+ *
+ *   DMA2_Stream0 : WICED_SPI_1 RX (channel 3, serial flash) & WICED_SPI_3 RX (channel 4, mikroBUS)
+ *   DMA2_Stream5 : WICED_SPI_1 TX (channel 3, serial flash) & WICED_SPI_4 TX (channel 1)
+ *   DMA1_Stream7 : WICED_I2C_1 TX (channel 1, auth chip)    & WICED_I2C_2 TX (channel 7, mikroBUS)
+ *
+ * A stream can only serve one channel at a time. Drivers that transfer with DMA on one of these
+ * ports take the lock of the port for the duration of the transfer and fall back to a CPU driven
+ * transfer when the other peripheral owns the stream. Ports without a shared stream always get the lock.
+ * The locks never block and may be taken from any thread. The serial flash driver transfers without
+ * DMA (SPI_NO_DMA) and never holds the WICED_SPI_1 streams; a driver that enables DMA on a port listed
+ * above must take its lock as well.
+ */
+#pragma once
+
+#include "platform_peripheral.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+
+/**
+ * Claim the DMA streams of an SPI port
+ *
+ * @param[in] port : The SPI port
+ *
+ * @return PLATFORM_SUCCESS if the caller may transfer with DMA, PLATFORM_ERROR if a stream is
+ *         used by another port, PLATFORM_BADARG for an invalid port
+ */
+platform_result_t platform_spi_dma_lock( wiced_spi_t port );
+
+/**
+ * Release the DMA streams claimed by platform_spi_dma_lock()
+ *
+ * @param[in] port : The SPI port
+ */
+void platform_spi_dma_unlock( wiced_spi_t port );
+
+/**
+ * Claim the DMA streams of an I2C port
+ *
+ * @param[in] port : The I2C port
+ *
+ * @return PLATFORM_SUCCESS if the caller may transfer with DMA, PLATFORM_ERROR if a stream is
+ *         used by another port, PLATFORM_BADARG for an invalid port
+ */
+platform_result_t platform_i2c_dma_lock( wiced_i2c_t port );
+
+/**
+ * Release the DMA streams claimed by platform_i2c_dma_lock()
+ *
+ * @param[in] port : The I2C port
+ */
+void platform_i2c_dma_unlock( wiced_i2c_t port );
+
+#ifdef __cplusplus
+} /*extern "C" */
+#endif